@@ -418,6 +418,9 @@ autoip4_supplicant(void)
 
 	autoip4_register_services(autoip4_dbus_server);
 
+	/* remove temporary lease files left behind by a crash */
+	ni_addrconf_lease_file_cleanup();
+
 	/* open global RTNL socket to listen for kernel events */
 	if (ni_server_listen_interface_events(autoip4_interface_event) < 0)
 		ni_fatal("unable to initialize netlink listener");
@@ -454,6 +457,9 @@ autoip4_supplicant(void)
 	autoip4_device_destroy_all(autoip4_dbus_server);
 	ni_dbus_objects_garbage_collect();
 
+	/* sync the directories of the written lease files */
+	ni_addrconf_lease_file_flush();
+
 	ni_socket_deactivate_all();
 }
 
@@ -1327,12 +1327,17 @@ ni_wireless_blob_to_xml(ni_wireless_blob_t *blob, const char *name, xml_node_t *
 		xml_node_set_cdata(xml, blob->str);
 	} else {
 		size_t hex_len = blob->byte_array.len * 2 + 1;
-		ni_string_free(&xml->cdata);
-		if (!(xml->cdata = malloc(hex_len)))
+		char *hex;
+
+		if (!(hex = malloc(hex_len)))
 			goto error;
 
-		if (ni_format_hex_data(blob->byte_array.data, blob->byte_array.len, xml->cdata, hex_len, NULL, FALSE) != 0)
+		if (ni_format_hex_data(blob->byte_array.data, blob->byte_array.len, hex, hex_len, NULL, FALSE) != 0) {
+			free(hex);
 			goto error;
+		}
+		xml_node_set_cdata(xml, hex);
+		free(hex);
 
 		xml_node_add_attr(xml, "type", "hex");
 	}
@@ -466,6 +466,9 @@ dhcp4_supplicant(void)
 
 	dhcp4_register_services(dhcp4_dbus_server);
 
+	/* remove temporary lease files left behind by a crash */
+	ni_addrconf_lease_file_cleanup();
+
 	/* open global RTNL socket to listen for kernel events */
 	if (ni_server_listen_interface_events(dhcp4_interface_event) < 0)
 		ni_fatal("unable to initialize netlink link listener");
@@ -510,6 +513,9 @@ dhcp4_supplicant(void)
 	dhcp4_device_destroy_all(dhcp4_dbus_server);
 	ni_dbus_objects_garbage_collect();
 
+	/* sync the directories of the written lease files */
+	ni_addrconf_lease_file_flush();
+
 	ni_socket_deactivate_all();
 }
 
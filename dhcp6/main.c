@@ -438,6 +438,9 @@ dhcp6_supplicant(void)
 
 	dhcp6_register_services(dhcp6_dbus_server);
 
+	/* remove temporary lease files left behind by a crash */
+	ni_addrconf_lease_file_cleanup();
+
 	/* open global RTNL socket to listen for kernel events */
 	if (ni_server_listen_interface_events(dhcp6_interface_event) < 0)
 		ni_fatal("Unable to initialize netlink interface event listener");
@@ -488,6 +491,9 @@ dhcp6_supplicant(void)
 	dhcp6_device_destroy_all(dhcp6_dbus_server);
 	ni_dbus_objects_garbage_collect();
 
+	/* sync the directories of the written lease files */
+	ni_addrconf_lease_file_flush();
+
 	ni_socket_deactivate_all();
 }
 
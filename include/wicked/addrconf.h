@@ -38,9 +38,18 @@ enum {
 	NI_ADDRCONF_UPDATER_GENERIC,
 	NI_ADDRCONF_UPDATER_HOSTNAME,
 	NI_ADDRCONF_UPDATER_RESOLVER,
+	NI_ADDRCONF_UPDATER_NIS,
 	__NI_ADDRCONF_UPDATER_MAX
 };
 
+/*
+ * Lease updater backend, scripts or builtin
+ */
+enum {
+	NI_ADDRCONF_UPDATER_BACKEND_SCRIPT,
+	NI_ADDRCONF_UPDATER_BACKEND_BUILTIN,
+};
+
 /*
  * Lease updater format, leaseinfo only for now
  */
@@ -227,6 +236,8 @@ extern int		ni_addrconf_lease_file_write(const char *, ni_addrconf_lease_t *);
 extern ni_addrconf_lease_t *ni_addrconf_lease_file_read(const char *, int, int);
 extern ni_bool_t	ni_addrconf_lease_file_exists(const char *, int, int);
 extern void		ni_addrconf_lease_file_remove(const char *, int, int);
+extern int		ni_addrconf_lease_file_flush(void);
+extern void		ni_addrconf_lease_file_cleanup(void);
 
 extern int		ni_addrconf_lease_to_xml(const ni_addrconf_lease_t *, xml_node_t **, const char *);
 extern int		ni_addrconf_lease_from_xml(ni_addrconf_lease_t **, const xml_node_t *, const char *);
@@ -83,6 +83,7 @@ extern ni_bool_t	ni_sockaddr_is_multicast(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_specified(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_is_unspecified(const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_equal(const ni_sockaddr_t *, const ni_sockaddr_t *);
+extern unsigned int	ni_sockaddr_hash(const ni_sockaddr_t *);
 extern int		ni_sockaddr_compare(const ni_sockaddr_t *, const ni_sockaddr_t *);
 extern ni_bool_t	ni_sockaddr_prefix_match(unsigned int, const ni_sockaddr_t *, const ni_sockaddr_t *);
 
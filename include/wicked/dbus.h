@@ -23,6 +23,7 @@ typedef struct ni_dbus_dict_entry ni_dbus_dict_entry_t;
 typedef struct ni_dbus_method	ni_dbus_method_t;
 typedef struct ni_dbus_property	ni_dbus_property_t;
 typedef struct ni_dbus_variant	ni_dbus_variant_t;
+typedef struct ni_dbus_dispatch	ni_dbus_dispatch_t;
 
 struct ni_dbus_variant {
 	/* the dbus type of this value */
@@ -146,6 +147,7 @@ struct ni_dbus_object {
 	void *			handle;		/* local object */
 	ni_dbus_object_t *	children;
 	const ni_dbus_service_t **interfaces;
+	ni_dbus_dispatch_t *	interface_dispatch;	/* interfaces by name */
 
 	ni_dbus_server_object_t *server_object;
 	ni_dbus_client_object_t *client_object;
@@ -167,6 +169,8 @@ extern ni_dbus_object_t *	ni_dbus_server_find_object_by_handle(ni_dbus_server_t
 extern dbus_bool_t		ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 					const char *interface, const char *signal_name,
 					unsigned int nargs, const ni_dbus_variant_t *args);
+extern void			ni_dbus_server_send_properties_changed(ni_dbus_server_t *);
+extern void			ni_dbus_object_properties_changed(ni_dbus_object_t *);
 
 extern dbus_bool_t		ni_dbus_class_is_subclass(const ni_dbus_class_t *sub, const ni_dbus_class_t *super);
 
@@ -186,6 +190,7 @@ extern const ni_dbus_method_t *	ni_dbus_service_get_method(const ni_dbus_service
 					const char *name);
 extern const ni_dbus_method_t *	ni_dbus_service_get_signal(const ni_dbus_service_t *service,
 					const char *name);
+extern void			ni_dbus_service_index(const ni_dbus_service_t *service);
 extern ni_bool_t		ni_dbus_objects_garbage_collect(void);
 
 extern ni_dbus_server_t *	ni_dbus_object_get_server(const ni_dbus_object_t *);
@@ -390,6 +395,8 @@ extern ni_dbus_message_t *	ni_dbus_object_call_new_va(const ni_dbus_object_t *ob
 
 extern dbus_bool_t		ni_dbus_object_get_managed_objects(ni_dbus_object_t *, DBusError *, ni_bool_t purge);
 extern dbus_bool_t		ni_dbus_object_refresh_properties(ni_dbus_object_t *, const ni_dbus_service_t *, DBusError *);
+extern void			ni_dbus_client_track_properties(ni_dbus_client_t *, ni_dbus_object_t *);
+extern ni_bool_t		ni_dbus_object_properties_current(const ni_dbus_object_t *);
 extern dbus_bool_t		ni_dbus_object_send_property(ni_dbus_object_t *proxy,
 					const char *service_name,
 					const char *property_name,
@@ -263,12 +263,36 @@ typedef struct ni_ethtool_pause {
 	ni_tristate_t			autoneg;
 } ni_ethtool_pause_t;
 
+/*
+ * categories of the device ethtool cache
+ */
+typedef enum {
+	NI_ETHTOOL_CACHE_PRIV_FLAGS	= NI_BIT(0),
+	NI_ETHTOOL_CACHE_LINK_DETECTED	= NI_BIT(1),
+	NI_ETHTOOL_CACHE_LINK_SETTINGS	= NI_BIT(2),
+	NI_ETHTOOL_CACHE_WAKE_ON_LAN	= NI_BIT(3),
+	NI_ETHTOOL_CACHE_FEATURES	= NI_BIT(4),
+	NI_ETHTOOL_CACHE_EEE		= NI_BIT(5),
+	NI_ETHTOOL_CACHE_RING		= NI_BIT(6),
+	NI_ETHTOOL_CACHE_CHANNELS	= NI_BIT(7),
+	NI_ETHTOOL_CACHE_COALESCE	= NI_BIT(8),
+	NI_ETHTOOL_CACHE_PAUSE		= NI_BIT(9),
+
+	NI_ETHTOOL_CACHE_ALL		= NI_BIT(10) - 1,
+} ni_ethtool_cache_t;
+
 /*
  * device ethtool structure
  */
 struct ni_ethtool {
 	ni_bitfield_t			supported;
 
+	/* categories valid while changes are monitored */
+	struct {
+		unsigned int		valid;
+		ni_bool_t		carrier;
+	} cache;
+
 	/* read-only info        */
 	ni_ethtool_driver_info_t *	driver_info;
 	ni_tristate_t			link_detected;
@@ -287,6 +311,8 @@ struct ni_ethtool {
 
 extern ni_ethtool_t *			ni_ethtool_new(void);
 extern void				ni_ethtool_free(ni_ethtool_t *);
+extern void				ni_ethtool_invalidate(ni_ethtool_t *, unsigned int);
+extern void				ni_ethtool_set_monitored(ni_bool_t);
 
 extern ni_ethtool_driver_info_t *	ni_netdev_get_ethtool_driver_info(ni_netdev_t *);
 extern ni_ethtool_driver_info_t *	ni_ethtool_driver_info_new(void);
@@ -52,6 +52,7 @@ typedef struct ni_ifworker		ni_ifworker_t;
 typedef struct ni_fsm_event		ni_fsm_event_t;
 typedef struct ni_fsm_require		ni_fsm_require_t;
 typedef struct ni_fsm_policy		ni_fsm_policy_t;
+typedef struct ni_fsm_policy_index	ni_fsm_policy_index_t;
 typedef int				ni_fsm_policy_compare_fn_t(const ni_fsm_policy_t *, const ni_fsm_policy_t *);
 
 typedef struct ni_fsm_policy_array {
@@ -148,7 +149,9 @@ struct ni_ifworker {
 				done		: 1,
 				kickstarted	: 1,
 				pending		: 1,
-				readonly	: 1;
+				readonly	: 1,
+				queued		: 1,
+				deferred	: 1;
 
 	ni_fsm_policy_array_t	policies;
 
@@ -266,6 +269,7 @@ struct ni_fsm {
 	} process_event;
 
 	ni_fsm_policy_t *	policies;
+	ni_fsm_policy_index_t *	policy_index;
 
 	ni_dbus_object_t *	client_root_object;
 };
@@ -301,6 +305,7 @@ extern void			ni_fsm_policy_free(ni_fsm_policy_t *);
 extern ni_bool_t		ni_fsm_policy_update(ni_fsm_policy_t *, xml_node_t *);
 extern ni_bool_t		ni_fsm_policy_remove(ni_fsm_t *, ni_fsm_policy_t *);
 extern ni_fsm_policy_t *	ni_fsm_policy_by_name(const ni_fsm_t *, const char *);
+extern void			ni_fsm_policy_index_free(ni_fsm_t *);
 extern int			ni_fsm_policy_compare_weight(const ni_fsm_policy_t *, const ni_fsm_policy_t *);
 extern unsigned int		ni_fsm_policy_get_applicable_policies(const ni_fsm_t *, ni_ifworker_t *,
 						const ni_fsm_policy_t **, unsigned int);
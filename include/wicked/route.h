@@ -182,6 +182,7 @@ extern ni_bool_t		ni_route_equal_options(const ni_route_t *, const ni_route_t *)
 extern ni_bool_t		ni_route_equal_gateways(const ni_route_t *, const ni_route_t *);
 extern ni_bool_t		ni_route_equal_pref_source(const ni_route_t *, const ni_route_t *);
 extern ni_bool_t		ni_route_equal_destination(const ni_route_t *, const ni_route_t *);
+extern unsigned int		ni_route_destination_hash(const ni_route_t *);
 extern const char *		ni_route_print(ni_stringbuf_t *, const ni_route_t *);
 
 extern const char *		ni_route_type_type_to_name(unsigned int);
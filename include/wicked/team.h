@@ -240,6 +240,7 @@ struct ni_team {
 
 extern ni_team_t *				ni_team_new();
 extern void					ni_team_free(ni_team_t *);
+extern ni_team_t *				ni_team_clone(const ni_team_t *);
 
 extern void					ni_team_runner_init(ni_team_runner_t *, ni_team_runner_type_t);
 extern void					ni_team_runner_destroy(ni_team_runner_t *);
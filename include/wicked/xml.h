@@ -65,6 +65,9 @@ struct xml_node {
 	struct xml_node *	children;
 
 	xml_location_t *	location;
+
+	/* Set when allocated by the reader from a document arena */
+	struct xml_arena *	arena;
 };
 
 typedef struct xml_node_array	xml_node_array_t;
@@ -110,6 +113,7 @@ extern int		xml_node_content_uuid(const xml_node_t *, unsigned int, const ni_uui
 extern int		xml_node_print_fn(const xml_node_t *, void (*)(const char *, void *), void *);
 extern int		xml_node_print_debug(const xml_node_t *, unsigned int facility);
 extern xml_node_t *	xml_node_scan(FILE *fp, const char *location);
+extern void		xml_node_set_name(xml_node_t *, const char *);
 extern void		xml_node_set_cdata(xml_node_t *, const char *);
 extern void		xml_node_set_int(xml_node_t *, int);
 extern void		xml_node_set_int64(xml_node_t *, int64_t);
@@ -287,13 +287,19 @@ babysit(void)
 	while (!ni_caught_terminal_signal()) {
 		long timeout = NI_IFWORKER_INFINITE_TIMEOUT;
 
-		do {
-			ni_fsm_do(mgr->fsm, &timeout);
+		ni_fsm_do(mgr->fsm, &timeout);
+
+		/* one batch of rechecks per turn, then run the armed workers */
 #if 0
-		} while (ni_nanny_recheck_do(mgr) || ni_nanny_down_do(mgr));
+		if (ni_nanny_recheck_do(mgr) || ni_nanny_down_do(mgr))
 #else
-		} while (ni_nanny_recheck_do(mgr));
+		if (ni_nanny_recheck_do(mgr))
 #endif
+			ni_fsm_do(mgr->fsm, &timeout);
+
+		/* more rechecks queued, just poll for events */
+		if (ni_nanny_recheck_pending(mgr))
+			timeout = 0;
 
 		if (ni_socket_wait(timeout) != 0)
 			ni_fatal("ni_socket_wait failed");
@@ -132,6 +132,9 @@ ni_nanny_free(ni_nanny_t *mgr)
 		}
 	}
 
+	ni_nanny_queue_destroy(&mgr->recheck);
+	ni_nanny_queue_destroy(&mgr->down);
+
 	ni_fatal("%s(): incomplete", __func__);
 }
 
@@ -143,19 +146,114 @@ ni_nanny_free(ni_nanny_t *mgr)
  *
  * Two, all enabled devices are checked when policies have been updated.
  *
- * Both checks happen once per mainloop iteration.
+ * Both checks happen in the mainloop, in batches of at most
+ * NI_NANNY_RECHECK_BATCH devices per pass. The rest stays queued
+ * until the fsm and the pending events have been processed.
+ *
+ * Devices without an applicable policy (yet), e.g. because their
+ * match conditions or references are not satisfied, are waiting
+ * and checked again in the next pass after the queue is done.
  */
+#define NI_NANNY_RECHECK_BATCH	64
+
+static unsigned int
+ni_nanny_queue_hash(const ni_ifworker_t *w)
+{
+	return ni_hash_data(&w, sizeof(w));
+}
+
+static ni_bool_t
+ni_nanny_queue_match(const void *data, const void *key)
+{
+	return data == key;
+}
+
+ni_bool_t
+ni_nanny_is_scheduled(const ni_nanny_queue_t *queue, const ni_ifworker_t *w)
+{
+	if (!queue || !w)
+		return FALSE;
+
+	return !!ni_hash_table_find(&queue->index, ni_nanny_queue_hash(w),
+					ni_nanny_queue_match, w);
+}
+
 void
-ni_nanny_schedule_recheck(ni_ifworker_array_t *array, ni_ifworker_t *w)
+ni_nanny_schedule_recheck(ni_nanny_queue_t *queue, ni_ifworker_t *w)
 {
-	if (ni_ifworker_array_index(array, w) < 0)
-		ni_ifworker_array_append(array, w);
+	if (!queue || !w || ni_nanny_is_scheduled(queue, w))
+		return;
+
+	if (ni_hash_table_insert(&queue->index, ni_nanny_queue_hash(w), w))
+		ni_ifworker_array_append(&queue->workers, w);
 }
 
 void
-ni_nanny_unschedule(ni_ifworker_array_t *array, ni_ifworker_t *w)
+ni_nanny_unschedule(ni_nanny_queue_t *queue, ni_ifworker_t *w)
 {
-	ni_ifworker_array_remove_with_children(array, w);
+	unsigned int i;
+
+	if (!ni_nanny_is_scheduled(queue, w))
+		return;
+
+	for (i = 0; i < w->children.count; i++)
+		ni_nanny_unschedule(queue, w->children.data[i]);
+
+	ni_hash_table_remove(&queue->index, ni_nanny_queue_hash(w), w);
+	ni_ifworker_array_remove(&queue->workers, w);
+	ni_ifworker_array_remove(&queue->waiting, w);
+}
+
+/*
+ * Keep a checked worker to check it again in a later pass.
+ */
+static void
+ni_nanny_queue_wait(ni_nanny_queue_t *queue, ni_ifworker_t *w)
+{
+	if (ni_nanny_is_scheduled(queue, w))
+		return;
+
+	if (ni_hash_table_insert(&queue->index, ni_nanny_queue_hash(w), w))
+		ni_ifworker_array_append(&queue->waiting, w);
+}
+
+/*
+ * Move up to max workers from the head of the queue into the batch.
+ */
+static void
+ni_nanny_queue_take(ni_nanny_queue_t *queue, ni_ifworker_array_t *batch, unsigned int max)
+{
+	unsigned int i, count;
+
+	count = queue->workers.count < max ? queue->workers.count : max;
+	if (count == 0)
+		return;
+
+	batch->data = xrealloc(batch->data, (batch->count + count) * sizeof(batch->data[0]));
+	for (i = 0; i < count; ++i) {
+		ni_ifworker_t *w = queue->workers.data[i];
+
+		ni_hash_table_remove(&queue->index, ni_nanny_queue_hash(w), w);
+		batch->data[batch->count++] = w;
+	}
+
+	queue->workers.count -= count;
+	memmove(queue->workers.data, queue->workers.data + count,
+			queue->workers.count * sizeof(queue->workers.data[0]));
+	if (queue->workers.count == 0) {
+		free(queue->workers.data);
+		queue->workers.data = NULL;
+	}
+}
+
+void
+ni_nanny_queue_destroy(ni_nanny_queue_t *queue)
+{
+	if (queue) {
+		ni_ifworker_array_destroy(&queue->workers);
+		ni_ifworker_array_destroy(&queue->waiting);
+		ni_hash_table_destroy(&queue->index);
+	}
 }
 
 /*
@@ -211,33 +309,62 @@ ni_nanny_recheck(ni_nanny_t *mgr, ni_ifworker_t *w)
 	return count;
 }
 
+/*
+ * Process the next batch of queued rechecks.
+ * A worker which is in progress, done or failed, is dropped from
+ * the queue; it is rearmed and scheduled again by the event, policy
+ * or user request causing a recheck. A worker without applicable
+ * policy is waiting and checked again in the next pass.
+ */
 unsigned int
 ni_nanny_recheck_do(ni_nanny_t *mgr)
 {
-	unsigned int i, count = 0;
+	ni_ifworker_array_t batch = NI_IFWORKER_ARRAY_INIT;
+	ni_nanny_queue_t *queue = &mgr->recheck;
+	unsigned int i, applied, count = 0;
 	ni_fsm_t *fsm = mgr->fsm;
 
 	ni_assert(fsm);
-	for (i = 0; i < mgr->recheck.count; ++i) {
-		ni_ifworker_t *w = mgr->recheck.data[i];
+	if (!queue->workers.count && queue->waiting.count) {
+		queue->workers = queue->waiting;
+		memset(&queue->waiting, 0, sizeof(queue->waiting));
+	}
+
+	ni_nanny_queue_take(queue, &batch, NI_NANNY_RECHECK_BATCH);
+	for (i = 0; i < batch.count; ++i) {
+		ni_ifworker_t *w = batch.data[i];
+
+		if (w->dead || w->pending || w->kickstarted || w->done || w->failed)
+			continue;
 
-		if (!w->dead && !w->pending && !w->kickstarted && !w->done && !w->failed)
-			count += ni_nanny_recheck(mgr, w);
+		if ((applied = ni_nanny_recheck(mgr, w)) == 0)
+			ni_nanny_queue_wait(queue, w);
+		count += applied;
 	}
+	ni_ifworker_array_destroy(&batch);
 
 	return count;
 }
 
+ni_bool_t
+ni_nanny_recheck_pending(const ni_nanny_t *mgr)
+{
+	/* the waiting workers do not need an immediate pass */
+	return mgr && mgr->recheck.workers.count;
+}
+
 /*
  * Taking down an interface
  */
 unsigned int
 ni_nanny_down_do(ni_nanny_t *mgr)
 {
+	ni_ifworker_array_t batch = NI_IFWORKER_ARRAY_INIT;
 	unsigned int i, count = 0;
 
-	for (i = 0; i < mgr->down.count; ++i) {
-		ni_ifworker_t *w = mgr->down.data[i];
+	ni_nanny_queue_take(&mgr->down, &batch, -1U);
+	for (i = 0; i < batch.count; ++i) {
+		ni_ifworker_t *w = batch.data[i];
 		ni_managed_device_t *mdev;
 
 		if ((mdev = ni_nanny_get_device(mgr, w)) != NULL) {
@@ -245,9 +372,7 @@ ni_nanny_down_do(ni_nanny_t *mgr)
 			count++;
 		}
 	}
-
-	if (i > 0)
-		ni_ifworker_array_destroy(&mgr->down);
+	ni_ifworker_array_destroy(&batch);
 
 	return count;
 }
@@ -255,14 +380,11 @@ ni_nanny_down_do(ni_nanny_t *mgr)
 ni_managed_policy_t *
 ni_nanny_get_policy(ni_nanny_t *mgr, const ni_fsm_policy_t *policy)
 {
-	ni_managed_policy_t *mpolicy;
-
-	for (mpolicy = mgr->policy_list; mpolicy; mpolicy = mpolicy->next) {
-		if (mpolicy->fsm_policy == policy)
-			return mpolicy;
-	}
+	if (!mgr || !policy)
+		return NULL;
 
-	return NULL;
+	return ni_hash_table_find(&mgr->policy_index, ni_managed_policy_hash(policy),
+					ni_managed_policy_match, policy);
 }
 
 /*
@@ -823,6 +945,11 @@ ni_nanny_process_fsm_event(ni_fsm_t *fsm, ni_ifworker_t *w, ni_fsm_event_t *ev)
 
 	case NI_EVENT_DEVICE_DELETE:
 		ni_nanny_unregister_device(mgr, w);
+
+		/* the fsm rearms a deleted factory device; recreate it */
+		if (ni_ifworker_is_factory_device(w) &&
+		    ni_fsm_exists_applicable_policy(mgr->fsm, mgr->fsm->policies, w))
+			ni_nanny_schedule_recheck(&mgr->recheck, w);
 		break;
 
 	case NI_EVENT_DEVICE_DOWN:
@@ -14,6 +14,7 @@
 #include <wicked/types.h>
 #include <wicked/secret.h>
 #include "appconfig.h"
+#include "util_priv.h"
 
 typedef struct ni_nanny		ni_nanny_t;
 typedef struct ni_managed_device ni_managed_device_t;
@@ -70,6 +71,7 @@ struct ni_managed_policy {
 
 	unsigned int		seqno;
 	ni_fsm_policy_t *	fsm_policy;
+	ni_hash_table_t *	index;
 };
 
 typedef struct ni_nanny_devmatch ni_nanny_devmatch_t;
@@ -88,16 +90,28 @@ struct ni_nanny_devmatch {
 	 const ni_dbus_class_t *class;	/* if type is NI_NANNY_DEVMATCH_CLASS */
 };
 
+/*
+ * Queue of workers to process in the main loop; a worker
+ * is queued once, the index refers to the queued workers
+ * and to the workers waiting to be checked again.
+ */
+typedef struct ni_nanny_queue {
+	ni_ifworker_array_t	workers;
+	ni_ifworker_array_t	waiting;
+	ni_hash_table_t		index;
+} ni_nanny_queue_t;
+
 struct ni_nanny {
 	ni_dbus_server_t *	server;
 	ni_fsm_t *		fsm;
 
 	ni_managed_device_t *	device_list;
 	ni_managed_policy_t *	policy_list;
+	ni_hash_table_t		policy_index;	/* by fsm_policy */
 
 	unsigned int		last_policy_seq;
-	ni_ifworker_array_t	recheck;
-	ni_ifworker_array_t	down;
+	ni_nanny_queue_t	recheck;
+	ni_nanny_queue_t	down;
 
 	ni_nanny_user_t *	users;
 
@@ -118,9 +132,12 @@ extern void			ni_nanny_start(ni_nanny_t *);
 extern void			ni_nanny_free(ni_nanny_t *);
 extern const char *		ni_nanny_statedir(void);
 extern void			ni_nanny_recheck_policies(ni_nanny_t *, const ni_string_array_t *);
-extern void			ni_nanny_schedule_recheck(ni_ifworker_array_t *, ni_ifworker_t *);
-extern void			ni_nanny_unschedule(ni_ifworker_array_t *, ni_ifworker_t *);
+extern void			ni_nanny_schedule_recheck(ni_nanny_queue_t *, ni_ifworker_t *);
+extern void			ni_nanny_unschedule(ni_nanny_queue_t *, ni_ifworker_t *);
+extern ni_bool_t		ni_nanny_is_scheduled(const ni_nanny_queue_t *, const ni_ifworker_t *);
+extern void			ni_nanny_queue_destroy(ni_nanny_queue_t *);
 extern unsigned int		ni_nanny_recheck_do(ni_nanny_t *mgr);
+extern ni_bool_t		ni_nanny_recheck_pending(const ni_nanny_t *mgr);
 extern unsigned int		ni_nanny_down_do(ni_nanny_t *mgr);
 extern void			ni_nanny_register_device(ni_nanny_t *, ni_ifworker_t *);
 extern void			ni_nanny_unregister_device(ni_nanny_t *, ni_ifworker_t *);
@@ -158,6 +175,8 @@ extern ni_managed_policy_t *	ni_managed_policy_new(ni_nanny_t *, ni_fsm_policy_t
 extern ni_managed_policy_t *	ni_managed_policy_ref(ni_managed_policy_t *);
 extern void			ni_managed_policy_free(ni_managed_policy_t *);
 extern uid_t			ni_managed_policy_owner(const ni_managed_policy_t *);
+extern unsigned int		ni_managed_policy_hash(const ni_fsm_policy_t *);
+extern ni_bool_t		ni_managed_policy_match(const void *, const void *);
 
 extern const char *		ni_managed_state_to_string(ni_managed_state_t);
 
@@ -151,6 +151,20 @@ __ni_managed_policy_list_unlink(ni_managed_policy_t *mpolicy)
 /*
  * managed_policy objects
  */
+unsigned int
+ni_managed_policy_hash(const ni_fsm_policy_t *policy)
+{
+	return ni_hash_data(&policy, sizeof(policy));
+}
+
+ni_bool_t
+ni_managed_policy_match(const void *data, const void *key)
+{
+	const ni_managed_policy_t *mpolicy = data;
+
+	return mpolicy->fsm_policy == key;
+}
+
 ni_managed_policy_t *
 ni_managed_policy_new(ni_nanny_t *mgr, ni_fsm_policy_t *policy)
 {
@@ -164,6 +178,9 @@ ni_managed_policy_new(ni_nanny_t *mgr, ni_fsm_policy_t *policy)
 	mpolicy->fsm_policy = ni_fsm_policy_ref(policy);
 
 	__ni_managed_policy_list_insert(&mgr->policy_list, mpolicy);
+	if (ni_hash_table_insert(&mgr->policy_index,
+				ni_managed_policy_hash(policy), mpolicy))
+		mpolicy->index = &mgr->policy_index;
 	return mpolicy;
 }
 
@@ -185,6 +202,10 @@ ni_managed_policy_free(ni_managed_policy_t *mpolicy)
 		mpolicy->refcount--;
 		if (mpolicy->refcount == 0) {
 			__ni_managed_policy_list_unlink(mpolicy);
+			if (mpolicy->index)
+				ni_hash_table_remove(mpolicy->index,
+					ni_managed_policy_hash(mpolicy->fsm_policy),
+					mpolicy);
 			ni_fsm_policy_free(mpolicy->fsm_policy);
 			free(mpolicy);
 		}
@@ -245,6 +245,9 @@ run_interface_server(void)
 	if (schema == NULL)
 		ni_fatal("Cannot initialize objectmodel, giving up.");
 
+	/* remove temporary lease files left behind by a crash */
+	ni_addrconf_lease_file_cleanup();
+
 	/* open global RTNL socket to listen for kernel events */
 	if (ni_server_listen_interface_events(handle_interface_event) < 0)
 		ni_fatal("unable to initialize netlink listener");
@@ -262,6 +265,9 @@ run_interface_server(void)
 		ni_server_disable_interface_uevents();
 	}
 
+	/* optional, ethtool settings are re-read on each link event without */
+	ni_server_enable_ethtool_events();
+
 	ni_rfkill_open(handle_rfkill_event, NULL);
 
 	/* Listen for other events, such as RESOLVER_UPDATED */
@@ -295,6 +301,9 @@ run_interface_server(void)
 			timeout = ni_timer_next_timeout();
 		} while (ni_dbus_objects_garbage_collect());
 
+		/* coalesced property changes of this main loop turn */
+		ni_dbus_server_send_properties_changed(dbus_server);
+
 		if (ni_socket_wait(timeout) != 0)
 			ni_fatal("ni_socket_wait failed");
 	}
@@ -302,6 +311,8 @@ run_interface_server(void)
 	if (opt_recover_state)
 		ni_objectmodel_save_state(opt_state_file);
 
+	ni_addrconf_lease_file_flush();
+
 	exit(0);
 }
 
@@ -460,6 +471,9 @@ handle_interface_addr_events(ni_netdev_t *dev, ni_event_t event, const ni_addres
 
 	ni_server_trace_interface_addr_events(dev, event, ap);
 
+	if (dbus_server)
+		ni_dbus_object_properties_changed(ni_objectmodel_get_netif_object(dbus_server, dev));
+
 	if (ap->family != AF_INET6)
 		return;
 
@@ -105,6 +105,7 @@ ni_address_copy(ni_address_t *dst, const ni_address_t *src)
 		dst->anycast_addr    = src->anycast_addr;
 		dst->cache_info = src->cache_info;
 		ni_string_dup(&dst->label, src->label);
+		return TRUE;
 	}
 	return FALSE;
 }
@@ -998,6 +999,21 @@ ni_sockaddr_equal(const ni_sockaddr_t *ss1, const ni_sockaddr_t *ss2)
 	return !memcmp(ap1, ap2, len);
 }
 
+/*
+ * Hash of the address family and data, consistent with ni_sockaddr_equal
+ */
+unsigned int
+ni_sockaddr_hash(const ni_sockaddr_t *ss)
+{
+	const unsigned char *data;
+	unsigned int len;
+
+	if (!ss || !(data = __ni_sockaddr_data(ss, &len)))
+		return ni_hash_uint(ss ? ss->ss_family : AF_UNSPEC);
+
+	return ni_hash_uint(ss->ss_family) ^ ni_hash_data(data, len);
+}
+
 
 ni_bool_t
 ni_sockaddr_prefix_match(unsigned int prefix_bits, const ni_sockaddr_t *laddr, const ni_sockaddr_t *gw)
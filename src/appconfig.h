@@ -43,6 +43,9 @@ struct ni_extension {
 	/* Format type. Only in use by system-updater. */
 	char *			format;
 
+	/* Backend type. Only in use by system-updater. */
+	char *			backend;
+
 	/* Shell commands */
 	ni_script_action_t *	actions;
 
@@ -74,6 +77,24 @@ typedef struct ni_config_rtnl_event {
 	unsigned int	mesg_buff_length;
 } ni_config_rtnl_event_t;
 
+typedef enum {
+	NI_CONFIG_EVENT_LOOP_EPOLL = 0,
+	NI_CONFIG_EVENT_LOOP_POLL,
+} ni_config_event_loop_backend_t;
+
+typedef struct ni_config_event_loop {
+	ni_config_event_loop_backend_t	backend;
+} ni_config_event_loop_t;
+
+typedef enum {
+	NI_CONFIG_PACKET_CAPTURE_RING = 0,
+	NI_CONFIG_PACKET_CAPTURE_SOCKET,
+} ni_config_packet_capture_backend_t;
+
+typedef struct ni_config_packet_capture {
+	ni_config_packet_capture_backend_t	backend;
+} ni_config_packet_capture_t;
+
 typedef enum {
 	NI_CONFIG_BONDING_CTL_NETLINK = 0,
 	NI_CONFIG_BONDING_CTL_SYSFS,
@@ -155,6 +176,15 @@ typedef struct ni_config_dhcp6 {
 	ni_dhcp_option_decl_t *	custom_options;
 } ni_config_dhcp6_t;
 
+typedef enum {
+	NI_CONFIG_LEASE_FILE_XML = 0,
+	NI_CONFIG_LEASE_FILE_BINARY,
+} ni_config_lease_file_format_t;
+
+typedef struct ni_config_lease_file {
+	ni_config_lease_file_format_t	format;
+} ni_config_lease_file_t;
+
 typedef struct ni_config_auto4 {
 	unsigned int	allow_update;
 } ni_config_auto4_t;
@@ -178,6 +208,7 @@ typedef struct ni_config {
 	    ni_config_auto4_t		auto4;
 	    ni_config_auto6_t		auto6;
 
+	    ni_config_lease_file_t	lease_file;
 	} addrconf;
 
 	char *			dbus_xml_schema_file;
@@ -194,6 +225,8 @@ typedef struct ni_config {
 	char *			dbus_type;
 
 	ni_config_rtnl_event_t	rtnl_event;
+	ni_config_event_loop_t	event_loop;
+	ni_config_packet_capture_t packet_capture;
 
 	ni_config_bonding_t	bonding;
 	ni_config_teamd_t	teamd;
@@ -212,6 +245,12 @@ extern const char *			ni_config_dhcp4_cid_type_format(ni_config_dhcp4_cid_type_t
 extern ni_bool_t			ni_config_dhcp4_cid_type_parse(ni_config_dhcp4_cid_type_t *, const char *);
 extern const ni_config_dhcp6_t *	ni_config_dhcp6_find_device(const char *);
 
+extern ni_config_event_loop_backend_t	ni_config_event_loop_backend(void);
+extern const char *	ni_config_event_loop_backend_to_name(ni_config_event_loop_backend_t);
+
+extern ni_config_packet_capture_backend_t	ni_config_packet_capture_backend(void);
+extern ni_config_lease_file_format_t	ni_config_lease_file_format(void);
+
 extern ni_config_bonding_ctl_t	ni_config_bonding_ctl(void);
 
 extern ni_bool_t	ni_config_teamd_enable(ni_config_teamd_ctl_t);
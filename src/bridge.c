@@ -50,6 +50,12 @@ ni_bridge_port_clone(const ni_bridge_port_t *src)
 		dst = ni_bridge_port_new(NULL, src->ifname, src->ifindex);
 		dst->priority = src->priority;
 		dst->path_cost = src->path_cost;
+
+		dst->status = src->status;
+		dst->status.designated_root = NULL;
+		dst->status.designated_bridge = NULL;
+		ni_string_dup(&dst->status.designated_root, src->status.designated_root);
+		ni_string_dup(&dst->status.designated_bridge, src->status.designated_bridge);
 		return dst;
 	}
 	return NULL;
@@ -11,6 +11,7 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
 #include <net/if.h>
 #include <net/ethernet.h>
 #include <net/if_arp.h>
@@ -46,6 +47,7 @@
 #include "socket_priv.h"
 #include "modprobe.h"
 #include "buffer.h"
+#include "appconfig.h"
 
 #define MTU_MAX			1500
 #define DHCP_CLIENT_PORT	68
@@ -54,6 +56,23 @@
 # define ETHERTYPE_LLDP		0x88CC
 #endif
 
+#if defined(PACKET_RX_RING) && defined(TP_STATUS_BLK_TMO)
+#define NI_CAPTURE_RING
+#endif
+
+/*
+ * Shared receive ring geometry, see ni_capture_ring_open()
+ */
+#define NI_CAPTURE_RING_BLOCK_SIZE	(1 << 16)
+#define NI_CAPTURE_RING_BLOCK_NR	16
+#define NI_CAPTURE_RING_FRAME_SIZE	2048
+#define NI_CAPTURE_RING_BLOCK_TMO	10	/* msec */
+#define NI_CAPTURE_RING_HASH_SIZE	64
+
+/* Limits for the jump offsets in the shared ring bpf filter */
+#define NI_CAPTURE_RING_MAX_IFINDEX	250
+#define NI_CAPTURE_RING_MAX_PORTS	60
+
 #define	AFPACKET_MODULE_NAME	"af_packet"
 #define AFPACKET_MODULE_OPTS	NULL
 
@@ -110,6 +129,32 @@ typedef union ni_packetaddr {
 	struct sockaddr_ll	sll;
 } ni_packetaddr_t;
 
+/*
+ * A receive ring shared by all captures of an ethernet protocol.
+ *
+ * Instead of a packet socket per device, one socket per protocol is
+ * bound to all devices with a TPACKET_V3 ring mapped into our address
+ * space. The kernel fills whole blocks of frames which are handed to
+ * the captures registered for the receiving ifindex; the bpf filter is
+ * rebuilt from the registered captures.
+ */
+typedef struct ni_capture_ring	ni_capture_ring_t;
+struct ni_capture_ring {
+	ni_capture_ring_t *	next;
+	unsigned int		refcount;
+
+	uint16_t		protocol;
+	ni_socket_t *		sock;
+
+	unsigned char *		map;
+	size_t			map_size;
+	unsigned int		block;
+
+	unsigned int		seq;
+	unsigned int		count;
+	ni_capture_t *		hash[NI_CAPTURE_RING_HASH_SIZE];
+};
+
 /*
  * Platform specific
  */
@@ -119,6 +164,7 @@ struct ni_capture {
 	int			protocol;
 
 	char *			ifname;
+	unsigned int		ifindex;
 
 	void *			buffer;
 	size_t			mtu;
@@ -128,12 +174,38 @@ struct ni_capture {
 		const ni_buffer_t *	buffer;
 		ni_timeout_param_t	timeout;
 	} retrans;
+	const ni_timer_t *	timer;
+
+	/* shared receive ring and the frame it passed to us */
+	ni_capture_ring_t *	ring;
+	ni_capture_t *		ring_next;
+	unsigned int		ring_seq;
+	uint8_t			ip_protocol;
+	uint16_t		ip_port;
+	struct {
+		ssize_t			len;
+		ni_bool_t		partial_csum;
+		ni_bool_t		csum_valid;
+		ni_sockaddr_t		from;
+	} frame;
 
 	void *			user_data;
 };
 
+static ni_capture_ring_t *	ni_capture_rings;
+static ni_bool_t		ni_capture_ring_disabled;
+
 static int		ni_capture_set_filter(ni_capture_t *, const ni_capture_protinfo_t *);
 static ssize_t		__ni_capture_send(const ni_capture_t *, const ni_buffer_t *);
+static void		ni_capture_retransmit(ni_capture_t *);
+static void		ni_capture_ring_detach(ni_capture_ring_t *, ni_capture_t *);
+static void		ni_capture_ring_release(ni_capture_ring_t *);
+
+static inline int
+ni_capture_fd(const ni_capture_t *capture)
+{
+	return capture->ring ? capture->ring->sock->__fd : capture->sock->__fd;
+}
 
 static uint32_t
 checksum_partial(uint32_t sum, const void *data, uint16_t len)
@@ -323,11 +395,62 @@ ni_capture_inspect_udp_header(void *data, size_t bytes, size_t *payload_len,
 
 /*
  * Timeout handling
+ *
+ * The retransmit deadline is armed as a timer owned by the capture,
+ * as captures attached to a shared ring have no active socket.
  */
+static void		__ni_capture_update_timer(ni_capture_t *);
+
+static void
+__ni_capture_timer_expired(void *user_data, const ni_timer_t *timer)
+{
+	ni_capture_t *capture = user_data;
+	struct timeval now;
+
+	if (capture->timer != timer)
+		return;
+
+	capture->timer = NULL;
+	ni_timer_get_time(&now);
+	if (timerisset(&capture->retrans.deadline) &&
+	    !timercmp(&now, &capture->retrans.deadline, <))
+		ni_capture_retransmit(capture);
+	__ni_capture_update_timer(capture);
+}
+
+static void
+__ni_capture_update_timer(ni_capture_t *capture)
+{
+	const struct timeval *deadline = &capture->retrans.deadline;
+	struct timeval now, delta;
+	unsigned long timeout = 0;
+
+	if (!timerisset(deadline)) {
+		if (capture->timer) {
+			ni_timer_cancel(capture->timer);
+			capture->timer = NULL;
+		}
+		return;
+	}
+
+	ni_timer_get_time(&now);
+	if (timercmp(deadline, &now, >)) {
+		timersub(deadline, &now, &delta);
+		/* round up, the deadline has to be passed when we fire */
+		timeout = delta.tv_sec * 1000 + (delta.tv_usec + 999) / 1000;
+	}
+
+	if (capture->timer && (capture->timer = ni_timer_rearm(capture->timer, timeout)))
+		return;
+
+	capture->timer = ni_timer_register(timeout, __ni_capture_timer_expired, capture);
+}
+
 void
 ni_capture_arm_retransmit(ni_capture_t *capture)
 {
 	ni_timeout_arm(&capture->retrans.deadline, &capture->retrans.timeout);
+	__ni_capture_update_timer(capture);
 }
 
 void
@@ -335,6 +458,7 @@ ni_capture_disarm_retransmit(ni_capture_t *capture)
 {
 	/* Clear retransmit timer, buffer, and everything else */
 	memset(&capture->retrans, 0, sizeof(capture->retrans));
+	__ni_capture_update_timer(capture);
 }
 
 void
@@ -345,6 +469,7 @@ ni_capture_force_retransmit(ni_capture_t *capture, unsigned int delay)
 
 		ni_timer_get_time(deadline);
 		deadline->tv_sec += delay;
+		__ni_capture_update_timer(capture);
 	}
 }
 
@@ -379,47 +504,11 @@ ni_capture_retransmit(ni_capture_t *capture)
 	ni_capture_arm_retransmit(capture);
 }
 
-/*
- * Common functions for handling timeouts
- * (Common as in: working for DHCP and ARP)
- * These are a bit of a layering violation, but I don't like too many
- * callbacks nested in callbacks...
- */
-static int
-__ni_capture_socket_get_timeout(const ni_socket_t *sock, struct timeval *tv)
-{
-	ni_capture_t *capture;
-
-	if (!(capture = sock->user_data)) {
-		ni_error("capture socket without capture object?!");
-		return -1;
-	}
-
-	timerclear(tv);
-	if (timerisset(&capture->retrans.deadline))
-		*tv = capture->retrans.deadline;
-	return timerisset(tv)? 0 : -1;
-}
-
-static void
-__ni_capture_socket_check_timeout(ni_socket_t *sock, const struct timeval *now)
-{
-	ni_capture_t *capture;
-
-	if (!(capture = sock->user_data)) {
-		ni_error("capture socket without capture object?!");
-		return;
-	}
-
-	if (timerisset(&capture->retrans.deadline) && timercmp(&capture->retrans.deadline, now, <))
-		ni_capture_retransmit(capture);
-}
-
 /*
  * Capture receive handling
  */
-int
-__ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_sockaddr_t *from)
+static int
+__ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_bool_t *csum_valid, ni_sockaddr_t *from)
 {
 #if defined(PACKET_AUXDATA)
 	/* use 2 times bigger buffer to catch possible additions... */
@@ -441,6 +530,7 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 	ssize_t bytes;
 
 	*partial_csum = FALSE;
+	*csum_valid = FALSE;
 	memset(cbuf, 0, sizeof(cbuf));
 	if (from)
 		memset(from, 0, sizeof(*from));
@@ -455,6 +545,10 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 			aux = (void *)CMSG_DATA(cmsg);
 			if (aux->tp_status & TP_STATUS_CSUMNOTREADY)
 				*partial_csum = TRUE;
+#if defined(TP_STATUS_CSUM_VALID)
+			if (aux->tp_status & TP_STATUS_CSUM_VALID)
+				*csum_valid = TRUE;
+#endif
 			break;
 		}
 	}
@@ -462,6 +556,7 @@ __ni_capture_recv(int fd, void *buf, size_t len, ni_bool_t *partial_csum, ni_soc
 	return bytes;
 #else
 	*partial_csum = FALSE;
+	*csum_valid = FALSE;
 
 	return read(fd, buf, len);
 #endif
@@ -501,10 +596,24 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	size_t payload_len;
 	ssize_t bytes;
 	ni_bool_t partial_checksum = FALSE;
+	ni_bool_t checksum_valid = FALSE;
 	const char *lladdr;
 
-	bytes = __ni_capture_recv(capture->sock->__fd, capture->buffer,
-				  capture->mtu, &partial_checksum, from);
+	if (capture->ring) {
+		/* frame copied to our buffer by ni_capture_ring_receive */
+		if ((bytes = capture->frame.len) < 0) {
+			errno = EAGAIN;
+		} else {
+			partial_checksum = capture->frame.partial_csum;
+			checksum_valid = capture->frame.csum_valid;
+			if (from)
+				*from = capture->frame.from;
+		}
+		capture->frame.len = -1;
+	} else {
+		bytes = __ni_capture_recv(capture->sock->__fd, capture->buffer,
+				capture->mtu, &partial_checksum, &checksum_valid, from);
+	}
 
 	if (bytes < 0) {
 		ni_error("%s: %s cannot read %s%spacket from socket: %m",
@@ -523,7 +632,7 @@ ni_capture_recv(ni_capture_t *capture, ni_buffer_t *bp, ni_sockaddr_t *from, con
 	case ETHERTYPE_IP:
 		/* Make sure IP and UDP header are sane */
 		payload = ni_capture_inspect_udp_header(capture->buffer, bytes,
-						&payload_len, partial_checksum);
+						&payload_len, partial_checksum || checksum_valid);
 		if (payload == NULL) {
 			ni_debug_socket("%s: bad IP/UDP %s%spacket header",
 					capture->ifname,
@@ -571,6 +680,9 @@ ni_capture_is_valid(const ni_capture_t *capture, int protocol)
 {
 	ni_socket_t *sock = capture->sock;
 
+	if (capture->ring && capture->ring->sock->error)
+		return 0;
+
 	return (sock && !sock->error && capture->protocol == protocol);
 }
 
@@ -676,11 +788,388 @@ __ni_capture_init_once(void)
 	ni_modprobe(AFPACKET_MODULE_NAME, AFPACKET_MODULE_OPTS);
 }
 
+/*
+ * Shared TPACKET_V3 receive rings
+ */
+#if defined(NI_CAPTURE_RING)
+static inline unsigned int
+ni_capture_ring_hash(unsigned int ifindex)
+{
+	return ifindex % NI_CAPTURE_RING_HASH_SIZE;
+}
+
+static int
+ni_capture_ring_set_filter(ni_capture_ring_t *ring)
+{
+	unsigned int ifindex[NI_CAPTURE_RING_MAX_IFINDEX];
+	struct {
+		uint8_t		protocol;
+		uint16_t	port;
+	} ports[NI_CAPTURE_RING_MAX_PORTS];
+	unsigned int nifindex = 0, nports = 0, len = 0, i, j;
+	ni_bool_t any_ifindex = FALSE;
+	struct sock_filter *insns;
+	struct sock_fprog pf;
+	ni_capture_t *cap;
+	int ret = 0;
+
+	for (i = 0; i < NI_CAPTURE_RING_HASH_SIZE; ++i) {
+		for (cap = ring->hash[i]; cap; cap = cap->ring_next) {
+			for (j = 0; j < nifindex && ifindex[j] != cap->ifindex; ++j)
+				;
+			if (j == nifindex) {
+				if (nifindex < NI_CAPTURE_RING_MAX_IFINDEX)
+					ifindex[nifindex++] = cap->ifindex;
+				else
+					any_ifindex = TRUE;
+			}
+
+			if (ring->protocol != ETHERTYPE_IP)
+				continue;
+
+			for (j = 0; j < nports; ++j) {
+				if (ports[j].protocol == cap->ip_protocol &&
+				    ports[j].port == cap->ip_port)
+					break;
+			}
+			if (j < nports)
+				continue;
+			if (nports == NI_CAPTURE_RING_MAX_PORTS) {
+				ni_error("cannot build shared capture filter: too many IP ports");
+				return -1;
+			}
+			ports[nports].protocol = cap->ip_protocol;
+			ports[nports].port = cap->ip_port;
+			nports++;
+		}
+	}
+	if (any_ifindex)
+		nifindex = 0;
+
+	/*
+	 * Accept frames received on the registered devices only,
+	 * IP frames have to be unfragmented and match a registered
+	 * protocol and destination port (see std_ipv4_bpf_filter).
+	 */
+	insns = xcalloc(nifindex + 2 + 3 + 4 * nports + 2, sizeof(*insns));
+	if (nifindex) {
+		insns[len++] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_W + BPF_ABS,
+						SKF_AD_OFF + SKF_AD_IFINDEX);
+		for (i = 0; i < nifindex; ++i) {
+			insns[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+						ifindex[i], nifindex - i, 0);
+		}
+		insns[len++] = (struct sock_filter)BPF_STMT(BPF_RET + BPF_K, 0);
+	}
+	if (ring->protocol == ETHERTYPE_IP) {
+		insns[len++] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_H + BPF_ABS, 6);
+		insns[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JSET + BPF_K,
+						0x1fff, 4 * nports + 1, 0);
+		insns[len++] = (struct sock_filter)BPF_STMT(BPF_LDX + BPF_B + BPF_MSH, 0);
+		for (i = 0; i < nports; ++i) {
+			insns[len++] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_B + BPF_ABS, 9);
+			insns[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+						ports[i].protocol, 0, 2);
+			insns[len++] = (struct sock_filter)BPF_STMT(BPF_LD + BPF_H + BPF_IND, 2);
+			insns[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP + BPF_JEQ + BPF_K,
+						ports[i].port, 4 * (nports - i) - 3, 0);
+		}
+		insns[len++] = (struct sock_filter)BPF_STMT(BPF_RET + BPF_K, 0);
+	}
+	insns[len++] = (struct sock_filter)BPF_STMT(BPF_RET + BPF_K, ~0U);
+
+	memset(&pf, 0, sizeof(pf));
+	pf.filter = insns;
+	pf.len = len;
+	if (setsockopt(ring->sock->__fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+		ni_error("SO_ATTACH_FILTER: %m");
+		ret = -1;
+	}
+	free(insns);
+	return ret;
+}
+
+static ni_capture_t *
+ni_capture_ring_find(ni_capture_ring_t *ring, unsigned int ifindex,
+		uint8_t ip_protocol, uint16_t ip_port, unsigned int seq)
+{
+	ni_capture_t *cap;
+
+	for (cap = ring->hash[ni_capture_ring_hash(ifindex)]; cap; cap = cap->ring_next) {
+		if (cap->ifindex != ifindex || cap->ring_seq == seq)
+			continue;
+		if (ring->protocol == ETHERTYPE_IP &&
+		    (cap->ip_protocol != ip_protocol || cap->ip_port != ip_port))
+			continue;
+		return cap;
+	}
+	return NULL;
+}
+
+/*
+ * Pass a frame to all captures on the receiving device. Each capture
+ * is marked with the frame sequence before its receive callback runs,
+ * so captures closed or opened by the callback are handled gracefully.
+ */
+static void
+ni_capture_ring_dispatch(ni_capture_ring_t *ring, const struct tpacket3_hdr *hdr)
+{
+	const struct sockaddr_ll *sll;
+	const unsigned char *data;
+	ni_capture_t *capture;
+	uint8_t ip_protocol = 0;
+	uint16_t ip_port = 0;
+	unsigned int seq, ihl;
+	ni_socket_t *sock;
+
+	sll = (const void *)((const unsigned char *)hdr + TPACKET_ALIGN(sizeof(*hdr)));
+	data = (const unsigned char *)hdr + hdr->tp_net;
+
+	if (sll->sll_pkttype == PACKET_OUTGOING)
+		return;
+
+	if (ring->protocol == ETHERTYPE_IP) {
+		/* the filter verified there is a ports header */
+		ihl = (data[0] & 0x0f) << 2;
+		if (hdr->tp_snaplen < ihl + 4)
+			return;
+		ip_protocol = data[9];
+		ip_port = (data[ihl + 2] << 8) | data[ihl + 3];
+	}
+
+	seq = ++ring->seq;
+	while ((capture = ni_capture_ring_find(ring, sll->sll_ifindex, ip_protocol, ip_port, seq))) {
+		capture->ring_seq = seq;
+
+		capture->frame.len = hdr->tp_snaplen < capture->mtu ?
+					hdr->tp_snaplen : capture->mtu;
+		memcpy(capture->buffer, data, capture->frame.len);
+
+		capture->frame.partial_csum = !!(hdr->tp_status & TP_STATUS_CSUMNOTREADY);
+#if defined(TP_STATUS_CSUM_VALID)
+		capture->frame.csum_valid = !!(hdr->tp_status & TP_STATUS_CSUM_VALID);
+#endif
+		memset(&capture->frame.from, 0, sizeof(capture->frame.from));
+		memcpy(&capture->frame.from, sll, sizeof(*sll));
+
+		sock = ni_socket_hold(capture->sock);
+		if (sock->receive)
+			sock->receive(sock);
+		ni_socket_release(sock);
+	}
+}
+
+static void
+ni_capture_ring_receive(ni_socket_t *sock)
+{
+	ni_capture_ring_t *ring = sock->user_data;
+	struct tpacket_block_desc *desc;
+	struct tpacket3_hdr *hdr;
+	unsigned int n, i;
+
+	if (!ring)
+		return;
+
+	ring->refcount++;
+	for (n = 0; n < NI_CAPTURE_RING_BLOCK_NR; ++n) {
+		desc = (void *)(ring->map + ring->block * NI_CAPTURE_RING_BLOCK_SIZE);
+		if (!(*(volatile uint32_t *)&desc->hdr.bh1.block_status & TP_STATUS_USER))
+			break;
+		__sync_synchronize();
+
+		hdr = (void *)((unsigned char *)desc + desc->hdr.bh1.offset_to_first_pkt);
+		for (i = 0; i < desc->hdr.bh1.num_pkts; ++i) {
+			ni_capture_ring_dispatch(ring, hdr);
+			hdr = (void *)((unsigned char *)hdr + hdr->tp_next_offset);
+		}
+
+		__sync_synchronize();
+		desc->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		ring->block = (ring->block + 1) % NI_CAPTURE_RING_BLOCK_NR;
+	}
+	ni_capture_ring_release(ring);
+}
+
+static ni_capture_ring_t *
+ni_capture_ring_create(uint16_t protocol)
+{
+	static struct sock_filter reject[] = {
+		BPF_STMT(BPF_RET + BPF_K, 0),
+	};
+	struct sock_fprog pf = { .len = 1, .filter = reject };
+	struct tpacket_req3 req;
+	ni_capture_ring_t *ring;
+	int fd, version = TPACKET_V3;
+	void *map;
+
+	if ((fd = socket(PF_PACKET, SOCK_DGRAM, htons(protocol))) < 0) {
+		ni_error("socket: %m");
+		return NULL;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	/* Don't queue anything until the captures are registered */
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &pf, sizeof(pf)) < 0) {
+		ni_error("SO_ATTACH_FILTER: %m");
+		goto failed;
+	}
+
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		ni_debug_socket("cannot use TPACKET_V3 capture ring: %m");
+		ni_capture_ring_disabled = TRUE;
+		goto failed;
+	}
+
+	memset(&req, 0, sizeof(req));
+	req.tp_block_size = NI_CAPTURE_RING_BLOCK_SIZE;
+	req.tp_block_nr = NI_CAPTURE_RING_BLOCK_NR;
+	req.tp_frame_size = NI_CAPTURE_RING_FRAME_SIZE;
+	req.tp_frame_nr = (NI_CAPTURE_RING_BLOCK_SIZE * NI_CAPTURE_RING_BLOCK_NR) /
+				NI_CAPTURE_RING_FRAME_SIZE;
+	req.tp_retire_blk_tov = NI_CAPTURE_RING_BLOCK_TMO;
+	if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+		ni_debug_socket("cannot setup TPACKET_V3 capture ring: %m");
+		ni_capture_ring_disabled = TRUE;
+		goto failed;
+	}
+
+	map = mmap(NULL, NI_CAPTURE_RING_BLOCK_SIZE * NI_CAPTURE_RING_BLOCK_NR,
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		ni_error("cannot map capture ring: %m");
+		goto failed;
+	}
+
+	ring = xcalloc(1, sizeof(*ring));
+	ring->refcount = 1;
+	ring->protocol = protocol;
+	ring->map = map;
+	ring->map_size = NI_CAPTURE_RING_BLOCK_SIZE * NI_CAPTURE_RING_BLOCK_NR;
+
+	ring->sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	ring->sock->receive = ni_capture_ring_receive;
+	ring->sock->user_data = ring;
+	ni_socket_activate(ring->sock);
+
+	ring->next = ni_capture_rings;
+	ni_capture_rings = ring;
+
+	ni_debug_socket("opened shared capture ring for ethertype 0x%04x", protocol);
+	return ring;
+
+failed:
+	close(fd);
+	return NULL;
+}
+
+static ni_capture_ring_t *
+ni_capture_ring_open(uint16_t protocol)
+{
+	ni_capture_ring_t *ring;
+
+	if (ni_capture_ring_disabled)
+		return NULL;
+
+	if (ni_config_packet_capture_backend() != NI_CONFIG_PACKET_CAPTURE_RING)
+		return NULL;
+
+	for (ring = ni_capture_rings; ring; ring = ring->next) {
+		if (ring->protocol == protocol) {
+			ring->refcount++;
+			return ring;
+		}
+	}
+	return ni_capture_ring_create(protocol);
+}
+
+static void
+ni_capture_ring_release(ni_capture_ring_t *ring)
+{
+	ni_capture_ring_t **pos;
+
+	if (!ring || !ring->refcount || --ring->refcount)
+		return;
+
+	for (pos = &ni_capture_rings; *pos; pos = &(*pos)->next) {
+		if (*pos == ring) {
+			*pos = ring->next;
+			break;
+		}
+	}
+
+	ni_debug_socket("closing shared capture ring for ethertype 0x%04x", ring->protocol);
+	ring->sock->user_data = NULL;
+	ni_socket_close(ring->sock);
+	munmap(ring->map, ring->map_size);
+	free(ring);
+}
+
+static int
+ni_capture_ring_attach(ni_capture_ring_t *ring, ni_capture_t *capture)
+{
+	unsigned int hash = ni_capture_ring_hash(capture->ifindex);
+
+	capture->ring = ring;
+	capture->ring_seq = ring->seq;
+	capture->frame.len = -1;
+	capture->ring_next = ring->hash[hash];
+	ring->hash[hash] = capture;
+	ring->count++;
+
+	if (ni_capture_ring_set_filter(ring) < 0) {
+		ni_capture_ring_detach(ring, capture);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+ni_capture_ring_detach(ni_capture_ring_t *ring, ni_capture_t *capture)
+{
+	ni_capture_t **pos;
+
+	for (pos = &ring->hash[ni_capture_ring_hash(capture->ifindex)]; *pos; pos = &(*pos)->ring_next) {
+		if (*pos == capture) {
+			*pos = capture->ring_next;
+			capture->ring_next = NULL;
+			ring->count--;
+			if (ring->count)
+				ni_capture_ring_set_filter(ring);
+			break;
+		}
+	}
+	capture->ring = NULL;
+}
+#else
+static ni_capture_ring_t *
+ni_capture_ring_open(uint16_t protocol)
+{
+	return NULL;
+}
+
+static int
+ni_capture_ring_attach(ni_capture_ring_t *ring, ni_capture_t *capture)
+{
+	return -1;
+}
+
+static void
+ni_capture_ring_detach(ni_capture_ring_t *ring, ni_capture_t *capture)
+{
+}
+
+static void
+ni_capture_ring_release(ni_capture_ring_t *ring)
+{
+}
+#endif
+
 ni_capture_t *
 ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t *protinfo, void (*receive)(ni_socket_t *))
 {
 	ni_packetaddr_t	addr;
 	ni_capture_t *capture = NULL;
+	ni_capture_ring_t *ring = NULL;
 	ni_hwaddr_t destaddr;
 	int fd = -1;
 
@@ -704,18 +1193,38 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 
 	__ni_capture_init_once();
 
-	if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
-		ni_error("socket: %m");
-		return NULL;
+	switch (protinfo->eth_protocol) {
+	case ETHERTYPE_IP:
+		if (protinfo->ip_protocol != IPPROTO_UDP && protinfo->ip_protocol != IPPROTO_TCP)
+			break;
+		/* fall through */
+	case ETHERTYPE_ARP:
+	case ETHERTYPE_LLDP:
+		ring = ni_capture_ring_open(protinfo->eth_protocol);
+		break;
+	default:
+		break;
+	}
+
+	if (!ring) {
+		if ((fd = socket (PF_PACKET, SOCK_DGRAM, htons(protinfo->eth_protocol))) < 0) {
+			ni_error("socket: %m");
+			return NULL;
+		}
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
 	}
-	fcntl(fd, F_SETFD, FD_CLOEXEC);
 
 	capture = calloc(1, sizeof(*capture));
 	if (!capture)
 		goto failed;
 	ni_string_dup(&capture->ifname, devinfo->ifname);
+	capture->ifindex = devinfo->ifindex;
+	/* captures on a shared ring get a socket without descriptor */
 	capture->sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	fd = -1;
 	capture->protocol = protinfo->eth_protocol;
+	capture->ip_protocol = protinfo->ip_protocol;
+	capture->ip_port = protinfo->ip_port;
 
 	capture->addr.sll.sll_family = AF_PACKET;
 	capture->addr.sll.sll_protocol = htons(protinfo->eth_protocol);
@@ -724,6 +1233,20 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	capture->addr.sll.sll_halen = destaddr.len;
 	memcpy(&capture->addr.sll.sll_addr, destaddr.data, destaddr.len);
 
+	capture->mtu = devinfo->mtu;
+	if (capture->mtu == 0)
+		capture->mtu = MTU_MAX;
+	capture->buffer = xmalloc(capture->mtu);
+
+	capture->sock->receive = receive;
+	capture->sock->user_data = capture;
+
+	if (ring) {
+		if (ni_capture_ring_attach(ring, capture) < 0)
+			goto failed;
+		return capture;
+	}
+
 	if (ni_capture_set_filter(capture, protinfo) < 0)
 		goto failed;
 
@@ -732,27 +1255,19 @@ ni_capture_open(const ni_capture_devinfo_t *devinfo, const ni_capture_protinfo_t
 	addr.sll.sll_protocol = htons(protinfo->eth_protocol);
 	addr.sll.sll_ifindex = devinfo->ifindex;
 
-	if (bind(fd, &addr.sa, sizeof(addr)) == -1) {
+	if (bind(capture->sock->__fd, &addr.sa, sizeof(addr)) == -1) {
 		ni_error("bind: %m");
 		goto failed;
 	}
 
-	__ni_capture_enable_packet_auxdata(fd);
+	__ni_capture_enable_packet_auxdata(capture->sock->__fd);
 
-	capture->mtu = devinfo->mtu;
-	if (capture->mtu == 0)
-		capture->mtu = MTU_MAX;
-	capture->buffer = xmalloc(capture->mtu);
-
-	capture->sock->receive = receive;
-	capture->sock->get_timeout = __ni_capture_socket_get_timeout;
-	capture->sock->check_timeout = __ni_capture_socket_check_timeout;
-	capture->sock->user_data = capture;
 	ni_socket_activate(capture->sock);
 	return capture;
 
 failed:
 	ni_capture_free(capture);
+	ni_capture_ring_release(ring);
 	if (fd >= 0)
 		close(fd);
 	return NULL;
@@ -811,7 +1326,7 @@ __ni_capture_send(const ni_capture_t *capture, const ni_buffer_t *buf)
 		return -1;
 	}
 
-	rv = sendto(capture->sock->__fd, ni_buffer_head(buf), ni_buffer_count(buf), 0,
+	rv = sendto(ni_capture_fd(capture), ni_buffer_head(buf), ni_buffer_count(buf), 0,
 			&capture->addr.sa, sizeof(capture->addr));
 	if (rv < 0)
 		ni_error("unable to send dhcp packet: %m");
@@ -840,6 +1355,16 @@ ni_capture_free(ni_capture_t *capture)
 {
 	if (!capture)
 		return;
+	if (capture->timer) {
+		ni_timer_cancel(capture->timer);
+		capture->timer = NULL;
+	}
+	if (capture->ring) {
+		ni_capture_ring_t *ring = capture->ring;
+
+		ni_capture_ring_detach(ring, capture);
+		ni_capture_ring_release(ring);
+	}
 	if (capture->sock)
 		ni_socket_close(capture->sock);
 	if (capture->buffer)
@@ -287,7 +287,7 @@ ni_convert_cfg_into_policy_node(const xml_node_t *ifcfg, xml_node_t *match, cons
 	 * TODO: ahm... add action parameter to this function.
 	 */
 	node = xml_node_clone(ifcfg, ifpolicy);
-	ni_string_dup(&node->name, NI_NANNY_IFPOLICY_MERGE);
+	xml_node_set_name(node, NI_NANNY_IFPOLICY_MERGE);
 
 	ni_var_array_destroy(&ifpolicy->attrs);
 	xml_node_add_attr(ifpolicy, NI_NANNY_IFPOLICY_NAME, name);
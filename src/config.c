@@ -49,6 +49,9 @@ static ni_bool_t	ni_config_parse_system_updater(ni_extension_t **, xml_node_t *)
 static ni_bool_t	ni_config_parse_extension(ni_extension_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_sources(ni_config_t *, xml_node_t *);
 static ni_bool_t	ni_config_parse_rtnl_event(ni_config_rtnl_event_t *, xml_node_t *);
+static ni_bool_t	ni_config_parse_event_loop(ni_config_event_loop_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_packet_capture(ni_config_packet_capture_t *, const xml_node_t *);
+static ni_bool_t	ni_config_parse_lease_file(ni_config_lease_file_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_bonding(ni_config_bonding_t *, const xml_node_t *);
 static ni_bool_t	ni_config_parse_teamd(ni_config_teamd_t *, const xml_node_t *);
 static ni_c_binding_t *	ni_c_binding_new(ni_c_binding_t **, const char *name, const char *lib, const char *symbol);
@@ -382,6 +385,10 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 				if (!strcmp(gchild->name, "auto6")
 				 && !ni_config_parse_addrconf_auto6(&conf->addrconf.auto6, gchild))
 					goto failed;
+
+				if (!strcmp(gchild->name, "lease-file")
+				 && !ni_config_parse_lease_file(&conf->addrconf.lease_file, gchild))
+					goto failed;
 			}
 		} else
 		if (strcmp(child->name, "sources") == 0) {
@@ -412,6 +419,14 @@ __ni_config_parse(ni_config_t *conf, const char *filename, ni_init_appdata_callb
 			if (!ni_config_parse_rtnl_event(&conf->rtnl_event, child))
 				goto failed;
 		} else
+		if (strcmp(child->name, "event-loop") == 0) {
+			if (!ni_config_parse_event_loop(&conf->event_loop, child))
+				goto failed;
+		} else
+		if (strcmp(child->name, "packet-capture") == 0) {
+			if (!ni_config_parse_packet_capture(&conf->packet_capture, child))
+				goto failed;
+		} else
 		if (strcmp(child->name, "bonding") == 0) {
 			if (!ni_config_parse_bonding(&conf->bonding, child))
 				goto failed;
@@ -1449,6 +1464,11 @@ ni_config_parse_objectmodel_firmware_discovery(ni_extension_t **list, xml_node_t
  *  <script name="restore" command="/some/crazy/path/to/script restore" />
  *  ...
  * </system-updater>
+ *
+ * The resolver, hostname and nis updaters can be handled in-process
+ * instead of by scripts:
+ *
+ * <system-updater name="resolver" backend="builtin" />
  */
 ni_bool_t
 ni_config_parse_system_updater(ni_extension_t **list, xml_node_t *node)
@@ -1467,6 +1487,9 @@ ni_config_parse_system_updater(ni_extension_t **list, xml_node_t *node)
 	/* If the updater has a format type, extract. */
 	ni_string_dup(&ex->format, xml_node_get_attr(node, "format"));
 
+	/* Scripts or the builtin backend (script if not set) */
+	ni_string_dup(&ex->backend, xml_node_get_attr(node, "backend"));
+
 	return ni_config_parse_extension(ex, node);
 }
 
@@ -1555,6 +1578,139 @@ ni_config_parse_rtnl_event(ni_config_rtnl_event_t *conf, xml_node_t *node)
 	return TRUE;
 }
 
+/*
+ * socket event loop config options
+ */
+static const ni_intmap_t	config_event_loop_backend_names[] = {
+	{ "epoll",		NI_CONFIG_EVENT_LOOP_EPOLL	},
+	{ "poll",		NI_CONFIG_EVENT_LOOP_POLL	},
+	{ NULL,			-1U				}
+};
+
+const char *
+ni_config_event_loop_backend_to_name(ni_config_event_loop_backend_t type)
+{
+	return ni_format_uint_mapped(type, config_event_loop_backend_names);
+}
+
+static ni_bool_t
+ni_config_event_loop_name_to_backend(const char *name, ni_config_event_loop_backend_t *type)
+{
+	unsigned int _type;
+
+	if (!name || !type)
+		return FALSE;
+
+	if (ni_parse_uint_mapped(name, config_event_loop_backend_names, &_type) != 0)
+		return FALSE;
+
+	*type = _type;
+	return TRUE;
+}
+
+ni_config_event_loop_backend_t
+ni_config_event_loop_backend(void)
+{
+	return ni_global.config ? ni_global.config->event_loop.backend : NI_CONFIG_EVENT_LOOP_EPOLL;
+}
+
+static ni_bool_t
+ni_config_parse_event_loop(ni_config_event_loop_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "backend")) {
+			if (!ni_config_event_loop_name_to_backend(child->cdata, &conf->backend)) {
+				ni_error("%s: invalid <event-loop><backend>%s</backend></event-loop> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * packet capture config options
+ */
+static const ni_intmap_t	config_packet_capture_backend_names[] = {
+	{ "ring",		NI_CONFIG_PACKET_CAPTURE_RING	},
+	{ "socket",		NI_CONFIG_PACKET_CAPTURE_SOCKET	},
+	{ NULL,			-1U				}
+};
+
+ni_config_packet_capture_backend_t
+ni_config_packet_capture_backend(void)
+{
+	return ni_global.config ? ni_global.config->packet_capture.backend : NI_CONFIG_PACKET_CAPTURE_RING;
+}
+
+static ni_bool_t
+ni_config_parse_packet_capture(ni_config_packet_capture_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int backend;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "backend")) {
+			if (!child->cdata || ni_parse_uint_mapped(child->cdata,
+					config_packet_capture_backend_names, &backend) != 0) {
+				ni_error("%s: invalid <packet-capture><backend>%s</backend></packet-capture> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->backend = backend;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * addrconf lease file config options
+ */
+static const ni_intmap_t	config_lease_file_format_names[] = {
+	{ "xml",		NI_CONFIG_LEASE_FILE_XML	},
+	{ "binary",		NI_CONFIG_LEASE_FILE_BINARY	},
+	{ NULL,			-1U				}
+};
+
+ni_config_lease_file_format_t
+ni_config_lease_file_format(void)
+{
+	return ni_global.config ? ni_global.config->addrconf.lease_file.format : NI_CONFIG_LEASE_FILE_XML;
+}
+
+static ni_bool_t
+ni_config_parse_lease_file(ni_config_lease_file_t *conf, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int format;
+
+	if (!conf || !node)
+		return FALSE;
+
+	for (child = node->children; child; child = child->next) {
+		if (ni_string_eq(child->name, "format")) {
+			if (!child->cdata || ni_parse_uint_mapped(child->cdata,
+					config_lease_file_format_names, &format) != 0) {
+				ni_error("%s: invalid <lease-file><format>%s</format></lease-file> option",
+						xml_node_location(child), child->cdata);
+				return FALSE;
+			}
+			conf->format = format;
+		}
+	}
+	return TRUE;
+}
+
+
 /*
  * bonding support config options
  */
@@ -24,11 +24,13 @@ struct ni_dbus_client {
 	char *			bus_name;
 	unsigned int		call_timeout;
 	const ni_intmap_t *	error_map;
+	ni_bool_t		track_properties;
 };
 
 struct ni_dbus_client_object {
 	ni_dbus_client_t *	client;
 	char *			default_interface;
+	ni_bool_t		properties_current;
 };
 
 
@@ -541,6 +543,8 @@ ni_dbus_object_get_managed_objects(ni_dbus_object_t *proxy, DBusError *error, ni
 			goto bad_reply;
 
 		descendant->stale = FALSE;
+		if (client->track_properties && descendant->client_object)
+			descendant->client_object->properties_current = TRUE;
 	}
 
 	if (purge)
@@ -747,6 +751,96 @@ __ni_dbus_object_refresh_properties(ni_dbus_object_t *proxy, const ni_dbus_servi
 	return TRUE;
 }
 
+/*
+ * Apply org.freedesktop.DBus.Properties.PropertiesChanged signals
+ * to the proxy objects below the root object.
+ *
+ * A proxy counts as current as long as it got all property changes
+ * since its last GetManagedObjects refresh. Properties gone on the
+ * server and merged dict properties cannot be reverted on the proxy,
+ * so these clear the flag and its next user does a full refresh.
+ */
+static void
+__ni_dbus_object_properties_changed_signal(ni_dbus_connection_t *conn, ni_dbus_message_t *msg, void *user_data)
+{
+	ni_dbus_object_t *root_object = user_data, *proxy;
+	const char *path = dbus_message_get_path(msg);
+	const ni_dbus_service_t *service;
+	const ni_dbus_property_t *property;
+	ni_dbus_client_object_t *cob;
+	ni_dbus_variant_t argv[3];
+	const char *relative_path;
+	unsigned int i;
+	int argc;
+
+	if (!ni_string_eq(dbus_message_get_member(msg), "PropertiesChanged"))
+		return;
+
+	if (!path || !(relative_path = ni_dbus_object_get_relative_path(root_object, path)))
+		return;
+	if (!(proxy = ni_dbus_object_lookup(root_object, relative_path)))
+		return;
+	if (!(cob = proxy->client_object) || !cob->properties_current)
+		return;
+
+	memset(argv, 0, sizeof(argv));
+	argc = ni_dbus_message_get_args_variants(msg, argv, 3);
+	if (argc != 3 || argv[0].type != DBUS_TYPE_STRING
+	 || !ni_dbus_variant_is_dict(&argv[1])
+	 || !ni_dbus_variant_is_string_array(&argv[2])) {
+		ni_debug_dbus("%s: bad PropertiesChanged signal", path);
+		cob->properties_current = FALSE;
+		goto out;
+	}
+
+	/* not a service we've got properties for */
+	if (!(service = ni_dbus_object_get_service(proxy, argv[0].string_value)))
+		goto out;
+
+	for (i = 0; i < argv[1].array.len; ++i) {
+		const ni_dbus_dict_entry_t *entry = &argv[1].dict_array_value[i];
+
+		property = __ni_dbus_service_get_property(service->properties, entry->key);
+		if (property && !property->set)
+			cob->properties_current = FALSE;
+
+		__ni_dbus_object_refresh_property(proxy, service, service->properties,
+				entry->key, &entry->datum);
+	}
+
+	if (argv[2].array.len)
+		cob->properties_current = FALSE;
+
+	ni_debug_dbus("%s: applied %u changed %s properties%s", path,
+			argv[1].array.len, service->name,
+			cob->properties_current ? "" : ", needs refresh");
+
+out:
+	for (i = 0; i < 3; ++i)
+		ni_dbus_variant_destroy(&argv[i]);
+}
+
+void
+ni_dbus_client_track_properties(ni_dbus_client_t *client, ni_dbus_object_t *root_object)
+{
+	if (!client || !root_object || client->track_properties)
+		return;
+
+	client->track_properties = TRUE;
+	ni_dbus_client_add_signal_handler(client, client->bus_name, NULL,
+					NI_DBUS_INTERFACE ".Properties",
+					__ni_dbus_object_properties_changed_signal,
+					root_object);
+}
+
+ni_bool_t
+ni_dbus_object_properties_current(const ni_dbus_object_t *proxy)
+{
+	ni_dbus_client_object_t *cob = proxy ? proxy->client_object : NULL;
+
+	return cob && cob->properties_current;
+}
+
 /*
  * Handle purging of stale objects
  */
@@ -909,6 +909,123 @@ ni_dbus_variant_sprint(const ni_dbus_variant_t *var)
 	return ni_dbus_variant_print(&sbuf, var);
 }
 
+/*
+ * Compute a 64bit FNV-1a digest of a variant, used to detect
+ * changes of property values without keeping a copy of them.
+ */
+#define NI_DBUS_DIGEST_FNV_OFFSET	14695981039346656037ULL
+#define NI_DBUS_DIGEST_FNV_PRIME	1099511628211ULL
+
+static uint64_t
+__ni_dbus_digest_data(uint64_t digest, const void *data, size_t len)
+{
+	const unsigned char *ptr = data;
+
+	while (ptr && len--) {
+		digest ^= *ptr++;
+		digest *= NI_DBUS_DIGEST_FNV_PRIME;
+	}
+	return digest;
+}
+
+static inline uint64_t
+__ni_dbus_digest_string(uint64_t digest, const char *str)
+{
+	/* include the NUL, so adjacent strings can't run into each other */
+	return __ni_dbus_digest_data(digest, str ? str : "", str ? strlen(str) + 1 : 1);
+}
+
+static uint64_t
+__ni_dbus_variant_digest(uint64_t digest, const ni_dbus_variant_t *var)
+{
+	unsigned int i;
+
+	digest = __ni_dbus_digest_data(digest, &var->type, sizeof(var->type));
+	switch (var->type) {
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		return __ni_dbus_digest_string(digest, var->string_value);
+
+	case DBUS_TYPE_BYTE:
+		return __ni_dbus_digest_data(digest, &var->byte_value, sizeof(var->byte_value));
+	case DBUS_TYPE_BOOLEAN:
+		return __ni_dbus_digest_data(digest, &var->bool_value, sizeof(var->bool_value));
+	case DBUS_TYPE_INT16:
+	case DBUS_TYPE_UINT16:
+		return __ni_dbus_digest_data(digest, &var->uint16_value, sizeof(var->uint16_value));
+	case DBUS_TYPE_INT32:
+	case DBUS_TYPE_UINT32:
+		return __ni_dbus_digest_data(digest, &var->uint32_value, sizeof(var->uint32_value));
+	case DBUS_TYPE_INT64:
+	case DBUS_TYPE_UINT64:
+		return __ni_dbus_digest_data(digest, &var->uint64_value, sizeof(var->uint64_value));
+	case DBUS_TYPE_DOUBLE:
+		return __ni_dbus_digest_data(digest, &var->double_value, sizeof(var->double_value));
+
+	case DBUS_TYPE_VARIANT:
+		if (var->variant_value)
+			digest = __ni_dbus_variant_digest(digest, var->variant_value);
+		return digest;
+
+	case DBUS_TYPE_STRUCT:
+		digest = __ni_dbus_digest_data(digest, &var->array.len, sizeof(var->array.len));
+		for (i = 0; i < var->array.len; ++i)
+			digest = __ni_dbus_variant_digest(digest, &var->struct_value[i]);
+		return digest;
+
+	case DBUS_TYPE_ARRAY:
+		break;
+
+	default:
+		return digest;
+	}
+
+	digest = __ni_dbus_digest_data(digest, &var->array.element_type, sizeof(var->array.element_type));
+	digest = __ni_dbus_digest_string(digest, var->array.element_signature);
+	digest = __ni_dbus_digest_data(digest, &var->array.len, sizeof(var->array.len));
+	switch (var->array.element_type) {
+	case DBUS_TYPE_BYTE:
+		digest = __ni_dbus_digest_data(digest, var->byte_array_value, var->array.len);
+		break;
+	case DBUS_TYPE_UINT32:
+		digest = __ni_dbus_digest_data(digest, var->uint32_array_value,
+						var->array.len * sizeof(uint32_t));
+		break;
+	case DBUS_TYPE_STRING:
+	case DBUS_TYPE_OBJECT_PATH:
+		for (i = 0; i < var->array.len; ++i)
+			digest = __ni_dbus_digest_string(digest, var->string_array_value[i]);
+		break;
+	case DBUS_TYPE_DICT_ENTRY:
+		for (i = 0; i < var->array.len; ++i) {
+			digest = __ni_dbus_digest_string(digest, var->dict_array_value[i].key);
+			digest = __ni_dbus_variant_digest(digest, &var->dict_array_value[i].datum);
+		}
+		break;
+	case DBUS_TYPE_INVALID:
+		if (var->array.element_signature == NULL)
+			break;
+		/* fallthrough */
+	case DBUS_TYPE_VARIANT:
+		for (i = 0; i < var->array.len; ++i)
+			digest = __ni_dbus_variant_digest(digest, &var->variant_array_value[i]);
+		break;
+	case DBUS_TYPE_STRUCT:
+		for (i = 0; i < var->array.len; ++i)
+			digest = __ni_dbus_variant_digest(digest, &var->struct_value[i]);
+		break;
+	default:
+		break;
+	}
+	return digest;
+}
+
+uint64_t
+ni_dbus_variant_digest(const ni_dbus_variant_t *var)
+{
+	return __ni_dbus_variant_digest(NI_DBUS_DIGEST_FNV_OFFSET, var);
+}
+
 dbus_bool_t
 ni_dbus_variant_parse(ni_dbus_variant_t *var,
 					const char *string_value, const char *signature)
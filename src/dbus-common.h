@@ -38,6 +38,8 @@ extern dbus_bool_t		ni_dbus_message_iter_append_uint32_array(DBusMessageIter *it
 
 extern const ni_dbus_property_t *__ni_dbus_service_get_property(const ni_dbus_property_t *, const char *);
 
+extern uint64_t		ni_dbus_variant_digest(const ni_dbus_variant_t *);
+
 
 /*
  * Efficient handling of dbus dicts
@@ -19,17 +19,59 @@
 
 static ni_dbus_object_t *	__ni_dbus_objects_trashcan;
 
+/*
+ * Index of all child objects by parent and name.
+ * A path index could not tell apart the client proxies and server
+ * objects, which use the same paths in one process -- resolving the
+ * path one name per level is independent of the number of objects.
+ */
+static ni_hash_table_t		__ni_dbus_objects_index = NI_HASH_TABLE_INIT;
+
 static dbus_bool_t		__ni_dbus_object_get_one_property(const ni_dbus_object_t *object,
 					const char *context,
 					const ni_dbus_property_t *property,
 					ni_dbus_variant_t *var,
 					DBusError *error);
 static const char *		__ni_dbus_object_child_path(const ni_dbus_object_t *, const char *);
+static void			__ni_dbus_dispatch_free(ni_dbus_dispatch_t *);
 
 const ni_dbus_class_t		ni_dbus_anonymous_class = {
 	.name = "<anonymous>"
 };
 
+/*
+ * Maintain the child object index
+ */
+static inline unsigned int
+__ni_dbus_object_index_hash(const ni_dbus_object_t *parent, const char *name, size_t len)
+{
+	return ni_hash_data(name, len) ^ ni_hash_data(&parent, sizeof(parent));
+}
+
+static void
+__ni_dbus_object_index_add(ni_dbus_object_t *child)
+{
+	if (!child->parent || !child->name)
+		return;
+
+	ni_hash_table_insert(&__ni_dbus_objects_index,
+			__ni_dbus_object_index_hash(child->parent, child->name,
+				strlen(child->name)), child);
+}
+
+static void
+__ni_dbus_object_index_del(ni_dbus_object_t *child)
+{
+	if (!child->parent || !child->name)
+		return;
+
+	ni_hash_table_remove(&__ni_dbus_objects_index,
+			__ni_dbus_object_index_hash(child->parent, child->name,
+				strlen(child->name)), child);
+	if (!__ni_dbus_objects_index.count)
+		ni_hash_table_destroy(&__ni_dbus_objects_index);
+}
+
 /*
  * Create a new dbus object
  */
@@ -71,6 +113,7 @@ __ni_dbus_object_new_child(ni_dbus_object_t *parent, const ni_dbus_class_t *obje
 	child->parent = parent;
 	__ni_dbus_object_insert(pos, child);
 	ni_string_dup(&child->name, name);
+	__ni_dbus_object_index_add(child);
 	if (parent->server_object)
 		__ni_dbus_server_object_inherit(child, parent);
 	if (parent->client_object)
@@ -105,6 +148,7 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 {
 	ni_dbus_object_t *child;
 
+	__ni_dbus_object_index_del(object);
 	__ni_dbus_object_unlink(object);
 	object->parent = NULL;
 
@@ -122,6 +166,7 @@ __ni_dbus_object_free(ni_dbus_object_t *object)
 	ni_string_free(&object->name);
 	ni_string_free(&object->path);
 
+	__ni_dbus_dispatch_free(object->interface_dispatch);
 	free(object->interfaces);
 	free(object);
 }
@@ -136,6 +181,7 @@ ni_dbus_object_free(ni_dbus_object_t *object)
 	if (object->pprev) {
 		ni_debug_dbus("%s: deferring deletion of active object %s",
 				__FUNCTION__, object->path);
+		__ni_dbus_object_index_del(object);
 		__ni_dbus_object_unlink(object);
 		object->parent = NULL;
 		__ni_dbus_object_insert(&__ni_dbus_objects_trashcan, object);
@@ -174,20 +220,38 @@ ni_dbus_object_translate_error(ni_dbus_object_t *obj, const DBusError *error)
 /*
  * Look up an object by its relative name
  */
+typedef struct ni_dbus_object_index_key {
+	const ni_dbus_object_t *	parent;
+	const char *			name;
+	size_t				len;
+} ni_dbus_object_index_key_t;
+
+static ni_bool_t
+__ni_dbus_object_index_match(const void *data, const void *ptr)
+{
+	const ni_dbus_object_t *child = data;
+	const ni_dbus_object_index_key_t *key = ptr;
+
+	return child->parent == key->parent &&
+		!strncmp(child->name, key->name, key->len) &&
+		child->name[key->len] == '\0';
+}
+
 static ni_dbus_object_t *
-__ni_dbus_object_get_child(ni_dbus_object_t *parent, const char *name)
+__ni_dbus_object_get_child(ni_dbus_object_t *parent, const char *name, size_t len)
 {
-	ni_dbus_object_t *child;
+	ni_dbus_object_index_key_t key = {
+		.parent = parent,
+		.name = name,
+		.len = len,
+	};
 
-	if (*name == '\0')
+	if (len == 0)
 		return parent;
 
-	for (child = parent->children; child; child = child->next) {
-		if (!strcmp(child->name, name))
-			return child;
-	}
-
-	return NULL;
+	return ni_hash_table_find(&__ni_dbus_objects_index,
+			__ni_dbus_object_index_hash(parent, name, len),
+			__ni_dbus_object_index_match, &key);
 }
 
 static ni_dbus_object_t *
@@ -195,8 +259,9 @@ __ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path, int cre
 				const ni_dbus_class_t *object_class,
 				void *object_handle)
 {
-	char *path_copy = NULL, *name, *next_name;
 	ni_dbus_object_t *found;
+	char *name = NULL;
+	size_t len;
 
 	if (path == NULL)
 		return root_object;
@@ -216,16 +281,18 @@ __ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path, int cre
 		path = relative_path;
 	}
 
-	ni_string_dup(&path_copy, path);
-
 	found = root_object;
-	for (name = strtok(path_copy, "/"); name && found; name = next_name) {
+	while (found) {
 		ni_dbus_object_t *child;
 
-		next_name = strtok(NULL, "/");
-		child = __ni_dbus_object_get_child(found, name);
+		path += strspn(path, "/");
+		if (!(len = strcspn(path, "/")))
+			break;
+
+		child = __ni_dbus_object_get_child(found, path, len);
 		if (child == NULL && create) {
-			if (next_name != NULL) {
+			ni_string_set(&name, path, len);
+			if (path[len + strspn(path + len, "/")] != '\0') {
 				/* Intermediate path component */
 				child = __ni_dbus_object_new_child(found, NULL, name, NULL);
 			} else {
@@ -234,9 +301,10 @@ __ni_dbus_object_lookup(ni_dbus_object_t *root_object, const char *path, int cre
 			}
 		}
 		found = child;
+		path += len;
 	}
 
-	ni_string_free(&path_copy);
+	ni_string_free(&name);
 	return found;
 }
 
@@ -295,24 +363,205 @@ ni_dbus_object_find_descendant_by_handle(const ni_dbus_object_t *parent, const v
 	return found;
 }
 
+/*
+ * Dispatch tables: the names of the methods, signals, properties of
+ * a service or of the interfaces of an object, sorted for a binary
+ * search. Equal names are kept in table order, so the first one wins.
+ *
+ * The method, signal and property tables are static or owned by the
+ * service and never freed, so their dispatch tables are built on the
+ * first lookup and kept in an index by table address.
+ */
+typedef struct ni_dbus_dispatch_entry {
+	const char *		name;
+	const void *		member;
+	unsigned int		index;
+} ni_dbus_dispatch_entry_t;
+
+struct ni_dbus_dispatch {
+	const void *		table;
+	unsigned int		count;
+	ni_dbus_dispatch_entry_t *entries;
+};
+
+static ni_hash_table_t		__ni_dbus_dispatch_tables = NI_HASH_TABLE_INIT;
+
+static ni_dbus_dispatch_t *
+__ni_dbus_dispatch_new(const void *table, unsigned int count)
+{
+	ni_dbus_dispatch_t *dispatch;
+
+	dispatch = xcalloc(1, sizeof(*dispatch));
+	dispatch->table = table;
+	dispatch->count = count;
+	if (count)
+		dispatch->entries = xcalloc(count, sizeof(dispatch->entries[0]));
+	return dispatch;
+}
+
+static void
+__ni_dbus_dispatch_free(ni_dbus_dispatch_t *dispatch)
+{
+	if (dispatch) {
+		free(dispatch->entries);
+		free(dispatch);
+	}
+}
+
+static inline void
+__ni_dbus_dispatch_set(ni_dbus_dispatch_t *dispatch, unsigned int index,
+			const char *name, const void *member)
+{
+	dispatch->entries[index].name = name;
+	dispatch->entries[index].member = member;
+	dispatch->entries[index].index = index;
+}
+
+static int
+__ni_dbus_dispatch_cmp(const void *a, const void *b)
+{
+	const ni_dbus_dispatch_entry_t *x = a, *y = b;
+	int r;
+
+	if ((r = strcmp(x->name, y->name)))
+		return r;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static int
+__ni_dbus_dispatch_casecmp(const void *a, const void *b)
+{
+	const ni_dbus_dispatch_entry_t *x = a, *y = b;
+	int r;
+
+	if ((r = strcasecmp(x->name, y->name)))
+		return r;
+	return x->index < y->index ? -1 : x->index > y->index;
+}
+
+static void
+__ni_dbus_dispatch_sort(ni_dbus_dispatch_t *dispatch, ni_bool_t nocase)
+{
+	if (dispatch->count > 1) {
+		qsort(dispatch->entries, dispatch->count, sizeof(dispatch->entries[0]),
+			nocase ? __ni_dbus_dispatch_casecmp : __ni_dbus_dispatch_cmp);
+	}
+}
+
+static void *
+__ni_dbus_dispatch_find(const ni_dbus_dispatch_t *dispatch, const char *name, ni_bool_t nocase)
+{
+	unsigned int lo = 0, hi, mid;
+	int r;
+
+	if (!dispatch || !name)
+		return NULL;
+
+	/* lower bound of the name */
+	hi = dispatch->count;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (nocase)
+			r = strcasecmp(dispatch->entries[mid].name, name);
+		else
+			r = strcmp(dispatch->entries[mid].name, name);
+		if (r < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == dispatch->count)
+		return NULL;
+	if (nocase ? strcasecmp(dispatch->entries[lo].name, name) :
+		     strcmp(dispatch->entries[lo].name, name))
+		return NULL;
+	return (void *) dispatch->entries[lo].member;
+}
+
+static ni_bool_t
+__ni_dbus_dispatch_match_table(const void *data, const void *table)
+{
+	const ni_dbus_dispatch_t *dispatch = data;
+
+	return dispatch->table == table;
+}
+
+static inline unsigned int
+__ni_dbus_dispatch_table_hash(const void *table)
+{
+	return ni_hash_data(&table, sizeof(table));
+}
+
+static const ni_dbus_dispatch_t *
+__ni_dbus_method_dispatch(const ni_dbus_method_t *methods)
+{
+	unsigned int hash = __ni_dbus_dispatch_table_hash(methods);
+	ni_dbus_dispatch_t *dispatch;
+	unsigned int count;
+
+	dispatch = ni_hash_table_find(&__ni_dbus_dispatch_tables, hash,
+			__ni_dbus_dispatch_match_table, methods);
+	if (dispatch)
+		return dispatch;
+
+	for (count = 0; methods[count].name; ++count)
+		;
+	dispatch = __ni_dbus_dispatch_new(methods, count);
+	for (count = 0; methods[count].name; ++count)
+		__ni_dbus_dispatch_set(dispatch, count, methods[count].name, &methods[count]);
+	__ni_dbus_dispatch_sort(dispatch, FALSE);
+
+	ni_hash_table_insert(&__ni_dbus_dispatch_tables, hash, dispatch);
+	return dispatch;
+}
+
+static const ni_dbus_dispatch_t *
+__ni_dbus_property_dispatch(const ni_dbus_property_t *properties)
+{
+	unsigned int hash = __ni_dbus_dispatch_table_hash(properties);
+	ni_dbus_dispatch_t *dispatch;
+	unsigned int count;
+
+	dispatch = ni_hash_table_find(&__ni_dbus_dispatch_tables, hash,
+			__ni_dbus_dispatch_match_table, properties);
+	if (dispatch)
+		return dispatch;
+
+	for (count = 0; properties[count].name; ++count)
+		;
+	dispatch = __ni_dbus_dispatch_new(properties, count);
+	for (count = 0; properties[count].name; ++count)
+		__ni_dbus_dispatch_set(dispatch, count, properties[count].name, &properties[count]);
+	__ni_dbus_dispatch_sort(dispatch, FALSE);
+
+	ni_hash_table_insert(&__ni_dbus_dispatch_tables, hash, dispatch);
+	return dispatch;
+}
+
 /*
  * Look up an object interface by name
  */
 const ni_dbus_service_t *
 ni_dbus_object_get_service(const ni_dbus_object_t *object, const char *interface)
 {
+	ni_dbus_object_t *obj = (ni_dbus_object_t *) object;
 	const ni_dbus_service_t *svc;
-	unsigned int i;
+	unsigned int count;
 
-	if (object == NULL || object->interfaces == NULL)
+	if (object == NULL || object->interfaces == NULL || interface == NULL)
 		return NULL;
 
-	for (i = 0; (svc = object->interfaces[i]) != NULL; ++i) {
-		if (!strcasecmp(svc->name, interface))
-			return svc;
+	if (!obj->interface_dispatch) {
+		for (count = 0; object->interfaces[count]; ++count)
+			;
+		obj->interface_dispatch = __ni_dbus_dispatch_new(object->interfaces, count);
+		for (count = 0; (svc = object->interfaces[count]); ++count)
+			__ni_dbus_dispatch_set(obj->interface_dispatch, count, svc->name, svc);
+		__ni_dbus_dispatch_sort(obj->interface_dispatch, TRUE);
 	}
 
-	return NULL;
+	return __ni_dbus_dispatch_find(object->interface_dispatch, interface, TRUE);
 }
 
 /*
@@ -503,6 +752,9 @@ ni_dbus_object_register_service(ni_dbus_object_t *object, const ni_dbus_service_
 	object->interfaces[count++] = svc;
 	object->interfaces[count] = NULL;
 
+	__ni_dbus_dispatch_free(object->interface_dispatch);
+	object->interface_dispatch = NULL;
+
 	if (svc->properties)
 		ni_dbus_object_register_property_interface(object);
 	return TRUE;
@@ -514,15 +766,9 @@ ni_dbus_object_register_service(ni_dbus_object_t *object, const ni_dbus_service_
 const ni_dbus_method_t *
 ni_dbus_service_get_method(const ni_dbus_service_t *service, const char *name)
 {
-	const ni_dbus_method_t *method;
-
-	if (service->methods == NULL)
+	if (service->methods == NULL || name == NULL)
 		return NULL;
-	for (method = service->methods; method->name; ++method) {
-		if (!strcmp(method->name, name))
-			return method;
-	}
-	return NULL;
+	return __ni_dbus_dispatch_find(__ni_dbus_method_dispatch(service->methods), name, FALSE);
 }
 
 /*
@@ -531,15 +777,9 @@ ni_dbus_service_get_method(const ni_dbus_service_t *service, const char *name)
 const ni_dbus_method_t *
 ni_dbus_service_get_signal(const ni_dbus_service_t *service, const char *name)
 {
-	const ni_dbus_method_t *method;
-
-	if (service->signals == NULL)
+	if (service->signals == NULL || name == NULL)
 		return NULL;
-	for (method = service->signals; method->name; ++method) {
-		if (!strcmp(method->name, name))
-			return method;
-	}
-	return NULL;
+	return __ni_dbus_dispatch_find(__ni_dbus_method_dispatch(service->signals), name, FALSE);
 }
 
 
@@ -549,15 +789,23 @@ ni_dbus_service_get_signal(const ni_dbus_service_t *service, const char *name)
 const ni_dbus_property_t *
 __ni_dbus_service_get_property(const ni_dbus_property_t *property_list, const char *name)
 {
-	const ni_dbus_property_t *property;
-
-	if (property_list == NULL)
+	if (property_list == NULL || name == NULL)
 		return NULL;
-	for (property = property_list; property->name; ++property) {
-		if (!strcmp(property->name, name))
-			return property;
-	}
-	return NULL;
+	return __ni_dbus_dispatch_find(__ni_dbus_property_dispatch(property_list), name, FALSE);
+}
+
+/*
+ * Build the dispatch tables of a service in advance
+ */
+void
+ni_dbus_service_index(const ni_dbus_service_t *service)
+{
+	if (service->methods)
+		__ni_dbus_method_dispatch(service->methods);
+	if (service->signals)
+		__ni_dbus_method_dispatch(service->signals);
+	if (service->properties)
+		__ni_dbus_property_dispatch(service->properties);
 }
 
 const ni_dbus_property_t *
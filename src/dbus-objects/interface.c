@@ -1248,6 +1248,10 @@ __ni_objectmodel_device_event(ni_dbus_server_t *server, ni_dbus_object_t *object
 
 	ni_debug_dbus("sending device event \"%s\" for %s; uuid=<%s>", signal_name,
 			ni_dbus_object_get_path(object), uuid ? ni_uuid_print(uuid) : "");
+
+	/* properties changed are sent along, before the signal */
+	if (ifevent != NI_EVENT_DEVICE_DELETE)
+		ni_dbus_object_properties_changed(object);
 	ni_dbus_server_send_signal(server, object, interface, signal_name, argc, &arg);
 
 	ni_dbus_variant_destroy(&arg);
@@ -51,6 +51,8 @@ static ni_dbus_service_array_t	ni_objectmodel_service_registry;
 
 static ni_dbus_service_t	ni_objectmodel_netif_root_interface;
 
+static void			ni_objectmodel_index_services(void);
+
 ni_dbus_server_t *		__ni_objectmodel_server;
 ni_xs_scope_t *			__ni_objectmodel_schema;
 
@@ -102,11 +104,27 @@ ni_objectmodel_init(ni_dbus_server_t *server)
 
 		/* Bind all extensions */
 		ni_objectmodel_bind_extensions();
+
+		/* Build the method and property dispatch tables */
+		ni_objectmodel_index_services();
 	}
 
 	return __ni_objectmodel_schema;
 }
 
+/*
+ * Build the method, signal and property dispatch tables of all
+ * registered services, once their handlers are bound.
+ */
+static void
+ni_objectmodel_index_services(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ni_objectmodel_service_registry.count; ++i)
+		ni_dbus_service_index(ni_objectmodel_service_registry.services[i]);
+}
+
 void
 ni_objectmodel_register_all(void)
 {
@@ -18,10 +18,27 @@
 #include "util_priv.h"
 
 
+/*
+ * Digest of a property value, as last handed out to the clients
+ * by GetManagedObjects, GetAll or a PropertiesChanged signal.
+ * An entry without name marks a service as seen by the clients.
+ */
+typedef struct ni_dbus_property_digest {
+	const ni_dbus_service_t *service;
+	const char *		name;
+	uint64_t		digest;
+} ni_dbus_property_digest_t;
+
 struct ni_dbus_server_object {
 	ni_dbus_server_t *	server;			/* back pointer at server */
+
+	ni_bool_t		properties_changed;	/* queued on the server */
+	unsigned int		num_digests;
+	ni_dbus_property_digest_t *digests;
 };
 
+#define NI_DBUS_CHANGED_CHUNK	16
+
 static const ni_dbus_class_t	dbus_root_object_class = {
 	.name = "<root>",
 };
@@ -29,12 +46,20 @@ static const ni_dbus_class_t	dbus_root_object_class = {
 struct ni_dbus_server {
 	ni_dbus_connection_t *	connection;
 	ni_dbus_object_t *	root_object;
+
+	/* objects with pending PropertiesChanged signals */
+	unsigned int		num_changed;
+	ni_dbus_object_t **	changed;
 };
 
 static dbus_bool_t		ni_dbus_object_register_object_manager(ni_dbus_object_t *);
 static dbus_bool_t		ni_dbus_object_register_introspectable_interface(ni_dbus_object_t *);
 static const char *		__ni_dbus_server_root_path(const char *);
 static void			__ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server);
+static void			__ni_dbus_server_object_send_properties_changed(ni_dbus_object_t *);
+static void			__ni_dbus_server_unqueue_changed(ni_dbus_server_t *, ni_dbus_object_t *);
+static void			__ni_dbus_server_object_set_digests(ni_dbus_object_t *,
+					const ni_dbus_service_t *, const ni_dbus_variant_t *);
 
 /*
  * Constructor for DBus server handle
@@ -79,6 +104,7 @@ ni_dbus_server_free(ni_dbus_server_t *server)
 		ni_dbus_connection_free(server->connection);
 	server->connection = NULL;
 
+	free(server->changed);
 	free(server);
 }
 
@@ -117,11 +143,29 @@ __ni_dbus_server_object_init(ni_dbus_object_t *object, ni_dbus_server_t *server)
 
 /*
  * Send a signal
+ *
+ * Pending property changes of the object are sent first, so that
+ * clients handling the signal see the current object properties.
  */
+static dbus_bool_t	__ni_dbus_server_send_signal(ni_dbus_server_t *, ni_dbus_object_t *,
+				const char *, const char *,
+				unsigned int, const ni_dbus_variant_t *);
+
 dbus_bool_t
 ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
 				const char *interface, const char *signal_name,
 				unsigned int nargs, const ni_dbus_variant_t *args)
+{
+	if (object->server_object && object->server_object->properties_changed)
+		__ni_dbus_server_object_send_properties_changed(object);
+
+	return __ni_dbus_server_send_signal(server, object, interface, signal_name, nargs, args);
+}
+
+static dbus_bool_t
+__ni_dbus_server_send_signal(ni_dbus_server_t *server, ni_dbus_object_t *object,
+				const char *interface, const char *signal_name,
+				unsigned int nargs, const ni_dbus_variant_t *args)
 {
 	const ni_dbus_service_t *svc = NULL;
 	const ni_dbus_method_t *method;
@@ -189,11 +233,302 @@ __ni_dbus_server_object_destroy(ni_dbus_object_t *object)
 		ni_dbus_connection_unregister_object(server->connection, object);
 
 	if (object->server_object) {
-		free(object->server_object);
+		ni_dbus_server_object_t *sob = object->server_object;
+
+		if (server && sob->properties_changed)
+			__ni_dbus_server_unqueue_changed(server, object);
+
+		free(sob->digests);
+		free(sob);
 		object->server_object = NULL;
 	}
 }
 
+/*
+ * Property change notification.
+ *
+ * The server keeps a digest of the property values of an object as its
+ * clients have seen them. When the object is marked as changed, it is
+ * queued and the next ni_dbus_server_send_properties_changed() call (once
+ * per main loop turn) or the next signal sent about it compares the
+ * current values with the digests and emits the standard
+ * org.freedesktop.DBus.Properties.PropertiesChanged signal for each
+ * service, carrying only the properties which changed or disappeared.
+ * A client retrieving the properties of an object which has not been
+ * marked triggers the same comparison, so the other clients do not
+ * keep values which differ from the new digests.
+ *
+ * Services the clients never retrieved have no digests and are skipped.
+ */
+void
+ni_dbus_object_properties_changed(ni_dbus_object_t *object)
+{
+	ni_dbus_server_object_t *sob;
+	ni_dbus_server_t *server;
+
+	if (!object || !(sob = object->server_object) || !(server = sob->server))
+		return;
+
+	if (sob->properties_changed || !sob->num_digests)
+		return;
+
+	sob->properties_changed = TRUE;
+	if ((server->num_changed % NI_DBUS_CHANGED_CHUNK) == 0) {
+		server->changed = xrealloc(server->changed,
+				(server->num_changed + NI_DBUS_CHANGED_CHUNK) *
+				sizeof(server->changed[0]));
+	}
+	server->changed[server->num_changed++] = object;
+}
+
+void
+ni_dbus_server_send_properties_changed(ni_dbus_server_t *server)
+{
+	ni_dbus_object_t **changed, *object;
+	unsigned int i, count;
+
+	if (!server || !server->num_changed)
+		return;
+
+	changed = server->changed;
+	count = server->num_changed;
+	server->changed = NULL;
+	server->num_changed = 0;
+
+	for (i = 0; i < count; ++i) {
+		object = changed[i];
+		object->server_object->properties_changed = FALSE;
+		__ni_dbus_server_object_send_properties_changed(object);
+	}
+	free(changed);
+}
+
+static void
+__ni_dbus_server_unqueue_changed(ni_dbus_server_t *server, ni_dbus_object_t *object)
+{
+	unsigned int i;
+
+	for (i = 0; i < server->num_changed; ++i) {
+		if (server->changed[i] != object)
+			continue;
+		server->num_changed--;
+		memmove(&server->changed[i], &server->changed[i + 1],
+			(server->num_changed - i) * sizeof(server->changed[0]));
+		break;
+	}
+}
+
+static inline ni_dbus_property_digest_t *
+__ni_dbus_server_object_find_digest(ni_dbus_server_object_t *sob,
+				const ni_dbus_service_t *service, const char *name)
+{
+	ni_dbus_property_digest_t *d;
+	unsigned int i;
+
+	for (i = 0, d = sob->digests; i < sob->num_digests; ++i, ++d) {
+		if (d->service != service)
+			continue;
+		if (name == NULL ? d->name == NULL : ni_string_eq(d->name, name))
+			return d;
+	}
+	return NULL;
+}
+
+static void
+__ni_dbus_server_object_set_digests(ni_dbus_object_t *object,
+				const ni_dbus_service_t *service,
+				const ni_dbus_variant_t *dict)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+	ni_dbus_property_digest_t *d;
+	unsigned int i, j;
+
+	if (!sob)
+		return;
+
+	/* drop the digests of the service */
+	for (i = j = 0; i < sob->num_digests; ++i) {
+		if (sob->digests[i].service != service)
+			sob->digests[j++] = sob->digests[i];
+	}
+	sob->num_digests = j;
+
+	sob->digests = xrealloc(sob->digests,
+			(sob->num_digests + dict->array.len + 1) * sizeof(*d));
+
+	d = &sob->digests[sob->num_digests++];
+	d->service = service;
+	d->name = NULL;
+	d->digest = 0;
+
+	for (i = 0; i < dict->array.len; ++i) {
+		const ni_dbus_dict_entry_t *entry = &dict->dict_array_value[i];
+
+		d = &sob->digests[sob->num_digests++];
+		d->service = service;
+		d->name = entry->key;
+		d->digest = ni_dbus_variant_digest(&entry->datum);
+	}
+}
+
+/*
+ * Move the properties which differ from their digests into the changed
+ * dict, record the names of the ones gone in the invalidated array and
+ * update the digests.
+ */
+static void
+__ni_dbus_server_object_diff_properties(ni_dbus_object_t *object,
+				const ni_dbus_service_t *service,
+				ni_dbus_variant_t *dict,
+				ni_dbus_variant_t *changed,
+				ni_dbus_variant_t *invalidated)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+	ni_dbus_property_digest_t *d;
+	unsigned int i, j;
+
+	for (i = 0; i < dict->array.len; ++i) {
+		ni_dbus_dict_entry_t *entry = &dict->dict_array_value[i];
+		uint64_t digest = ni_dbus_variant_digest(&entry->datum);
+		ni_dbus_variant_t *var;
+
+		if ((d = __ni_dbus_server_object_find_digest(sob, service, entry->key))) {
+			if (d->digest == digest)
+				continue;
+		} else {
+			sob->digests = xrealloc(sob->digests,
+					(sob->num_digests + 1) * sizeof(*d));
+			d = &sob->digests[sob->num_digests++];
+			d->service = service;
+			d->name = entry->key;
+		}
+		d->digest = digest;
+
+		var = ni_dbus_dict_add(changed, entry->key);
+		*var = entry->datum;
+		memset(&entry->datum, 0, sizeof(entry->datum));
+	}
+
+	for (i = j = 0; i < sob->num_digests; ++i) {
+		d = &sob->digests[i];
+		if (d->service == service && d->name && !ni_dbus_dict_get(dict, d->name)) {
+			ni_dbus_variant_append_string_array(invalidated, d->name);
+			continue;
+		}
+		sob->digests[j++] = *d;
+	}
+	sob->num_digests = j;
+}
+
+/*
+ * Check whether the properties of a service differ from the digests
+ * the clients have seen: a value changed, appeared or disappeared.
+ */
+static ni_bool_t
+__ni_dbus_server_object_digests_differ(ni_dbus_object_t *object,
+				const ni_dbus_service_t *service,
+				const ni_dbus_variant_t *dict)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+	ni_dbus_property_digest_t *d;
+	unsigned int i, count = 0;
+
+	for (i = 0, d = sob->digests; i < sob->num_digests; ++i, ++d) {
+		if (d->service == service && d->name)
+			count++;
+	}
+	if (count != dict->array.len)
+		return TRUE;
+
+	for (i = 0; i < dict->array.len; ++i) {
+		const ni_dbus_dict_entry_t *entry = &dict->dict_array_value[i];
+
+		d = __ni_dbus_server_object_find_digest(sob, service, entry->key);
+		if (!d || d->digest != ni_dbus_variant_digest(&entry->datum))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+__ni_dbus_server_object_send_service_changed(ni_dbus_object_t *object,
+				const ni_dbus_service_t *service)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+	ni_dbus_variant_t dict = NI_DBUS_VARIANT_INIT;
+	ni_dbus_variant_t argv[3];
+
+	ni_dbus_variant_init_dict(&dict);
+	if (!ni_dbus_object_get_properties_as_dict(object, service, &dict, NULL)) {
+		ni_dbus_variant_destroy(&dict);
+		return;
+	}
+
+	memset(argv, 0, sizeof(argv));
+	ni_dbus_variant_set_string(&argv[0], service->name);
+	ni_dbus_variant_init_dict(&argv[1]);
+	ni_dbus_variant_init_string_array(&argv[2]);
+
+	__ni_dbus_server_object_diff_properties(object, service, &dict, &argv[1], &argv[2]);
+	if (argv[1].array.len || argv[2].array.len) {
+		ni_debug_dbus("%s: %s properties changed (%u changed, %u invalidated)",
+				object->path, service->name,
+				argv[1].array.len, argv[2].array.len);
+		__ni_dbus_server_send_signal(sob->server, object,
+				NI_DBUS_INTERFACE ".Properties", "PropertiesChanged",
+				3, argv);
+	}
+
+	ni_dbus_variant_destroy(&argv[0]);
+	ni_dbus_variant_destroy(&argv[1]);
+	ni_dbus_variant_destroy(&argv[2]);
+	ni_dbus_variant_destroy(&dict);
+}
+
+static void
+__ni_dbus_server_object_send_properties_changed(ni_dbus_object_t *object)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+	const ni_dbus_service_t *service;
+	unsigned int i;
+
+	if (sob->properties_changed) {
+		__ni_dbus_server_unqueue_changed(sob->server, object);
+		sob->properties_changed = FALSE;
+	}
+
+	for (i = 0; object->interfaces && (service = object->interfaces[i]); ++i) {
+		if (!service->properties)
+			continue;
+		if (!__ni_dbus_server_object_find_digest(sob, service, NULL))
+			continue;
+
+		__ni_dbus_server_object_send_service_changed(object, service);
+	}
+}
+
+/*
+ * A client retrieved the properties of a service. When they differ from
+ * what the other clients have seen, because the object has not been
+ * marked as changed (yet), the change is signaled to them before the
+ * reply is sent. Otherwise, the digests are initialized.
+ */
+static void
+__ni_dbus_server_object_properties_retrieved(ni_dbus_object_t *object,
+				const ni_dbus_service_t *service,
+				const ni_dbus_variant_t *dict)
+{
+	ni_dbus_server_object_t *sob = object->server_object;
+
+	if (!sob || !service->properties)
+		return;
+
+	if (!__ni_dbus_server_object_find_digest(sob, service, NULL))
+		__ni_dbus_server_object_set_digests(object, service, dict);
+	else if (__ni_dbus_server_object_digests_differ(object, service, dict))
+		__ni_dbus_server_object_send_service_changed(object, service);
+}
+
 /*
  * Register an object
  */
@@ -369,6 +704,8 @@ __ni_dbus_object_properties_getall(ni_dbus_object_t *object, const ni_dbus_metho
 	ni_dbus_variant_init_dict(&dict);
 	if (service != NULL) {
 		rv = ni_dbus_object_get_properties_as_dict(object, service, &dict, error);
+		if (rv)
+			__ni_dbus_server_object_properties_retrieved(object, service, &dict);
 	} else {
 		unsigned int i;
 
@@ -473,9 +810,15 @@ static ni_dbus_method_t	__ni_dbus_object_properties_methods[] = {
 	{ NULL }
 };
 
+static ni_dbus_method_t	__ni_dbus_object_properties_signals[] = {
+	{ "PropertiesChanged",	"sa{sv}as" },
+	{ NULL }
+};
+
 static const ni_dbus_service_t __ni_dbus_object_properties_interface = {
 	.name = NI_DBUS_INTERFACE ".Properties",
 	.methods = __ni_dbus_object_properties_methods,
+	.signals = __ni_dbus_object_properties_signals,
 };
 
 static dbus_bool_t
@@ -522,6 +865,8 @@ __ni_dbus_object_manager_enumerate_object(ni_dbus_object_t *object, ni_dbus_vari
 
 			ni_dbus_variant_init_dict(propdict);
 			rv = ni_dbus_object_get_properties_as_dict(object, service, propdict, error);
+			if (rv)
+				__ni_dbus_server_object_properties_retrieved(object, service, propdict);
 		}
 	}
 
@@ -774,6 +774,7 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 	if (scalar_info->constraint.bitmask) {
 		const ni_intmap_t *bits = scalar_info->constraint.bitmask->bits;
 		ni_string_array_t bit_name_arr = NI_STRING_ARRAY_INIT;
+		char *bit_names = NULL;
 		unsigned long value = 0;
 
 		if (!ni_dbus_variant_get_ulong(var, &value))
@@ -792,14 +793,17 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 			ni_string_array_append(&bit_name_arr, num);
 		}
 
-		ni_string_join(&node->cdata, &bit_name_arr, " | ");
+		ni_string_join(&bit_names, &bit_name_arr, " | ");
+		xml_node_set_cdata(node, bit_names);
 		ni_string_array_destroy(&bit_name_arr);
+		ni_string_free(&bit_names);
 		return TRUE;
 	}
 
 	if (scalar_info->constraint.bitmap) {
 		const ni_intmap_t *bits = scalar_info->constraint.bitmap->bits;
 		ni_string_array_t bit_name_arr = NI_STRING_ARRAY_INIT;
+		char *bit_names = NULL;
 		unsigned long value = 0;
 		unsigned int bb;
 
@@ -818,10 +822,12 @@ ni_dbus_deserialize_xml_scalar(const ni_dbus_variant_t *var, const ni_xs_type_t
 				ni_warn("unable to represent bit%u in <%s>", bb, node->name);
 		}
 
-		if (!ni_string_join(&node->cdata, &bit_name_arr, ", "))
+		if (!ni_string_join(&bit_names, &bit_name_arr, ", "))
 			ni_debug_dbus("Empty bit names string obtained.");
+		xml_node_set_cdata(node, bit_names);
 
 		ni_string_array_destroy(&bit_name_arr);
+		ni_string_free(&bit_names);
 
 		return TRUE;
 	}
@@ -370,6 +370,7 @@ ni_dhcp4_tester_run(ni_dhcp4_tester_t *opts)
 	ni_socket_deactivate_all();
 
 failure:
+	ni_addrconf_lease_file_flush();
 	if (dev)
 		ni_dhcp4_device_put(dev);
 	if (req)
@@ -42,6 +42,7 @@
 #include "appconfig.h"
 #include "util_priv.h"
 #include "netinfo_priv.h"
+#include "socket_priv.h"
 #include "iaid.h"
 #include "duid.h"
 #include "dhcp.h"
@@ -798,6 +799,17 @@ ni_dhcp6_device_transmit_arm_delay(ni_dhcp6_device_t *dev)
 	return TRUE;
 }
 
+/*
+ * The retransmission deadline is checked by the multicast socket
+ * timeout callback; tell the socket layer when it has changed.
+ */
+static inline void
+ni_dhcp6_device_retransmit_update(ni_dhcp6_device_t *dev)
+{
+	if (dev->mcast.sock)
+		ni_socket_update_timeout(dev->mcast.sock);
+}
+
 static void
 ni_dhcp6_device_retransmit_arm(ni_dhcp6_device_t *dev)
 {
@@ -876,6 +888,7 @@ ni_dhcp6_device_retransmit_arm(ni_dhcp6_device_t *dev)
 		 */
 		ni_dhcp6_fsm_set_timeout_msec(dev, dev->retrans.duration);
 	}
+	ni_dhcp6_device_retransmit_update(dev);
 }
 
 void
@@ -892,6 +905,7 @@ ni_dhcp6_device_retransmit_disarm(ni_dhcp6_device_t *dev)
 
 	dev->dhcp6.xid = 0;
 	memset(&dev->retrans, 0, sizeof(dev->retrans));
+	ni_dhcp6_device_retransmit_update(dev);
 }
 
 static ni_bool_t
@@ -932,6 +946,7 @@ ni_dhcp6_device_retransmit_advance(ni_dhcp6_device_t *dev)
 				dev->retrans.params.jitter.min,
 				dev->retrans.params.jitter.max);
 
+		ni_dhcp6_device_retransmit_update(dev);
 		return TRUE;
 	}
 	ni_debug_dhcp("%s: xid 0x%06x retransmission limit reached", dev->ifname, dev->dhcp6.xid);
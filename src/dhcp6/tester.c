@@ -421,6 +421,7 @@ ni_dhcp6_tester_run(ni_dhcp6_tester_t *opts)
 	ni_socket_deactivate_all();
 
 failure:
+	ni_addrconf_lease_file_flush();
 	if (dev)
 		ni_dhcp6_device_put(dev);
 	if (req)
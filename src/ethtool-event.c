@@ -0,0 +1,375 @@
+/*
+ *	wicked ethtool netlink event listener
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License
+ *	along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *	The ethtool generic netlink family (linux >= 5.6) sends a message
+ *	to its "monitor" multicast group whenever a setting of a device
+ *	is changed, regardless if via netlink or the ethtool ioctl.
+ *	We use them to invalidate the categories in the device ethtool
+ *	cache, so a RTM_NEWLINK does not need to query all of them again.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <linux/genetlink.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/ethtool.h>
+
+#include "netinfo_priv.h"
+#include "socket_priv.h"
+
+#if defined(HAVE_LINUX_ETHTOOL_NETLINK_H)
+#include <linux/ethtool_netlink.h>
+
+/* all notifications carry the device header as first attribute */
+#define NI_ETHTOOL_A_NTF_HEADER		ETHTOOL_A_LINKINFO_HEADER
+
+typedef struct ni_ethtool_event_handle {
+	struct nl_sock *	nlsock;
+	unsigned int		family;
+	unsigned int		group;
+} ni_ethtool_event_handle_t;
+
+static ni_socket_t *		__ni_ethtool_event_sock;
+
+static const struct {
+	unsigned int		cmd;
+	unsigned int		categories;
+} __ni_ethtool_event_map[] = {
+	{ ETHTOOL_MSG_LINKINFO_NTF,	NI_ETHTOOL_CACHE_LINK_SETTINGS	},
+	{ ETHTOOL_MSG_LINKMODES_NTF,	NI_ETHTOOL_CACHE_LINK_SETTINGS	},
+	{ ETHTOOL_MSG_WOL_NTF,		NI_ETHTOOL_CACHE_WAKE_ON_LAN	},
+	{ ETHTOOL_MSG_FEATURES_NTF,	NI_ETHTOOL_CACHE_FEATURES	},
+	{ ETHTOOL_MSG_PRIVFLAGS_NTF,	NI_ETHTOOL_CACHE_PRIV_FLAGS	},
+	{ ETHTOOL_MSG_RINGS_NTF,	NI_ETHTOOL_CACHE_RING		},
+	{ ETHTOOL_MSG_CHANNELS_NTF,	NI_ETHTOOL_CACHE_CHANNELS	},
+	{ ETHTOOL_MSG_COALESCE_NTF,	NI_ETHTOOL_CACHE_COALESCE	},
+	{ ETHTOOL_MSG_PAUSE_NTF,	NI_ETHTOOL_CACHE_PAUSE		},
+	{ ETHTOOL_MSG_EEE_NTF,		NI_ETHTOOL_CACHE_EEE		},
+};
+
+static unsigned int
+__ni_ethtool_event_categories(unsigned int cmd)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(__ni_ethtool_event_map)/sizeof(__ni_ethtool_event_map[0]); ++i) {
+		if (__ni_ethtool_event_map[i].cmd == cmd)
+			return __ni_ethtool_event_map[i].categories;
+	}
+	return 0;
+}
+
+/*
+ * Resolve the ethtool family and monitor group ids
+ */
+static int
+__ni_ethtool_event_resolve_cb(struct nl_msg *msg, void *arg)
+{
+	ni_ethtool_event_handle_t *handle = arg;
+	struct nlattr *tb[CTRL_ATTR_MAX + 1];
+	struct nlattr *gtb[CTRL_ATTR_MCAST_GRP_MAX + 1];
+	struct nlattr *grp;
+	int rem;
+
+	if (nlmsg_parse(nlmsg_hdr(msg), GENL_HDRLEN, tb, CTRL_ATTR_MAX, NULL) < 0)
+		return NL_SKIP;
+
+	if (tb[CTRL_ATTR_FAMILY_ID])
+		handle->family = nla_get_u16(tb[CTRL_ATTR_FAMILY_ID]);
+
+	if (!tb[CTRL_ATTR_MCAST_GROUPS])
+		return NL_OK;
+
+	nla_for_each_nested(grp, tb[CTRL_ATTR_MCAST_GROUPS], rem) {
+		if (nla_parse_nested(gtb, CTRL_ATTR_MCAST_GRP_MAX, grp, NULL) < 0)
+			continue;
+		if (!gtb[CTRL_ATTR_MCAST_GRP_NAME] || !gtb[CTRL_ATTR_MCAST_GRP_ID])
+			continue;
+		if (ni_string_eq(nla_get_string(gtb[CTRL_ATTR_MCAST_GRP_NAME]),
+					ETHTOOL_MCGRP_MONITOR_NAME))
+			handle->group = nla_get_u32(gtb[CTRL_ATTR_MCAST_GRP_ID]);
+	}
+	return NL_OK;
+}
+
+static ni_bool_t
+__ni_ethtool_event_resolve(ni_ethtool_event_handle_t *handle)
+{
+	struct genlmsghdr hdr = { .cmd = CTRL_CMD_GETFAMILY, .version = 1 };
+	struct nl_msg *msg;
+	int ret;
+
+	if (!(msg = nlmsg_alloc_simple(GENL_ID_CTRL, 0)))
+		return FALSE;
+
+	if (nlmsg_append(msg, &hdr, sizeof(hdr), NLMSG_ALIGNTO) < 0 ||
+	    nla_put_string(msg, CTRL_ATTR_FAMILY_NAME, ETHTOOL_GENL_NAME) < 0) {
+		nlmsg_free(msg);
+		return FALSE;
+	}
+
+	nl_socket_modify_cb(handle->nlsock, NL_CB_VALID, NL_CB_CUSTOM,
+				__ni_ethtool_event_resolve_cb, handle);
+
+	ret = nl_send_auto(handle->nlsock, msg);
+	nlmsg_free(msg);
+	if (ret < 0)
+		return FALSE;
+
+	if ((ret = nl_recvmsgs_default(handle->nlsock)) < 0) {
+		ni_debug_events("cannot resolve %s generic netlink family: %s",
+				ETHTOOL_GENL_NAME, nl_geterror(ret));
+		return FALSE;
+	}
+	return handle->family && handle->group;
+}
+
+/*
+ * Process a notification for a device
+ */
+static int
+__ni_ethtool_event_process_cb(struct nl_msg *msg, void *arg)
+{
+	ni_ethtool_event_handle_t *handle = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct nlattr *tb[NI_ETHTOOL_A_NTF_HEADER + 1];
+	struct nlattr *htb[ETHTOOL_A_HEADER_MAX + 1];
+	struct genlmsghdr *ghdr;
+	unsigned int categories;
+	unsigned int ifindex;
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+
+	if (nlh->nlmsg_type != handle->family || !nlmsg_valid_hdr(nlh, GENL_HDRLEN))
+		return NL_SKIP;
+
+	ghdr = nlmsg_data(nlh);
+	if (!(categories = __ni_ethtool_event_categories(ghdr->cmd)))
+		return NL_SKIP;
+
+	if (nlmsg_parse(nlh, GENL_HDRLEN, tb, NI_ETHTOOL_A_NTF_HEADER, NULL) < 0 ||
+	    !tb[NI_ETHTOOL_A_NTF_HEADER])
+		return NL_SKIP;
+
+	if (nla_parse_nested(htb, ETHTOOL_A_HEADER_MAX, tb[NI_ETHTOOL_A_NTF_HEADER], NULL) < 0 ||
+	    !htb[ETHTOOL_A_HEADER_DEV_INDEX])
+		return NL_SKIP;
+
+	ifindex = nla_get_u32(htb[ETHTOOL_A_HEADER_DEV_INDEX]);
+	if (!(nc = ni_global_state_handle(0)) || !(dev = ni_netdev_by_index(nc, ifindex)))
+		return NL_SKIP;
+
+	ni_debug_events("%s[%u]: ethtool change notification (cmd %u)",
+			dev->name, ifindex, ghdr->cmd);
+
+	if (dev->ethtool) {
+		ni_ethtool_invalidate(dev->ethtool, categories);
+		ni_system_ethtool_refresh(dev);
+	}
+	return NL_OK;
+}
+
+static void
+__ni_ethtool_event_invalidate_all(void)
+{
+	ni_netconfig_t *nc;
+	ni_netdev_t *dev;
+
+	if (!(nc = ni_global_state_handle(0)))
+		return;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		ni_ethtool_invalidate(dev->ethtool, NI_ETHTOOL_CACHE_ALL);
+}
+
+static void
+__ni_ethtool_event_disable(void)
+{
+	ni_socket_t *sock;
+
+	ni_ethtool_set_monitored(FALSE);
+	if ((sock = __ni_ethtool_event_sock)) {
+		__ni_ethtool_event_sock = NULL;
+		ni_socket_close(sock);
+	}
+}
+
+static void
+__ni_ethtool_event_receive(ni_socket_t *sock)
+{
+	ni_ethtool_event_handle_t *handle = sock->user_data;
+	int ret;
+
+	if (!handle || !handle->nlsock)
+		return;
+
+	do {
+		ret = nl_recvmsgs_default(handle->nlsock);
+	} while (ret == NLE_SUCCESS || ret == -NLE_INTR);
+
+	switch (ret) {
+	case -NLE_AGAIN:
+		break;
+
+	case -NLE_NOMEM:
+		/* receive buffer overrun, we may have lost notifications */
+		ni_warn("ethtool netlink event overrun, invalidating ethtool cache");
+		__ni_ethtool_event_invalidate_all();
+		break;
+
+	default:
+		ni_error("ethtool netlink event receive error: %s (%m)", nl_geterror(ret));
+		__ni_ethtool_event_invalidate_all();
+		__ni_ethtool_event_disable();
+		break;
+	}
+}
+
+static void
+__ni_ethtool_event_handle_free(ni_ethtool_event_handle_t *handle)
+{
+	if (handle) {
+		if (handle->nlsock)
+			nl_socket_free(handle->nlsock);
+		free(handle);
+	}
+}
+
+static void
+__ni_ethtool_event_close(ni_socket_t *sock)
+{
+	ni_ethtool_event_handle_t *handle = sock->user_data;
+
+	if (handle && handle->nlsock) {
+		nl_socket_free(handle->nlsock);
+		handle->nlsock = NULL;
+	}
+}
+
+static void
+__ni_ethtool_event_release_data(void *user_data)
+{
+	__ni_ethtool_event_handle_free(user_data);
+}
+
+static void
+__ni_ethtool_event_sock_error_handler(ni_socket_t *sock)
+{
+	ni_error("poll error on ethtool netlink event socket: %m");
+	__ni_ethtool_event_invalidate_all();
+	__ni_ethtool_event_disable();
+}
+
+int
+ni_server_enable_ethtool_events(void)
+{
+	ni_ethtool_event_handle_t *handle;
+	ni_socket_t *sock;
+	int ret;
+
+	if (__ni_ethtool_event_sock) {
+		ni_error("ethtool event handler is already set");
+		return -1;
+	}
+
+	if (!(handle = calloc(1, sizeof(*handle)))) {
+		ni_error("Unable to allocate ethtool event handle: %m");
+		return -1;
+	}
+
+	if (!(handle->nlsock = nl_socket_alloc())) {
+		ni_error("Cannot allocate ethtool netlink event socket: %m");
+		__ni_ethtool_event_handle_free(handle);
+		return -1;
+	}
+
+	if ((ret = nl_connect(handle->nlsock, NETLINK_GENERIC)) < 0) {
+		ni_error("Cannot open generic netlink: %s", nl_geterror(ret));
+		__ni_ethtool_event_handle_free(handle);
+		return -1;
+	}
+
+	if (!__ni_ethtool_event_resolve(handle)) {
+		ni_debug_events("ethtool netlink monitor not available");
+		__ni_ethtool_event_handle_free(handle);
+		return -1;
+	}
+
+	/* Switch over to the processing of async notifications */
+	nl_socket_modify_cb(handle->nlsock, NL_CB_VALID, NL_CB_CUSTOM,
+				__ni_ethtool_event_process_cb, handle);
+	nl_socket_disable_seq_check(handle->nlsock);
+
+	if ((ret = nl_socket_add_membership(handle->nlsock, handle->group)) < 0) {
+		ni_error("Cannot add ethtool monitor group %u membership: %s",
+				handle->group, nl_geterror(ret));
+		__ni_ethtool_event_handle_free(handle);
+		return -1;
+	}
+	nl_socket_set_nonblocking(handle->nlsock);
+
+	if (!(sock = ni_socket_wrap(nl_socket_get_fd(handle->nlsock), SOCK_DGRAM))) {
+		ni_error("Cannot wrap ethtool netlink event socket: %m");
+		__ni_ethtool_event_handle_free(handle);
+		return -1;
+	}
+
+	sock->user_data	= handle;
+	sock->receive	= __ni_ethtool_event_receive;
+	sock->close	= __ni_ethtool_event_close;
+	sock->handle_error = __ni_ethtool_event_sock_error_handler;
+	sock->release_user_data = __ni_ethtool_event_release_data;
+
+	__ni_ethtool_event_sock = sock;
+	ni_socket_activate(sock);
+
+	/* from now on, the cached categories stay valid until changed */
+	__ni_ethtool_event_invalidate_all();
+	ni_ethtool_set_monitored(TRUE);
+	return 0;
+}
+
+void
+ni_server_disable_ethtool_events(void)
+{
+	__ni_ethtool_event_disable();
+}
+
+#else
+
+int
+ni_server_enable_ethtool_events(void)
+{
+	ni_debug_events("ethtool netlink monitor not supported");
+	return -1;
+}
+
+void
+ni_server_disable_ethtool_events(void)
+{
+}
+
+#endif
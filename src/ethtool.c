@@ -35,6 +35,11 @@
 #include "util_priv.h"
 #include "kernel.h"
 
+/*
+ * Set while the ethtool netlink monitor reports changes to us
+ */
+static ni_bool_t		ni_ethtool_monitored;
+
 /*
  * support mask to not repeat ioctl
  * calls that returned EOPNOTSUPP.
@@ -3614,25 +3619,56 @@ ni_ethtool_refresh(ni_netdev_t *dev)
 {
 	ni_ethtool_t *ethtool;
 	ni_netdev_ref_t ref;
+	unsigned int stale;
+	ni_bool_t carrier;
 
 	if (!dev || !(ethtool = ni_netdev_get_ethtool(dev)))
 		return FALSE;
 
+	/*
+	 * Without a monitor for changes, everything is stale.
+	 * Otherwise the cached categories are invalidated by the
+	 * ethtool netlink notifications and carrier changes.
+	 */
+	if (!ni_ethtool_monitored)
+		ethtool->cache.valid = 0;
+
+	carrier = ni_netdev_link_is_up(dev);
+	if (ethtool->cache.carrier != carrier) {
+		ethtool->cache.carrier = carrier;
+		ethtool->cache.valid &= ~(NI_ETHTOOL_CACHE_LINK_DETECTED |
+					  NI_ETHTOOL_CACHE_LINK_SETTINGS |
+					  NI_ETHTOOL_CACHE_EEE |
+					  NI_ETHTOOL_CACHE_PAUSE);
+	}
+	stale = ~ethtool->cache.valid & NI_ETHTOOL_CACHE_ALL;
+
 	ref.name = dev->name;
 	ref.index = dev->link.ifindex;
 	if (!ethtool->driver_info)
 		ni_ethtool_get_driver_info(&ref, ethtool);
-	ni_ethtool_get_priv_flags(&ref, ethtool);
-	ni_ethtool_get_link_detected(&ref, ethtool);
-	ni_ethtool_get_link_settings(&ref, ethtool);
-	ni_ethtool_get_wake_on_lan(&ref, ethtool);
-	ni_ethtool_get_features(&ref, ethtool, FALSE);
-	ni_ethtool_get_eee(&ref, ethtool);
-	ni_ethtool_get_ring(&ref, ethtool);
-	ni_ethtool_get_channels(&ref, ethtool);
-	ni_ethtool_get_coalesce(&ref, ethtool);
-	ni_ethtool_get_pause(&ref, ethtool);
-
+	if (stale & NI_ETHTOOL_CACHE_PRIV_FLAGS)
+		ni_ethtool_get_priv_flags(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_LINK_DETECTED)
+		ni_ethtool_get_link_detected(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_LINK_SETTINGS)
+		ni_ethtool_get_link_settings(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_WAKE_ON_LAN)
+		ni_ethtool_get_wake_on_lan(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_FEATURES)
+		ni_ethtool_get_features(&ref, ethtool, FALSE);
+	if (stale & NI_ETHTOOL_CACHE_EEE)
+		ni_ethtool_get_eee(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_RING)
+		ni_ethtool_get_ring(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_CHANNELS)
+		ni_ethtool_get_channels(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_COALESCE)
+		ni_ethtool_get_coalesce(&ref, ethtool);
+	if (stale & NI_ETHTOOL_CACHE_PAUSE)
+		ni_ethtool_get_pause(&ref, ethtool);
+
+	ethtool->cache.valid = NI_ETHTOOL_CACHE_ALL;
 	return TRUE;
 }
 
@@ -3668,6 +3704,7 @@ ni_system_ethtool_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t
 		ni_ethtool_set_channels(&ref, dev->ethtool, cfg->ethtool->channels);
 		ni_ethtool_set_coalesce(&ref, dev->ethtool, cfg->ethtool->coalesce);
 		ni_ethtool_set_pause(&ref, dev->ethtool, cfg->ethtool->pause);
+		ni_ethtool_invalidate(dev->ethtool, NI_ETHTOOL_CACHE_ALL);
 		ni_ethtool_refresh(dev);
 	}
 	return 0;
@@ -3694,6 +3731,19 @@ ni_ethtool_free(ni_ethtool_t *ethtool)
 	}
 }
 
+void
+ni_ethtool_invalidate(ni_ethtool_t *ethtool, unsigned int categories)
+{
+	if (ethtool)
+		ethtool->cache.valid &= ~categories;
+}
+
+void
+ni_ethtool_set_monitored(ni_bool_t monitored)
+{
+	ni_ethtool_monitored = monitored;
+}
+
 static inline void
 ni_ethtool_init(ni_ethtool_t *ethtool)
 {
@@ -49,6 +49,8 @@ ni_extension_free(ni_extension_t *ex)
 
 	ni_string_free(&ex->name);
 	ni_string_free(&ex->interface);
+	ni_string_free(&ex->format);
+	ni_string_free(&ex->backend);
 
 	ni_config_fslocation_destroy(&ex->statedir);
 
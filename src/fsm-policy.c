@@ -105,6 +105,9 @@ struct ni_fsm_policy {
 	ni_fsm_policy_t **		pprev;
 	ni_fsm_policy_t *		next;
 
+	ni_fsm_policy_index_t *		index;
+	ni_fsm_policy_t *		name_next;
+
 	unsigned int			seq;
 
 	ni_fsm_policy_type_t		type;
@@ -136,6 +139,99 @@ static ni_bool_t		ni_fsm_template_bind_devices(ni_fsm_policy_t *, ni_fsm_policy_
 static ni_fsm_template_input_t *ni_fsm_template_input_new(const char *id, ni_fsm_template_input_t ***tailp);
 static void			ni_fsm_template_input_free(ni_fsm_template_input_t *);
 
+/*
+ * fsm policy name index
+ *
+ * A policy applies only to the worker, which ifname maps to the policy
+ * name, so the name is the discriminator used to find the candidates.
+ * The index refers to the first policy with a name, the policies with
+ * the same name are chained via name_next in the fsm policy list order.
+ */
+struct ni_fsm_policy_index {
+	ni_hash_table_t			by_name;
+};
+
+static ni_bool_t
+ni_fsm_policy_index_match(const void *data, const void *key)
+{
+	const ni_fsm_policy_t *policy = data;
+
+	return ni_string_eq(policy->name, key);
+}
+
+static ni_fsm_policy_t *
+ni_fsm_policy_index_find(const ni_fsm_policy_index_t *index, const char *name)
+{
+	if (!index || !name)
+		return NULL;
+
+	return ni_hash_table_find(&index->by_name, ni_hash_string(name),
+				ni_fsm_policy_index_match, name);
+}
+
+static void
+ni_fsm_policy_index_insert(ni_fsm_policy_index_t *index, ni_fsm_policy_t *policy)
+{
+	ni_fsm_policy_t *head;
+	unsigned int hash;
+
+	if (!index || !policy->name)
+		return;
+
+	hash = ni_hash_string(policy->name);
+	if ((head = ni_fsm_policy_index_find(index, policy->name)))
+		ni_hash_table_remove(&index->by_name, hash, head);
+
+	policy->index = index;
+	policy->name_next = head;
+	ni_hash_table_insert(&index->by_name, hash, policy);
+}
+
+static void
+ni_fsm_policy_index_unlink(ni_fsm_policy_t *policy)
+{
+	ni_fsm_policy_index_t *index;
+	ni_fsm_policy_t *head, *prev;
+	unsigned int hash;
+
+	if (!(index = policy->index))
+		return;
+
+	hash = ni_hash_string(policy->name);
+	head = ni_fsm_policy_index_find(index, policy->name);
+	if (head == policy) {
+		ni_hash_table_remove(&index->by_name, hash, policy);
+		if (policy->name_next)
+			ni_hash_table_insert(&index->by_name, hash, policy->name_next);
+	} else {
+		for (prev = head; prev; prev = prev->name_next) {
+			if (prev->name_next == policy) {
+				prev->name_next = policy->name_next;
+				break;
+			}
+		}
+	}
+	policy->index = NULL;
+	policy->name_next = NULL;
+}
+
+void
+ni_fsm_policy_index_free(ni_fsm_t *fsm)
+{
+	ni_fsm_policy_t *policy;
+
+	if (!fsm || !fsm->policy_index)
+		return;
+
+	for (policy = fsm->policies; policy; policy = policy->next) {
+		policy->index = NULL;
+		policy->name_next = NULL;
+	}
+	ni_hash_table_destroy(&fsm->policy_index->by_name);
+	free(fsm->policy_index);
+	fsm->policy_index = NULL;
+}
+
 /*
  * fsm policy list primitives
  */
@@ -154,6 +250,8 @@ ni_fsm_policy_list_unlink(ni_fsm_policy_t *policy)
 {
 	ni_fsm_policy_t **pprev, *next;
 
+	ni_fsm_policy_index_unlink(policy);
+
 	pprev = policy->pprev;
 	next = policy->next;
 	if (pprev)
@@ -427,7 +525,11 @@ ni_fsm_policy_new(ni_fsm_t *fsm, const char *name, xml_node_t *node)
 		return NULL;
 	}
 
+	if (!fsm->policy_index)
+		fsm->policy_index = xcalloc(1, sizeof(*fsm->policy_index));
+
 	ni_fsm_policy_list_insert(&fsm->policies, policy);
+	ni_fsm_policy_index_insert(fsm->policy_index, policy);
 	return policy;
 }
 
@@ -514,13 +616,7 @@ ni_fsm_policies_changed_since(const ni_fsm_t *fsm, unsigned int *tstamp)
 ni_fsm_policy_t *
 ni_fsm_policy_by_name(const ni_fsm_t *fsm, const char *name)
 {
-	ni_fsm_policy_t *policy;
-
-	for (policy = fsm->policies; policy; policy = policy->next) {
-		if (policy->name && ni_string_eq(policy->name, name))
-			return policy;
-	}
-	return NULL;
+	return ni_fsm_policy_index_find(fsm->policy_index, name);
 }
 
 /*
@@ -680,13 +776,19 @@ ni_fsm_policy_get_applicable_policies(const ni_fsm_t *fsm, ni_ifworker_t *w,
 {
 	unsigned int count = 0;
 	ni_fsm_policy_t *policy;
+	char *pname;
 
 	if (!w) {
 		ni_error("unable to get applicable policy for non-existing device");
 		return 0;
 	}
 
-	for (policy = fsm->policies; policy; policy = policy->next) {
+	/* only the policies named after the worker are candidates */
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	policy = ni_fsm_policy_index_find(fsm->policy_index, pname);
+	ni_string_free(&pname);
+
+	for ( ; policy; policy = policy->name_next) {
 		if (!ni_ifpolicy_name_is_valid(policy->name)) {
 			ni_error("policy with invalid name %s", policy->name);
 			continue;
@@ -716,11 +818,24 @@ ni_bool_t
 ni_fsm_exists_applicable_policy(const ni_fsm_t *fsm, ni_fsm_policy_t *list, ni_ifworker_t *w)
 {
 	ni_fsm_policy_t *policy;
+	char *pname;
 
 	if (!list || !w)
 		return FALSE;
 
-	for (policy = list; policy; policy = policy->next) {
+	if (!fsm || list != fsm->policies) {
+		for (policy = list; policy; policy = policy->next) {
+			if (ni_fsm_policy_applicable(fsm, policy, w))
+				return TRUE;
+		}
+		return FALSE;
+	}
+
+	pname = ni_ifpolicy_name_from_ifname(w->name);
+	policy = ni_fsm_policy_index_find(fsm->policy_index, pname);
+	ni_string_free(&pname);
+
+	for ( ; policy; policy = policy->name_next) {
 		if (ni_fsm_policy_applicable(fsm, policy, w))
 			return TRUE;
 	}
@@ -41,6 +41,8 @@ static ni_ifworker_t *		__ni_ifworker_identify_device(ni_fsm_t *, const char *,
 static void			ni_ifworker_set_dependencies_xml(ni_ifworker_t *, xml_node_t *);
 static int			ni_fsm_schedule_init(ni_fsm_t *fsm, ni_ifworker_t *, unsigned int, unsigned int);
 static int			ni_fsm_schedule_bind_methods(ni_fsm_t *, ni_ifworker_t *);
+static void			ni_fsm_schedule_enqueue(ni_ifworker_t *);
+static void			ni_fsm_schedule_dequeue(ni_ifworker_t *);
 static ni_fsm_require_t *	ni_ifworker_netif_resolver_new(xml_node_t *);
 static ni_fsm_require_t *	ni_ifworker_modem_resolver_new(xml_node_t *);
 static void			ni_fsm_require_list_destroy(ni_fsm_require_t **);
@@ -87,6 +89,7 @@ void
 ni_fsm_free(ni_fsm_t *fsm)
 {
 	ni_fsm_events_destroy(&fsm->events);
+	ni_fsm_policy_index_free(fsm);
 	ni_ifworker_array_destroy(&fsm->pending);
 	ni_ifworker_array_destroy(&fsm->workers);
 	free(fsm);
@@ -1644,6 +1647,7 @@ ni_ifworker_set_state(ni_ifworker_t *w, unsigned int new_state)
 			w->progress.callback(w, new_state);
 
 		w->fsm.state = new_state;
+		ni_fsm_schedule_enqueue(w);
 		ni_debug_application("%s: changed state %s -> %s%s",
 				w->name,
 				ni_ifworker_state_name(prev_state),
@@ -1800,6 +1804,7 @@ ni_ifworker_revert_state(ni_ifworker_t *w, ni_event_t event)
 			w->name, ni_ifworker_state_name(w->fsm.state),
 			ni_event_type_to_name(event));
 	}
+	ni_fsm_schedule_enqueue(w);
 	return TRUE;
 }
 
@@ -3387,6 +3392,7 @@ ni_fsm_destroy_worker(ni_fsm_t *fsm, ni_ifworker_t *w)
 		ni_ifworker_release(w);
 		return;
 	}
+	ni_fsm_schedule_dequeue(w);
 
 	ni_ifworker_device_delete(w);
 
@@ -4046,6 +4052,7 @@ ni_fsm_recv_new_netif(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 			found = ni_ifworker_new(&fsm->workers, NI_IFWORKER_TYPE_NETDEV, dev->name);
 			if (found)
 				found->readonly = fsm->readonly;
+			ni_fsm_schedule_enqueue(found);
 		} else {
 			renamed = !ni_string_eq(found->name, dev->name);
 			if (renamed)
@@ -4116,7 +4123,7 @@ ni_fsm_recv_new_netif_path(ni_fsm_t *fsm, const char *path)
 	}
 
 	object = ni_dbus_object_create(list_object, path, NULL, NULL);
-	return ni_fsm_recv_new_netif(fsm, object, TRUE);
+	return ni_fsm_recv_new_netif(fsm, object, !ni_dbus_object_properties_current(object));
 }
 
 #ifdef MODEM
@@ -4172,6 +4179,7 @@ ni_fsm_recv_new_modem(ni_fsm_t *fsm, ni_dbus_object_t *object, ni_bool_t refresh
 	if (!found) {
 		ni_debug_application("received new modem %s (%s)", modem->device, object->path);
 		found = ni_ifworker_new(&fsm->workers, NI_IFWORKER_TYPE_MODEM, modem->device);
+		ni_fsm_schedule_enqueue(found);
 	}
 
 	if (!found)
@@ -5153,127 +5161,273 @@ ni_fsm_schedule_bind_methods(ni_fsm_t *fsm, ni_ifworker_t *w)
 	return 0;
 }
 
-unsigned int
-ni_fsm_schedule(ni_fsm_t *fsm)
+typedef enum {
+	NI_FSM_SCHEDULE_IDLE = 0,	/* nothing to do until woken up	*/
+	NI_FSM_SCHEDULE_PROGRESS,	/* worker changed its state	*/
+	NI_FSM_SCHEDULE_DEFERRED,	/* pending dependencies		*/
+} ni_fsm_schedule_result_t;
+
+/*
+ * The ready queue of the currently running ni_fsm_schedule() call.
+ *
+ * All workers are queued once when the call starts; afterwards only
+ * workers which may be able to make progress are queued: when their
+ * state changes or is reverted, when they have been advanced and when
+ * they are created by an event. Workers deferred because of pending
+ * dependencies are parked until the ready queue is drained and are
+ * re-checked once per round in which any other worker made progress.
+ * The requirements (device resolution, worker states, ...) may refer
+ * to any other worker, so the deferred workers are not woken up by
+ * specific workers.
+ */
+typedef struct ni_fsm_schedule_queue {
+	ni_ifworker_array_t	ready;
+	ni_ifworker_array_t	deferred;
+} ni_fsm_schedule_queue_t;
+
+static ni_fsm_schedule_queue_t *	ni_fsm_schedule_queue;
+
+static void
+ni_fsm_schedule_enqueue(ni_ifworker_t *w)
 {
-	unsigned int i, waiting, nrequested;
+	ni_fsm_schedule_queue_t *queue = ni_fsm_schedule_queue;
 
-	while (1) {
-		int made_progress = 0;
+	if (!queue || !w || w->queued)
+		return;
 
-		for (i = 0; i < fsm->workers.count; ++i) {
-			ni_ifworker_t *w = fsm->workers.data[i];
-			ni_fsm_transition_t *action;
-			unsigned int prev_state;
-			int rv;
+	if (w->deferred) {
+		ni_ifworker_array_remove(&queue->deferred, w);
+		w->deferred = FALSE;
+	}
 
-			ni_ifworker_get(w);
+	w->queued = TRUE;
+	ni_ifworker_array_append(&queue->ready, w);
+}
 
-			if (w->pending)
-				goto release;
+static void
+ni_fsm_schedule_defer(ni_ifworker_t *w)
+{
+	ni_fsm_schedule_queue_t *queue = ni_fsm_schedule_queue;
 
-			if (ni_ifworker_complete(w)) {
-				ni_ifworker_cancel_secondary_timeout(w);
-				ni_ifworker_cancel_timeout(w);
-				goto release;
-			}
+	if (!queue || !w || w->queued || w->deferred)
+		return;
 
-			if (!w->kickstarted)
-				w->kickstarted = TRUE;
-
-			/* We requested a change that takes time (such as acquiring
-			 * a DHCP lease). Wait for a notification from wickedd */
-			if (w->fsm.wait_for) {
-				ni_debug_application("%s: state=%s want=%s, wait-for=%s", w->name,
-					ni_ifworker_state_name(w->fsm.state),
-					ni_ifworker_state_name(w->target_state),
-					ni_ifworker_state_name(w->fsm.wait_for->next_state));
-				goto release;
-			}
+	w->deferred = TRUE;
+	ni_ifworker_array_append(&queue->deferred, w);
+}
 
-			action = w->fsm.next_action;
-			if (action->next_state == NI_FSM_STATE_NONE)
-				w->fsm.state = w->target_state;
+static void
+ni_fsm_schedule_dequeue(ni_ifworker_t *w)
+{
+	ni_fsm_schedule_queue_t *queue = ni_fsm_schedule_queue;
+	unsigned int i;
 
-			if (w->fsm.state == w->target_state) {
-				ni_ifworker_success(w);
-				made_progress = 1;
-				goto release;
-			}
+	if (!queue || !w)
+		return;
 
-			ni_debug_application("%s: state=%s want=%s, next transition is %s -> %s", w->name,
-				ni_ifworker_state_name(w->fsm.state),
-				ni_ifworker_state_name(w->target_state),
-				ni_ifworker_state_name(w->fsm.next_action->from_state),
-				ni_ifworker_state_name(w->fsm.next_action->next_state));
-
-			if (!action->bound) {
-				ni_ifworker_fail(w, "failed to bind services and methods for %s()",
-						action->common.method_name);
-				goto release;
-			}
+	if (w->deferred) {
+		ni_ifworker_array_remove(&queue->deferred, w);
+		w->deferred = FALSE;
+	}
 
-			if (!ni_ifworker_check_dependencies(fsm, w, action)) {
-				ni_debug_application("%s: defer action (pending dependencies)", w->name);
-				goto release;
-			}
+	/* A queued worker has exactly one pending entry: the last one */
+	for (i = queue->ready.count; w->queued && i-- > 0; ) {
+		if (queue->ready.data[i] == w) {
+			queue->ready.data[i] = NULL;
+			w->queued = FALSE;
+			ni_ifworker_release(w);
+		}
+	}
+}
 
-			ni_ifworker_cancel_secondary_timeout(w);
+static void
+ni_fsm_schedule_wakeup_deferred(void)
+{
+	ni_fsm_schedule_queue_t *queue = ni_fsm_schedule_queue;
+	unsigned int i;
 
-			prev_state = w->fsm.state;
-			ni_fsm_events_block(fsm);
+	if (!queue || !queue->deferred.count)
+		return;
 
-			rv = action->call_func(fsm, w, action);
-			if (w->fsm.next_action)
-				w->fsm.next_action++;
+	for (i = 0; i < queue->deferred.count; ++i) {
+		ni_ifworker_t *w = queue->deferred.data[i];
 
-			if (rv >= 0) {
-				made_progress = 1;
+		w->deferred = FALSE;
+		ni_fsm_schedule_enqueue(w);
+	}
+	ni_ifworker_array_destroy(&queue->deferred);
+}
 
-				if (w->fsm.wait_for) {
-					ni_debug_application("%s: waiting for event in state %s",
-						w->name, ni_ifworker_state_name(w->fsm.state));
-				} else {
-					ni_debug_application("%s: successfully transitioned from %s to %s",
-							w->name,
-							ni_ifworker_state_name(prev_state),
-							ni_ifworker_state_name(w->fsm.state));
-				}
-			} else
-			if (!w->failed) {
-				/* The fsm action should really have marked this
-				 * as a failure. shame on the lazy programmer. */
-				ni_ifworker_fail(w, "failed to transition from %s to %s",
-						ni_ifworker_state_name(prev_state),
-						ni_ifworker_state_name(action->next_state));
-			}
+static void
+ni_fsm_schedule_queue_destroy(ni_fsm_schedule_queue_t *queue)
+{
+	unsigned int i;
+
+	for (i = 0; i < queue->ready.count; ++i) {
+		ni_ifworker_t *w = queue->ready.data[i];
 
-			ni_fsm_process_events(fsm);
-			ni_fsm_events_unblock(fsm);
-release:
+		if (w) {
+			w->queued = FALSE;
 			ni_ifworker_release(w);
+		}
+	}
+	free(queue->ready.data);
+	queue->ready.data = NULL;
+	queue->ready.count = 0;
+
+	for (i = 0; i < queue->deferred.count; ++i)
+		queue->deferred.data[i]->deferred = FALSE;
+	ni_ifworker_array_destroy(&queue->deferred);
+}
+
+static ni_fsm_schedule_result_t
+ni_fsm_schedule_worker(ni_fsm_t *fsm, ni_ifworker_t *w)
+{
+	ni_fsm_transition_t *action;
+	unsigned int prev_state;
+	int rv;
+
+	if (w->pending)
+		return NI_FSM_SCHEDULE_IDLE;
 
-			ni_dbus_objects_garbage_collect();
+	if (ni_ifworker_complete(w)) {
+		ni_ifworker_cancel_secondary_timeout(w);
+		ni_ifworker_cancel_timeout(w);
+		return NI_FSM_SCHEDULE_IDLE;
+	}
+
+	if (!w->kickstarted)
+		w->kickstarted = TRUE;
+
+	/* We requested a change that takes time (such as acquiring
+	 * a DHCP lease). Wait for a notification from wickedd */
+	if (w->fsm.wait_for) {
+		ni_debug_application("%s: state=%s want=%s, wait-for=%s", w->name,
+			ni_ifworker_state_name(w->fsm.state),
+			ni_ifworker_state_name(w->target_state),
+			ni_ifworker_state_name(w->fsm.wait_for->next_state));
+		return NI_FSM_SCHEDULE_IDLE;
+	}
+
+	action = w->fsm.next_action;
+	if (action->next_state == NI_FSM_STATE_NONE)
+		w->fsm.state = w->target_state;
+
+	if (w->fsm.state == w->target_state) {
+		ni_ifworker_success(w);
+		return NI_FSM_SCHEDULE_PROGRESS;
+	}
+
+	ni_debug_application("%s: state=%s want=%s, next transition is %s -> %s", w->name,
+		ni_ifworker_state_name(w->fsm.state),
+		ni_ifworker_state_name(w->target_state),
+		ni_ifworker_state_name(w->fsm.next_action->from_state),
+		ni_ifworker_state_name(w->fsm.next_action->next_state));
+
+	if (!action->bound) {
+		ni_ifworker_fail(w, "failed to bind services and methods for %s()",
+				action->common.method_name);
+		return NI_FSM_SCHEDULE_IDLE;
+	}
+
+	if (!ni_ifworker_check_dependencies(fsm, w, action)) {
+		ni_debug_application("%s: defer action (pending dependencies)", w->name);
+		return NI_FSM_SCHEDULE_DEFERRED;
+	}
+
+	ni_ifworker_cancel_secondary_timeout(w);
+
+	prev_state = w->fsm.state;
+	ni_fsm_events_block(fsm);
+
+	/* The call functions set up the wait_for callbacks from the
+	 * method reply, so the calls are issued synchronously. */
+	rv = action->call_func(fsm, w, action);
+	if (w->fsm.next_action)
+		w->fsm.next_action++;
+
+	if (rv >= 0) {
+		if (w->fsm.wait_for) {
+			ni_debug_application("%s: waiting for event in state %s",
+				w->name, ni_ifworker_state_name(w->fsm.state));
+		} else {
+			ni_debug_application("%s: successfully transitioned from %s to %s",
+					w->name,
+					ni_ifworker_state_name(prev_state),
+					ni_ifworker_state_name(w->fsm.state));
 		}
+	} else
+	if (!w->failed) {
+		/* The fsm action should really have marked this
+		 * as a failure. shame on the lazy programmer. */
+		ni_ifworker_fail(w, "failed to transition from %s to %s",
+				ni_ifworker_state_name(prev_state),
+				ni_ifworker_state_name(action->next_state));
+	}
+	ni_fsm_process_events(fsm);
+	ni_fsm_events_unblock(fsm);
 
-		if (!made_progress)
-			break;
+	ni_dbus_objects_garbage_collect();
 
-		/* If all the requested workers are done (eg because they failed)
-		 * do not wait for any of the subordinate device which might still be
-		 * in the middle of being set up.
-		 */
-		for (i = nrequested = 0; i < fsm->workers.count; ++i) {
-			ni_ifworker_t *w = fsm->workers.data[i];
+	return rv >= 0 ? NI_FSM_SCHEDULE_PROGRESS : NI_FSM_SCHEDULE_IDLE;
+}
 
-			if (!ni_ifworker_complete(w))
-				nrequested++;
+unsigned int
+ni_fsm_schedule(ni_fsm_t *fsm)
+{
+	ni_fsm_schedule_queue_t queue, *prev_queue;
+	unsigned int i, waiting, nrequested;
+
+	memset(&queue, 0, sizeof(queue));
+	prev_queue = ni_fsm_schedule_queue;
+	ni_fsm_schedule_queue = &queue;
+
+	for (i = 0; i < fsm->workers.count; ++i)
+		ni_fsm_schedule_enqueue(fsm->workers.data[i]);
+
+	while (1) {
+		ni_bool_t made_progress = FALSE;
+
+		for (i = 0; i < queue.ready.count; ++i) {
+			ni_ifworker_t *w = queue.ready.data[i];
+
+			if (!w)
+				continue;
+
+			queue.ready.data[i] = NULL;
+			w->queued = FALSE;
+
+			switch (ni_fsm_schedule_worker(fsm, w)) {
+			case NI_FSM_SCHEDULE_PROGRESS:
+				made_progress = TRUE;
+				ni_fsm_schedule_enqueue(w);
+				break;
+
+			case NI_FSM_SCHEDULE_DEFERRED:
+				ni_fsm_schedule_defer(w);
+				break;
+
+			default:
+				break;
+			}
+
+			ni_ifworker_release(w);
 		}
 
-		if (nrequested == 0)
+		free(queue.ready.data);
+		queue.ready.data = NULL;
+		queue.ready.count = 0;
+
+		if (!made_progress || !queue.deferred.count)
 			break;
+
+		ni_fsm_schedule_wakeup_deferred();
 	}
 
+	ni_fsm_schedule_queue_destroy(&queue);
+	ni_fsm_schedule_queue = prev_queue;
+	ni_dbus_objects_garbage_collect();
+
 	for (i = waiting = nrequested = 0; i < fsm->workers.count; ++i) {
 		ni_ifworker_t *w = fsm->workers.data[i];
 
@@ -5816,6 +5970,9 @@ ni_fsm_create_client(ni_fsm_t *fsm)
 
 	client = ni_dbus_object_get_client(fsm->client_root_object);
 
+	/* keep the proxies current, so events don't need a refresh */
+	ni_dbus_client_track_properties(client, fsm->client_root_object);
+
 	ni_dbus_client_add_signal_handler(client, NULL, NULL,
 					NI_OBJECTMODEL_NETIF_INTERFACE,
 					interface_state_change_signal,
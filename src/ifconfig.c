@@ -130,6 +130,8 @@ static int	__ni_rtnl_link_change(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_
 
 static int	__ni_rtnl_link_change_mtu(ni_netdev_t *dev, unsigned int mtu);
 static int	__ni_rtnl_link_change_hwaddr(ni_netdev_t *dev, const ni_hwaddr_t *hwaddr);
+static int	__ni_rtnl_link_change_bridge(ni_netdev_t *dev, const ni_bridge_t *conf);
+static int	__ni_rtnl_link_change_bridge_port(const ni_netdev_t *dev, const ni_bridge_port_t *conf);
 
 static int	__ni_rtnl_link_up(const ni_netdev_t *, const ni_netdev_req_t *);
 static int	__ni_rtnl_link_down(const ni_netdev_t *);
@@ -140,11 +142,7 @@ static int	__ni_rtnl_link_add_port_up(const ni_netdev_t *, const char *, unsigne
 static int	__ni_rtnl_link_add_slave_down(const ni_netdev_t *, const char *, unsigned int);
 
 static int	__ni_rtnl_send_deladdr(ni_netdev_t *, const ni_address_t *);
-static int	__ni_rtnl_send_newaddr(ni_netdev_t *, const ni_address_t *, int);
 static int	__ni_rtnl_send_delroute(ni_netdev_t *, ni_route_t *);
-static int	__ni_rtnl_send_newroute(ni_netdev_t *, ni_route_t *, int);
-static int	__ni_rtnl_send_newrule(const ni_rule_t *, int);
-static int	__ni_rtnl_send_delrule(const ni_rule_t *);
 
 static int	addattr_sockaddr(struct nl_msg *, int, const ni_sockaddr_t *);
 
@@ -265,7 +263,7 @@ ni_system_interface_enslave(ni_netconfig_t *nc, ni_netdev_t *master, ni_netdev_t
 			return -1;
 		}
 
-		ret = ni_ovs_vsctl_bridge_port_add(dev->name, &req->port->ovsbr, TRUE);
+		ret = ni_ovs_bridge_port_add(dev->name, &req->port->ovsbr, TRUE);
 		if (ret == 0)  {
 			ni_netdev_ref_set(&dev->link.masterdev,
 					master->name, master->link.ifindex);
@@ -300,12 +298,12 @@ ni_system_interface_unenslave(ni_netconfig_t *nc, ni_netdev_t *dev)
 
 	switch (master->link.type) {
 		case NI_IFTYPE_OVS_SYSTEM:
-			if (ni_ovs_vsctl_bridge_port_to_bridge(dev->name, &bridge)) {
+			if (ni_ovs_bridge_port_to_bridge(dev->name, &bridge)) {
 				ni_error("%s: unable to find ovs bridge interface to unenslave",
 						dev->name);
 				return -1;
 			}
-			if (ni_ovs_vsctl_bridge_port_del(bridge, dev->name)) {
+			if (ni_ovs_bridge_port_del(bridge, dev->name)) {
 				ni_error("%s: unable to unenslave port from ovs-bridge %s",
 						dev->name, bridge);
 				return -1;
@@ -1386,10 +1384,8 @@ ni_system_interface_delete(ni_netconfig_t *nc, const char *ifname)
 		break;
 
 	case NI_IFTYPE_BOND:
-		if (ni_sysfs_bonding_delete_master(dev->name) < 0) {
-			ni_error("could not destroy bonding interface %s", dev->name);
+		if (ni_system_bond_delete(nc, dev) < 0)
 			return -1;
-		}
 		break;
 
 	default:
@@ -1804,6 +1800,10 @@ ni_system_bridge_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_bridge_t *
 		return -1;
 	}
 
+	if (__ni_rtnl_link_change_bridge(dev, bcfg) == 0)
+		return 0;
+
+	/* kernel without bridge changelink support or refused some value */
 	if (ni_sysfs_bridge_update_config(dev->name, bcfg) < 0) {
 		ni_error("%s: failed to update sysfs attributes for %s", __func__, dev->name);
 		return -1;
@@ -1920,7 +1920,8 @@ ni_system_bridge_add_port(ni_netconfig_t *nc, ni_netdev_t *brdev, const ni_bridg
 	}
 
 	/* Now configure the newly added port */
-	if ((rv = ni_sysfs_bridge_port_update_config(pif->name, port)) < 0) {
+	if (__ni_rtnl_link_change_bridge_port(pif, port) < 0 &&
+	    (rv = ni_sysfs_bridge_port_update_config(pif->name, port)) < 0) {
 		ni_error("%s: failed to configure port %s: %s",
 			brdev->name, pif->name, ni_strerror(rv));
 		return rv;
@@ -1982,7 +1983,7 @@ ni_system_ovs_bridge_create(ni_netconfig_t *nc, const ni_netdev_t *cfg, ni_netde
 		}
 	}
 
-	if (ni_ovs_vsctl_bridge_add(cfg, TRUE))
+	if (ni_ovs_bridge_add(cfg, TRUE))
 		return -1;
 
 	/* Wait for sysfs to appear */
@@ -2019,7 +2020,7 @@ ni_system_ovs_bridge_delete(ni_netconfig_t *nc, ni_netdev_t *dev)
 	if (!dev || dev->link.type != NI_IFTYPE_OVS_BRIDGE)
 		return -1;
 
-	return ni_ovs_vsctl_bridge_del(dev->name) ? -1 : 0;
+	return ni_ovs_bridge_del(dev->name) ? -1 : 0;
 }
 
 /*
@@ -2191,6 +2192,12 @@ ni_system_bond_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cf
 
 	case NI_CONFIG_BONDING_CTL_NETLINK:
 	default:
+		/* old kernels do not provide the bonding options via netlink */
+		if (!__ni_discover_bond_netlink_supported()) {
+			ni_debug_ifconfig("%s: no netlink bonding support, using sysfs",
+					dev->name);
+			return ni_system_bond_setup_sysfs(nc, dev, cfg);
+		}
 		return ni_system_bond_setup_netlink(nc, dev, cfg);
 	}
 }
@@ -2198,8 +2205,8 @@ ni_system_bond_setup(ni_netconfig_t *nc, ni_netdev_t *dev, const ni_netdev_t *cf
 /*
  * Shutdown a bonding device
  */
-int
-ni_system_bond_shutdown(ni_netdev_t *dev)
+static int
+ni_system_bond_shutdown_sysfs(ni_netdev_t *dev)
 {
 	ni_string_array_t list = NI_STRING_ARRAY_INIT;
 	unsigned int i;
@@ -2218,13 +2225,60 @@ cleanup:
 	return rv;
 }
 
+static int
+ni_system_bond_shutdown_netlink(ni_netdev_t *dev)
+{
+	ni_netconfig_t *nc = ni_global_state_handle(0);
+	ni_netdev_t *slave;
+
+	if (!nc)
+		return -1;
+
+	for (slave = ni_netconfig_devlist(nc); slave; slave = slave->next) {
+		if (slave->link.masterdev.index != dev->link.ifindex)
+			continue;
+
+		if (__ni_rtnl_link_unenslave(slave) != NLE_SUCCESS)
+			return -1;
+
+		ni_netdev_ref_destroy(&slave->link.masterdev);
+	}
+	return 0;
+}
+
+int
+ni_system_bond_shutdown(ni_netdev_t *dev)
+{
+	switch (ni_config_bonding_ctl()) {
+	case NI_CONFIG_BONDING_CTL_SYSFS:
+		return ni_system_bond_shutdown_sysfs(dev);
+
+	case NI_CONFIG_BONDING_CTL_NETLINK:
+	default:
+		return ni_system_bond_shutdown_netlink(dev);
+	}
+}
+
 /*
  * Delete a bonding device
  */
 int
 ni_system_bond_delete(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
-	if (ni_sysfs_bonding_delete_master(dev->name) < 0) {
+	int ret;
+
+	switch (ni_config_bonding_ctl()) {
+	case NI_CONFIG_BONDING_CTL_SYSFS:
+		ret = ni_sysfs_bonding_delete_master(dev->name);
+		break;
+
+	case NI_CONFIG_BONDING_CTL_NETLINK:
+	default:
+		ret = __ni_rtnl_link_delete(dev);
+		break;
+	}
+
+	if (ret < 0) {
 		ni_error("could not destroy bonding interface %s", dev->name);
 		return -1;
 	}
@@ -2269,14 +2323,27 @@ ni_system_bond_add_slave(ni_netconfig_t *nc, ni_netdev_t *dev, unsigned int slav
 	if (ni_bonding_has_slave(bond, slave_dev->name))
 		return 0;
 
-	ni_bonding_get_slave_names(bond, &slave_names);
-	ni_string_array_append(&slave_names, slave_dev->name);
-	if (ni_sysfs_bonding_set_list_attr(dev->name, "slaves", &slave_names) < 0) {
+	switch (ni_config_bonding_ctl()) {
+	case NI_CONFIG_BONDING_CTL_SYSFS:
+		ni_bonding_get_slave_names(bond, &slave_names);
+		ni_string_array_append(&slave_names, slave_dev->name);
+		if (ni_sysfs_bonding_set_list_attr(dev->name, "slaves", &slave_names) < 0) {
+			ni_string_array_destroy(&slave_names);
+			ni_error("%s: could not update list of slaves", dev->name);
+			return -NI_ERROR_PERMISSION_DENIED;
+		}
 		ni_string_array_destroy(&slave_names);
-		ni_error("%s: could not update list of slaves", dev->name);
-		return -NI_ERROR_PERMISSION_DENIED;
+		break;
+
+	case NI_CONFIG_BONDING_CTL_NETLINK:
+	default:
+		if (__ni_rtnl_link_add_slave_down(slave_dev, dev->name, dev->link.ifindex) < 0) {
+			ni_error("%s: could not enslave %s", dev->name, slave_dev->name);
+			return -NI_ERROR_PERMISSION_DENIED;
+		}
+		ni_netdev_ref_set(&slave_dev->link.masterdev, dev->name, dev->link.ifindex);
+		break;
 	}
-	ni_string_array_destroy(&slave_names);
 	ni_bonding_add_slave(bond, slave_dev->name);
 
 	return 0;
@@ -2311,13 +2378,29 @@ ni_system_bond_remove_slave(ni_netconfig_t *nc, ni_netdev_t *dev, unsigned int s
 	}
 
 	ni_bonding_slave_array_delete(&bond->slaves, idx);
-	ni_bonding_get_slave_names(bond, &slave_names);
-	if (ni_sysfs_bonding_set_list_attr(dev->name, "slaves", &slave_names) < 0) {
+
+	switch (ni_config_bonding_ctl()) {
+	case NI_CONFIG_BONDING_CTL_SYSFS:
+		ni_bonding_get_slave_names(bond, &slave_names);
+		if (ni_sysfs_bonding_set_list_attr(dev->name, "slaves", &slave_names) < 0) {
+			ni_string_array_destroy(&slave_names);
+			ni_error("%s: could not update list of slaves", dev->name);
+			return -NI_ERROR_PERMISSION_DENIED;
+		}
 		ni_string_array_destroy(&slave_names);
-		ni_error("%s: could not update list of slaves", dev->name);
-		return -NI_ERROR_PERMISSION_DENIED;
+		break;
+
+	case NI_CONFIG_BONDING_CTL_NETLINK:
+	default:
+		if (slave_dev->link.masterdev.index != dev->link.ifindex)
+			break;
+		if (__ni_rtnl_link_unenslave(slave_dev) != NLE_SUCCESS) {
+			ni_error("%s: could not unenslave %s", dev->name, slave_dev->name);
+			return -NI_ERROR_PERMISSION_DENIED;
+		}
+		ni_netdev_ref_destroy(&slave_dev->link.masterdev);
+		break;
 	}
-	ni_string_array_destroy(&slave_names);
 
 	return 0;
 }
@@ -4175,6 +4258,143 @@ failed:
 	return -1;
 }
 
+static int
+__ni_rtnl_link_put_bridge(struct nl_msg *msg, const ni_bridge_t *conf)
+{
+	struct nlattr *linkinfo;
+	struct nlattr *infodata;
+
+	if (!(linkinfo = nla_nest_start(msg, IFLA_LINKINFO)))
+		goto nla_put_failure;
+	NLA_PUT_STRING(msg, IFLA_INFO_KIND, "bridge");
+
+	if (!(infodata = nla_nest_start(msg, IFLA_INFO_DATA)))
+		goto nla_put_failure;
+
+	/* times are in clock_t (USER_HZ) units as in sysfs */
+	NLA_PUT_U32(msg, IFLA_BR_STP_STATE, conf->stp);
+	if (conf->priority != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U16(msg, IFLA_BR_PRIORITY, conf->priority);
+	if (conf->forward_delay != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U32(msg, IFLA_BR_FORWARD_DELAY,
+				(unsigned int)(conf->forward_delay * 100.0));
+	if (conf->ageing_time != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U32(msg, IFLA_BR_AGEING_TIME,
+				(unsigned int)(conf->ageing_time * 100.0));
+	if (conf->hello_time != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U32(msg, IFLA_BR_HELLO_TIME,
+				(unsigned int)(conf->hello_time * 100.0));
+	if (conf->max_age != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U32(msg, IFLA_BR_MAX_AGE,
+				(unsigned int)(conf->max_age * 100.0));
+
+	nla_nest_end(msg, infodata);
+	nla_nest_end(msg, linkinfo);
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static int
+__ni_rtnl_link_change_bridge(ni_netdev_t *dev, const ni_bridge_t *conf)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+	int err;
+
+	if (!dev || !conf)
+		return -1;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = dev->link.ifindex;
+
+	if (!(msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_REQUEST)))
+		goto nla_put_failure;
+
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	if (__ni_rtnl_link_put_bridge(msg, conf) < 0)
+		goto nla_put_failure;
+
+	if ((err = ni_nl_talk(msg, NULL))) {
+		ni_debug_ifconfig("unable to modify bridge %s config: %s",
+				dev->name, nl_geterror(err));
+		goto failed;
+	}
+
+	ni_debug_ifconfig("successfully modified bridge %s config", dev->name);
+	nlmsg_free(msg);
+	return 0;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr to modify bridge %s config",
+			dev->name);
+failed:
+	nlmsg_free(msg);
+	return -1;
+}
+
+static int
+__ni_rtnl_link_change_bridge_port(const ni_netdev_t *dev, const ni_bridge_port_t *conf)
+{
+	struct ifinfomsg ifi;
+	struct nlattr *linkinfo;
+	struct nlattr *slavedata;
+	struct nl_msg *msg;
+	int err;
+
+	if (!dev || !conf)
+		return -1;
+
+	if (conf->priority == NI_BRIDGE_VALUE_NOT_SET &&
+	    conf->path_cost == NI_BRIDGE_VALUE_NOT_SET)
+		return 0;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = dev->link.ifindex;
+
+	if (!(msg = nlmsg_alloc_simple(RTM_NEWLINK, NLM_F_REQUEST)))
+		goto nla_put_failure;
+
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0)
+		goto nla_put_failure;
+
+	/* the port config is applied by the master via slave data */
+	if (!(linkinfo = nla_nest_start(msg, IFLA_LINKINFO)))
+		goto nla_put_failure;
+	if (!(slavedata = nla_nest_start(msg, IFLA_INFO_SLAVE_DATA)))
+		goto nla_put_failure;
+
+	if (conf->priority != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U16(msg, IFLA_BRPORT_PRIORITY, conf->priority);
+	if (conf->path_cost != NI_BRIDGE_VALUE_NOT_SET)
+		NLA_PUT_U32(msg, IFLA_BRPORT_COST, conf->path_cost);
+
+	nla_nest_end(msg, slavedata);
+	nla_nest_end(msg, linkinfo);
+
+	if ((err = ni_nl_talk(msg, NULL))) {
+		ni_debug_ifconfig("unable to modify bridge port %s config: %s",
+				dev->name, nl_geterror(err));
+		goto failed;
+	}
+
+	ni_debug_ifconfig("successfully modified bridge port %s config", dev->name);
+	nlmsg_free(msg);
+	return 0;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr to modify bridge port %s config",
+			dev->name);
+failed:
+	nlmsg_free(msg);
+	return -1;
+}
+
 int
 __ni_rtnl_link_change_mtu(ni_netdev_t *dev, unsigned int mtu)
 {
@@ -4509,53 +4729,51 @@ addattr_sockaddr(struct nl_msg *msg, int type, const ni_sockaddr_t *addr)
 	return nla_put(msg, type, len, ((const caddr_t) addr) + offset);
 }
 
-static ni_address_t *
-__ni_netdev_address_in_list(ni_address_t *list, const ni_address_t *ap)
+/*
+ * Index of addresses matching the local (and ipv4 peer) address
+ */
+static ni_bool_t
+__ni_netdev_address_match(const void *data, const void *key)
 {
-	ni_address_t *ap2;
-
-	if (ap->local_addr.ss_family == AF_INET) {
-		const struct sockaddr_in *sin1, *sin2;
+	const ni_address_t *ap2 = data;
+	const ni_address_t *ap = key;
 
-		sin1 = &ap->local_addr.sin;
-		for (ap2 = list; ap2; ap2 = ap2->next) {
-			if (ap2->local_addr.ss_family != AF_INET)
-				continue;
-			sin2 = &ap2->local_addr.sin;
-			if (sin1->sin_addr.s_addr != sin2->sin_addr.s_addr)
-				continue;
-
-			if (!ni_sockaddr_equal(&ap->peer_addr, &ap2->peer_addr))
-				continue;
+	if (!ni_sockaddr_equal(&ap->local_addr, &ap2->local_addr))
+		return FALSE;
 
-			return ap2;
-		}
+	switch (ap->local_addr.ss_family) {
+	case AF_INET:
+		return ni_sockaddr_equal(&ap->peer_addr, &ap2->peer_addr);
+	case AF_INET6:
+		return TRUE;
+	default:
+		return FALSE;
 	}
+}
 
-	if (ap->local_addr.ss_family == AF_INET6) {
-		const struct sockaddr_in6 *sin1, *sin2;
+static void
+__ni_netdev_address_index(ni_hash_table_t *index, ni_address_t *list)
+{
+	ni_address_t *ap;
 
-		sin1 = &ap->local_addr.six;
-		for (ap2 = list; ap2; ap2 = ap2->next) {
-			if (ap2->local_addr.ss_family != AF_INET6)
-				continue;
-			sin2 = &ap2->local_addr.six;
-			if (!memcmp(&sin1->sin6_addr, &sin2->sin6_addr, 16))
-				return ap2;
-		}
-	}
+	for (ap = list; ap; ap = ap->next)
+		ni_hash_table_insert(index, ni_sockaddr_hash(&ap->local_addr), ap);
+}
 
-	return NULL;
+static ni_address_t *
+__ni_netdev_address_in_index(const ni_hash_table_t *index, const ni_address_t *ap)
+{
+	return ni_hash_table_find(index, ni_sockaddr_hash(&ap->local_addr),
+					__ni_netdev_address_match, ap);
 }
 
-static int
-__ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
+static struct nl_msg *
+__ni_rtnl_newaddr_msg(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	unsigned int omit = IFA_F_TENTATIVE|IFA_F_DADFAILED;
 	struct ifaddrmsg ifa;
 	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s, %s %s)", __FUNCTION__, dev->name,
 			flags & NLM_F_REPLACE ? "replace " :
@@ -4634,29 +4852,31 @@ __ni_rtnl_send_newaddr(ni_netdev_t *dev, const ni_address_t *ap, int flags)
 			goto nla_put_failure;
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_error("%s(%s/%u): ni_nl_talk failed [%s]", __func__,
-				ni_sockaddr_print(&ap->local_addr),
-				ap->prefixlen,  nl_geterror(err));
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink attr");
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
 }
 
 static int
-__ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
+__ni_rtnl_newaddr_result(const ni_address_t *ap, int err)
+{
+	if (err && abs(err) != NLE_EXIST) {
+		ni_error("%s(%s/%u): ni_nl_talk failed [%s]", __func__,
+				ni_sockaddr_print(&ap->local_addr),
+				ap->prefixlen,  nl_geterror(err));
+		return -1;
+	}
+	return 0;
+}
+
+static struct nl_msg *
+__ni_rtnl_deladdr_msg(ni_netdev_t *dev, const ni_address_t *ap)
 {
 	struct ifaddrmsg ifa;
 	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s/%u)", __FUNCTION__, ni_sockaddr_print(&ap->local_addr), ap->prefixlen);
 
@@ -4680,33 +4900,49 @@ __ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
 			goto nla_put_failure;
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) < 0) {
+	return msg;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr");
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_deladdr_result(const ni_address_t *ap, int err)
+{
+	if (err < 0) {
 		ni_error("%s(%s/%u): rtnl_talk failed: %s", __func__,
 				ni_sockaddr_print(&ap->local_addr),
 				ap->prefixlen,  nl_geterror(err));
-		goto failed;
+		return -1;
 	}
-
-	nlmsg_free(msg);
 	return 0;
+}
 
-nla_put_failure:
-	ni_error("failed to encode netlink attr");
-failed:
+static int
+__ni_rtnl_send_deladdr(ni_netdev_t *dev, const ni_address_t *ap)
+{
+	struct nl_msg *msg;
+	int err;
+
+	if (!(msg = __ni_rtnl_deladdr_msg(dev, ap)))
+		return -1;
+
+	err = ni_nl_talk(msg, NULL);
 	nlmsg_free(msg);
-	return -1;
+	return __ni_rtnl_deladdr_result(ap, err);
 }
 
 /*
  * Add a static route
  */
-static int
-__ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
+static struct nl_msg *
+__ni_rtnl_newroute_msg(ni_netdev_t *dev, ni_route_t *rp, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct rtmsg rt;
 	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
 			flags & NLM_F_REPLACE ? "replace " :
@@ -4892,31 +5128,34 @@ __ni_rtnl_send_newroute(ni_netdev_t *dev, ni_route_t *rp, int flags)
 		nla_nest_end(msg, mxrta);
 	}
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-		ni_error("%s(%s): ni_nl_talk failed [%s]", __FUNCTION__,
-				ni_route_print(&buf, rp),  nl_geterror(err));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink attr");
 failed:
 	nlmsg_free(msg);
-	return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+	return NULL;
 }
 
 static int
-__ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
+__ni_rtnl_newroute_result(const ni_route_t *rp, int err)
+{
+	if (err && abs(err) != NLE_EXIST) {
+		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+		ni_error("%s(%s): ni_nl_talk failed [%s]", __FUNCTION__,
+				ni_route_print(&buf, rp),  nl_geterror(err));
+		ni_stringbuf_destroy(&buf);
+		return -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+	}
+	return 0;
+}
+
+static struct nl_msg *
+__ni_rtnl_delroute_msg(ni_netdev_t *dev, ni_route_t *rp)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct rtmsg rt;
 	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_route_print(&buf, rp));
 	ni_stringbuf_destroy(&buf);
@@ -4946,22 +5185,40 @@ __ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
 
 	NLA_PUT_U32(msg, RTA_OIF, dev->link.ifindex);
 
-	if ((err = ni_nl_talk(msg, NULL)) < 0) {
+	return msg;
+
+nla_put_failure:
+	ni_error("failed to encode netlink attr");
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int
+__ni_rtnl_delroute_result(const ni_route_t *rp, int err)
+{
+	if (err < 0) {
+		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 		ni_error("%s(%s): rtnl_talk failed[%d]: %s", __func__,
 				ni_route_print(&buf, rp),
 				err, nl_geterror(err));
 		ni_stringbuf_destroy(&buf);
-		goto failed;
+		return -1;
 	}
-
-	nlmsg_free(msg);
 	return 0;
+}
 
-nla_put_failure:
-	ni_error("failed to encode netlink attr");
-failed:
+static int
+__ni_rtnl_send_delroute(ni_netdev_t *dev, ni_route_t *rp)
+{
+	struct nl_msg *msg;
+	int err;
+
+	if (!(msg = __ni_rtnl_delroute_msg(dev, rp)))
+		return -1;
+
+	err = ni_nl_talk(msg, NULL);
 	nlmsg_free(msg);
-	return -1;
+	return __ni_rtnl_delroute_result(rp, err);
 }
 
 static int
@@ -5011,13 +5268,12 @@ nla_put_failure:
 	return -1;
 }
 
-static int
-__ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
+static struct nl_msg *
+__ni_rtnl_newrule_msg(const ni_rule_t *rule, int flags)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct nl_msg *msg;
 	struct fib_rule_hdr frh;
-	int err;
 
 	ni_debug_ifconfig("%s(%s%s)", __FUNCTION__,
 			flags & NLM_F_REPLACE ? "replace " :
@@ -5042,29 +5298,32 @@ __ni_rtnl_send_newrule(const ni_rule_t *rule, int flags)
 	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
 		goto nla_put_failure;
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_EXIST) {
-		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink NEWRULE message attribute");
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
 }
 
 static int
-__ni_rtnl_send_delrule(const ni_rule_t *rule)
+__ni_rtnl_newrule_result(const ni_rule_t *rule, int err)
+{
+	if (err && abs(err) != NLE_EXIST) {
+		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
+		ni_stringbuf_destroy(&buf);
+		return -1;
+	}
+	return 0;
+}
+
+static struct nl_msg *
+__ni_rtnl_delrule_msg(const ni_rule_t *rule)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
 	struct fib_rule_hdr frh;
 	struct nl_msg *msg;
-	int err;
 
 	ni_debug_ifconfig("%s(%s)", __FUNCTION__, ni_rule_print(&buf, rule));
 	ni_stringbuf_destroy(&buf);
@@ -5086,20 +5345,24 @@ __ni_rtnl_send_delrule(const ni_rule_t *rule)
 	if (ni_rtnl_rule_msg_put(msg, rule) < 0)
 		goto nla_put_failure;
 
-	if ((err = ni_nl_talk(msg, NULL)) && abs(err) != NLE_OBJ_NOTFOUND) {
-		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
-		ni_stringbuf_destroy(&buf);
-		goto failed;
-	}
-
-	nlmsg_free(msg);
-	return 0;
+	return msg;
 
 nla_put_failure:
 	ni_error("failed to encode netlink DELRULE message attribute");
-failed:
 	nlmsg_free(msg);
-	return -1;
+	return NULL;
+}
+
+static int
+__ni_rtnl_delrule_result(const ni_rule_t *rule, int err)
+{
+	if (err && abs(err) != NLE_OBJ_NOTFOUND) {
+		ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+		ni_error("%s(%s): rtnl_talk failed", __FUNCTION__, ni_rule_print(&buf, rule));
+		ni_stringbuf_destroy(&buf);
+		return -1;
+	}
+	return 0;
 }
 
 static void
@@ -5457,11 +5720,13 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 {
 	unsigned int max_changes = NI_ADDRCONF_UPDATER_MAX_ADDR_CHANGES;
 	ni_addrconf_mode_t owner = NI_ADDRCONF_NONE;
+	ni_hash_table_t index = NI_HASH_TABLE_INIT;
+	ni_nl_batch_t batch = NI_NL_BATCH_INIT;
 	ni_address_updater_t *au;
 	unsigned int family = AF_UNSPEC;
 	ni_address_t *ap, *next;
-	unsigned int minprio;
-	int rv;
+	unsigned int minprio, i;
+	int rv = 0;
 
 	do {
 		__ni_global_seqno++;
@@ -5484,6 +5749,9 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 		return -1;
 	}
 
+	if (new_lease)
+		__ni_netdev_address_index(&index, new_lease->addrs);
+
 	for (ap = dev->addrs; ap; ap = next) {
 		ni_address_t *new_addr;
 
@@ -5493,7 +5761,7 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 
 		/* See if the config list contains the address we've found in the
 		 * system. */
-		new_addr = new_lease ? __ni_netdev_address_in_list(new_lease->addrs, ap) : NULL;
+		new_addr = __ni_netdev_address_in_index(&index, ap);
 
 		/* Do not touch addresses not managed by us. */
 		if (ap->owner == NI_ADDRCONF_NONE) {
@@ -5561,25 +5829,43 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 					ni_sockaddr_print(&ap->local_addr), ap->prefixlen);
 
 			if (replace < 0)
-				__ni_rtnl_send_deladdr(dev, ap);
+				ni_nl_batch_append(&batch, __ni_rtnl_deladdr_msg(dev, ap), ap);
 
 			if (!ni_address_lft_is_valid(new_addr, NULL))
 				continue;
 
-			if ((rv = __ni_rtnl_send_newaddr(dev, new_addr, NLM_F_REPLACE)) < 0)
-				continue;
-
-			new_addr->owner = new_lease->type;
-			ni_address_copy(ap, new_addr);
+			ni_nl_batch_append(&batch, __ni_rtnl_newaddr_msg(dev, new_addr,
+						NLM_F_REPLACE), ap);
 		} else {
 			if (max_changes == 0)
 				break;
 			else max_changes--;
 
-			if ((rv = __ni_rtnl_send_deladdr(dev, ap)) < 0)
-				continue;
+			ni_nl_batch_append(&batch, __ni_rtnl_deladdr_msg(dev, ap), ap);
+		}
+	}
+
+	/* Send all the above changes in one transaction */
+	ni_nl_batch_talk(&batch);
+	for (i = 0; i < batch.count; ++i) {
+		ni_nl_batch_entry_t *entry = &batch.data[i];
+		ni_address_t *new_addr;
+
+		ap = entry->user_data;
+		if (nlmsg_hdr(entry->msg)->nlmsg_type == RTM_DELADDR) {
+			__ni_rtnl_deladdr_result(ap, entry->error);
+			continue;
 		}
+
+		new_addr = __ni_netdev_address_in_index(&index, ap);
+		if (__ni_rtnl_newaddr_result(new_addr, entry->error) < 0)
+			continue;
+
+		new_addr->owner = new_lease->type;
+		ni_address_copy(ap, new_addr);
 	}
+	ni_nl_batch_destroy(&batch);
+	ni_hash_table_destroy(&index);
 
 	if (max_changes == 0)
 		return 1;
@@ -5620,13 +5906,27 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 				ap->prefixlen);
 
 		__ni_netdev_addr_complete(dev, ap);
-		if ((rv = __ni_rtnl_send_newaddr(dev, ap, NLM_F_CREATE)) < 0)
-			return rv;
+		ni_nl_batch_append(&batch, __ni_rtnl_newaddr_msg(dev, ap, NLM_F_CREATE), ap);
+	}
+
+	ni_nl_batch_talk(&batch);
+	for (i = 0; i < batch.count; ++i) {
+		ni_nl_batch_entry_t *entry = &batch.data[i];
+
+		ap = entry->user_data;
+		if (__ni_rtnl_newaddr_result(ap, entry->error) < 0) {
+			rv = -1;
+			continue;
+		}
 
 		ap->owner = new_lease->type;
 
 		ni_arp_notify_add_address(&au->notify, ap);
 	}
+	ni_nl_batch_destroy(&batch);
+
+	if (rv < 0)
+		return rv;
 
 	if (family == AF_INET && ni_address_updater_arp_send(updater, dev))
 		return 1;
@@ -5638,61 +5938,62 @@ __ni_netdev_update_addrs(ni_netdev_t *dev,
 }
 
 /*
- * Check if a route already exists.
+ * Index of routes matching the table and destination
  */
-static ni_route_t *
-__ni_netdev_route_table_contains(ni_route_table_t *tab, const ni_route_t *rp)
+static ni_bool_t
+__ni_netdev_route_match(const void *data, const void *key)
 {
-	unsigned int i;
-	ni_route_t *rp2;
+	const ni_route_t *rp2 = data;
+	const ni_route_t *rp = key;
 
-	for (i = 0; i < tab->routes.count; ++i) {
-		if ((rp2 = tab->routes.data[i]) == NULL)
-			continue;
+	return rp->table == rp2->table && ni_route_equal_destination(rp, rp2);
+}
 
-		if (rp->table != rp2->table)
-			continue;
+static void
+__ni_netdev_route_index(ni_hash_table_t *index, ni_route_table_t *tables)
+{
+	ni_route_table_t *tab;
+	ni_route_t *rp;
+	unsigned int i;
+
+	for (tab = tables; tab; tab = tab->next) {
+		for (i = 0; i < tab->routes.count; ++i) {
+			if ((rp = tab->routes.data[i]) == NULL)
+				continue;
 
-		if (ni_route_equal_destination(rp, rp2))
-			return rp2;
+			ni_hash_table_insert(index, ni_route_destination_hash(rp), rp);
+		}
 	}
+}
 
-	return NULL;
+/*
+ * Check if a route already exists.
+ */
+static ni_route_t *
+__ni_netdev_route_in_index(const ni_hash_table_t *index, const ni_route_t *rp)
+{
+	return ni_hash_table_find(index, ni_route_destination_hash(rp),
+					__ni_netdev_route_match, rp);
 }
 
 static ni_route_t *
-__ni_skip_conflicting_route(ni_netconfig_t *nc, ni_netdev_t *our_dev,
+__ni_skip_conflicting_route(const ni_hash_table_t *index, ni_netdev_t *our_dev,
 		ni_addrconf_lease_t *our_lease, ni_route_t *our_rp)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
-	ni_netdev_t *dev;
-	ni_route_table_t *tab;
 	ni_route_t *rp;
-	unsigned int i;
 
-	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
-		if (!dev->routes)
-			continue;
-
-		if (!(tab = ni_route_tables_find(dev->routes, our_rp->table)))
-			continue;
-
-		for (i = 0; i < tab->routes.count; ++i) {
-			rp = tab->routes.data[i];
-			if (!rp || !ni_route_equal_destination(rp, our_rp))
-				continue;
+	if (!(rp = __ni_netdev_route_in_index(index, our_rp)))
+		return NULL;
 
-			ni_debug_ifconfig("%s: skipping conflicting %s:%s route: %s",
-					our_dev->name,
-					ni_addrfamily_type_to_name(our_lease->family),
-					ni_addrconf_type_to_name(our_lease->type),
-					ni_route_print(&buf, rp));
-			ni_stringbuf_destroy(&buf);
+	ni_debug_ifconfig("%s: skipping conflicting %s:%s route: %s",
+			our_dev->name,
+			ni_addrfamily_type_to_name(our_lease->family),
+			ni_addrconf_type_to_name(our_lease->type),
+			ni_route_print(&buf, rp));
+	ni_stringbuf_destroy(&buf);
 
-			return rp;
-		}
-	}
-	return NULL;
+	return rp;
 }
 
 static int
@@ -5701,12 +6002,18 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 				ni_addrconf_lease_t       *new_lease)
 {
 	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_nl_batch_t replace = NI_NL_BATCH_INIT;
+	ni_nl_batch_t delete = NI_NL_BATCH_INIT;
+	ni_nl_batch_t create = NI_NL_BATCH_INIT;
+	ni_hash_table_t cfg_index = NI_HASH_TABLE_INIT;
+	ni_hash_table_t sys_index = NI_HASH_TABLE_INIT;
 	ni_addrconf_mode_t old_type = NI_ADDRCONF_NONE;
 	unsigned int family = AF_UNSPEC;
-	ni_route_table_t *tab, *cfg_tab;
+	ni_route_table_t *tab;
 	ni_route_t *rp, *new_route;
+	ni_netdev_t *other;
 	unsigned int minprio, i;
-	int rv = 0;
+	int rv = 0, ret;
 
 	do {
 		__ni_global_seqno++;
@@ -5725,6 +6032,9 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 	 * We need to mimic the kernel's matching behavior when modifying
 	 * the configuration of existing routes.
 	 */
+	if (new_lease)
+		__ni_netdev_route_index(&cfg_index, new_lease->routes);
+
 	for (tab = dev->routes; tab; tab = tab->next) {
 		for (i = 0; i < tab->routes.count; ++i) {
 			if ((rp = tab->routes.data[i]) == NULL)
@@ -5735,11 +6045,7 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 
 			/* See if the config list contains the route we've
 			 * found in the system. */
-			cfg_tab = new_lease ? ni_route_tables_find(new_lease->routes, rp->table) : NULL;
-			if (cfg_tab)
-				new_route = __ni_netdev_route_table_contains(cfg_tab, rp);
-			else
-				new_route = NULL;
+			new_route = __ni_netdev_route_in_index(&cfg_index, rp);
 
 			/* Do not touch route if not managed by us. */
 			if (rp->owner == NI_ADDRCONF_NONE) {
@@ -5779,14 +6085,9 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 			}
 
 			if (new_route != NULL) {
-				if (__ni_rtnl_send_newroute(dev, new_route, NLM_F_REPLACE) >= 0) {
-					ni_debug_ifconfig("%s: successfully updated existing route %s",
-							dev->name, ni_route_print(&buf, rp));
-					ni_stringbuf_destroy(&buf);
-					new_route->owner = new_lease->type;
-					new_route->seq = __ni_global_seqno;
-					ni_netconfig_route_add(nc, new_route, dev);
-
+				if (ni_nl_batch_append(&replace, __ni_rtnl_newroute_msg(dev,
+							new_route, NLM_F_REPLACE), rp)) {
+					ni_route_ref(rp);
 					continue;
 				}
 
@@ -5799,10 +6100,55 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_route_print(&buf, rp));
 			ni_stringbuf_destroy(&buf);
 
-			if ((__ni_rtnl_send_delroute(dev, rp)) < 0) {
-				continue;
-			}
+			if (ni_nl_batch_append(&delete, __ni_rtnl_delroute_msg(dev, rp), rp))
+				ni_route_ref(rp);
+		}
+	}
+
+	/* Send the route updates in one transaction, the routes we
+	 * fail to update are deleted in a second one.
+	 */
+	ni_nl_batch_talk(&replace);
+	for (i = 0; i < replace.count; ++i) {
+		rp = replace.data[i].user_data;
+		new_route = __ni_netdev_route_in_index(&cfg_index, rp);
+
+		if (new_route && __ni_rtnl_newroute_result(new_route, replace.data[i].error) >= 0) {
+			ni_debug_ifconfig("%s: successfully updated existing route %s",
+					dev->name, ni_route_print(&buf, rp));
+			ni_stringbuf_destroy(&buf);
+			new_route->owner = new_lease->type;
+			new_route->seq = __ni_global_seqno;
+			ni_netconfig_route_add(nc, new_route, dev);
+		} else {
+			ni_error("%s: failed to update route %s",
+				dev->name, ni_route_print(&buf, rp));
+			ni_stringbuf_destroy(&buf);
+
+			ni_debug_ifconfig("%s: trying to delete existing route %s",
+					dev->name, ni_route_print(&buf, rp));
+			ni_stringbuf_destroy(&buf);
+
+			if (ni_nl_batch_append(&delete, __ni_rtnl_delroute_msg(dev, rp), rp))
+				ni_route_ref(rp);
 		}
+		ni_route_free(rp);
+	}
+	ni_nl_batch_destroy(&replace);
+
+	ni_nl_batch_talk(&delete);
+	for (i = 0; i < delete.count; ++i) {
+		rp = delete.data[i].user_data;
+		__ni_rtnl_delroute_result(rp, delete.data[i].error);
+		ni_route_free(rp);
+	}
+	ni_nl_batch_destroy(&delete);
+	ni_hash_table_destroy(&cfg_index);
+
+	/* Index the routes of all devices to skip conflicting ones */
+	if (new_lease) {
+		for (other = ni_netconfig_devlist(nc); other; other = other->next)
+			__ni_netdev_route_index(&sys_index, other->routes);
 	}
 
 	/* Loop over all tables and routes in the configuration
@@ -5816,7 +6162,7 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 			if (rp->seq == __ni_global_seqno)
 				continue;
 
-			if (__ni_skip_conflicting_route(nc, dev, new_lease, rp))
+			if (__ni_skip_conflicting_route(&sys_index, dev, new_lease, rp))
 				continue;
 
 			ni_debug_ifconfig("%s: adding new %s:%s lease route %s",
@@ -5825,14 +6171,29 @@ __ni_netdev_update_routes(ni_netconfig_t *nc, ni_netdev_t *dev,
 					dev->name, ni_route_print(&buf, rp));
 			ni_stringbuf_destroy(&buf);
 
-			if ((rv = __ni_rtnl_send_newroute(dev, rp, NLM_F_CREATE)) < 0)
-				continue;
+			if (!ni_nl_batch_append(&create, __ni_rtnl_newroute_msg(dev, rp,
+							NLM_F_CREATE), rp))
+				rv = -NI_ERROR_CANNOT_CONFIGURE_ROUTE;
+			else
+				ni_hash_table_insert(&sys_index, ni_route_destination_hash(rp), rp);
+		}
+	}
+	ni_hash_table_destroy(&sys_index);
 
-			rp->owner = new_lease->type;
-			rp->seq = __ni_global_seqno;
-			ni_netconfig_route_add(nc, rp, dev);
+	ni_nl_batch_talk(&create);
+	for (i = 0; i < create.count; ++i) {
+		rp = create.data[i].user_data;
+		if ((ret = __ni_rtnl_newroute_result(rp, create.data[i].error)) < 0) {
+			rv = ret;
+			continue;
 		}
+
+		rv = 0;
+		rp->owner = new_lease->type;
+		rp->seq = __ni_global_seqno;
+		ni_netconfig_route_add(nc, rp, dev);
 	}
+	ni_nl_batch_destroy(&create);
 
 	return rv;
 }
@@ -5964,6 +6325,7 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 	ni_stringbuf_t out = NI_STRINGBUF_INIT_DYNAMIC;
 	ni_rule_array_t del_rules = NI_RULE_ARRAY_INIT;
 	ni_rule_array_t mod_rules = NI_RULE_ARRAY_INIT;
+	ni_nl_batch_t batch = NI_NL_BATCH_INIT;
 	const ni_addrconf_lease_t *lease;
 	ni_rule_array_t *old_rules;
 	ni_rule_array_t *new_rules;
@@ -6073,13 +6435,20 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 			}
 
 			/* OK to delete -- no other lease provides it */
-			if (__ni_rtnl_send_delrule(rule) < 0)
-				continue;
-
-			ni_netconfig_rule_del(nc, rule, NULL);
+			ni_nl_batch_append(&batch, __ni_rtnl_delrule_msg(rule), rule);
 		}
 	}
 
+	ni_nl_batch_talk(&batch);
+	for (i = 0; i < batch.count; ++i) {
+		rule = batch.data[i].user_data;
+		if (__ni_rtnl_delrule_result(rule, batch.data[i].error) < 0)
+			continue;
+
+		ni_netconfig_rule_del(nc, rule, NULL);
+	}
+	ni_nl_batch_destroy(&batch);
+
 	for (i = 0; i < mod_rules.count; ++i) {
 		rule = mod_rules.data[i];
 
@@ -6130,12 +6499,20 @@ __ni_netdev_update_rules(ni_netconfig_t *nc, ni_netdev_t *dev,
 
 		r->seq = __ni_global_seqno;
 		r->owner = new_lease->uuid;
-		if (__ni_rtnl_send_newrule(r, NLM_F_REPLACE) < 0) {
+		if (!ni_nl_batch_append(&batch, __ni_rtnl_newrule_msg(r, NLM_F_REPLACE), r))
+			ni_rule_free(r);
+	}
+
+	ni_nl_batch_talk(&batch);
+	for (i = 0; i < batch.count; ++i) {
+		r = batch.data[i].user_data;
+		if (__ni_rtnl_newrule_result(r, batch.data[i].error) < 0) {
 			ni_rule_free(r);
 		} else {
 			ni_netconfig_rule_add(nc, r);
 		}
 	}
+	ni_nl_batch_destroy(&batch);
 
 	(void)__ni_system_refresh_rules(nc);
 
@@ -22,11 +22,13 @@
 #include <wicked/ipv6.h>
 
 #include "netinfo_priv.h"
+#include "util_priv.h"
 #include "socket_priv.h"
 #include "ipv6_priv.h"
 #include "sysfs.h"
 #include "kernel.h"
 #include "appconfig.h"
+#include "teamd.h"
 
 #ifndef NI_ND_OPT_RDNSS_INFORMATION
 #define NI_ND_OPT_RDNSS_INFORMATION	25	/* RFC 5006 */
@@ -276,8 +278,11 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 	if (!(ifi = ni_rtnl_ifinfomsg(h, RTM_NEWLINK)))
 		return -1;
 
-	if (ifi->ifi_family == AF_BRIDGE)
+	if (ifi->ifi_family == AF_BRIDGE) {
+		if ((dev = ni_netdev_by_index(nc, ifi->ifi_index)))
+			__ni_netdev_process_newlink_bridge_port(dev, h, ifi, nc);
 		return 0;
+	}
 
 	old = ni_netdev_by_index(nc, ifi->ifi_index);
 	ifname = if_indextoname(ifi->ifi_index, namebuf);
@@ -343,6 +348,7 @@ __ni_rtevent_newlink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 			char *current = if_indextoname(conflict->link.ifindex, namebuf);
 			if (current) {
 				ni_string_dup(&conflict->name, current);
+				ni_netconfig_device_index_update(nc, conflict);
 				__ni_netdev_event(nc, conflict, NI_EVENT_DEVICE_RENAME);
 			} else {
 				unsigned int ifflags = conflict->link.ifflags;
@@ -398,6 +404,8 @@ __ni_rtevent_dellink(ni_netconfig_t *nc, const struct sockaddr_nl *nladdr, struc
 		dev->deleted = 1;
 		__ni_netdev_process_events(nc, dev, old_flags);
 		ni_client_state_drop(dev->link.ifindex);
+		if (dev->link.type == NI_IFTYPE_TEAM)
+			ni_teamd_discover_drop(dev->name);
 		ni_netconfig_device_remove(nc, dev);
 	}
 
@@ -930,6 +938,440 @@ __ni_rtevent_process_cb(struct nl_msg *msg, void *ptr)
 static ni_bool_t	__ni_rtevent_restart(ni_socket_t *sock);
 
 
+/*
+ * Resynchronize the netinfo cache after an rtnetlink event overrun.
+ *
+ * When the kernel is unable to queue further messages to the event
+ * socket (ENOBUFS), any number of NEW/DEL notifications are lost.
+ * The socket itself stays usable, so instead of restarting it, we
+ * bump the cache generation and schedule a (coalesced, rate-limited)
+ * dump of links, addresses, routes and rules. The dump result is
+ * compared against a snapshot of the cache and only the events we
+ * have missed are synthesized to the listeners.
+ */
+#define NI_RTEVENT_RESYNC_DELAY		100	/* msec to coalesce overruns	*/
+#define NI_RTEVENT_RESYNC_INTERVAL	1000	/* msec between two resyncs	*/
+
+typedef struct ni_rtevent_resync_link {
+	unsigned int		ifindex;
+	unsigned int		ifflags;
+	char *			ifname;
+	ni_address_t *		addrs;
+} ni_rtevent_resync_link_t;
+
+typedef struct ni_rtevent_resync_snapshot {
+	unsigned int		count;
+	ni_rtevent_resync_link_t *links;
+	ni_hash_table_t		index;
+	ni_route_array_t	routes;
+	ni_rule_array_t		rules;
+} ni_rtevent_resync_snapshot_t;
+
+static struct {
+	const ni_timer_t *	timer;
+	struct timeval		last;
+	unsigned int		generation;
+	unsigned int		synced;
+} ni_rtevent_resync;
+
+static void
+ni_rtevent_resync_snapshot_destroy(ni_rtevent_resync_snapshot_t *snap)
+{
+	ni_rtevent_resync_link_t *link;
+	unsigned int i;
+
+	for (i = 0; i < snap->count; ++i) {
+		link = &snap->links[i];
+		ni_string_free(&link->ifname);
+		ni_address_list_destroy(&link->addrs);
+	}
+	free(snap->links);
+	snap->links = NULL;
+	snap->count = 0;
+	ni_hash_table_destroy(&snap->index);
+	ni_route_array_destroy(&snap->routes);
+	ni_rule_array_destroy(&snap->rules);
+}
+
+/*
+ * The snapshot and the refreshed state are matched via hash indexes,
+ * the hashes are consistent with the match functions used to diff.
+ */
+static ni_bool_t
+ni_rtevent_resync_match_ref(const void *a, const void *b)
+{
+	return a == b;
+}
+
+static unsigned int
+ni_rtevent_resync_ref_hash(const void *ptr)
+{
+	return ni_hash_data(&ptr, sizeof(ptr));
+}
+
+static ni_bool_t
+ni_rtevent_resync_match_link(const void *a, const void *b)
+{
+	return ((const ni_rtevent_resync_link_t *)a)->ifindex ==
+		*(const unsigned int *)b;
+}
+
+static ni_bool_t
+ni_rtevent_resync_match_addr(const void *a, const void *b)
+{
+	return ni_sockaddr_equal(&((const ni_address_t *)a)->local_addr,
+				&((const ni_address_t *)b)->local_addr);
+}
+
+static ni_bool_t
+ni_rtevent_resync_match_route(const void *a, const void *b)
+{
+	return ni_route_equal(a, b);
+}
+
+static unsigned int
+ni_rtevent_resync_route_hash(const ni_route_t *rp)
+{
+	unsigned int hash;
+
+	/* ni_route_equal does not compare the table */
+	hash = ni_hash_uint(rp->family << 8 | rp->prefixlen);
+	if (rp->prefixlen)
+		hash ^= ni_sockaddr_hash(&rp->destination);
+	return hash;
+}
+
+static ni_bool_t
+ni_rtevent_resync_match_rule(const void *a, const void *b)
+{
+	return ni_rule_equal(a, b);
+}
+
+static unsigned int
+ni_rtevent_resync_rule_hash(const ni_rule_t *rule)
+{
+	/* the pref is not compared, when a rule has none assigned */
+	return ni_hash_uint(rule->family << 16 | rule->action << 8 | rule->tos) ^
+		ni_hash_uint(rule->table) ^ ni_hash_uint(rule->fwmark) ^
+		ni_hash_uint(rule->src.len << 8 | rule->dst.len);
+}
+
+static void
+ni_rtevent_resync_collect_routes(ni_netdev_t *dev, ni_route_array_t *routes,
+				ni_hash_table_t *seen)
+{
+	ni_route_table_t *tab;
+	ni_route_t *rp;
+	unsigned int i, hash;
+
+	for (tab = dev->routes; tab; tab = tab->next) {
+		for (i = 0; i < tab->routes.count; ++i) {
+			if (!(rp = tab->routes.data[i]))
+				continue;
+
+			/* multipath routes are referenced by each hop device */
+			hash = ni_rtevent_resync_ref_hash(rp);
+			if (ni_hash_table_find(seen, hash, ni_rtevent_resync_match_ref, rp))
+				continue;
+
+			ni_hash_table_insert(seen, hash, rp);
+			ni_route_array_append(routes, ni_route_ref(rp));
+		}
+	}
+}
+
+static void
+ni_rtevent_resync_collect_all_routes(ni_netconfig_t *nc, ni_route_array_t *routes)
+{
+	ni_hash_table_t seen = NI_HASH_TABLE_INIT;
+	ni_netdev_t *dev;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		ni_rtevent_resync_collect_routes(dev, routes, &seen);
+	ni_hash_table_destroy(&seen);
+}
+
+static ni_bool_t
+ni_rtevent_resync_snapshot_init(ni_rtevent_resync_snapshot_t *snap, ni_netconfig_t *nc)
+{
+	const ni_rule_array_t *rules;
+	ni_rtevent_resync_link_t *link;
+	ni_address_t *ap, *clone;
+	ni_netdev_t *dev;
+	unsigned int i;
+
+	memset(snap, 0, sizeof(*snap));
+	ni_route_array_init(&snap->routes);
+	ni_rule_array_init(&snap->rules);
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
+		snap->count++;
+
+	if (snap->count && !(snap->links = calloc(snap->count, sizeof(*snap->links)))) {
+		snap->count = 0;
+		return FALSE;
+	}
+
+	for (i = 0, dev = ni_netconfig_devlist(nc); dev && i < snap->count; dev = dev->next, ++i) {
+		link = &snap->links[i];
+		link->ifindex = dev->link.ifindex;
+		link->ifflags = dev->link.ifflags;
+		ni_string_dup(&link->ifname, dev->name);
+
+		ni_hash_table_insert(&snap->index, ni_hash_uint(link->ifindex), link);
+
+		for (ap = dev->addrs; ap; ap = ap->next) {
+			if ((clone = ni_address_clone(ap)))
+				ni_address_list_append(&link->addrs, clone);
+		}
+	}
+	ni_rtevent_resync_collect_all_routes(nc, &snap->routes);
+
+	if ((rules = ni_netconfig_rule_array(nc))) {
+		for (i = 0; i < rules->count; ++i) {
+			if (rules->data[i])
+				ni_rule_array_append(&snap->rules, ni_rule_ref(rules->data[i]));
+		}
+	}
+	return TRUE;
+}
+
+static ni_rtevent_resync_link_t *
+ni_rtevent_resync_snapshot_link(ni_rtevent_resync_snapshot_t *snap, unsigned int ifindex)
+{
+	return ni_hash_table_find(&snap->index, ni_hash_uint(ifindex),
+					ni_rtevent_resync_match_link, &ifindex);
+}
+
+static void
+ni_rtevent_resync_addrs(ni_netdev_t *dev, ni_address_t *old_addrs)
+{
+	ni_hash_table_t old_index = NI_HASH_TABLE_INIT;
+	ni_hash_table_t new_index = NI_HASH_TABLE_INIT;
+	const ni_address_t *ap, *old;
+
+	for (ap = dev->addrs; ap; ap = ap->next)
+		ni_hash_table_insert(&new_index, ni_sockaddr_hash(&ap->local_addr), ap);
+	for (old = old_addrs; old; old = old->next)
+		ni_hash_table_insert(&old_index, ni_sockaddr_hash(&old->local_addr), old);
+
+	for (old = old_addrs; old; old = old->next) {
+		if (!ni_hash_table_find(&new_index, ni_sockaddr_hash(&old->local_addr),
+					ni_rtevent_resync_match_addr, old))
+			__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_DELETE, old);
+	}
+
+	for (ap = dev->addrs; ap; ap = ap->next) {
+		old = ni_hash_table_find(&old_index, ni_sockaddr_hash(&ap->local_addr),
+					ni_rtevent_resync_match_addr, ap);
+		if (old && old->prefixlen == ap->prefixlen && old->flags == ap->flags)
+			continue;
+
+		__ni_netdev_addr_event(dev, NI_EVENT_ADDRESS_UPDATE, ap);
+	}
+
+	ni_hash_table_destroy(&old_index);
+	ni_hash_table_destroy(&new_index);
+}
+
+static void
+ni_rtevent_resync_routes(ni_netconfig_t *nc, ni_route_array_t *old_routes)
+{
+	ni_route_array_t routes = NI_ROUTE_ARRAY_INIT;
+	ni_hash_table_t old_index = NI_HASH_TABLE_INIT;
+	ni_hash_table_t new_index = NI_HASH_TABLE_INIT;
+	ni_route_t *rp, *old;
+	unsigned int i;
+
+	ni_rtevent_resync_collect_all_routes(nc, &routes);
+
+	for (i = 0; i < routes.count; ++i) {
+		if ((rp = routes.data[i]))
+			ni_hash_table_insert(&new_index, ni_rtevent_resync_route_hash(rp), rp);
+	}
+	for (i = 0; i < old_routes->count; ++i) {
+		if ((old = old_routes->data[i]))
+			ni_hash_table_insert(&old_index, ni_rtevent_resync_route_hash(old), old);
+	}
+
+	for (i = 0; i < old_routes->count; ++i) {
+		if (!(old = old_routes->data[i]))
+			continue;
+
+		if (!ni_hash_table_find(&new_index, ni_rtevent_resync_route_hash(old),
+					ni_rtevent_resync_match_route, old))
+			__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_DELETE, old);
+	}
+
+	for (i = 0; i < routes.count; ++i) {
+		if (!(rp = routes.data[i]))
+			continue;
+
+		old = ni_hash_table_find(&old_index, ni_rtevent_resync_route_hash(rp),
+					ni_rtevent_resync_match_route, rp);
+		if (old && ni_route_equal_hops(old, rp) && ni_route_equal_options(old, rp))
+			continue;
+
+		__ni_netinfo_route_event(nc, NI_EVENT_ROUTE_UPDATE, rp);
+	}
+
+	ni_hash_table_destroy(&old_index);
+	ni_hash_table_destroy(&new_index);
+	ni_route_array_destroy(&routes);
+}
+
+static void
+ni_rtevent_resync_rules(ni_netconfig_t *nc, ni_rule_array_t *old_rules)
+{
+	ni_hash_table_t old_index = NI_HASH_TABLE_INIT;
+	ni_hash_table_t new_index = NI_HASH_TABLE_INIT;
+	const ni_rule_array_t *rules;
+	ni_rule_t *rule, *old;
+	unsigned int i;
+
+	rules = ni_netconfig_rule_array(nc);
+	for (i = 0; rules && i < rules->count; ++i) {
+		if ((rule = rules->data[i]))
+			ni_hash_table_insert(&new_index, ni_rtevent_resync_rule_hash(rule), rule);
+	}
+	for (i = 0; i < old_rules->count; ++i) {
+		if ((old = old_rules->data[i]))
+			ni_hash_table_insert(&old_index, ni_rtevent_resync_rule_hash(old), old);
+	}
+
+	for (i = 0; i < old_rules->count; ++i) {
+		if (!(old = old_rules->data[i]))
+			continue;
+
+		if (!ni_hash_table_find(&new_index, ni_rtevent_resync_rule_hash(old),
+					ni_rtevent_resync_match_rule, old))
+			__ni_netinfo_rule_event(nc, NI_EVENT_RULE_DELETE, old);
+	}
+
+	for (i = 0; rules && i < rules->count; ++i) {
+		if (!(rule = rules->data[i]))
+			continue;
+
+		if (!ni_hash_table_find(&old_index, ni_rtevent_resync_rule_hash(rule),
+					ni_rtevent_resync_match_rule, rule))
+			__ni_netinfo_rule_event(nc, NI_EVENT_RULE_UPDATE, rule);
+	}
+
+	ni_hash_table_destroy(&old_index);
+	ni_hash_table_destroy(&new_index);
+}
+
+static int
+ni_rtevent_resync_run(ni_netconfig_t *nc)
+{
+	ni_rtevent_resync_snapshot_t snap;
+	ni_rtevent_resync_link_t *link;
+	ni_netdev_t *dev, *del_list = NULL;
+	unsigned int old_flags;
+
+	if (!ni_rtevent_resync_snapshot_init(&snap, nc)) {
+		ni_error("unable to snapshot netinfo state for rtnetlink resync");
+		ni_rtevent_resync_snapshot_destroy(&snap);
+		return -1;
+	}
+
+	if (__ni_system_refresh_all(nc, &del_list) < 0) {
+		ni_error("rtnetlink resync: unable to refresh interfaces");
+		ni_rtevent_resync_snapshot_destroy(&snap);
+		return -1;
+	}
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		if (!(link = ni_rtevent_resync_snapshot_link(&snap, dev->link.ifindex))) {
+			dev->created = 1;
+			__ni_netdev_process_events(nc, dev, 0);
+			ni_rtevent_resync_addrs(dev, NULL);
+			continue;
+		}
+
+		if (!ni_string_eq(link->ifname, dev->name)) {
+			ni_debug_events("%s[%u]: device renamed to %s",
+					link->ifname, dev->link.ifindex, dev->name);
+			__ni_netdev_event(nc, dev, NI_EVENT_DEVICE_RENAME);
+		}
+		if (link->ifflags != dev->link.ifflags)
+			__ni_netdev_process_events(nc, dev, link->ifflags);
+
+		ni_rtevent_resync_addrs(dev, link->addrs);
+	}
+
+	ni_rtevent_resync_routes(nc, &snap.routes);
+	ni_rtevent_resync_rules(nc, &snap.rules);
+
+	while ((dev = del_list) != NULL) {
+		del_list = dev->next;
+		dev->next = NULL;
+
+		if ((link = ni_rtevent_resync_snapshot_link(&snap, dev->link.ifindex)))
+			ni_rtevent_resync_addrs(dev, link->addrs);
+
+		old_flags = dev->link.ifflags;
+		dev->link.ifflags = 0;
+		dev->deleted = 1;
+		__ni_netdev_process_events(nc, dev, old_flags);
+
+		__ni_refresh_unbind_master(nc, dev);
+		ni_client_state_drop(dev->link.ifindex);
+		ni_netdev_put(dev);
+	}
+
+	ni_rtevent_resync_snapshot_destroy(&snap);
+	return 0;
+}
+
+static void
+ni_rtevent_resync_timeout(void *user_data, const ni_timer_t *timer)
+{
+	unsigned int generation = ni_rtevent_resync.generation;
+	ni_netconfig_t *nc;
+
+	if (ni_rtevent_resync.timer != timer)
+		return;
+	ni_rtevent_resync.timer = NULL;
+
+	if (ni_rtevent_resync.synced == generation)
+		return;
+
+	if (!(nc = ni_global_state_handle(0)))
+		return;
+
+	ni_debug_events("rtnetlink resync of cache generation %u", generation);
+	ni_timer_get_time(&ni_rtevent_resync.last);
+	if (ni_rtevent_resync_run(nc) == 0)
+		ni_rtevent_resync.synced = generation;
+}
+
+static void
+ni_rtevent_resync_schedule(void)
+{
+	unsigned long timeout = NI_RTEVENT_RESYNC_DELAY;
+	struct timeval now, delta;
+	unsigned long elapsed;
+
+	ni_rtevent_resync.generation++;
+	if (ni_rtevent_resync.timer)
+		return;
+
+	if (timerisset(&ni_rtevent_resync.last)) {
+		ni_timer_get_time(&now);
+		timersub(&now, &ni_rtevent_resync.last, &delta);
+		elapsed = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+		if (elapsed < NI_RTEVENT_RESYNC_INTERVAL &&
+		    timeout < NI_RTEVENT_RESYNC_INTERVAL - elapsed)
+			timeout = NI_RTEVENT_RESYNC_INTERVAL - elapsed;
+	}
+
+	ni_debug_events("rtnetlink resync of cache generation %u scheduled in %lums",
+			ni_rtevent_resync.generation, timeout);
+	ni_rtevent_resync.timer = ni_timer_register(timeout,
+				ni_rtevent_resync_timeout, NULL);
+}
+
 /*
  * Receive netlink message and trigger processing by callback
  */
@@ -949,6 +1391,16 @@ __ni_rtevent_receive(ni_socket_t *sock)
 		case -NLE_AGAIN:
 			break;
 
+		case -NLE_NOMEM:
+			/*
+			 * libnl maps the ENOBUFS socket overrun to NLE_NOMEM:
+			 * the socket is still fine, but events were dropped.
+			 */
+			ni_warn("rtnetlink event receive error: %s (%m)",
+					nl_geterror(ret));
+			ni_rtevent_resync_schedule();
+			break;
+
 		default:
 			ni_error("rtnetlink event receive error: %s (%m)",
 					nl_geterror(ret));
@@ -972,6 +1424,10 @@ __ni_rtevent_close(ni_socket_t *sock)
 
 	if (handle) {
 		if (handle->nlsock) {
+			/* close the fd dup'ed from a netlink shim */
+			if (sock->__fd >= 0 &&
+			    sock->__fd != nl_socket_get_fd(handle->nlsock))
+				close(sock->__fd);
 			nl_socket_free(handle->nlsock);
 			handle->nlsock = NULL;
 		}
@@ -1024,7 +1480,23 @@ __ni_rtevent_join_group(ni_rtevent_handle_t *handle, unsigned int group)
 static void
 __ni_rtevent_sock_error_handler(ni_socket_t *sock)
 {
-	ni_error("poll error on rtnetlink event socket: %m");
+	socklen_t len = sizeof(int);
+	int err = 0;
+
+	/*
+	 * A receive queue overrun is reported as POLLERR with ENOBUFS;
+	 * fetching SO_ERROR clears it and the socket remains usable,
+	 * so just put it back into the poll set and resync.
+	 */
+	if (getsockopt(sock->__fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 &&
+	    err == ENOBUFS && ni_socket_activate(sock)) {
+		ni_warn("rtnetlink event socket overrun: %s", strerror(err));
+		ni_rtevent_resync_schedule();
+		return;
+	}
+
+	ni_error("poll error on rtnetlink event socket: %s",
+			err ? strerror(err) : "unknown error");
 	if (__ni_rtevent_restart(sock)) {
 		ni_note("restarted rtnetlink event listener");
 	} else {
@@ -1050,12 +1522,27 @@ __ni_rtevent_config_mesg_buff_len(void)
 	return ni_global.config ? ni_global.config->rtnl_event.mesg_buff_length : 0;
 }
 
+static ni_socket_t *
+__ni_rtevent_shim_wrap(ni_nl_shim_t *shim)
+{
+	ni_socket_t *sock;
+	int fd;
+
+	if ((fd = dup(shim->event_fd)) < 0)
+		return NULL;
+
+	if (!(sock = ni_socket_wrap(fd, SOCK_DGRAM)))
+		close(fd);
+	return sock;
+}
+
 static ni_socket_t *
 __ni_rtevent_sock_open(void)
 {
 	unsigned int recv_buff_len = __ni_rtevent_config_recv_buff_len();
 	unsigned int mesg_buff_len = __ni_rtevent_config_mesg_buff_len();
 	ni_rtevent_handle_t *handle;
+	ni_nl_shim_t *shim;
 	ni_socket_t *sock;
 	int fd, ret;
 
@@ -1076,6 +1563,7 @@ __ni_rtevent_sock_open(void)
 	 */
 	nl_socket_modify_cb(handle->nlsock, NL_CB_VALID, NL_CB_CUSTOM,
 				__ni_rtevent_process_cb, NULL);
+	ni_nl_shim_setup_event(handle->nlsock);
 
 	/* Required to receive async event notifications */
 	nl_socket_disable_seq_check(handle->nlsock);
@@ -1089,8 +1577,14 @@ __ni_rtevent_sock_open(void)
 	/* Enable non-blocking processing */
 	nl_socket_set_nonblocking(handle->nlsock);
 
+	/* A netlink shim may provide the events via another fd to poll */
 	fd = nl_socket_get_fd(handle->nlsock);
-	if (!(sock = ni_socket_wrap(fd, SOCK_DGRAM))) {
+	shim = ni_nl_shim_get();
+	if (shim && shim->event_fd >= 0)
+		sock = __ni_rtevent_shim_wrap(shim);
+	else
+		sock = ni_socket_wrap(fd, SOCK_DGRAM);
+	if (!sock) {
 		ni_error("Cannot wrap rtnetlink event socket: %m");
 		__ni_rtevent_handle_free(handle);
 		return NULL;
@@ -1140,6 +1634,9 @@ __ni_rtevent_restart(ni_socket_t *sock)
 				__ni_rtevent_join_group(handle, groups->data[i]);
 			}
 			ni_socket_activate(__ni_rtevent_sock);
+
+			/* we've lost the events sent in the meantime */
+			ni_rtevent_resync_schedule();
 			return TRUE;
 		}
 		ni_socket_release(sock);
@@ -69,7 +69,7 @@ static int		__ni_netdev_process_newroute(ni_netdev_t *, struct nlmsghdr *,
 					struct rtmsg *, ni_netconfig_t *);
 static int		__ni_netdev_process_newrule(struct nlmsghdr *, struct fib_rule_hdr *,
 					ni_netconfig_t *);
-static int		__ni_discover_bridge(ni_netdev_t *);
+static int		__ni_discover_bridge(ni_netdev_t *, struct nlattr **, ni_netconfig_t *);
 static int		__ni_discover_bond(ni_netdev_t *, struct nlattr **, ni_netconfig_t *);
 static int		__ni_discover_addrconf(ni_netdev_t *);
 static int		__ni_discover_infiniband(ni_netdev_t *, ni_netconfig_t *);
@@ -99,16 +99,24 @@ struct ni_rtnl_query {
 };
 
 /*
- * Query netlink for all relevant information
+ * Query netlink for all relevant information.
+ *
+ * When an ifindex is given, links are requested using a non-dump
+ * RTM_GETLINK and addresses/routes using kernel side filtered dumps
+ * (with a fallback to full dumps on older kernels).
  */
 static inline int
-__ni_rtnl_query(struct ni_rtnl_info *qr, int af, int type)
+__ni_rtnl_query(struct ni_rtnl_info *qr, int af, int type, unsigned int ifindex)
 {
 	int rv;
 
 	ni_nlmsg_list_init(&qr->nlmsg_list);
 retry:
-	rv = ni_nl_dump_store(af, type, &qr->nlmsg_list);
+	if (type == RTM_GETLINK && af == AF_UNSPEC)
+		rv = ni_nl_get_link_store(ifindex, &qr->nlmsg_list);
+	else
+		rv = ni_nl_dump_store_ifindex(af, type, ifindex, &qr->nlmsg_list);
+
 	switch (rv) {
 	case NLE_SUCCESS:
 		qr->entry = qr->nlmsg_list.head;
@@ -116,6 +124,15 @@ retry:
 	case -NLE_DUMP_INTR:
 		ni_nlmsg_list_destroy(&qr->nlmsg_list);
 		goto retry;
+	case -NLE_NODEV:
+	case -NLE_OBJ_NOTFOUND:
+		/* device vanished meanwhile -- same as an empty dump */
+		if (ifindex && type == RTM_GETLINK) {
+			qr->entry = qr->nlmsg_list.head;
+			rv = NLE_SUCCESS;
+			break;
+		}
+		/* fall through */
 	default:
 		qr->entry = NULL;
 		break;
@@ -152,10 +169,14 @@ ni_rtnl_query(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0
-	 || (family != AF_INET && __ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0)
-	 || __ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0
-	 || __ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	/*
+	 * The per-interface ipv6 link info is only available via an
+	 * AF_INET6 dump and not needed by single interface refreshes.
+	 */
+	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK, ifindex) < 0
+	 || (!ifindex && family != AF_INET && __ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK, 0) < 0)
+	 || __ni_rtnl_query(&q->addr_info, family, RTM_GETADDR, ifindex) < 0
+	 || __ni_rtnl_query(&q->route_info, family, RTM_GETROUTE, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -169,7 +190,7 @@ ni_rtnl_query_link(struct ni_rtnl_query *q, unsigned int ifindex)
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK) < 0) {
+	if (__ni_rtnl_query(&q->link_info, AF_UNSPEC, RTM_GETLINK, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -183,7 +204,8 @@ ni_rtnl_query_ipv6_link(struct ni_rtnl_query *q, unsigned int ifindex)
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK) < 0) {
+	/* AF_INET6 link info is dump-only; filtered in the iterator */
+	if (__ni_rtnl_query(&q->ipv6_info, AF_INET6, RTM_GETLINK, 0) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -235,7 +257,7 @@ ni_rtnl_query_addr_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned
 	memset(q, 0, sizeof(*q));
 	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->addr_info, family, RTM_GETADDR) < 0) {
+	if (__ni_rtnl_query(&q->addr_info, family, RTM_GETADDR, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -262,11 +284,12 @@ ni_rtnl_query_next_addr_info(struct ni_rtnl_query *q, struct nlmsghdr **hp)
 }
 
 static int
-ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int family)
+ni_rtnl_query_route_info(struct ni_rtnl_query *q, unsigned int ifindex, unsigned int family)
 {
 	memset(q, 0, sizeof(*q));
+	q->ifindex = ifindex;
 
-	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE) < 0) {
+	if (__ni_rtnl_query(&q->route_info, family, RTM_GETROUTE, ifindex) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -296,7 +319,7 @@ ni_rtnl_query_rule_info(struct ni_rtnl_query *q, unsigned int family)
 {
 	memset(q, 0, sizeof(*q));
 
-	if (__ni_rtnl_query(&q->rule_info, family, RTM_GETRULE) < 0) {
+	if (__ni_rtnl_query(&q->rule_info, family, RTM_GETRULE, 0) < 0) {
 		ni_rtnl_query_destroy(q);
 		return -1;
 	}
@@ -436,6 +459,25 @@ __ni_refresh_bonding_master_bind(ni_netdev_t *master, ni_linkinfo_t *link, const
 	ni_bonding_slave_set_info(slave, link->slave.bond);
 }
 
+static inline void
+__ni_refresh_bridge_master_bind(ni_netdev_t *master, ni_linkinfo_t *link, const char *ifname)
+{
+	ni_bridge_t *bridge;
+	ni_bridge_port_t *port;
+
+	if (!link->slave.bridge || !(bridge = ni_netdev_get_bridge(master)))
+		return;
+
+	port = ni_bridge_port_clone(link->slave.bridge);
+	port->ifindex = link->ifindex;
+	if (!ni_string_eq(port->ifname, ifname))
+		ni_string_dup(&port->ifname, ifname);
+
+	ni_bridge_del_port_ifindex(bridge, link->ifindex);
+	if (ni_bridge_add_port(bridge, port) < 0)
+		ni_bridge_port_free(port);
+}
+
 static void
 __ni_refresh_bind_master(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
@@ -458,6 +500,10 @@ __ni_refresh_bind_master(ni_netconfig_t *nc, ni_netdev_t *dev)
 		__ni_refresh_bonding_master_bind(master, &dev->link, dev->name);
 		break;
 
+	case NI_IFTYPE_BRIDGE:
+		__ni_refresh_bridge_master_bind(master, &dev->link, dev->name);
+		break;
+
 	default:
 		break;
 	}
@@ -483,7 +529,7 @@ __ni_refresh_bonding_master_unbind(ni_netdev_t *master, ni_linkinfo_t *link, con
 	ni_bonding_unbind_slave(master->bonding, &ref, master->name);
 }
 
-static void
+void
 __ni_refresh_unbind_master(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	ni_netdev_t *master;
@@ -502,6 +548,11 @@ __ni_refresh_unbind_master(ni_netconfig_t *nc, ni_netdev_t *dev)
 		__ni_refresh_bonding_master_unbind(master, &dev->link, dev->name);
 		break;
 
+	case NI_IFTYPE_BRIDGE:
+		if (master->bridge)
+			ni_bridge_del_port_ifindex(master->bridge, dev->link.ifindex);
+		break;
+
 	default:
 		break;
 	}
@@ -574,9 +625,10 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 			if ((pci_dev = ni_sysfs_netdev_get_pci(ifname)) != NULL)
 				ni_netdev_set_pci(dev, pci_dev);
 
-			/* FIXME: use ni_netconfig_device_append() */
+			/* open-coded ni_netconfig_device_append() using tail */
 			*tail = dev;
 			tail = &dev->next;
+			ni_netconfig_device_index_add(nc, dev);
 		} else {
 			if (!ni_string_eq(dev->name, ifname))
 				ni_string_dup(&dev->name, ifname);
@@ -640,6 +692,7 @@ __ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list)
 		ni_route_tables_drop_by_seq(nc, dev->routes, seqno);
 		if (dev->seq != seqno) {
 			*tail = dev->next;
+			ni_netconfig_device_index_del(nc, dev);
 			if (del_list == NULL) {
 				__ni_refresh_unbind_master(nc, dev);
 				ni_client_state_drop(dev->link.ifindex);
@@ -890,7 +943,7 @@ __ni_system_refresh_routes(ni_netconfig_t *nc)
 		seqno = ++__ni_global_seqno;
 	} while (!seqno);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, 0, ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next)
@@ -931,7 +984,8 @@ __ni_system_refresh_interface_routes(ni_netconfig_t *nc, ni_netdev_t *dev)
 		dev->seq = ++__ni_global_seqno;
 	} while (!dev->seq);
 
-	if (ni_rtnl_query_route_info(&query, ni_netconfig_get_family_filter(nc)) < 0)
+	if (ni_rtnl_query_route_info(&query, dev->link.ifindex,
+				ni_netconfig_get_family_filter(nc)) < 0)
 		goto failed;
 
 	ni_route_tables_reset_seq(dev->routes);
@@ -987,6 +1041,9 @@ __ni_device_refresh_link_info(ni_netconfig_t *nc, ni_linkinfo_t *link)
 		}
 	}
 
+	if (dev && &dev->link == link)
+		ni_netconfig_device_index_update(nc, dev);
+
 done:
 	ni_rtnl_query_destroy(&query);
 	return rv;
@@ -1097,7 +1154,7 @@ __ni_process_ifinfomsg_ovs_type(ni_iftype_t *type, const char *ifname, ni_netcon
 	if (ni_netconfig_discover_filtered(nc, NI_NETCONFIG_DISCOVER_LINK_EXTERN))
 		return;
 
-	if (ni_ovs_vsctl_bridge_exists(ifname) == 0)
+	if (ni_ovs_bridge_exists(ifname) == 0)
 		*type = NI_IFTYPE_OVS_BRIDGE;
 }
 
@@ -1253,6 +1310,10 @@ __ni_process_ifinfomsg_masterdev_unbind(ni_linkinfo_t *link, const char *ifname,
 		case NI_IFTYPE_BOND:
 			ni_bonding_unbind_slave(master->bonding, &ref, master->name);
 			break;
+		case NI_IFTYPE_BRIDGE:
+			if (master->bridge)
+				ni_bridge_del_port_ifindex(master->bridge, ref.index);
+			break;
 		default:
 			break;
 		}
@@ -1401,6 +1462,93 @@ __ni_process_ifinfomsg_bond_slave_data(ni_linkinfo_t *link, const char *ifname,
 	}
 }
 
+static inline void
+__ni_bridge_id_print(char **str, const struct nlattr *nla)
+{
+	const struct ifla_bridge_id *id;
+
+	if (nla_len(nla) < (int)sizeof(*id))
+		return;
+
+	/* same format as in the sysfs bridge id attributes */
+	id = nla_data(nla);
+	ni_string_printf(str, "%.2x%.2x.%.2x%.2x%.2x%.2x%.2x%.2x",
+			id->prio[0], id->prio[1],
+			id->addr[0], id->addr[1], id->addr[2],
+			id->addr[3], id->addr[4], id->addr[5]);
+}
+
+/*
+ * Parse IFLA_BRPORT_* as provided in the bridge port slave data and
+ * in the IFLA_PROTINFO of AF_BRIDGE link messages.
+ */
+static int
+__ni_process_ifinfomsg_bridge_port_data(ni_bridge_port_t *port, const char *ifname, struct nlattr *data)
+{
+	/* static const */ struct nla_policy	__brport_policy[IFLA_BRPORT_MAX+1] = {
+		[IFLA_BRPORT_STATE]			= { .type = NLA_U8	},
+		[IFLA_BRPORT_PRIORITY]			= { .type = NLA_U16	},
+		[IFLA_BRPORT_COST]			= { .type = NLA_U32	},
+		[IFLA_BRPORT_MODE]			= { .type = NLA_U8	},
+		[IFLA_BRPORT_ROOT_ID]			= { .type = NLA_UNSPEC	},
+		[IFLA_BRPORT_BRIDGE_ID]			= { .type = NLA_UNSPEC	},
+		[IFLA_BRPORT_DESIGNATED_PORT]		= { .type = NLA_U16	},
+		[IFLA_BRPORT_DESIGNATED_COST]		= { .type = NLA_U16	},
+		[IFLA_BRPORT_ID]			= { .type = NLA_U16	},
+		[IFLA_BRPORT_NO]			= { .type = NLA_U16	},
+		[IFLA_BRPORT_TOPOLOGY_CHANGE_ACK]	= { .type = NLA_U8	},
+		[IFLA_BRPORT_CONFIG_PENDING]		= { .type = NLA_U8	},
+		[IFLA_BRPORT_MESSAGE_AGE_TIMER]		= { .type = NLA_U64	},
+		[IFLA_BRPORT_FORWARD_DELAY_TIMER]	= { .type = NLA_U64	},
+		[IFLA_BRPORT_HOLD_TIMER]		= { .type = NLA_U64	},
+	};
+	struct nlattr *tb[IFLA_BRPORT_MAX+1];
+	ni_bridge_port_status_t *ps = &port->status;
+
+	if (nla_parse_nested(tb, IFLA_BRPORT_MAX, data, __brport_policy) < 0) {
+		ni_warn("%s: unable to parse bridge port data", ifname);
+		return -1;
+	}
+
+	if (tb[IFLA_BRPORT_PRIORITY])
+		port->priority = ps->priority = nla_get_u16(tb[IFLA_BRPORT_PRIORITY]);
+	if (tb[IFLA_BRPORT_COST])
+		port->path_cost = ps->path_cost = nla_get_u32(tb[IFLA_BRPORT_COST]);
+
+	if (tb[IFLA_BRPORT_STATE])
+		ps->state = nla_get_u8(tb[IFLA_BRPORT_STATE]);
+	if (tb[IFLA_BRPORT_ID])
+		ps->port_id = nla_get_u16(tb[IFLA_BRPORT_ID]);
+	if (tb[IFLA_BRPORT_NO])
+		ps->port_no = nla_get_u16(tb[IFLA_BRPORT_NO]);
+	if (tb[IFLA_BRPORT_ROOT_ID])
+		__ni_bridge_id_print(&ps->designated_root, tb[IFLA_BRPORT_ROOT_ID]);
+	if (tb[IFLA_BRPORT_BRIDGE_ID])
+		__ni_bridge_id_print(&ps->designated_bridge, tb[IFLA_BRPORT_BRIDGE_ID]);
+	if (tb[IFLA_BRPORT_DESIGNATED_PORT])
+		ps->designated_port = nla_get_u16(tb[IFLA_BRPORT_DESIGNATED_PORT]);
+	if (tb[IFLA_BRPORT_DESIGNATED_COST])
+		ps->designated_cost = nla_get_u16(tb[IFLA_BRPORT_DESIGNATED_COST]);
+	if (tb[IFLA_BRPORT_TOPOLOGY_CHANGE_ACK])
+		ps->change_ack = nla_get_u8(tb[IFLA_BRPORT_TOPOLOGY_CHANGE_ACK]);
+	if (tb[IFLA_BRPORT_MODE])
+		ps->hairpin_mode = nla_get_u8(tb[IFLA_BRPORT_MODE]);
+	if (tb[IFLA_BRPORT_CONFIG_PENDING])
+		ps->config_pending = nla_get_u8(tb[IFLA_BRPORT_CONFIG_PENDING]);
+
+	if (tb[IFLA_BRPORT_HOLD_TIMER])
+		ps->hold_timer = nla_get_u64(tb[IFLA_BRPORT_HOLD_TIMER]);
+	if (tb[IFLA_BRPORT_MESSAGE_AGE_TIMER])
+		ps->message_age_timer = nla_get_u64(tb[IFLA_BRPORT_MESSAGE_AGE_TIMER]);
+	if (tb[IFLA_BRPORT_FORWARD_DELAY_TIMER])
+		ps->forward_delay_timer = nla_get_u64(tb[IFLA_BRPORT_FORWARD_DELAY_TIMER]);
+
+	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
+			"%s: bridge port state=%d priority=%u path-cost=%u",
+			ifname, ps->state, port->priority, port->path_cost);
+	return 0;
+}
+
 static inline void
 __ni_process_ifinfomsg_slave_data(ni_linkinfo_t *link, const char *ifname,
 		ni_netdev_t *master, const char *kind, struct nlattr *data)
@@ -1438,6 +1586,30 @@ __ni_process_ifinfomsg_slave_data(ni_linkinfo_t *link, const char *ifname,
 			__ni_process_ifinfomsg_bond_slave_data(link, ifname, data);
 		break;
 
+	case NI_IFTYPE_BRIDGE:
+		if (master && master->link.type != link->slave.type) {
+			ni_warn("%s: master %s link type does not match slaveinfo kind type",
+					master->name, ifname);
+			return;
+		}
+
+		if (!data) {
+			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
+					"%s: slave info does not provide any data", ifname);
+			return;
+		}
+
+		link->slave.bridge = ni_bridge_port_new(NULL, ifname, link->ifindex);
+		if (__ni_process_ifinfomsg_bridge_port_data(link->slave.bridge, ifname, data) < 0) {
+			ni_bridge_port_free(link->slave.bridge);
+			link->slave.bridge = NULL;
+			return;
+		}
+
+		if (master)
+			__ni_refresh_bridge_master_bind(master, link, ifname);
+		break;
+
 	default:
 		break;
 	}
@@ -1870,6 +2042,9 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 	if (rv < 0)
 		return rv;
 
+	/* rehash the device on rename, hwaddr or lower/master change */
+	ni_netconfig_device_index_update(nc, dev);
+
 #if 0
 	ni_debug_ifconfig("%s: ifi flags:%s%s%s, my flags:%s%s%s, oper_state=%d/%s", dev->name,
 		(ifi->ifi_flags & IFF_RUNNING)? " running" : "",
@@ -1903,7 +2078,7 @@ __ni_netdev_process_newlink(ni_netdev_t *dev, struct nlmsghdr *h,
 		break;
 
 	case NI_IFTYPE_BRIDGE:
-		__ni_discover_bridge(dev);
+		__ni_discover_bridge(dev, tb, nc);
 		break;
 	case NI_IFTYPE_BOND:
 		__ni_discover_bond(dev, tb, nc);
@@ -2750,6 +2925,39 @@ __ni_netdev_process_newlink_ipv6(ni_netdev_t *dev, struct nlmsghdr *h, struct if
 	return __ni_process_ifinfomsg_ipv6info(dev, tb[IFLA_PROTINFO]);
 }
 
+/*
+ * Refresh bridge port info given an AF_BRIDGE RTM_NEWLINK message,
+ * e.g. sent by the kernel on spanning tree port state changes
+ */
+int
+__ni_netdev_process_newlink_bridge_port(ni_netdev_t *dev, struct nlmsghdr *h,
+				struct ifinfomsg *ifi, ni_netconfig_t *nc)
+{
+	struct nlattr *tb[IFLA_MAX+1];
+	ni_netdev_t *master;
+
+	if (nlmsg_parse(h, sizeof(*ifi), tb, IFLA_MAX, NULL) < 0) {
+		ni_error("unable to parse rtnl LINK message");
+		return -1;
+	}
+
+	if (!tb[IFLA_PROTINFO] || !tb[IFLA_MASTER])
+		return 0;
+
+	/* without slave data, the bridge is discovered via sysfs */
+	if (dev->link.slave.type != NI_IFTYPE_BRIDGE || !dev->link.slave.bridge)
+		return 0;
+
+	if (__ni_process_ifinfomsg_bridge_port_data(dev->link.slave.bridge,
+					dev->name, tb[IFLA_PROTINFO]) < 0)
+		return -1;
+
+	master = ni_netdev_by_index(nc, dev->link.masterdev.index);
+	if (master && master->link.type == NI_IFTYPE_BRIDGE)
+		__ni_refresh_bridge_master_bind(master, &dev->link, dev->name);
+	return 0;
+}
+
 /*
  * Parse IPv6 prefixes received via router advertisements
  */
@@ -3474,17 +3682,161 @@ failure:
  * Discover bridge topology
  */
 static int
-__ni_discover_bridge(ni_netdev_t *dev)
+__ni_discover_bridge_netlink_master(ni_netdev_t *dev, struct nlattr *info_data)
+{
+	/* static const */ struct nla_policy	__bridge_master_policy[IFLA_BR_MAX+1] = {
+		[IFLA_BR_FORWARD_DELAY]			= { .type = NLA_U32	},
+		[IFLA_BR_HELLO_TIME]			= { .type = NLA_U32	},
+		[IFLA_BR_MAX_AGE]			= { .type = NLA_U32	},
+		[IFLA_BR_AGEING_TIME]			= { .type = NLA_U32	},
+		[IFLA_BR_STP_STATE]			= { .type = NLA_U32	},
+		[IFLA_BR_PRIORITY]			= { .type = NLA_U16	},
+		[IFLA_BR_ROOT_ID]			= { .type = NLA_UNSPEC	},
+		[IFLA_BR_BRIDGE_ID]			= { .type = NLA_UNSPEC	},
+		[IFLA_BR_ROOT_PORT]			= { .type = NLA_U16	},
+		[IFLA_BR_ROOT_PATH_COST]		= { .type = NLA_U32	},
+		[IFLA_BR_TOPOLOGY_CHANGE]		= { .type = NLA_U8	},
+		[IFLA_BR_TOPOLOGY_CHANGE_DETECTED]	= { .type = NLA_U8	},
+		[IFLA_BR_HELLO_TIMER]			= { .type = NLA_U64	},
+		[IFLA_BR_TCN_TIMER]			= { .type = NLA_U64	},
+		[IFLA_BR_TOPOLOGY_CHANGE_TIMER]		= { .type = NLA_U64	},
+		[IFLA_BR_GC_TIMER]			= { .type = NLA_U64	},
+		[IFLA_BR_GROUP_ADDR]			= { .type = NLA_UNSPEC	},
+	};
+	struct nlattr *tb[IFLA_BR_MAX+1];
+	ni_bridge_t *bridge = dev->bridge;
+	ni_bridge_status_t *bs = &bridge->status;
+
+	if (nla_parse_nested(tb, IFLA_BR_MAX, info_data, __bridge_master_policy) < 0) {
+		ni_error("%s: Unable to parse bridge IFLA_INFO_DATA", dev->name);
+		return -1;
+	}
+
+	/* times are in clock_t (USER_HZ) units as in sysfs */
+	if (tb[IFLA_BR_STP_STATE]) {
+		bs->stp_state = nla_get_u32(tb[IFLA_BR_STP_STATE]);
+		bridge->stp = bs->stp_state ? TRUE : FALSE;
+	}
+	if (tb[IFLA_BR_PRIORITY])
+		bridge->priority = nla_get_u16(tb[IFLA_BR_PRIORITY]);
+	if (tb[IFLA_BR_FORWARD_DELAY])
+		bridge->forward_delay = (double)nla_get_u32(tb[IFLA_BR_FORWARD_DELAY]) / 100.0;
+	if (tb[IFLA_BR_AGEING_TIME])
+		bridge->ageing_time = (double)nla_get_u32(tb[IFLA_BR_AGEING_TIME]) / 100.0;
+	if (tb[IFLA_BR_HELLO_TIME])
+		bridge->hello_time = (double)nla_get_u32(tb[IFLA_BR_HELLO_TIME]) / 100.0;
+	if (tb[IFLA_BR_MAX_AGE])
+		bridge->max_age = (double)nla_get_u32(tb[IFLA_BR_MAX_AGE]) / 100.0;
+
+	if (tb[IFLA_BR_ROOT_ID])
+		__ni_bridge_id_print(&bs->root_id, tb[IFLA_BR_ROOT_ID]);
+	if (tb[IFLA_BR_BRIDGE_ID])
+		__ni_bridge_id_print(&bs->bridge_id, tb[IFLA_BR_BRIDGE_ID]);
+	if (tb[IFLA_BR_GROUP_ADDR] && nla_len(tb[IFLA_BR_GROUP_ADDR]) >= ETH_ALEN) {
+		const unsigned char *a = nla_data(tb[IFLA_BR_GROUP_ADDR]);
+
+		ni_string_printf(&bs->group_addr, "%02x:%02x:%02x:%02x:%02x:%02x",
+				a[0], a[1], a[2], a[3], a[4], a[5]);
+	}
+	if (tb[IFLA_BR_ROOT_PORT])
+		bs->root_port = nla_get_u16(tb[IFLA_BR_ROOT_PORT]);
+	if (tb[IFLA_BR_ROOT_PATH_COST])
+		bs->root_path_cost = nla_get_u32(tb[IFLA_BR_ROOT_PATH_COST]);
+	if (tb[IFLA_BR_TOPOLOGY_CHANGE])
+		bs->topology_change = nla_get_u8(tb[IFLA_BR_TOPOLOGY_CHANGE]);
+	if (tb[IFLA_BR_TOPOLOGY_CHANGE_DETECTED])
+		bs->topology_change_detected = nla_get_u8(tb[IFLA_BR_TOPOLOGY_CHANGE_DETECTED]);
+
+	if (tb[IFLA_BR_GC_TIMER])
+		bs->gc_timer = nla_get_u64(tb[IFLA_BR_GC_TIMER]);
+	if (tb[IFLA_BR_TCN_TIMER])
+		bs->tcn_timer = nla_get_u64(tb[IFLA_BR_TCN_TIMER]);
+	if (tb[IFLA_BR_HELLO_TIMER])
+		bs->hello_timer = nla_get_u64(tb[IFLA_BR_HELLO_TIMER]);
+	if (tb[IFLA_BR_TOPOLOGY_CHANGE_TIMER])
+		bs->topology_change_timer = nla_get_u64(tb[IFLA_BR_TOPOLOGY_CHANGE_TIMER]);
+
+	return 0;
+}
+
+static void
+__ni_discover_bridge_netlink_ports(ni_netdev_t *dev, ni_netconfig_t *nc)
+{
+	ni_bridge_t *bridge = dev->bridge;
+	ni_bridge_port_t *port;
+	ni_netdev_t *pdev;
+
+	/*
+	 * The ports refresh their own entry from the slave data of their
+	 * link messages; here we just rebuild the list from the ports we
+	 * already know and use sysfs for ports without any slave data.
+	 */
+	ni_bridge_ports_destroy(bridge);
+	for (pdev = ni_netconfig_devlist(nc); pdev; pdev = pdev->next) {
+		if (pdev->link.masterdev.index != dev->link.ifindex)
+			continue;
+
+		if (pdev->link.slave.type == NI_IFTYPE_BRIDGE && pdev->link.slave.bridge) {
+			__ni_refresh_bridge_master_bind(dev, &pdev->link, pdev->name);
+			continue;
+		}
+
+		port = ni_bridge_port_new(bridge, pdev->name, pdev->link.ifindex);
+		ni_sysfs_bridge_port_get_config(port->ifname, port);
+		ni_sysfs_bridge_port_get_status(port->ifname, &port->status);
+	}
+}
+
+static int
+__ni_discover_bridge_netlink(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t *nc)
+{
+	/* static const */ struct nla_policy	__info_data_policy[IFLA_INFO_MAX+1] = {
+		[IFLA_INFO_KIND]			= { .type = NLA_STRING	},
+		[IFLA_INFO_DATA]			= { .type = NLA_NESTED	},
+		/* _here_, we handle only these attrs */
+	};
+	struct nlattr *info[IFLA_INFO_MAX+1];
+	static int fallback = 1;
+
+	if (!nc || !tb || !tb[IFLA_LINKINFO])
+		return fallback;
+
+	if (nla_parse_nested(info, IFLA_INFO_MAX, tb[IFLA_LINKINFO], __info_data_policy) < 0) {
+		ni_error("%s: Unable to parse IFLA_LINKINFO newlink attribute", dev->name);
+		return -1;
+	}
+
+	if (!info[IFLA_INFO_KIND] || !ni_string_eq("bridge", nla_get_string(info[IFLA_INFO_KIND])))
+		return fallback; /* just a safe guard, we've already checked this   */
+
+	if (!info[IFLA_INFO_DATA])
+		return fallback; /* ahm... no data provided in this newlink message */
+
+	fallback = 0;		 /* disable sysfs fallback, kernel supports netlink */
+
+	if (__ni_discover_bridge_netlink_master(dev, info[IFLA_INFO_DATA]) < 0)
+		return -1;
+
+	__ni_discover_bridge_netlink_ports(dev, nc);
+	return 0;
+}
+
+static int
+__ni_discover_bridge(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t *nc)
 {
 	ni_bridge_t *bridge;
 	ni_string_array_t ports;
 	unsigned int i;
+	int ret;
 
 	if (dev->link.type != NI_IFTYPE_BRIDGE)
 		return 0;
 
 	bridge = ni_netdev_get_bridge(dev);
 
+	if ((ret = __ni_discover_bridge_netlink(dev, tb, nc)) <= 0)
+		return ret;
+
 	ni_sysfs_bridge_get_config(dev->name, bridge);
 	ni_sysfs_bridge_get_status(dev->name, &bridge->status);
 
@@ -3883,6 +4235,18 @@ __ni_discover_bond_netlink_master(ni_netdev_t *dev, struct nlattr *info_data, ni
 	return 0;
 }
 
+/*
+ * The sysfs fallback stays enabled until the kernel provides the
+ * bonding details (IFLA_BOND_*) in a newlink message.
+ */
+static int	__ni_discover_bond_netlink_fallback = 1;
+
+ni_bool_t
+__ni_discover_bond_netlink_supported(void)
+{
+	return !__ni_discover_bond_netlink_fallback;
+}
+
 static int
 __ni_discover_bond_netlink(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t *nc)
 {
@@ -3892,7 +4256,7 @@ __ni_discover_bond_netlink(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t
 		/* _here_, we handle only these attrs */
 	};
 	struct nlattr *info[IFLA_INFO_MAX+1];
-	static int fallback = 1;
+	int fallback = __ni_discover_bond_netlink_fallback;
 
 	if (!tb || !tb[IFLA_LINKINFO])
 		return fallback;
@@ -3908,7 +4272,8 @@ __ni_discover_bond_netlink(ni_netdev_t *dev, struct nlattr **tb, ni_netconfig_t
 	if (!info[IFLA_INFO_DATA])
 		return fallback; /* ahm... no data provided in this newlink message */
 
-	fallback = 0;		 /* disable sysfs fallback, kernel supports netlink */
+	/* disable sysfs fallback, kernel supports netlink */
+	__ni_discover_bond_netlink_fallback = 0;
 
 	return __ni_discover_bond_netlink_master(dev, info[IFLA_INFO_DATA], nc);
 }
@@ -192,6 +192,16 @@ ni_json_string_get(ni_json_t *json, char **ret)
 	return FALSE;
 }
 
+const char *
+ni_json_string_value(ni_json_t *json)
+{
+	char **val;
+
+	if ((val = ni_json_to_string(json)))
+		return *val;
+	return NULL;
+}
+
 /*
  * json object name:value pair
  */
@@ -1067,6 +1077,7 @@ ni_json_reader_stack_pop(ni_json_reader_t *jr)
 		stack->parent = NULL;
 		ni_string_free(&stack->name);
 		ni_json_free(stack->value);
+		free(stack);
 	}
 	return jr->stack;
 }
@@ -1566,7 +1577,7 @@ ni_json_reader_parse_array(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected array token");
 		break;
 	}
-	ni_stringbuf_clear(&tokenValue);
+	ni_stringbuf_destroy(&tokenValue);
 }
 
 static void
@@ -1611,7 +1622,7 @@ ni_json_reader_parse_object(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected object token");
 		break;
 	}
-	ni_stringbuf_clear(&tokenValue);
+	ni_stringbuf_destroy(&tokenValue);
 }
 
 static void
@@ -1669,6 +1680,7 @@ ni_json_reader_parse_pair(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected object pair token");
 		break;
 	}
+	ni_stringbuf_destroy(&tokenValue);
 }
 
 static void
@@ -1718,6 +1730,7 @@ ni_json_reader_parse_initial(ni_json_reader_t *jr)
 		ni_json_reader_set_error(jr, "unexpected token");
 		break;
 	}
+	ni_stringbuf_destroy(&tokenValue);
 }
 
 static ni_json_t *
@@ -337,6 +337,78 @@ __ni_nla_get_addr(int af, ni_sockaddr_t *ss, const struct nlattr *nla)
 	return 0;
 }
 
+/*
+ * Netlink shim, see kernel.h
+ */
+static ni_nl_shim_t *		ni_nl_shim;
+
+int
+ni_nl_shim_install(ni_nl_shim_t *shim)
+{
+	if (__ni_global_netlink) {
+		ni_error("Cannot install netlink shim: netlink handle already open");
+		return -1;
+	}
+	ni_nl_shim = shim;
+	return 0;
+}
+
+ni_nl_shim_t *
+ni_nl_shim_get(void)
+{
+	return ni_nl_shim;
+}
+
+static int
+__ni_nl_shim_request_send(struct nl_sock *sk, struct nl_msg *msg)
+{
+	return ni_nl_shim->request_send(ni_nl_shim, sk, msg);
+}
+
+static int
+__ni_nl_shim_request_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+		unsigned char **buf, struct ucred **creds)
+{
+	if (creds)
+		*creds = NULL;
+	return ni_nl_shim->request_recv(ni_nl_shim, sk, nla, buf);
+}
+
+static int
+__ni_nl_shim_event_recv(struct nl_sock *sk, struct sockaddr_nl *nla,
+		unsigned char **buf, struct ucred **creds)
+{
+	if (creds)
+		*creds = NULL;
+	return ni_nl_shim->event_recv(ni_nl_shim, sk, nla, buf);
+}
+
+static void
+__ni_nl_shim_setup_request(struct nl_cb *cb)
+{
+	if (!ni_nl_shim || !cb)
+		return;
+
+	if (ni_nl_shim->request_send)
+		nl_cb_overwrite_send(cb, __ni_nl_shim_request_send);
+	if (ni_nl_shim->request_recv)
+		nl_cb_overwrite_recv(cb, __ni_nl_shim_request_recv);
+}
+
+void
+ni_nl_shim_setup_event(struct nl_sock *sk)
+{
+	struct nl_cb *cb;
+
+	if (!ni_nl_shim || !ni_nl_shim->event_recv || !sk)
+		return;
+
+	if ((cb = nl_socket_get_cb(sk))) {
+		nl_cb_overwrite_recv(cb, __ni_nl_shim_event_recv);
+		nl_cb_put(cb);
+	}
+}
+
 /*
  * Open netlink handle; usually for rtnetlink
  */
@@ -351,6 +423,8 @@ __ni_netlink_open(int protocol)
 		ni_error("nl_cb_alloc failed");
 		goto failed;
 	}
+	if (protocol == NETLINK_ROUTE)
+		__ni_nl_shim_setup_request(nl->nl_cb);
 
 	nl->nl_sock = nl_socket_alloc_cb(nl->nl_cb);
 	if (nl_connect(nl->nl_sock, protocol) < 0) {
@@ -533,31 +607,18 @@ __ni_nl_dump_valid(struct nl_msg *msg, void *p)
 }
 
 /*
- * Issue a DUMP request and store all replies in list
+ * Receive all replies of a DUMP request and store them in list
  */
-int
-ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+static int
+__ni_nl_dump_recv(struct nl_sock *nl_sock, const char *name, struct ni_nlmsg_list *list)
 {
-	struct nl_sock *nl_sock;
 	struct __ni_nl_dump_state data = {
 		.msg_type = -1,
 		.list = list,
 	};
 	struct nl_cb *cb;
-	const char *name;
 	int rv;
 
-	name = ni_rtnl_msg_type_to_name(type, __func__);
-	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
-		ni_error("%s: no netlink socket", name);
-		return -NLE_BAD_SOCK;
-	}
-
-	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
-		ni_error("%s: failed to send request", name);
-		return rv;
-	}
-
 	if (!(cb = __ni_nl_cb_clone(__ni_global_netlink)))
 		return -NLE_NOMEM;
 
@@ -587,6 +648,194 @@ retry:
 	return rv;
 }
 
+/*
+ * Issue a DUMP request and store all replies in list
+ */
+int
+ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	const char *name;
+	int rv;
+
+	name = ni_rtnl_msg_type_to_name(type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	if ((rv = nl_rtgen_request(nl_sock, type, af, NLM_F_DUMP)) < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	return __ni_nl_dump_recv(nl_sock, name, list);
+}
+
+/*
+ * Kernel side filtering of address and route dumps by interface
+ * index requires NETLINK_GET_STRICT_CHK (linux >= 4.20). As it also
+ * enforces strict header validation of the (rtgen) dump requests we
+ * are using everywhere else, we enable it for filtered requests only.
+ * The kernel evaluates the flag while processing the request, so it
+ * is sufficient to reset it right after sending.
+ */
+#ifndef SOL_NETLINK
+#define SOL_NETLINK			270
+#endif
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK		12
+#endif
+
+static ni_bool_t	__ni_nl_strict_check_unsupported;
+
+static ni_bool_t
+__ni_nl_set_strict_check(struct nl_sock *nl_sock, ni_bool_t enable)
+{
+	int val = enable ? 1 : 0;
+
+	if (__ni_nl_strict_check_unsupported)
+		return FALSE;
+
+	if (setsockopt(nl_socket_get_fd(nl_sock), SOL_NETLINK,
+				NETLINK_GET_STRICT_CHK, &val, sizeof(val)) < 0) {
+		if (enable) {
+			ni_debug_socket("netlink strict checking not supported: %m"
+					" -- using unfiltered dumps");
+			__ni_nl_strict_check_unsupported = TRUE;
+		}
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static struct nl_msg *
+__ni_nl_filtered_dump_request(int af, int type, unsigned int ifindex)
+{
+	struct nl_msg *msg;
+
+	if (!(msg = nlmsg_alloc_simple(type, NLM_F_DUMP)))
+		return NULL;
+
+	switch (type) {
+	case RTM_GETADDR: {
+			struct ifaddrmsg ifa;
+
+			memset(&ifa, 0, sizeof(ifa));
+			ifa.ifa_family = af;
+			ifa.ifa_index = ifindex;
+			if (nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO) < 0)
+				goto failure;
+		}
+		break;
+
+	case RTM_GETROUTE: {
+			struct rtmsg rtm;
+
+			memset(&rtm, 0, sizeof(rtm));
+			rtm.rtm_family = af;
+			if (nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO) < 0)
+				goto failure;
+			if (nla_put_u32(msg, RTA_OIF, ifindex) < 0)
+				goto failure;
+		}
+		break;
+
+	default:
+		goto failure;
+	}
+	return msg;
+
+failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+/*
+ * Issue a DUMP request filtered by the kernel to the given interface
+ * index and store all replies in list. Supported for RTM_GETADDR and
+ * RTM_GETROUTE; falls back to an unfiltered dump on older kernels, so
+ * the caller still has to filter the replies.
+ */
+int
+ni_nl_dump_store_ifindex(int af, int type, unsigned int ifindex, struct ni_nlmsg_list *list)
+{
+	struct nl_sock *nl_sock;
+	struct nl_msg *msg;
+	const char *name;
+	int rv;
+
+	if (!ifindex || (type != RTM_GETADDR && type != RTM_GETROUTE))
+		return ni_nl_dump_store(af, type, list);
+
+	name = ni_rtnl_msg_type_to_name(type, __func__);
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", name);
+		return -NLE_BAD_SOCK;
+	}
+
+	if (__ni_nl_strict_check_unsupported)
+		return ni_nl_dump_store(af, type, list);
+
+	if (!(msg = __ni_nl_filtered_dump_request(af, type, ifindex))) {
+		ni_error("%s: unable to construct filtered dump request", name);
+		return -NLE_NOMEM;
+	}
+
+	if (!__ni_nl_set_strict_check(nl_sock, TRUE)) {
+		nlmsg_free(msg);
+		return ni_nl_dump_store(af, type, list);
+	}
+	rv = nl_send_auto(nl_sock, msg);
+	__ni_nl_set_strict_check(nl_sock, FALSE);
+	nlmsg_free(msg);
+
+	if (rv < 0) {
+		ni_error("%s: failed to send request", name);
+		return rv;
+	}
+
+	rv = __ni_nl_dump_recv(nl_sock, name, list);
+	if (rv == -NLE_INVAL) {
+		/* some family dump handler rejected the filter */
+		ni_debug_socket("%s: filtered dump rejected -- using unfiltered dumps", name);
+		__ni_nl_strict_check_unsupported = TRUE;
+		ni_nlmsg_list_destroy(list);
+		return ni_nl_dump_store(af, type, list);
+	}
+	return rv;
+}
+
+/*
+ * Issue a non-dump RTM_GETLINK request for a single interface
+ * and store the reply in list.
+ */
+int
+ni_nl_get_link_store(unsigned int ifindex, struct ni_nlmsg_list *list)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+	int rv;
+
+	if (!ifindex)
+		return ni_nl_dump_store(AF_UNSPEC, RTM_GETLINK, list);
+
+	if (!(msg = nlmsg_alloc_simple(RTM_GETLINK, 0)))
+		return -NLE_NOMEM;
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_index = ifindex;
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0) {
+		nlmsg_free(msg);
+		return -NLE_NOMEM;
+	}
+
+	rv = ni_nl_talk(msg, list);
+	nlmsg_free(msg);
+	return rv;
+}
+
 /*
  * Send a message and capture the response message(s)
  */
@@ -611,6 +860,208 @@ ni_nl_talk(struct nl_msg *msg, struct ni_nlmsg_list *list)
 	}
 }
 
+/*
+ * Netlink transactions
+ *
+ * Instead of waiting for the ACK of each request before sending the
+ * next one, the requests of a batch are sent in windows using a single
+ * sendmsg with one iovec per request and an own sequence number each.
+ * The kernel processes all of them, so the (N)ACKs are collected and
+ * reported back to the batch entries by sequence number.
+ *
+ * The batch uses an own sequence number space: libnl expects the replies
+ * to its requests in lockstep with the sequence numbers it handed out and
+ * reports a sequence mismatch otherwise.
+ */
+#define NI_NL_BATCH_CHUNK		64
+#define NI_NL_BATCH_WINDOW		64
+#define NI_NL_BATCH_WINDOW_SIZE		(32 * 1024)
+
+static unsigned int			ni_nl_batch_seq;
+
+ni_bool_t
+ni_nl_batch_append(ni_nl_batch_t *batch, struct nl_msg *msg, void *user_data)
+{
+	ni_nl_batch_entry_t *entry;
+	size_t newsize;
+
+	if (!batch || !msg)
+		goto failure;
+
+	if ((batch->count % NI_NL_BATCH_CHUNK) == 0) {
+		if (batch->count > UINT_MAX - NI_NL_BATCH_CHUNK)
+			goto failure;
+
+		newsize = batch->count + NI_NL_BATCH_CHUNK;
+		entry = realloc(batch->data, newsize * sizeof(*entry));
+		if (!entry)
+			goto failure;
+		batch->data = entry;
+	}
+
+	entry = &batch->data[batch->count++];
+	entry->msg = msg;
+	entry->user_data = user_data;
+	entry->seq = 0;
+	entry->error = 0;
+	return TRUE;
+
+failure:
+	/* the batch owns the message, also when we fail to add it */
+	nlmsg_free(msg);
+	return FALSE;
+}
+
+void
+ni_nl_batch_destroy(ni_nl_batch_t *batch)
+{
+	unsigned int i;
+
+	if (!batch)
+		return;
+
+	for (i = 0; i < batch->count; ++i)
+		nlmsg_free(batch->data[i].msg);
+	free(batch->data);
+	batch->data = NULL;
+	batch->count = 0;
+}
+
+static unsigned int
+__ni_nl_batch_send(struct nl_sock *nl_sock, ni_nl_batch_entry_t *entries,
+			unsigned int count, int *err)
+{
+	struct sockaddr_nl peer = { .nl_family = AF_NETLINK };
+	struct iovec iov[NI_NL_BATCH_WINDOW];
+	struct msghdr mh;
+	struct nlmsghdr *nlh;
+	unsigned int i;
+	size_t size = 0;
+
+	/* keep the window sequence numbers contiguous and non-zero */
+	if (ni_nl_batch_seq > UINT_MAX - NI_NL_BATCH_WINDOW)
+		ni_nl_batch_seq = 0;
+
+	for (i = 0; i < count && i < NI_NL_BATCH_WINDOW; ++i) {
+		nlh = nlmsg_hdr(entries[i].msg);
+		if (i && size + NLMSG_ALIGN(nlh->nlmsg_len) > NI_NL_BATCH_WINDOW_SIZE)
+			break;
+
+		nlh->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+		nlh->nlmsg_pid = nl_socket_get_local_port(nl_sock);
+		nlh->nlmsg_seq = ++ni_nl_batch_seq;
+		entries[i].seq = nlh->nlmsg_seq;
+		entries[i].error = -NLE_AGAIN;
+
+		iov[i].iov_base = nlh;
+		iov[i].iov_len = NLMSG_ALIGN(nlh->nlmsg_len);
+		size += iov[i].iov_len;
+	}
+
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_name = &peer;
+	mh.msg_namelen = sizeof(peer);
+	mh.msg_iov = iov;
+	mh.msg_iovlen = i;
+
+	if (sendmsg(nl_socket_get_fd(nl_sock), &mh, 0) < 0) {
+		*err = -nl_syserr2nlerr(errno);
+		ni_error("%s: unable to send: %s", __func__, nl_geterror(*err));
+		return 0;
+	}
+	*err = 0;
+	return i;
+}
+
+static int
+__ni_nl_batch_recv(struct nl_sock *nl_sock, ni_nl_batch_entry_t *entries,
+			unsigned int count)
+{
+	unsigned int pending = count, index;
+	struct sockaddr_nl peer;
+	struct nlmsghdr *nlh;
+	struct nlmsgerr *e;
+	unsigned char *buf;
+	int len;
+
+	while (pending) {
+		buf = NULL;
+		if ((len = nl_recv(nl_sock, &peer, &buf, NULL)) <= 0) {
+			if (len == -NLE_INTR)
+				continue;
+			ni_debug_socket("%s: recv failed: %s", __func__,
+					nl_geterror(len ? len : -NLE_FAILURE));
+			free(buf);
+			return len ? len : -NLE_FAILURE;
+		}
+
+		for (nlh = (struct nlmsghdr *)buf; nlmsg_ok(nlh, len);
+		     nlh = nlmsg_next(nlh, &len)) {
+			if (nlh->nlmsg_type != NLMSG_ERROR)
+				continue;
+
+			index = nlh->nlmsg_seq - entries[0].seq;
+			if (index >= count || entries[index].seq != nlh->nlmsg_seq)
+				continue;
+			if (entries[index].error != -NLE_AGAIN)
+				continue;
+
+			if (!nlmsg_valid_hdr(nlh, sizeof(*e))) {
+				entries[index].error = -NLE_MSG_TRUNC;
+			} else {
+				e = nlmsg_data(nlh);
+				entries[index].error = e->error ?
+					-nl_syserr2nlerr(-e->error) : 0;
+			}
+			if (entries[index].error)
+				ni_debug_ifconfig("netlink reports error %d", entries[index].error);
+			pending--;
+		}
+		free(buf);
+	}
+	return 0;
+}
+
+/*
+ * Send all requests of a batch and collect the per-request results.
+ * Returns 0 or the error which prevented to complete the transaction;
+ * the entries not processed by the kernel then carry this error.
+ */
+int
+ni_nl_batch_talk(ni_nl_batch_t *batch)
+{
+	struct nl_sock *nl_sock;
+	unsigned int done, sent, i;
+	int err = 0;
+
+	if (!batch)
+		return -NLE_INVAL;
+
+	if (!__ni_global_netlink || !(nl_sock = __ni_global_netlink->nl_sock)) {
+		ni_error("%s: no netlink socket", __func__);
+		err = -NLE_BAD_SOCK;
+		goto failed;
+	}
+
+	for (done = 0; done < batch->count; done += sent) {
+		sent = __ni_nl_batch_send(nl_sock, batch->data + done,
+					batch->count - done, &err);
+		if (!sent)
+			goto failed;
+
+		if ((err = __ni_nl_batch_recv(nl_sock, batch->data + done, sent)) < 0)
+			goto failed;
+	}
+	return 0;
+
+failed:
+	for (i = 0; i < batch->count; ++i) {
+		if (batch->data[i].seq == 0 || batch->data[i].error == -NLE_AGAIN)
+			batch->data[i].error = err;
+	}
+	return err;
+}
+
 #define ni_t2n(x)	[x] = #x
 static const char *	ni_rtnl_msg_type_names[RTM_MAX] = {
 #ifdef	RTM_NEWLINK
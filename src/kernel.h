@@ -74,10 +74,65 @@ struct ni_nlmsg_list {
 
 extern int	ni_nl_talk(struct nl_msg *, struct ni_nlmsg_list *);
 extern int	ni_nl_dump_store(int af, int type, struct ni_nlmsg_list *list);
+extern int	ni_nl_dump_store_ifindex(int af, int type, unsigned int ifindex,
+					struct ni_nlmsg_list *list);
+extern int	ni_nl_get_link_store(unsigned int ifindex, struct ni_nlmsg_list *list);
 
 extern void	ni_nlmsg_list_init(struct ni_nlmsg_list *);
 extern void	ni_nlmsg_list_destroy(struct ni_nlmsg_list *);
 
+/*
+ * Netlink transaction: a batch of requests pipelined to the kernel,
+ * with the ACK/error of each request reported in its entry.
+ */
+typedef struct ni_nl_batch_entry {
+	struct nl_msg *		msg;
+	void *			user_data;
+	unsigned int		seq;
+	int			error;
+} ni_nl_batch_entry_t;
+
+typedef struct ni_nl_batch {
+	unsigned int		count;
+	ni_nl_batch_entry_t *	data;
+} ni_nl_batch_t;
+
+#define NI_NL_BATCH_INIT	{ .count = 0, .data = NULL }
+
+extern ni_bool_t	ni_nl_batch_append(ni_nl_batch_t *, struct nl_msg *, void *);
+extern int		ni_nl_batch_talk(ni_nl_batch_t *);
+extern void		ni_nl_batch_destroy(ni_nl_batch_t *);
+
+/*
+ * Netlink shim: takes the place of the kernel as peer of the global
+ * rtnetlink request socket and of the rtnetlink event socket, e.g.
+ * to record or replay netlink message streams (testing/rtnl-bench).
+ *
+ * The recv hooks follow nl_recv(): they return the length of a malloc'ed
+ * buffer with one or more messages, -NLE_AGAIN when nothing is pending.
+ * NULL hooks keep talking to the kernel. When the event_fd is not -1,
+ * the event socket is polled via this fd instead of the kernel socket.
+ *
+ * The shim has to be installed before the global state handle and the
+ * event listener are opened. Batched transactions are not shimmed.
+ */
+typedef struct ni_nl_shim	ni_nl_shim_t;
+
+struct ni_nl_shim {
+	int			(*request_send)(ni_nl_shim_t *, struct nl_sock *,
+						struct nl_msg *);
+	int			(*request_recv)(ni_nl_shim_t *, struct nl_sock *,
+						struct sockaddr_nl *, unsigned char **);
+	int			(*event_recv)(ni_nl_shim_t *, struct nl_sock *,
+						struct sockaddr_nl *, unsigned char **);
+	int			event_fd;
+	void *			user_data;
+};
+
+extern int		ni_nl_shim_install(ni_nl_shim_t *);
+extern ni_nl_shim_t *	ni_nl_shim_get(void);
+extern void		ni_nl_shim_setup_event(struct nl_sock *);
+
 extern const char *	ni_rtnl_msg_type_to_name(unsigned int, const char *);
 
 static inline void *
@@ -135,6 +190,9 @@ extern int	__ni_rtnl_parse_newprefix(const char *, struct nlmsghdr *, struct pre
 
 extern int	__ni_netdev_process_newlink(ni_netdev_t *, struct nlmsghdr *, struct ifinfomsg *, ni_netconfig_t *);
 extern int	__ni_netdev_process_newlink_ipv6(ni_netdev_t *, struct nlmsghdr *, struct ifinfomsg *);
+extern int	__ni_netdev_process_newlink_bridge_port(ni_netdev_t *, struct nlmsghdr *, struct ifinfomsg *,
+							ni_netconfig_t *);
+extern ni_bool_t	__ni_discover_bond_netlink_supported(void);
 extern int	__ni_netdev_process_newprefix(ni_netdev_t *, struct nlmsghdr *, struct prefixmsg *);
 extern int	__ni_netdev_process_newaddr_event(ni_netdev_t *dev, struct nlmsghdr *h, struct ifaddrmsg *ifa, const ni_address_t **);
 
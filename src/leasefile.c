@@ -33,7 +33,11 @@
 #include <limits.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/addrconf.h>
@@ -43,8 +47,10 @@
 #include <wicked/route.h>
 #include <wicked/logging.h>
 #include <wicked/xml.h>
+#include <wicked/socket.h>
 
 #include "appconfig.h"
+#include "buffer.h"
 #include "leasefile.h"
 #include "dhcp.h"
 #include "dhcp4/lease.h"
@@ -1254,9 +1260,314 @@ ni_addrconf_lease_from_xml(ni_addrconf_lease_t **leasep, const xml_node_t *root,
  * lease file read and write routines
  */
 static const char *		__ni_addrconf_lease_file_path(char **,
-				const char *, const char *, int, int);
+				const char *, const char *, int, int,
+				ni_config_lease_file_format_t);
 static void			__ni_addrconf_lease_file_remove(
-				const char *, const char *, int, int);
+				const char *, const char *, int, int,
+				ni_config_lease_file_format_t);
+
+/*
+ * Binary lease file format
+ *
+ * The binary format is a TLV encoding of the lease xml document, so the
+ * lease xml mapping above applies to both formats, but a lease is not
+ * formatted and scanned as text:
+ *
+ *   header:	magic "WLSE", uint16 version, uint16 reserved
+ *   record:	uint8 type, uint32 length, data[length]
+ *
+ * A node record starts a new (child) node, its attribute, cdata and
+ * child node records follow until the node end record. Integers are
+ * in network byte order. Records of an unknown type are skipped, files
+ * with a newer version are rejected.
+ */
+#define NI_ADDRCONF_LEASE_BIN_MAGIC	"WLSE"
+#define NI_ADDRCONF_LEASE_BIN_VERSION	1
+
+enum {
+	NI_ADDRCONF_LEASE_BIN_NODE	= 1,
+	NI_ADDRCONF_LEASE_BIN_END	= 2,
+	NI_ADDRCONF_LEASE_BIN_ATTR	= 3,
+	NI_ADDRCONF_LEASE_BIN_CDATA	= 4,
+};
+
+static void
+__ni_addrconf_lease_bin_put_record(ni_buffer_t *bp, unsigned int type,
+				const char *data, size_t len, const char *more, size_t mlen)
+{
+	size_t need = 1 + 4 + len + mlen;
+
+	if (ni_buffer_tailroom(bp) < need)
+		ni_buffer_ensure_tailroom(bp, need + BUFSIZ);
+
+	ni_buffer_putc(bp, type);
+	ni_buffer_put_uint32(bp, len + mlen);
+	ni_buffer_put(bp, data, len);
+	ni_buffer_put(bp, more, mlen);
+}
+
+static void
+__ni_addrconf_lease_bin_put_node(ni_buffer_t *bp, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	const ni_var_t *var;
+	unsigned int i;
+
+	__ni_addrconf_lease_bin_put_record(bp, NI_ADDRCONF_LEASE_BIN_NODE,
+			node->name, ni_string_len(node->name), NULL, 0);
+
+	for (i = 0, var = node->attrs.data; i < node->attrs.count; ++i, ++var) {
+		/* name, optionally followed by a NUL and the value */
+		__ni_addrconf_lease_bin_put_record(bp, NI_ADDRCONF_LEASE_BIN_ATTR,
+				var->name, ni_string_len(var->name) + !!var->value,
+				var->value, ni_string_len(var->value));
+	}
+
+	if (node->cdata) {
+		__ni_addrconf_lease_bin_put_record(bp, NI_ADDRCONF_LEASE_BIN_CDATA,
+				node->cdata, ni_string_len(node->cdata), NULL, 0);
+	}
+
+	for (child = node->children; child; child = child->next)
+		__ni_addrconf_lease_bin_put_node(bp, child);
+
+	__ni_addrconf_lease_bin_put_record(bp, NI_ADDRCONF_LEASE_BIN_END,
+			NULL, 0, NULL, 0);
+}
+
+static int
+ni_addrconf_lease_bin_encode(ni_buffer_t *bp, const xml_node_t *xml)
+{
+	if (!bp || !xml)
+		return -1;
+
+	ni_buffer_ensure_tailroom(bp, BUFSIZ);
+	ni_buffer_put(bp, NI_ADDRCONF_LEASE_BIN_MAGIC, 4);
+	ni_buffer_put_uint16(bp, NI_ADDRCONF_LEASE_BIN_VERSION);
+	ni_buffer_put_uint16(bp, 0);
+	__ni_addrconf_lease_bin_put_node(bp, xml);
+
+	return bp->overflow ? -1 : 0;
+}
+
+static xml_node_t *
+ni_addrconf_lease_bin_decode(ni_buffer_t *bp, const char *filename)
+{
+	xml_node_t *root = NULL, *node = NULL;
+	const unsigned char *magic;
+	uint16_t version, reserved;
+	char *name = NULL, *value;
+	const char *data;
+	uint32_t len;
+	int type;
+
+	magic = ni_buffer_pull_head(bp, 4);
+	if (!magic || memcmp(magic, NI_ADDRCONF_LEASE_BIN_MAGIC, 4) ||
+	    ni_buffer_get_uint16(bp, &version) < 0 ||
+	    ni_buffer_get_uint16(bp, &reserved) < 0) {
+		ni_error("%s: not a binary lease file", filename);
+		return NULL;
+	}
+	if (version > NI_ADDRCONF_LEASE_BIN_VERSION) {
+		ni_error("%s: unsupported binary lease file version %u",
+				filename, version);
+		return NULL;
+	}
+
+	while ((type = ni_buffer_getc(bp)) >= 0) {
+		if (ni_buffer_get_uint32(bp, &len) < 0 ||
+		    !(data = ni_buffer_pull_head(bp, len)))
+			goto truncated;
+
+		switch (type) {
+		case NI_ADDRCONF_LEASE_BIN_NODE:
+			if (root && !node)
+				goto corrupted;
+
+			ni_string_set(&name, data, len);
+			node = xml_node_new(name, node);
+			if (!root)
+				root = node;
+			break;
+
+		case NI_ADDRCONF_LEASE_BIN_END:
+			if (!node)
+				goto corrupted;
+			node = node->parent;
+			break;
+
+		case NI_ADDRCONF_LEASE_BIN_ATTR:
+			if (!node)
+				goto corrupted;
+
+			ni_string_set(&name, data, len);
+			if ((value = memchr(name, '\0', len)))
+				value++;
+			xml_node_add_attr(node, name, value);
+			break;
+
+		case NI_ADDRCONF_LEASE_BIN_CDATA:
+			if (!node)
+				goto corrupted;
+
+			ni_string_set(&name, data, len);
+			xml_node_set_cdata(node, name);
+			break;
+
+		default:
+			break;
+		}
+	}
+	if (!root || node)
+		goto truncated;
+
+	ni_string_free(&name);
+	return root;
+
+truncated:
+	ni_error("%s: truncated binary lease file", filename);
+	goto failure;
+corrupted:
+	ni_error("%s: corrupted binary lease file", filename);
+failure:
+	ni_string_free(&name);
+	xml_node_free(root);
+	return NULL;
+}
+
+/*
+ * Lease files are written to a temporary file, which is synced and
+ * renamed to the lease file name at once, so a reader in any process
+ * sees the most recent lease. Only the sync of the lease directory,
+ * making the rename persistent, is deferred shortly and done once for
+ * all leases written meanwhile, e.g. in a renew wave of many devices.
+ */
+#define NI_ADDRCONF_LEASE_FILE_SYNC_DELAY	200	/* msec */
+
+static ni_string_array_t			ni_addrconf_lease_file_sync_dirs = NI_STRING_ARRAY_INIT;
+static const ni_timer_t *			ni_addrconf_lease_file_timer;
+
+static int
+__ni_addrconf_lease_file_sync_dir(const char *dirname)
+{
+	int fd, ret = 0;
+
+	if ((fd = open(dirname, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -1;
+
+	if (fsync(fd) < 0 && errno != EINVAL) {
+		ni_warn("Unable to sync lease directory %s: %m", dirname);
+		ret = -1;
+	}
+	close(fd);
+	return ret;
+}
+
+static int
+__ni_addrconf_lease_file_sync_file(const char *filename)
+{
+	int fd, ret = 0;
+
+	if ((fd = open(filename, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+
+	if (fdatasync(fd) < 0 && errno != EINVAL) {
+		ni_error("Unable to sync lease file %s: %m", filename);
+		ret = -1;
+	}
+	close(fd);
+	return ret;
+}
+
+static void
+__ni_addrconf_lease_file_timeout(void *user_data, const ni_timer_t *timer)
+{
+	if (ni_addrconf_lease_file_timer == timer) {
+		ni_addrconf_lease_file_timer = NULL;
+		ni_addrconf_lease_file_flush();
+	}
+}
+
+static void
+__ni_addrconf_lease_file_sync_dir_later(const char *dirname)
+{
+	if (ni_string_array_index(&ni_addrconf_lease_file_sync_dirs, dirname) == -1)
+		ni_string_array_append(&ni_addrconf_lease_file_sync_dirs, dirname);
+
+	if (!ni_addrconf_lease_file_timer) {
+		ni_addrconf_lease_file_timer = ni_timer_register(
+				NI_ADDRCONF_LEASE_FILE_SYNC_DELAY,
+				__ni_addrconf_lease_file_timeout, NULL);
+	}
+}
+
+/*
+ * Sync the lease directories with pending renames
+ */
+int
+ni_addrconf_lease_file_flush(void)
+{
+	unsigned int i;
+	int ret = 0;
+
+	if (ni_addrconf_lease_file_timer) {
+		ni_timer_cancel(ni_addrconf_lease_file_timer);
+		ni_addrconf_lease_file_timer = NULL;
+	}
+
+	for (i = 0; i < ni_addrconf_lease_file_sync_dirs.count; ++i) {
+		if (__ni_addrconf_lease_file_sync_dir(ni_addrconf_lease_file_sync_dirs.data[i]) < 0)
+			ret = -1;
+	}
+	ni_string_array_destroy(&ni_addrconf_lease_file_sync_dirs);
+	return ret;
+}
+
+/*
+ * Temporary lease files carry the pid of their writer; remove the
+ * ones left behind by writers which did not live to rename them.
+ */
+static void
+__ni_addrconf_lease_file_cleanup_dir(const char *dirname)
+{
+	struct dirent *dp;
+	char *path = NULL;
+	const char *sfx;
+	char *end;
+	long pid;
+	DIR *dir;
+
+	if (!dirname || !(dir = opendir(dirname)))
+		return;
+
+	while ((dp = readdir(dir)) != NULL) {
+		if (!ni_string_startswith(dp->d_name, "lease-"))
+			continue;
+		if (!(sfx = strstr(dp->d_name, ".xml.")) &&
+		    !(sfx = strstr(dp->d_name, ".bin.")))
+			continue;
+
+		pid = strtol(sfx + 5, &end, 10);
+		if (pid <= 0 || end == sfx + 5 || *end != '.' || strlen(end + 1) != 6)
+			continue;
+		if (kill((pid_t)pid, 0) == 0 || errno != ESRCH)
+			continue;
+
+		ni_string_printf(&path, "%s/%s", dirname, dp->d_name);
+		ni_debug_dhcp("Removing stale temporary lease file '%s'", path);
+		if (unlink(path) < 0 && errno != ENOENT)
+			ni_warn("Unable to remove temporary lease file '%s': %m", path);
+	}
+	ni_string_free(&path);
+	closedir(dir);
+}
+
+void
+ni_addrconf_lease_file_cleanup(void)
+{
+	__ni_addrconf_lease_file_cleanup_dir(ni_config_storedir());
+	__ni_addrconf_lease_file_cleanup_dir(ni_config_statedir());
+}
 
 /*
  * Write a lease to a file
@@ -1264,10 +1575,14 @@ static void			__ni_addrconf_lease_file_remove(
 int
 ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 {
-	char tempname[PATH_MAX] = {'\0'};
+	ni_config_lease_file_format_t format = ni_config_lease_file_format();
+	ni_config_lease_file_format_t other;
+	char *tempname = NULL;
 	ni_bool_t fallback = FALSE;
+	const char *dirname = ni_config_storedir();
 	char *filename = NULL;
 	xml_node_t *xml = NULL;
+	ni_buffer_t buf;
 	FILE *fp = NULL;
 	int ret = -1;
 	int fd;
@@ -1277,8 +1592,8 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 		return 0;
 	}
 
-	if (!__ni_addrconf_lease_file_path(&filename, ni_config_storedir(),
-					ifname, lease->type, lease->family)) {
+	if (!__ni_addrconf_lease_file_path(&filename, dirname, ifname,
+					lease->type, lease->family, format)) {
 		ni_error("Cannot construct lease file name: %m");
 		return -1;
 	}
@@ -1297,21 +1612,22 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 		goto failed;
 	}
 
-	snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
+	ni_string_printf(&tempname, "%s.%d.XXXXXX", filename, (int)getpid());
 	if ((fd = mkstemp(tempname)) < 0) {
 		if (errno == EROFS && __ni_addrconf_lease_file_path(&filename,
 						ni_config_statedir(), ifname,
-						lease->type, lease->family)) {
+						lease->type, lease->family, format)) {
 			ni_debug_dhcp("Read-only filesystem, try fallback to %s",
 					filename);
-			snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
+			dirname = ni_config_statedir();
+			ni_string_printf(&tempname, "%s.%d.XXXXXX", filename, (int)getpid());
 			fd = mkstemp(tempname);
 			fallback = TRUE;
 		}
 		if (fd < 0) {
 			ni_error("Cannot create temporary lease file '%s': %m",
 					tempname);
-			tempname[0] = '\0';
+			ni_string_free(&tempname);
 			ret = -1;
 			goto failed;
 		}
@@ -1324,20 +1640,47 @@ ni_addrconf_lease_file_write(const char *ifname, ni_addrconf_lease_t *lease)
 	}
 
 	ni_debug_dhcp("Writing lease to temporary file for '%s'", filename);
-	xml_node_print(xml, fp);
-	fclose(fp);
+	if (format == NI_CONFIG_LEASE_FILE_BINARY) {
+		ni_buffer_init_dynamic(&buf, BUFSIZ);
+		if (ni_addrconf_lease_bin_encode(&buf, xml) == 0)
+			fwrite(ni_buffer_head(&buf), ni_buffer_count(&buf), 1, fp);
+		ni_buffer_destroy(&buf);
+	} else {
+		xml_node_print(xml, fp);
+	}
 	xml_node_free(xml);
+	xml = NULL;
+
+	ret = ferror(fp);
+	if (fclose(fp) != 0 || ret) {
+		fp = NULL;
+		ni_error("Unable to write temporary lease file '%s': %m", tempname);
+		ret = -1;
+		goto failed;
+	}
+	fp = NULL;
 
-	if ((ret = rename(tempname, filename)) != 0) {
+	if (__ni_addrconf_lease_file_sync_file(tempname) != 0 ||
+	    rename(tempname, filename) != 0) {
 		ni_error("Unable to rename temporary lease file '%s' to '%s': %m",
 				tempname, filename);
 		goto failed;
-	} else if (!fallback) {
-		__ni_addrconf_lease_file_remove(ni_config_statedir(),
-				ifname, lease->type, lease->family);
 	}
-
+	ni_string_free(&tempname);
 	ni_debug_dhcp("Lease written to file '%s'", filename);
+
+	other = format == NI_CONFIG_LEASE_FILE_XML ?
+		NI_CONFIG_LEASE_FILE_BINARY : NI_CONFIG_LEASE_FILE_XML;
+	__ni_addrconf_lease_file_remove(dirname, ifname,
+			lease->type, lease->family, other);
+	if (!fallback) {
+		__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname,
+				lease->type, lease->family, NI_CONFIG_LEASE_FILE_BINARY);
+		__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname,
+				lease->type, lease->family, NI_CONFIG_LEASE_FILE_XML);
+	}
+
+	__ni_addrconf_lease_file_sync_dir_later(dirname);
 	ni_string_free(&filename);
 	return 0;
 
@@ -1346,49 +1689,102 @@ failed:
 		fclose(fp);
 	if (xml)
 		xml_node_free(xml);
-	if (tempname[0])
+	if (tempname) {
 		unlink(tempname);
+		ni_string_free(&tempname);
+	}
 	ni_string_free(&filename);
 	return -1;
 }
 
+static xml_node_t *
+__ni_addrconf_lease_file_read_bin(FILE *fp, const char *filename)
+{
+	xml_node_t *xml = NULL;
+	struct stat stb;
+	ni_buffer_t buf;
+	size_t len;
+
+	if (fstat(fileno(fp), &stb) < 0)
+		stb.st_size = BUFSIZ;
+
+	ni_buffer_init_dynamic(&buf, stb.st_size + 1);
+	do {
+		if (!ni_buffer_tailroom(&buf))
+			ni_buffer_ensure_tailroom(&buf, BUFSIZ);
+
+		len = fread(ni_buffer_tail(&buf), 1, ni_buffer_tailroom(&buf), fp);
+		ni_buffer_push_tail(&buf, len);
+	} while (len > 0);
+
+	if (ferror(fp))
+		ni_error("Unable to read %s: %m", filename);
+	else
+		xml = ni_addrconf_lease_bin_decode(&buf, filename);
+
+	ni_buffer_destroy(&buf);
+	return xml;
+}
+
+static FILE *
+__ni_addrconf_lease_file_open(char **filename, const char *dirname, const char *ifname,
+		int type, int family, ni_config_lease_file_format_t *format)
+{
+	ni_config_lease_file_format_t formats[2];
+	unsigned int i;
+	FILE *fp;
+
+	formats[0] = ni_config_lease_file_format();
+	formats[1] = formats[0] == NI_CONFIG_LEASE_FILE_XML ?
+		NI_CONFIG_LEASE_FILE_BINARY : NI_CONFIG_LEASE_FILE_XML;
+
+	for (i = 0; i < 2; ++i) {
+		if (!__ni_addrconf_lease_file_path(filename, dirname,
+					ifname, type, family, formats[i]))
+			return NULL;
+
+		if ((fp = fopen(*filename, "re")) != NULL) {
+			*format = formats[i];
+			return fp;
+		}
+		if (errno != ENOENT) {
+			ni_error("Unable to open %s for reading: %m", *filename);
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
 /*
  * Read a lease from a file
  */
 ni_addrconf_lease_t *
 ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 {
+	ni_config_lease_file_format_t format;
 	ni_addrconf_lease_t *lease = NULL;
 	xml_node_t *xml = NULL, *lnode;
 	char *filename = NULL;
 	FILE *fp;
 
-	if (!__ni_addrconf_lease_file_path(&filename,
-				ni_config_statedir(),
-				ifname, type, family)) {
-		ni_error("Unable to construct lease file name: %m");
-		return NULL;
+	fp = __ni_addrconf_lease_file_open(&filename, ni_config_statedir(),
+						ifname, type, family, &format);
+	if (!fp && (!filename || errno == ENOENT)) {
+		fp = __ni_addrconf_lease_file_open(&filename, ni_config_storedir(),
+						ifname, type, family, &format);
 	}
-
-	if ((fp = fopen(filename, "re")) == NULL) {
-		if (errno == ENOENT) {
-			if (__ni_addrconf_lease_file_path(&filename,
-						ni_config_storedir(),
-						ifname, type, family))
-				fp = fopen(filename, "re");
-		}
-		if (fp == NULL) {
-			if (errno != ENOENT) {
-				ni_error("Unable to open %s for reading: %m",
-						filename);
-			}
-			ni_string_free(&filename);
-			return NULL;
-		}
+	if (fp == NULL) {
+		if (!filename)
+			ni_error("Unable to construct lease file name: %m");
+		ni_string_free(&filename);
+		return NULL;
 	}
 
 	ni_debug_dhcp("Reading lease from %s", filename);
-	xml = xml_node_scan(fp, filename);
+	if (format == NI_CONFIG_LEASE_FILE_BINARY)
+		xml = __ni_addrconf_lease_file_read_bin(fp, filename);
+	else
+		xml = xml_node_scan(fp, filename);
 	fclose(fp);
 
 	if (xml == NULL) {
@@ -1410,7 +1806,7 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
 	}
 
 	if (ni_addrconf_lease_from_xml(&lease, xml, ifname) < 0) {
-		ni_error("Unable to parse xml lease file '%s'", filename);
+		ni_error("Unable to parse lease file '%s'", filename);
 		ni_string_free(&filename);
 		xml_node_free(xml);
 		return NULL;
@@ -1426,11 +1822,12 @@ ni_addrconf_lease_file_read(const char *ifname, int type, int family)
  */
 static void
 __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
-				int type, int family)
+				int type, int family,
+				ni_config_lease_file_format_t format)
 {
 	char *filename = NULL;
 
-	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family))
+	if (!__ni_addrconf_lease_file_path(&filename, dir, ifname, type, family, format))
 		return;
 
 	if (ni_file_exists(filename) && unlink(filename) == 0)
@@ -1441,40 +1838,49 @@ __ni_addrconf_lease_file_remove(const char *dir, const char *ifname,
 void
 ni_addrconf_lease_file_remove(const char *ifname, int type, int family)
 {
-	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family);
-	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family);
+	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_BINARY);
+	__ni_addrconf_lease_file_remove(ni_config_statedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_XML);
+	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_BINARY);
+	__ni_addrconf_lease_file_remove(ni_config_storedir(), ifname, type, family,
+					NI_CONFIG_LEASE_FILE_XML);
 }
 
 static const char *
 __ni_addrconf_lease_file_path(char **path, const char *dir,
-		const char *ifname, int type, int family)
+		const char *ifname, int type, int family,
+		ni_config_lease_file_format_t format)
 {
 	const char *t = ni_addrconf_type_to_name(type);
 	const char *f = ni_addrfamily_type_to_name(family);
+	const char *s = format == NI_CONFIG_LEASE_FILE_XML ? "xml" : "bin";
 
 	if (!path || ni_string_empty(dir) || ni_string_empty(ifname) || !t || !f)
 		return NULL;
-	return ni_string_printf(path, "%s/lease-%s-%s-%s.xml", dir, ifname, t, f);
+	return ni_string_printf(path, "%s/lease-%s-%s-%s.%s", dir, ifname, t, f, s);
 }
 
 ni_bool_t
 ni_addrconf_lease_file_exists(const char *ifname, int type, int family)
 {
+	const char *dirs[] = { ni_config_statedir(), ni_config_storedir() };
+	const ni_config_lease_file_format_t formats[] = {
+		NI_CONFIG_LEASE_FILE_XML, NI_CONFIG_LEASE_FILE_BINARY
+	};
 	char *filename = NULL;
-
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_statedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
-		}
-	}
-	if (__ni_addrconf_lease_file_path(&filename, ni_config_storedir(), ifname, type, family)) {
-		if (ni_file_exists(filename)) {
-			ni_string_free(&filename);
-			return TRUE;
+	unsigned int i, f;
+
+	for (i = 0; i < 2; ++i) {
+		for (f = 0; f < 2; ++f) {
+			if (__ni_addrconf_lease_file_path(&filename, dirs[i], ifname, type, family, formats[f]) &&
+			    ni_file_exists(filename)) {
+				ni_string_free(&filename);
+				return TRUE;
+			}
 		}
 	}
 	ni_string_free(&filename);
 	return FALSE;
 }
-
@@ -42,10 +42,47 @@ typedef struct ni_netconfig_filter {
 	unsigned int		discover;
 } ni_netconfig_filter_t;
 
+/*
+ * Hash indexes of the interface list, so lookups by ifindex,
+ * ifname, hwaddr and of child devices by their lower/master
+ * device ifindex do not need to walk the (long) device list.
+ *
+ * Each device in the list has one index node, which is linked
+ * into a bucket chain of every index its key is set for.
+ */
+enum {
+	NI_NETDEV_INDEX_IFINDEX,
+	NI_NETDEV_INDEX_IFNAME,
+	NI_NETDEV_INDEX_HWADDR,
+	NI_NETDEV_INDEX_LOWER,
+	NI_NETDEV_INDEX_MASTER,
+
+	NI_NETDEV_INDEX_MAX
+};
+
+#define NI_NETDEV_INDEX_SIZE_MIN	64U
+
+typedef struct ni_netdev_index_node	ni_netdev_index_node_t;
+struct ni_netdev_index_node {
+	ni_netdev_t *			dev;
+	struct {
+		ni_netdev_index_node_t *next;
+		unsigned int		hash;
+		ni_bool_t		linked;
+	}				chain[NI_NETDEV_INDEX_MAX];
+};
+
+typedef struct ni_netdev_index {
+	unsigned int			size;
+	unsigned int			count;
+	ni_netdev_index_node_t **	buckets[NI_NETDEV_INDEX_MAX];
+} ni_netdev_index_t;
+
 struct ni_netconfig {
 	ni_netconfig_filter_t	filter;
 
 	ni_netdev_t *		interfaces;
+	ni_netdev_index_t	index;
 	ni_modem_t *		modems;
 
 	struct {
@@ -431,15 +468,23 @@ ni_xs_scope_t *
 ni_server_dbus_xml_schema(void)
 {
 	const char *filename = ni_global.config->dbus_xml_schema_file;
+	const char *statedir = ni_global.config->statedir.path;
+	char *cachefile = NULL;
 	ni_xs_scope_t *scope;
+	int rv;
 
 	if (filename == NULL) {
 		ni_error("Cannot create dbus xml schema: no schema path configured");
 		return NULL;
 	}
 
+	if (!ni_string_empty(statedir))
+		ni_string_printf(&cachefile, "%s/%s", statedir, NI_XS_SCHEMA_CACHE_FILE);
+
 	scope = ni_dbus_xml_init();
-	if (ni_xs_process_schema_file(filename, scope) < 0) {
+	rv = ni_xs_process_schema_file_cached(filename, scope, cachefile);
+	ni_string_free(&cachefile);
+	if (rv < 0) {
 		ni_error("Cannot create dbus xml schema: error in schema definition");
 		ni_xs_scope_free(scope);
 		return NULL;
@@ -516,9 +561,12 @@ ni_netconfig_init(ni_netconfig_t *nc)
 	memset(nc, 0, sizeof(*nc));
 }
 
+static void		ni_netdev_index_destroy(ni_netdev_index_t *);
+
 void
 ni_netconfig_destroy(ni_netconfig_t *nc)
 {
+	ni_netdev_index_destroy(&nc->index);
 	__ni_netdev_list_destroy(&nc->interfaces);
 	ni_rule_array_destroy(&nc->route.rules);
 	memset(nc, 0, sizeof(*nc));
@@ -575,20 +623,282 @@ ni_netconfig_device_list_head(ni_netconfig_t *nc)
 	return &nc->interfaces;
 }
 
+/*
+ * Device hash index maintenance
+ */
+static ni_bool_t
+ni_netdev_index_key(const ni_netdev_t *dev, unsigned int type, unsigned int *hash)
+{
+	switch (type) {
+	case NI_NETDEV_INDEX_IFINDEX:
+		*hash = ni_hash_uint(dev->link.ifindex);
+		return TRUE;
+
+	case NI_NETDEV_INDEX_IFNAME:
+		if (ni_string_empty(dev->name))
+			return FALSE;
+		*hash = ni_hash_string(dev->name);
+		return TRUE;
+
+	case NI_NETDEV_INDEX_HWADDR:
+		if (!dev->link.hwaddr.len)
+			return FALSE;
+		*hash = ni_hash_data(dev->link.hwaddr.data, dev->link.hwaddr.len);
+		return TRUE;
+
+	case NI_NETDEV_INDEX_LOWER:
+		if (!dev->link.lowerdev.index)
+			return FALSE;
+		*hash = ni_hash_uint(dev->link.lowerdev.index);
+		return TRUE;
+
+	case NI_NETDEV_INDEX_MASTER:
+		if (!dev->link.masterdev.index)
+			return FALSE;
+		*hash = ni_hash_uint(dev->link.masterdev.index);
+		return TRUE;
+
+	default:
+		return FALSE;
+	}
+}
+
+static inline ni_netdev_index_node_t **
+ni_netdev_index_bucket(const ni_netdev_index_t *index, unsigned int type, unsigned int hash)
+{
+	return &index->buckets[type][hash & (index->size - 1)];
+}
+
+static inline ni_netdev_index_node_t *
+ni_netdev_index_first(const ni_netdev_index_t *index, unsigned int type, unsigned int hash)
+{
+	if (!index->count)
+		return NULL;
+	return *ni_netdev_index_bucket(index, type, hash);
+}
+
+static void
+ni_netdev_index_link(ni_netdev_index_t *index, ni_netdev_index_node_t *node, unsigned int type)
+{
+	ni_netdev_index_node_t **bucket;
+	unsigned int hash;
+
+	if (!ni_netdev_index_key(node->dev, type, &hash))
+		return;
+
+	bucket = ni_netdev_index_bucket(index, type, hash);
+	node->chain[type].hash = hash;
+	node->chain[type].next = *bucket;
+	node->chain[type].linked = TRUE;
+	*bucket = node;
+}
+
+static void
+ni_netdev_index_unlink(ni_netdev_index_t *index, ni_netdev_index_node_t *node, unsigned int type)
+{
+	ni_netdev_index_node_t **pos, *cur;
+
+	if (!node->chain[type].linked)
+		return;
+
+	pos = ni_netdev_index_bucket(index, type, node->chain[type].hash);
+	for ( ; (cur = *pos) != NULL; pos = &cur->chain[type].next) {
+		if (cur == node) {
+			*pos = cur->chain[type].next;
+			break;
+		}
+	}
+	node->chain[type].next = NULL;
+	node->chain[type].linked = FALSE;
+}
+
+static void
+ni_netdev_index_resize(ni_netdev_index_t *index, unsigned int size)
+{
+	ni_netdev_index_node_t **old[NI_NETDEV_INDEX_MAX], *node, *next;
+	unsigned int type, osize, i;
+
+	osize = index->size;
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type) {
+		old[type] = index->buckets[type];
+		index->buckets[type] = xcalloc(size, sizeof(ni_netdev_index_node_t *));
+	}
+	index->size = size;
+
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type) {
+		for (i = 0; i < osize; ++i) {
+			for (node = old[type][i]; node; node = next) {
+				ni_netdev_index_node_t **bucket;
+
+				next = node->chain[type].next;
+				bucket = ni_netdev_index_bucket(index, type, node->chain[type].hash);
+				node->chain[type].next = *bucket;
+				*bucket = node;
+			}
+		}
+		free(old[type]);
+	}
+}
+
+static ni_netdev_index_node_t *
+ni_netdev_index_find_node(const ni_netdev_index_t *index, const ni_netdev_t *dev, ni_bool_t scan)
+{
+	ni_netdev_index_node_t *node;
+	unsigned int i;
+
+	node = ni_netdev_index_first(index, NI_NETDEV_INDEX_IFINDEX, ni_hash_uint(dev->link.ifindex));
+	for ( ; node; node = node->chain[NI_NETDEV_INDEX_IFINDEX].next) {
+		if (node->dev == dev)
+			return node;
+	}
+
+	/* the ifindex of a device in the list is not expected to change */
+	for (i = 0; scan && i < index->size && index->count; ++i) {
+		node = index->buckets[NI_NETDEV_INDEX_IFINDEX][i];
+		for ( ; node; node = node->chain[NI_NETDEV_INDEX_IFINDEX].next) {
+			if (node->dev == dev)
+				return node;
+		}
+	}
+	return NULL;
+}
+
+static void
+ni_netdev_index_add(ni_netdev_index_t *index, ni_netdev_t *dev)
+{
+	ni_netdev_index_node_t *node;
+	unsigned int type;
+
+	if (ni_netdev_index_find_node(index, dev, FALSE))
+		return;
+
+	if (!index->size)
+		ni_netdev_index_resize(index, NI_NETDEV_INDEX_SIZE_MIN);
+	else if (index->count >= index->size)
+		ni_netdev_index_resize(index, index->size << 1);
+
+	node = xcalloc(1, sizeof(*node));
+	node->dev = dev;
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+		ni_netdev_index_link(index, node, type);
+	index->count++;
+}
+
+static void
+ni_netdev_index_del(ni_netdev_index_t *index, ni_netdev_t *dev)
+{
+	ni_netdev_index_node_t *node;
+	unsigned int type;
+
+	if (!(node = ni_netdev_index_find_node(index, dev, TRUE)))
+		return;
+
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+		ni_netdev_index_unlink(index, node, type);
+	index->count--;
+	free(node);
+}
+
+static void
+ni_netdev_index_update(ni_netdev_index_t *index, ni_netdev_t *dev)
+{
+	ni_netdev_index_node_t *node;
+	unsigned int type, hash;
+
+	if (!(node = ni_netdev_index_find_node(index, dev, FALSE)))
+		return;
+
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type) {
+		if (ni_netdev_index_key(dev, type, &hash)) {
+			if (node->chain[type].linked && node->chain[type].hash == hash)
+				continue;
+		} else if (!node->chain[type].linked)
+			continue;
+
+		ni_netdev_index_unlink(index, node, type);
+		ni_netdev_index_link(index, node, type);
+	}
+}
+
+static void
+ni_netdev_index_destroy(ni_netdev_index_t *index)
+{
+	ni_netdev_index_node_t *node, *next;
+	unsigned int type, i;
+
+	for (i = 0; i < index->size; ++i) {
+		for (node = index->buckets[NI_NETDEV_INDEX_IFINDEX][i]; node; node = next) {
+			next = node->chain[NI_NETDEV_INDEX_IFINDEX].next;
+			free(node);
+		}
+	}
+	for (type = 0; type < NI_NETDEV_INDEX_MAX; ++type)
+		free(index->buckets[type]);
+	memset(index, 0, sizeof(*index));
+}
+
+/*
+ * Add a device linked into the device list by the caller
+ * (e.g. while a full refresh) to the hash indexes.
+ */
+void
+ni_netconfig_device_index_add(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	if (nc && dev)
+		ni_netdev_index_add(&nc->index, dev);
+}
+
+/*
+ * Update the hash indexes of a device in the list after its
+ * name, hwaddr or lower/master device reference has changed.
+ * Devices not in the list are ignored.
+ */
+void
+ni_netconfig_device_index_update(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	if (nc && dev)
+		ni_netdev_index_update(&nc->index, dev);
+}
+
+/*
+ * Drop a device from the hash indexes while it is unlinked
+ * from the device list by the caller.
+ */
+void
+ni_netconfig_device_index_del(ni_netconfig_t *nc, ni_netdev_t *dev)
+{
+	if (nc && dev)
+		ni_netdev_index_del(&nc->index, dev);
+}
+
 void
 ni_netconfig_device_append(ni_netconfig_t *nc, ni_netdev_t *dev)
 {
 	__ni_netdev_list_append(&nc->interfaces, dev);
+	ni_netdev_index_add(&nc->index, dev);
 }
 
 static inline void
 ni_netconfig_device_unbind_slave_index(ni_netconfig_t *nc, unsigned int master)
 {
+	const unsigned int type = NI_NETDEV_INDEX_MASTER;
+	ni_netdev_index_node_t **pos, *node;
 	ni_netdev_t *dev;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->link.masterdev.index == master)
+	if (!nc->index.count)
+		return;
+
+	pos = ni_netdev_index_bucket(&nc->index, type, ni_hash_uint(master));
+	while ((node = *pos) != NULL) {
+		dev = node->dev;
+		if (dev->link.masterdev.index == master) {
+			*pos = node->chain[type].next;
+			node->chain[type].next = NULL;
+			node->chain[type].linked = FALSE;
 			ni_netdev_ref_destroy(&dev->link.masterdev);
+		} else {
+			pos = &node->chain[type].next;
+		}
 	}
 }
 
@@ -600,6 +910,7 @@ ni_netconfig_device_remove(ni_netconfig_t *nc, ni_netdev_t *dev)
 	for (pos = &nc->interfaces; (cur = *pos) != NULL; pos = &cur->next) {
 		if (cur == dev) {
 			*pos = cur->next;
+			ni_netdev_index_del(&nc->index, cur);
 			ni_netconfig_device_unbind_slave_index(nc, cur->link.ifindex);
 			ni_netdev_put(cur);
 			return;
@@ -814,11 +1125,16 @@ ni_netconfig_rule_find(ni_netconfig_t *nc, const ni_rule_t *rule)
 ni_netdev_t *
 ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 {
-	ni_netdev_t *dev;
+	const unsigned int type = NI_NETDEV_INDEX_IFNAME;
+	ni_netdev_index_node_t *node;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->name && ni_string_eq(dev->name, name))
-			return dev;
+	if (ni_string_empty(name))
+		return NULL;
+
+	node = ni_netdev_index_first(&nc->index, type, ni_hash_string(name));
+	for ( ; node; node = node->chain[type].next) {
+		if (ni_string_eq(node->dev->name, name))
+			return node->dev;
 	}
 
 	return NULL;
@@ -830,11 +1146,13 @@ ni_netdev_by_name(ni_netconfig_t *nc, const char *name)
 ni_netdev_t *
 ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 {
-	ni_netdev_t *dev;
+	const unsigned int type = NI_NETDEV_INDEX_IFINDEX;
+	ni_netdev_index_node_t *node;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (dev->link.ifindex == ifindex)
-			return dev;
+	node = ni_netdev_index_first(&nc->index, type, ni_hash_uint(ifindex));
+	for ( ; node; node = node->chain[type].next) {
+		if (node->dev->link.ifindex == ifindex)
+			return node->dev;
 	}
 
 	return NULL;
@@ -846,14 +1164,16 @@ ni_netdev_by_index(ni_netconfig_t *nc, unsigned int ifindex)
 ni_netdev_t *
 ni_netdev_by_hwaddr(ni_netconfig_t *nc, const ni_hwaddr_t *lla)
 {
-	ni_netdev_t *dev;
+	const unsigned int type = NI_NETDEV_INDEX_HWADDR;
+	ni_netdev_index_node_t *node;
 
 	if (!lla || !lla->len)
 		return NULL;
 
-	for (dev = nc->interfaces; dev; dev = dev->next) {
-		if (ni_link_address_equal(&dev->link.hwaddr, lla))
-			return dev;
+	node = ni_netdev_index_first(&nc->index, type, ni_hash_data(lla->data, lla->len));
+	for ( ; node; node = node->chain[type].next) {
+		if (ni_link_address_equal(&node->dev->link.hwaddr, lla))
+			return node->dev;
 	}
 
 	return NULL;
@@ -865,16 +1185,24 @@ ni_netdev_by_hwaddr(ni_netconfig_t *nc, const ni_hwaddr_t *lla)
 ni_netdev_t *
 ni_netdev_by_vlan_name_and_tag(ni_netconfig_t *nc, const char *parent_name, uint16_t tag)
 {
-	ni_netdev_t *dev;
+	const unsigned int type = NI_NETDEV_INDEX_LOWER;
+	ni_netdev_index_node_t *node;
+	ni_netdev_t *parent, *dev;
 
 	if (!parent_name || !tag)
 		return NULL;
-	for (dev = nc->interfaces; dev; dev = dev->next) {
+
+	if (!(parent = ni_netdev_by_name(nc, parent_name)) || !parent->link.ifindex)
+		return NULL;
+
+	node = ni_netdev_index_first(&nc->index, type, ni_hash_uint(parent->link.ifindex));
+	for ( ; node; node = node->chain[type].next) {
+		dev = node->dev;
 		if (dev->link.type == NI_IFTYPE_VLAN
 		 && dev->vlan
 		 && dev->vlan->tag == tag
-		 && dev->link.lowerdev.name
-		 && !strcmp(dev->link.lowerdev.name, parent_name))
+		 && dev->link.lowerdev.index == parent->link.ifindex
+		 && ni_string_eq(dev->link.lowerdev.name, parent_name))
 			return dev;
 	}
 
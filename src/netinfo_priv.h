@@ -47,6 +47,9 @@ extern void		__ni_netlink_close(ni_netlink_t *);
 extern void		ni_netconfig_device_append(ni_netconfig_t *, ni_netdev_t *);
 extern void		ni_netconfig_device_remove(ni_netconfig_t *, ni_netdev_t *);
 extern ni_netdev_t **	ni_netconfig_device_list_head(ni_netconfig_t *);
+extern void		ni_netconfig_device_index_add(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_index_update(ni_netconfig_t *, ni_netdev_t *);
+extern void		ni_netconfig_device_index_del(ni_netconfig_t *, ni_netdev_t *);
 extern void		ni_netconfig_modem_append(ni_netconfig_t *, ni_modem_t *);
 extern int		ni_netconfig_route_add(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
 extern int		ni_netconfig_route_del(ni_netconfig_t *, ni_route_t *, ni_netdev_t *);
@@ -80,6 +83,7 @@ extern void		__ni_routes_clear(ni_netconfig_t *);
 extern ni_bool_t	__ni_address_list_remove(ni_address_t **, ni_address_t *);
 
 extern int		__ni_system_refresh_all(ni_netconfig_t *nc, ni_netdev_t **del_list);
+extern void		__ni_refresh_unbind_master(ni_netconfig_t *, ni_netdev_t *);
 extern int		__ni_system_refresh_interfaces(ni_netconfig_t *nc);
 extern int		__ni_system_refresh_interface(ni_netconfig_t *, ni_netdev_t *);
 extern int		__ni_system_refresh_interface_addrs(ni_netconfig_t *, ni_netdev_t *);
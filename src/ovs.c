@@ -30,6 +30,7 @@
 #include <wicked/util.h>
 #include <wicked/netinfo.h>
 #include "ovs.h"
+#include "ovsdb.h"
 #include "buffer.h"
 #include "process.h"
 #include "util_priv.h"
@@ -663,6 +664,140 @@ failure:
 	return rv;
 }
 
+/*
+ * Bridge operations using the ovsdb-server connection when available
+ * or the ovs-vsctl utility otherwise.
+ */
+int
+ni_ovs_bridge_exists(const char *brname)
+{
+	ni_ovsdb_client_t *client;
+
+	if ((client = ni_ovsdb_client()))
+		return ni_ovsdb_bridge_exists(client, brname);
+	return ni_ovs_vsctl_bridge_exists(brname);
+}
+
+int
+ni_ovs_bridge_to_vlan(const char *brname, uint16_t *vlan)
+{
+	ni_ovsdb_client_t *client;
+
+	if ((client = ni_ovsdb_client()))
+		return ni_ovsdb_bridge_to_vlan(client, brname, vlan);
+	return ni_ovs_vsctl_bridge_to_vlan(brname, vlan);
+}
+
+int
+ni_ovs_bridge_to_parent(const char *brname, char **parent)
+{
+	ni_ovsdb_client_t *client;
+
+	if ((client = ni_ovsdb_client()))
+		return ni_ovsdb_bridge_to_parent(client, brname, parent);
+	return ni_ovs_vsctl_bridge_to_parent(brname, parent);
+}
+
+int
+ni_ovs_bridge_get_ports(const char *brname, ni_ovs_bridge_port_array_t *ports)
+{
+	ni_ovsdb_client_t *client;
+
+	if ((client = ni_ovsdb_client()))
+		return ni_ovsdb_bridge_ports(client, brname, ports);
+	return ni_ovs_vsctl_bridge_ports(brname, ports);
+}
+
+int
+ni_ovs_bridge_port_to_bridge(const char *pname, char **brname)
+{
+	ni_ovsdb_client_t *client;
+
+	if ((client = ni_ovsdb_client()))
+		return ni_ovsdb_bridge_port_to_bridge(client, pname, brname);
+	return ni_ovs_vsctl_bridge_port_to_bridge(pname, brname);
+}
+
+int
+ni_ovs_bridge_add(const ni_netdev_t *cfg, ni_bool_t may_exist)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_txn_t *txn;
+	int rv = -1;
+
+	if (!cfg || ni_string_empty(cfg->name) || !cfg->ovsbr)
+		return rv;
+
+	if (!(client = ni_ovsdb_client()))
+		return ni_ovs_vsctl_bridge_add(cfg, may_exist);
+
+	if ((txn = ni_ovsdb_txn_new(client))) {
+		if (ni_ovsdb_txn_bridge_add(txn, cfg->name,
+					cfg->ovsbr->config.vlan.parent.name,
+					cfg->ovsbr->config.vlan.tag, may_exist))
+			rv = ni_ovsdb_txn_commit(txn);
+		ni_ovsdb_txn_free(txn);
+	}
+	return rv;
+}
+
+int
+ni_ovs_bridge_del(const char *brname)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_txn_t *txn;
+	int rv = -1;
+
+	if (!(client = ni_ovsdb_client()))
+		return ni_ovs_vsctl_bridge_del(brname);
+
+	if ((txn = ni_ovsdb_txn_new(client))) {
+		if (ni_ovsdb_txn_bridge_del(txn, brname))
+			rv = ni_ovsdb_txn_commit(txn);
+		ni_ovsdb_txn_free(txn);
+	}
+	return rv;
+}
+
+int
+ni_ovs_bridge_port_add(const char *pname, const ni_ovs_bridge_port_config_t *pconf, ni_bool_t may_exist)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_txn_t *txn;
+	int rv = -1;
+
+	if (ni_string_empty(pname) || !pconf || ni_string_empty(pconf->bridge.name))
+		return rv;
+
+	if (!(client = ni_ovsdb_client()))
+		return ni_ovs_vsctl_bridge_port_add(pname, pconf, may_exist);
+
+	if ((txn = ni_ovsdb_txn_new(client))) {
+		if (ni_ovsdb_txn_port_add(txn, pconf->bridge.name, pname, may_exist))
+			rv = ni_ovsdb_txn_commit(txn);
+		ni_ovsdb_txn_free(txn);
+	}
+	return rv;
+}
+
+int
+ni_ovs_bridge_port_del(const char *brname, const char *pname)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_txn_t *txn;
+	int rv = -1;
+
+	if (!(client = ni_ovsdb_client()))
+		return ni_ovs_vsctl_bridge_port_del(brname, pname);
+
+	if ((txn = ni_ovsdb_txn_new(client))) {
+		if (ni_ovsdb_txn_port_del(txn, brname, pname))
+			rv = ni_ovsdb_txn_commit(txn);
+		ni_ovsdb_txn_free(txn);
+	}
+	return rv;
+}
+
 int
 ni_ovs_bridge_discover(ni_netdev_t *dev, ni_netconfig_t *nc)
 {
@@ -673,9 +808,9 @@ ni_ovs_bridge_discover(ni_netdev_t *dev, ni_netconfig_t *nc)
 		return -1;
 
 	ovsbr = ni_ovs_bridge_new();
-	if (ni_ovs_vsctl_bridge_to_parent(dev->name, &ovsbr->config.vlan.parent.name) ||
-	    ni_ovs_vsctl_bridge_to_vlan(dev->name, &ovsbr->config.vlan.tag) ||
-	    ni_ovs_vsctl_bridge_ports(dev->name, &ovsbr->ports)) {
+	if (ni_ovs_bridge_to_parent(dev->name, &ovsbr->config.vlan.parent.name) ||
+	    ni_ovs_bridge_to_vlan(dev->name, &ovsbr->config.vlan.tag) ||
+	    ni_ovs_bridge_get_ports(dev->name, &ovsbr->ports)) {
 		ni_ovs_bridge_free(ovsbr);
 		return -1;
 	}
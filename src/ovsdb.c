@@ -0,0 +1,1453 @@
+/*
+ *	OVSDB JSON-RPC client and cache of the bridge configuration
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ *	The client talks the OVSDB management protocol (RFC 7047) to the
+ *	ovsdb-server unix socket instead of forking an ovs-vsctl per query.
+ *	It monitors the bridges and ports of the Open_vSwitch database and
+ *	answers the queries from this cache. Pending update notifications
+ *	are read before each query: ovsdb-server sends them on commit, that
+ *	is before ovs-vswitchd creates or deletes the netdevs, so they are
+ *	already pending when we process the corresponding netlink events.
+ *
+ *	The bridge and port model follows ovs-vsctl: a "fake bridge" is a
+ *	port of its parent bridge with fake_bridge set and the vlan tag of
+ *	the fake bridge; the parent ports with this tag are its ports.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+
+#include "ovsdb.h"
+#include "json.h"
+#include "buffer.h"
+#include "socket_priv.h"
+#include "util_priv.h"
+
+#define NI_OVSDB_RUNDIR			"/run/openvswitch"
+#define NI_OVSDB_SOCKET			"db.sock"
+#define NI_OVSDB_DATABASE		"Open_vSwitch"
+#define NI_OVSDB_RECV_CHUNK		65536
+#define NI_OVSDB_CALL_TIMEOUT		10000	/* msec */
+#define NI_OVSDB_RECONFIG_TIMEOUT	5000	/* msec */
+
+typedef struct ni_ovsdb_row	ni_ovsdb_row_t;
+typedef struct ni_ovsdb_table	ni_ovsdb_table_t;
+typedef struct ni_ovsdb_port_ref ni_ovsdb_port_ref_t;
+
+/*
+ * Entry of the port uuid to bridge index
+ */
+struct ni_ovsdb_port_ref {
+	const char *		uuid;
+	ni_ovsdb_row_t *	bridge;
+};
+
+struct ni_ovsdb_row {
+	ni_ovsdb_row_t *	next;
+	ni_ovsdb_row_t **	pprev;
+
+	char *			uuid;
+	char *			name;
+
+	/* Bridge */
+	ni_string_array_t	ports;		/* port row uuids */
+	ni_ovsdb_port_ref_t *	port_refs;	/* by_port index entries */
+
+	/* Port */
+	int			tag;		/* -1 when unset */
+	ni_bool_t		fake_bridge;
+};
+
+struct ni_ovsdb_table {
+	const char *		name;
+	void			(*parse)(ni_ovsdb_row_t *, ni_json_t *);
+
+	ni_ovsdb_row_t *	rows;
+	ni_hash_table_t		by_uuid;
+	ni_hash_table_t		by_name;
+	ni_hash_table_t		by_port;	/* Bridge: port uuid */
+};
+
+struct ni_ovsdb_client {
+	ni_socket_t *		sock;
+
+	ni_buffer_t		rbuf;
+	struct {
+		size_t		pos;
+		unsigned int	depth;
+		ni_bool_t	quoted;
+		ni_bool_t	escaped;
+	} scan;
+
+	int64_t			seqno;
+	struct {
+		int64_t		id;
+		ni_json_t *	reply;
+	} call;
+
+	int64_t			cur_cfg;
+	int64_t			next_cfg;
+	ni_ovsdb_table_t	bridges;
+	ni_ovsdb_table_t	ports;
+};
+
+struct ni_ovsdb_txn {
+	ni_ovsdb_client_t *	client;
+	ni_json_t *		params;
+	ni_stringbuf_t		comment;
+	unsigned int		named;
+	unsigned int		changes;
+};
+
+/*
+ * The real bridge a bridge name refers to and the port
+ * representing it in the real bridge, when it is a fake one.
+ */
+typedef struct ni_ovsdb_bridge_ref {
+	ni_ovsdb_row_t *	bridge;
+	ni_ovsdb_row_t *	fake;
+} ni_ovsdb_bridge_ref_t;
+
+static ni_ovsdb_client_t *	ni_ovsdb_client_handle;
+
+static const char *		ni_ovsdb_monitor_request =
+	"[ \"" NI_OVSDB_DATABASE "\", null, {"
+		" \"Open_vSwitch\": { \"columns\": [ \"cur_cfg\", \"next_cfg\" ] },"
+		" \"Bridge\": { \"columns\": [ \"name\", \"ports\" ] },"
+		" \"Port\": { \"columns\": [ \"name\", \"tag\", \"fake_bridge\" ] }"
+	" } ]";
+
+static int			ni_ovsdb_client_input(ni_ovsdb_client_t *);
+
+/*
+ * OVSDB value encoding
+ */
+static ni_json_t *
+ni_ovsdb_json_atom(const char *type, const char *value)
+{
+	ni_json_t *atom;
+
+	atom = ni_json_new_array();
+	ni_json_array_append(atom, ni_json_new_string(type));
+	ni_json_array_append(atom, ni_json_new_string(value));
+	return atom;
+}
+
+static ni_json_t *
+ni_ovsdb_json_set(ni_json_t *member)
+{
+	ni_json_t *set, *members;
+
+	set = ni_json_new_array();
+	members = ni_json_new_array();
+	ni_json_array_append(set, ni_json_new_string("set"));
+	ni_json_array_append(set, members);
+	if (member)
+		ni_json_array_append(members, member);
+	return set;
+}
+
+static ni_bool_t
+ni_ovsdb_value_is_set(ni_json_t *value)
+{
+	return ni_string_eq(ni_json_string_value(ni_json_array_get(value, 0)), "set");
+}
+
+static const char *
+ni_ovsdb_value_uuid(ni_json_t *atom)
+{
+	if (ni_json_array_entries(atom) != 2 ||
+	    !ni_string_eq(ni_json_string_value(ni_json_array_get(atom, 0)), "uuid"))
+		return NULL;
+	return ni_json_string_value(ni_json_array_get(atom, 1));
+}
+
+static void
+ni_ovsdb_value_uuid_set(ni_string_array_t *uuids, ni_json_t *value)
+{
+	ni_json_t *members;
+	const char *uuid;
+	unsigned int i, count;
+
+	ni_string_array_destroy(uuids);
+	if (ni_ovsdb_value_is_set(value)) {
+		members = ni_json_array_get(value, 1);
+		count = ni_json_array_entries(members);
+		for (i = 0; i < count; ++i) {
+			if ((uuid = ni_ovsdb_value_uuid(ni_json_array_get(members, i))))
+				ni_string_array_append(uuids, uuid);
+		}
+	} else
+	if ((uuid = ni_ovsdb_value_uuid(value))) {
+		ni_string_array_append(uuids, uuid);
+	}
+}
+
+static ni_bool_t
+ni_ovsdb_value_int(ni_json_t *value, int64_t *num)
+{
+	/* optional column: integer or an empty set */
+	if (ni_ovsdb_value_is_set(value))
+		value = ni_json_array_get(ni_json_array_get(value, 1), 0);
+	return ni_json_int64_get(value, num);
+}
+
+/*
+ * Cached database tables
+ */
+static ni_bool_t
+ni_ovsdb_row_match_uuid(const void *data, const void *uuid)
+{
+	const ni_ovsdb_row_t *row = data;
+
+	return ni_string_eq(row->uuid, uuid);
+}
+
+static ni_bool_t
+ni_ovsdb_row_match_name(const void *data, const void *name)
+{
+	const ni_ovsdb_row_t *row = data;
+
+	return ni_string_eq(row->name, name);
+}
+
+static ni_bool_t
+ni_ovsdb_port_ref_match(const void *data, const void *uuid)
+{
+	const ni_ovsdb_port_ref_t *ref = data;
+
+	return ni_string_eq(ref->uuid, uuid);
+}
+
+static void
+ni_ovsdb_row_free(ni_ovsdb_row_t *row)
+{
+	if (row) {
+		ni_string_free(&row->uuid);
+		ni_string_free(&row->name);
+		ni_string_array_destroy(&row->ports);
+		free(row->port_refs);
+		free(row);
+	}
+}
+
+static void
+ni_ovsdb_bridge_parse(ni_ovsdb_row_t *row, ni_json_t *data)
+{
+	ni_json_t *value;
+
+	if ((value = ni_json_object_get_value(data, "name")))
+		ni_json_string_get(value, &row->name);
+	if ((value = ni_json_object_get_value(data, "ports")))
+		ni_ovsdb_value_uuid_set(&row->ports, value);
+}
+
+static void
+ni_ovsdb_port_parse(ni_ovsdb_row_t *row, ni_json_t *data)
+{
+	ni_json_t *value;
+	int64_t tag;
+
+	if ((value = ni_json_object_get_value(data, "name")))
+		ni_json_string_get(value, &row->name);
+	if ((value = ni_json_object_get_value(data, "tag"))) {
+		if (ni_ovsdb_value_int(value, &tag) && tag >= 0 && tag <= 0x0fff)
+			row->tag = tag;
+		else
+			row->tag = -1;
+	}
+	if ((value = ni_json_object_get_value(data, "fake_bridge")))
+		ni_json_bool_get(value, &row->fake_bridge);
+}
+
+static void
+ni_ovsdb_table_init(ni_ovsdb_table_t *table, const char *name,
+			void (*parse)(ni_ovsdb_row_t *, ni_json_t *))
+{
+	memset(table, 0, sizeof(*table));
+	table->name = name;
+	table->parse = parse;
+}
+
+static void
+ni_ovsdb_table_destroy(ni_ovsdb_table_t *table)
+{
+	ni_ovsdb_row_t *row;
+
+	while ((row = table->rows)) {
+		table->rows = row->next;
+		ni_ovsdb_row_free(row);
+	}
+	ni_hash_table_destroy(&table->by_uuid);
+	ni_hash_table_destroy(&table->by_name);
+	ni_hash_table_destroy(&table->by_port);
+}
+
+static void
+ni_ovsdb_table_index_ports(ni_ovsdb_table_t *table, ni_ovsdb_row_t *row)
+{
+	ni_ovsdb_port_ref_t *ref;
+	unsigned int i;
+
+	if (!row->ports.count)
+		return;
+
+	row->port_refs = xcalloc(row->ports.count, sizeof(*row->port_refs));
+	for (i = 0; i < row->ports.count; ++i) {
+		ref = &row->port_refs[i];
+		ref->uuid = row->ports.data[i];
+		ref->bridge = row;
+		ni_hash_table_insert(&table->by_port, ni_hash_string(ref->uuid), ref);
+	}
+}
+
+static void
+ni_ovsdb_table_unindex_ports(ni_ovsdb_table_t *table, ni_ovsdb_row_t *row)
+{
+	ni_ovsdb_port_ref_t *ref;
+	unsigned int i;
+
+	if (!row->port_refs)
+		return;
+
+	for (i = 0; i < row->ports.count; ++i) {
+		ref = &row->port_refs[i];
+		ni_hash_table_remove(&table->by_port, ni_hash_string(ref->uuid), ref);
+	}
+	free(row->port_refs);
+	row->port_refs = NULL;
+}
+
+static ni_ovsdb_row_t *
+ni_ovsdb_table_find_uuid(const ni_ovsdb_table_t *table, const char *uuid)
+{
+	if (ni_string_empty(uuid))
+		return NULL;
+	return ni_hash_table_find(&table->by_uuid, ni_hash_string(uuid),
+					ni_ovsdb_row_match_uuid, uuid);
+}
+
+static ni_ovsdb_row_t *
+ni_ovsdb_table_find_name(const ni_ovsdb_table_t *table, const char *name)
+{
+	if (ni_string_empty(name))
+		return NULL;
+	return ni_hash_table_find(&table->by_name, ni_hash_string(name),
+					ni_ovsdb_row_match_name, name);
+}
+
+static void
+ni_ovsdb_table_delete(ni_ovsdb_table_t *table, ni_ovsdb_row_t *row)
+{
+	if ((*row->pprev = row->next))
+		row->next->pprev = row->pprev;
+
+	ni_hash_table_remove(&table->by_uuid, ni_hash_string(row->uuid), row);
+	if (row->name)
+		ni_hash_table_remove(&table->by_name, ni_hash_string(row->name), row);
+	ni_ovsdb_table_unindex_ports(table, row);
+	ni_ovsdb_row_free(row);
+}
+
+static void
+ni_ovsdb_table_update(ni_ovsdb_table_t *table, const char *uuid, ni_json_t *data)
+{
+	ni_ovsdb_row_t *row;
+
+	row = ni_ovsdb_table_find_uuid(table, uuid);
+	if (!ni_json_is_object(data)) {
+		if (row)
+			ni_ovsdb_table_delete(table, row);
+		return;
+	}
+
+	if (!row) {
+		row = xcalloc(1, sizeof(*row));
+		row->tag = -1;
+		ni_string_dup(&row->uuid, uuid);
+
+		if ((row->next = table->rows))
+			row->next->pprev = &row->next;
+		row->pprev = &table->rows;
+		table->rows = row;
+		ni_hash_table_insert(&table->by_uuid, ni_hash_string(uuid), row);
+	} else {
+		if (row->name)
+			ni_hash_table_remove(&table->by_name, ni_hash_string(row->name), row);
+		ni_ovsdb_table_unindex_ports(table, row);
+	}
+
+	table->parse(row, data);
+	if (row->name)
+		ni_hash_table_insert(&table->by_name, ni_hash_string(row->name), row);
+	ni_ovsdb_table_index_ports(table, row);
+}
+
+static void
+ni_ovsdb_cache_update(ni_ovsdb_client_t *client, ni_json_t *updates)
+{
+	unsigned int i, j, tables, rows;
+	ni_ovsdb_table_t *table;
+	ni_json_pair_t *tpair, *rpair;
+	ni_json_t *trows, *data;
+	const char *tname;
+
+	tables = ni_json_object_entries(updates);
+	for (i = 0; i < tables; ++i) {
+		tpair = ni_json_object_get_pair_at(updates, i);
+		tname = ni_json_pair_get_name(tpair);
+		trows = ni_json_pair_get_value(tpair);
+
+		if (ni_string_eq(tname, client->bridges.name))
+			table = &client->bridges;
+		else
+		if (ni_string_eq(tname, client->ports.name))
+			table = &client->ports;
+		else
+			table = NULL;
+
+		rows = ni_json_object_entries(trows);
+		for (j = 0; j < rows; ++j) {
+			rpair = ni_json_object_get_pair_at(trows, j);
+			data = ni_json_object_get_value(ni_json_pair_get_value(rpair), "new");
+
+			if (table) {
+				ni_ovsdb_table_update(table, ni_json_pair_get_name(rpair), data);
+			} else
+			if (ni_string_eq(tname, NI_OVSDB_DATABASE)) {
+				ni_ovsdb_value_int(ni_json_object_get_value(data, "cur_cfg"),
+							&client->cur_cfg);
+				ni_ovsdb_value_int(ni_json_object_get_value(data, "next_cfg"),
+							&client->next_cfg);
+			}
+		}
+	}
+}
+
+/*
+ * Bridge and port lookups following the ovs-vsctl model
+ */
+static ni_ovsdb_row_t *
+ni_ovsdb_port_parent(const ni_ovsdb_client_t *client, const ni_ovsdb_row_t *port)
+{
+	const ni_ovsdb_port_ref_t *ref;
+
+	ref = ni_hash_table_find(&client->bridges.by_port, ni_hash_string(port->uuid),
+					ni_ovsdb_port_ref_match, port->uuid);
+	return ref ? ref->bridge : NULL;
+}
+
+static ni_ovsdb_row_t *
+ni_ovsdb_fake_bridge_by_vlan(const ni_ovsdb_client_t *client,
+				const ni_ovsdb_row_t *bridge, int vlan)
+{
+	ni_ovsdb_row_t *port;
+	unsigned int i;
+
+	for (i = 0; i < bridge->ports.count; ++i) {
+		port = ni_ovsdb_table_find_uuid(&client->ports, bridge->ports.data[i]);
+		if (port && port->fake_bridge && port->tag == vlan)
+			return port;
+	}
+	return NULL;
+}
+
+static ni_bool_t
+ni_ovsdb_bridge_lookup(const ni_ovsdb_client_t *client, const char *brname,
+			ni_ovsdb_bridge_ref_t *ref)
+{
+	memset(ref, 0, sizeof(*ref));
+
+	if ((ref->bridge = ni_ovsdb_table_find_name(&client->bridges, brname)))
+		return TRUE;
+
+	ref->fake = ni_ovsdb_table_find_name(&client->ports, brname);
+	if (ref->fake && ref->fake->fake_bridge &&
+	    (ref->bridge = ni_ovsdb_port_parent(client, ref->fake)))
+		return TRUE;
+
+	memset(ref, 0, sizeof(*ref));
+	return FALSE;
+}
+
+static ni_bool_t
+ni_ovsdb_bridge_has_port(const ni_ovsdb_client_t *client,
+			const ni_ovsdb_bridge_ref_t *ref, const ni_ovsdb_row_t *port)
+{
+	if (port->fake_bridge)
+		return FALSE;
+
+	if (ref->fake)
+		return port->tag >= 0 && port->tag == ref->fake->tag;
+
+	return port->tag < 0 || !ni_ovsdb_fake_bridge_by_vlan(client, ref->bridge, port->tag);
+}
+
+static const char *
+ni_ovsdb_bridge_ref_name(const ni_ovsdb_bridge_ref_t *ref)
+{
+	return ref->fake ? ref->fake->name : ref->bridge->name;
+}
+
+/*
+ * Find the bridge of a (non-local) port
+ */
+static ni_bool_t
+ni_ovsdb_port_lookup(const ni_ovsdb_client_t *client, const ni_ovsdb_row_t *port,
+			ni_ovsdb_bridge_ref_t *ref)
+{
+	memset(ref, 0, sizeof(*ref));
+
+	if (port->fake_bridge || !(ref->bridge = ni_ovsdb_port_parent(client, port)))
+		return FALSE;
+
+	if (port->tag >= 0)
+		ref->fake = ni_ovsdb_fake_bridge_by_vlan(client, ref->bridge, port->tag);
+
+	return !ni_string_eq(port->name, ni_ovsdb_bridge_ref_name(ref));
+}
+
+/*
+ * JSON-RPC connection
+ */
+static const char *
+ni_ovsdb_socket_path(void)
+{
+	static char *path = NULL;
+	const char *rundir;
+
+	/* ovs utilities use the rundir from environment as well */
+	rundir = getenv("OVS_RUNDIR");
+	if (ni_string_empty(rundir))
+		rundir = NI_OVSDB_RUNDIR;
+
+	return ni_string_printf(&path, "%s/%s", rundir, NI_OVSDB_SOCKET);
+}
+
+static long
+ni_ovsdb_timeout_left(const struct timeval *start, unsigned long timeout)
+{
+	struct timeval now, delta;
+	unsigned long elapsed;
+
+	ni_timer_get_time(&now);
+	timersub(&now, start, &delta);
+	elapsed = delta.tv_sec * 1000 + delta.tv_usec / 1000;
+	return elapsed < timeout ? (long)(timeout - elapsed) : 0;
+}
+
+static void
+ni_ovsdb_client_disconnect(ni_ovsdb_client_t *client)
+{
+	ni_socket_t *sock;
+
+	if ((sock = client->sock)) {
+		client->sock = NULL;
+		sock->user_data = NULL;
+		ni_socket_close(sock);
+	}
+}
+
+void
+ni_ovsdb_client_free(ni_ovsdb_client_t *client)
+{
+	if (client) {
+		ni_ovsdb_client_disconnect(client);
+		ni_buffer_destroy(&client->rbuf);
+		ni_json_free(client->call.reply);
+		ni_ovsdb_table_destroy(&client->bridges);
+		ni_ovsdb_table_destroy(&client->ports);
+		free(client);
+	}
+}
+
+static int
+ni_ovsdb_client_send(ni_ovsdb_client_t *client, ni_json_t *msg)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	struct pollfd pfd;
+	size_t off = 0;
+	ssize_t ret;
+
+	if (!client->sock || !ni_json_format_string(&buf, msg, NULL)) {
+		ni_stringbuf_destroy(&buf);
+		return -1;
+	}
+
+	while (off < buf.len) {
+		ret = send(client->sock->__fd, buf.string + off, buf.len - off,
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (ret >= 0) {
+			off += ret;
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			pfd.fd = client->sock->__fd;
+			pfd.events = POLLOUT;
+			if (poll(&pfd, 1, NI_OVSDB_CALL_TIMEOUT) > 0)
+				continue;
+		}
+		ni_error("ovsdb: unable to send request to %s: %m",
+				ni_ovsdb_socket_path());
+		ni_stringbuf_destroy(&buf);
+		ni_ovsdb_client_disconnect(client);
+		return -1;
+	}
+	ni_stringbuf_destroy(&buf);
+	return 0;
+}
+
+static void
+ni_ovsdb_client_echo(ni_ovsdb_client_t *client, ni_json_t *request)
+{
+	ni_json_t *reply;
+
+	reply = ni_json_new_object();
+	ni_json_object_set(reply, "id", ni_json_object_ref_value(request, "id"));
+	ni_json_object_set(reply, "result", ni_json_object_ref_value(request, "params"));
+	ni_json_object_set(reply, "error", ni_json_new_null());
+	ni_ovsdb_client_send(client, reply);
+	ni_json_free(reply);
+}
+
+static void
+ni_ovsdb_client_process(ni_ovsdb_client_t *client, ni_json_t *msg)
+{
+	const char *method;
+	int64_t id;
+
+	if ((method = ni_json_string_value(ni_json_object_get_value(msg, "method")))) {
+		if (ni_string_eq(method, "update"))
+			ni_ovsdb_cache_update(client, ni_json_array_get(
+					ni_json_object_get_value(msg, "params"), 1));
+		else
+		if (ni_string_eq(method, "echo"))
+			ni_ovsdb_client_echo(client, msg);
+		else
+			ni_debug_ifconfig("ovsdb: ignoring unexpected %s request", method);
+		return;
+	}
+
+	if (ni_json_int64_get(ni_json_object_get_value(msg, "id"), &id) &&
+	    id == client->call.id && !client->call.reply) {
+		client->call.reply = ni_json_ref(msg);
+		return;
+	}
+	ni_debug_ifconfig("ovsdb: ignoring unexpected reply");
+}
+
+/*
+ * Find the end of the next complete message in the receive buffer;
+ * the scan state is kept across the partial reads of large messages.
+ */
+static ni_bool_t
+ni_ovsdb_client_frame(ni_ovsdb_client_t *client, size_t *len)
+{
+	const unsigned char *data = ni_buffer_head(&client->rbuf);
+	size_t count = ni_buffer_count(&client->rbuf);
+	unsigned char cc;
+
+	for ( ; client->scan.pos < count; client->scan.pos++) {
+		cc = data[client->scan.pos];
+
+		if (client->scan.quoted) {
+			if (client->scan.escaped)
+				client->scan.escaped = FALSE;
+			else if (cc == '\\')
+				client->scan.escaped = TRUE;
+			else if (cc == '"')
+				client->scan.quoted = FALSE;
+			continue;
+		}
+
+		switch (cc) {
+		case '"':
+			client->scan.quoted = TRUE;
+			break;
+		case '{':
+		case '[':
+			client->scan.depth++;
+			break;
+		case '}':
+		case ']':
+			if (client->scan.depth && --client->scan.depth == 0) {
+				*len = ++client->scan.pos;
+				client->scan.pos = 0;
+				return TRUE;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return FALSE;
+}
+
+static int
+ni_ovsdb_client_dispatch(ni_ovsdb_client_t *client)
+{
+	ni_buffer_t *rbuf = &client->rbuf;
+	ni_buffer_t msgbuf;
+	ni_json_t *msg;
+	size_t len;
+
+	while (client->sock && ni_ovsdb_client_frame(client, &len)) {
+		ni_buffer_init_reader(&msgbuf, ni_buffer_head(rbuf), len);
+		msg = ni_json_parse_buffer(&msgbuf);
+		ni_buffer_pull_head(rbuf, len);
+
+		if (!ni_json_is_object(msg)) {
+			ni_error("ovsdb: unable to parse json-rpc message");
+			ni_json_free(msg);
+			return -1;
+		}
+		ni_ovsdb_client_process(client, msg);
+		ni_json_free(msg);
+	}
+
+	/* move the incomplete rest to the buffer begin */
+	if (rbuf->head) {
+		len = ni_buffer_count(rbuf);
+		if (len)
+			memmove(rbuf->base, rbuf->base + rbuf->head, len);
+		rbuf->head = 0;
+		rbuf->tail = len;
+	}
+	return client->sock ? 0 : -1;
+}
+
+/*
+ * Read and process all pending input
+ */
+static int
+ni_ovsdb_client_input(ni_ovsdb_client_t *client)
+{
+	ni_buffer_t *rbuf = &client->rbuf;
+	ssize_t len;
+
+	while (client->sock) {
+		ni_buffer_ensure_tailroom(rbuf, NI_OVSDB_RECV_CHUNK);
+		len = recv(client->sock->__fd, ni_buffer_tail(rbuf),
+				ni_buffer_tailroom(rbuf), MSG_DONTWAIT);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+
+			ni_error("ovsdb: unable to receive from %s: %m",
+					ni_ovsdb_socket_path());
+			break;
+		}
+		if (len == 0) {
+			ni_debug_ifconfig("ovsdb: connection closed by server");
+			break;
+		}
+
+		ni_buffer_push_tail(rbuf, len);
+		if (ni_ovsdb_client_dispatch(client) < 0)
+			break;
+	}
+
+	ni_ovsdb_client_disconnect(client);
+	return -1;
+}
+
+static int
+ni_ovsdb_client_poll(ni_ovsdb_client_t *client, long timeout)
+{
+	struct pollfd pfd;
+	int ret;
+
+	if (!client->sock)
+		return -1;
+
+	pfd.fd = client->sock->__fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	if ((ret = poll(&pfd, 1, timeout)) < 0) {
+		if (errno == EINTR)
+			return 0;
+
+		ni_error("ovsdb: poll error: %m");
+		ni_ovsdb_client_disconnect(client);
+		return -1;
+	}
+	return ret ? ni_ovsdb_client_input(client) : 0;
+}
+
+/*
+ * Send a request and wait for its reply while processing notifications
+ */
+static ni_json_t *
+ni_ovsdb_client_call(ni_ovsdb_client_t *client, const char *method, ni_json_t *params)
+{
+	struct timeval start;
+	ni_json_t *request, *reply;
+	long timeout;
+
+	request = ni_json_new_object();
+	ni_json_object_set(request, "method", ni_json_new_string(method));
+	ni_json_object_set(request, "params", params);
+	ni_json_object_set(request, "id", ni_json_new_int64(++client->seqno));
+
+	client->call.id = client->seqno;
+	if (ni_ovsdb_client_send(client, request) < 0) {
+		ni_json_free(request);
+		return NULL;
+	}
+	ni_json_free(request);
+
+	ni_timer_get_time(&start);
+	while (!client->call.reply) {
+		if (!(timeout = ni_ovsdb_timeout_left(&start, NI_OVSDB_CALL_TIMEOUT))) {
+			ni_error("ovsdb: timeout waiting for %s reply", method);
+			ni_ovsdb_client_disconnect(client);
+			return NULL;
+		}
+		if (ni_ovsdb_client_poll(client, timeout) < 0)
+			return NULL;
+	}
+
+	reply = client->call.reply;
+	client->call.reply = NULL;
+	client->call.id = 0;
+	return reply;
+}
+
+static ni_json_t *
+ni_ovsdb_reply_result(ni_json_t *reply, const char *method)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *error;
+
+	error = ni_json_object_get_value(reply, "error");
+	if (error && !ni_json_is_null(error)) {
+		ni_error("ovsdb: %s request failed: %s", method,
+				ni_json_format_string(&buf, error, NULL));
+		ni_stringbuf_destroy(&buf);
+		return NULL;
+	}
+	return ni_json_object_get_value(reply, "result");
+}
+
+static int
+ni_ovsdb_client_monitor(ni_ovsdb_client_t *client)
+{
+	ni_json_t *reply, *result;
+	int ret = -1;
+
+	if (!(reply = ni_ovsdb_client_call(client, "monitor",
+			ni_json_parse_string(ni_ovsdb_monitor_request))))
+		return ret;
+
+	if ((result = ni_ovsdb_reply_result(reply, "monitor"))) {
+		ni_ovsdb_cache_update(client, result);
+		ret = 0;
+	}
+	ni_json_free(reply);
+	return ret;
+}
+
+static void
+ni_ovsdb_client_receive(ni_socket_t *sock)
+{
+	ni_ovsdb_client_t *client = sock->user_data;
+
+	if (client)
+		ni_ovsdb_client_input(client);
+}
+
+static void
+ni_ovsdb_client_hangup(ni_socket_t *sock)
+{
+	ni_ovsdb_client_t *client = sock->user_data;
+
+	if (client)
+		ni_ovsdb_client_disconnect(client);
+}
+
+/*
+ * Monitor the database via a connected socket; takes over the fd
+ */
+ni_ovsdb_client_t *
+ni_ovsdb_client_open(int fd)
+{
+	ni_ovsdb_client_t *client;
+	ni_socket_t *sock;
+
+	if (!(sock = ni_socket_wrap(fd, SOCK_STREAM))) {
+		close(fd);
+		return NULL;
+	}
+
+	client = xcalloc(1, sizeof(*client));
+	ni_buffer_init_dynamic(&client->rbuf, NI_OVSDB_RECV_CHUNK);
+	ni_ovsdb_table_init(&client->bridges, "Bridge", ni_ovsdb_bridge_parse);
+	ni_ovsdb_table_init(&client->ports, "Port", ni_ovsdb_port_parse);
+
+	client->sock = sock;
+	sock->user_data = client;
+	sock->receive = ni_ovsdb_client_receive;
+	sock->handle_error = ni_ovsdb_client_hangup;
+	sock->handle_hangup = ni_ovsdb_client_hangup;
+
+	if (ni_ovsdb_client_monitor(client) < 0) {
+		ni_ovsdb_client_free(client);
+		return NULL;
+	}
+
+	ni_socket_activate(client->sock);
+	return client;
+}
+
+/*
+ * Apply the pending update notifications
+ */
+int
+ni_ovsdb_client_refresh(ni_ovsdb_client_t *client)
+{
+	if (!client || !client->sock)
+		return -1;
+
+	return ni_ovsdb_client_input(client);
+}
+
+static ni_ovsdb_client_t *
+ni_ovsdb_client_connect(void)
+{
+	struct sockaddr_un sun;
+	ni_ovsdb_client_t *client;
+	const char *path;
+	int fd;
+
+	path = ni_ovsdb_socket_path();
+	if (ni_string_len(path) >= sizeof(sun.sun_path)) {
+		ni_error("ovsdb: socket path %s is too long", path);
+		return NULL;
+	}
+
+	memset(&sun, 0, sizeof(sun));
+	sun.sun_family = AF_LOCAL;
+	strcpy(sun.sun_path, path);
+
+	if ((fd = socket(AF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) < 0) {
+		ni_error("ovsdb: unable to create socket: %m");
+		return NULL;
+	}
+	if (connect(fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+		ni_debug_ifconfig("ovsdb: unable to connect to %s: %m", path);
+		close(fd);
+		return NULL;
+	}
+
+	if (!(client = ni_ovsdb_client_open(fd)))
+		return NULL;
+
+	ni_debug_ifconfig("ovsdb: connected to %s, monitoring %u bridges and %u ports",
+			path, client->bridges.by_uuid.count, client->ports.by_uuid.count);
+	return client;
+}
+
+ni_ovsdb_client_t *
+ni_ovsdb_client(void)
+{
+	ni_ovsdb_client_t *client = ni_ovsdb_client_handle;
+
+	/* apply pending updates, reconnect when it got closed */
+	if (client && client->sock)
+		ni_ovsdb_client_refresh(client);
+
+	if (client && !client->sock) {
+		ni_ovsdb_client_close();
+		client = NULL;
+	}
+
+	if (!client)
+		client = ni_ovsdb_client_handle = ni_ovsdb_client_connect();
+
+	return client;
+}
+
+void
+ni_ovsdb_client_close(void)
+{
+	ni_ovsdb_client_t *client = ni_ovsdb_client_handle;
+
+	ni_ovsdb_client_handle = NULL;
+	ni_ovsdb_client_free(client);
+}
+
+/*
+ * Queries
+ */
+int
+ni_ovsdb_bridge_exists(ni_ovsdb_client_t *client, const char *brname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (!client || ni_string_empty(brname))
+		return -1;
+
+	return ni_ovsdb_bridge_lookup(client, brname, &ref) ? 0 : 2;
+}
+
+int
+ni_ovsdb_bridge_to_vlan(ni_ovsdb_client_t *client, const char *brname, uint16_t *vlan)
+{
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (!client || ni_string_empty(brname) || !vlan)
+		return -1;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: unable to query bridge vlan", brname);
+		return -1;
+	}
+
+	*vlan = ref.fake ? ref.fake->tag : 0;
+	return 0;
+}
+
+int
+ni_ovsdb_bridge_to_parent(ni_ovsdb_client_t *client, const char *brname, char **parent)
+{
+	ni_ovsdb_bridge_ref_t ref;
+
+	if (!client || ni_string_empty(brname) || !parent)
+		return -1;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: unable to query bridge parent", brname);
+		return -1;
+	}
+
+	if (ref.fake)
+		ni_string_dup(parent, ref.bridge->name);
+	return 0;
+}
+
+int
+ni_ovsdb_bridge_ports(ni_ovsdb_client_t *client, const char *brname,
+			ni_ovs_bridge_port_array_t *ports)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	ni_ovsdb_row_t *port;
+	unsigned int i;
+
+	if (!client || ni_string_empty(brname) || !ports)
+		return -1;
+
+	if (!ni_ovsdb_bridge_lookup(client, brname, &ref)) {
+		ni_error("%s: unable to query bridge ports", brname);
+		return -1;
+	}
+
+	for (i = 0; i < ref.bridge->ports.count; ++i) {
+		port = ni_ovsdb_table_find_uuid(&client->ports, ref.bridge->ports.data[i]);
+		if (!port || ni_string_eq(port->name, brname))
+			continue;
+
+		if (ni_ovsdb_bridge_has_port(client, &ref, port))
+			ni_ovs_bridge_port_array_add_new(ports, port->name);
+	}
+	return 0;
+}
+
+int
+ni_ovsdb_bridge_port_to_bridge(ni_ovsdb_client_t *client, const char *pname, char **brname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	ni_ovsdb_row_t *port;
+
+	if (!client || ni_string_empty(pname) || !brname)
+		return -1;
+
+	if (!(port = ni_ovsdb_table_find_name(&client->ports, pname)) ||
+	    !ni_ovsdb_port_lookup(client, port, &ref)) {
+		ni_error("%s: unable to query port bridge", pname);
+		return -1;
+	}
+
+	ni_string_dup(brname, ni_ovsdb_bridge_ref_name(&ref));
+	return 0;
+}
+
+/*
+ * Transactions
+ */
+ni_ovsdb_txn_t *
+ni_ovsdb_txn_new(ni_ovsdb_client_t *client)
+{
+	ni_ovsdb_txn_t *txn;
+
+	if (!client)
+		return NULL;
+
+	txn = xcalloc(1, sizeof(*txn));
+	txn->client = client;
+	txn->params = ni_json_new_array();
+	ni_json_array_append(txn->params, ni_json_new_string(NI_OVSDB_DATABASE));
+	ni_stringbuf_init(&txn->comment);
+	return txn;
+}
+
+void
+ni_ovsdb_txn_free(ni_ovsdb_txn_t *txn)
+{
+	if (txn) {
+		ni_json_free(txn->params);
+		ni_stringbuf_destroy(&txn->comment);
+		free(txn);
+	}
+}
+
+static void
+ni_ovsdb_txn_comment(ni_ovsdb_txn_t *txn, const char *fmt, ...)
+{
+	va_list ap;
+
+	ni_stringbuf_puts(&txn->comment, txn->comment.len ? "; " : "wicked: ");
+	va_start(ap, fmt);
+	ni_stringbuf_vprintf(&txn->comment, fmt, ap);
+	va_end(ap);
+	txn->changes++;
+}
+
+static ni_json_t *
+ni_ovsdb_txn_op(ni_ovsdb_txn_t *txn, const char *op, const char *table)
+{
+	ni_json_t *json;
+
+	json = ni_json_new_object();
+	ni_json_object_set(json, "op", ni_json_new_string(op));
+	if (table)
+		ni_json_object_set(json, "table", ni_json_new_string(table));
+	ni_json_array_append(txn->params, json);
+	return json;
+}
+
+static ni_json_t *
+ni_ovsdb_txn_insert(ni_ovsdb_txn_t *txn, const char *table, const char *name, char **named)
+{
+	ni_json_t *op, *row;
+
+	ni_string_printf(named, "row%u", ++txn->named);
+
+	op = ni_ovsdb_txn_op(txn, "insert", table);
+	ni_json_object_set(op, "uuid-name", ni_json_new_string(*named));
+	ni_json_object_set(op, "row", (row = ni_json_new_object()));
+	ni_json_object_set(row, "name", ni_json_new_string(name));
+	return row;
+}
+
+static void
+ni_ovsdb_txn_mutate(ni_ovsdb_txn_t *txn, const char *table, const char *uuid,
+			const char *column, const char *mutator, ni_json_t *value)
+{
+	ni_json_t *op, *where, *cond, *mutations, *mutation;
+
+	op = ni_ovsdb_txn_op(txn, "mutate", table);
+
+	ni_json_object_set(op, "where", (where = ni_json_new_array()));
+	if (uuid) {
+		cond = ni_json_new_array();
+		ni_json_array_append(cond, ni_json_new_string("_uuid"));
+		ni_json_array_append(cond, ni_json_new_string("=="));
+		ni_json_array_append(cond, ni_ovsdb_json_atom("uuid", uuid));
+		ni_json_array_append(where, cond);
+	}
+
+	ni_json_object_set(op, "mutations", (mutations = ni_json_new_array()));
+	mutation = ni_json_new_array();
+	ni_json_array_append(mutation, ni_json_new_string(column));
+	ni_json_array_append(mutation, ni_json_new_string(mutator));
+	ni_json_array_append(mutation, value);
+	ni_json_array_append(mutations, mutation);
+}
+
+/*
+ * Insert the port row with its interface row, returning the port named-uuid
+ */
+static void
+ni_ovsdb_txn_insert_port(ni_ovsdb_txn_t *txn, const char *name, const char *type,
+			int tag, ni_bool_t fake_bridge, char **port)
+{
+	char *iface = NULL;
+	ni_json_t *row;
+
+	row = ni_ovsdb_txn_insert(txn, "Interface", name, &iface);
+	if (type)
+		ni_json_object_set(row, "type", ni_json_new_string(type));
+
+	row = ni_ovsdb_txn_insert(txn, "Port", name, port);
+	ni_json_object_set(row, "interfaces", ni_ovsdb_json_atom("named-uuid", iface));
+	if (tag >= 0)
+		ni_json_object_set(row, "tag", ni_json_new_int64(tag));
+	if (fake_bridge)
+		ni_json_object_set(row, "fake_bridge", ni_json_new_bool(TRUE));
+
+	ni_string_free(&iface);
+}
+
+ni_bool_t
+ni_ovsdb_txn_bridge_add(ni_ovsdb_txn_t *txn, const char *brname,
+			const char *parent, uint16_t vlan, ni_bool_t may_exist)
+{
+	ni_ovsdb_bridge_ref_t ref, pref;
+	char *port = NULL, *bridge = NULL;
+	ni_json_t *row;
+
+	if (!txn || ni_string_empty(brname))
+		return FALSE;
+
+	if (!ni_string_empty(parent)) {
+		if (!ni_ovsdb_bridge_lookup(txn->client, parent, &pref) || pref.fake) {
+			ni_error("%s: unable to find ovs parent bridge %s", brname, parent);
+			return FALSE;
+		}
+		if (vlan > 0x0fff) {
+			ni_error("%s: bridge vlan id %u not in range 0..%u", brname, vlan, 0x0fff);
+			return FALSE;
+		}
+	} else {
+		parent = NULL;
+	}
+
+	if (ni_ovsdb_bridge_lookup(txn->client, brname, &ref)) {
+		if (!may_exist) {
+			ni_error("%s: ovs bridge already exists", brname);
+			return FALSE;
+		}
+		if (parent ? (!ref.fake || ref.bridge != pref.bridge || ref.fake->tag != vlan)
+			   : (ref.fake != NULL)) {
+			ni_error("%s: ovs bridge already exists with another parent or vlan", brname);
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	if (parent) {
+		ni_ovsdb_txn_insert_port(txn, brname, "internal", vlan, TRUE, &port);
+		ni_ovsdb_txn_mutate(txn, "Bridge", pref.bridge->uuid, "ports", "insert",
+				ni_ovsdb_json_set(ni_ovsdb_json_atom("named-uuid", port)));
+		ni_ovsdb_txn_comment(txn, "add-br %s %s %u", brname, parent, vlan);
+	} else {
+		ni_ovsdb_txn_insert_port(txn, brname, "internal", -1, FALSE, &port);
+		row = ni_ovsdb_txn_insert(txn, "Bridge", brname, &bridge);
+		ni_json_object_set(row, "ports", ni_ovsdb_json_atom("named-uuid", port));
+		ni_ovsdb_txn_mutate(txn, NI_OVSDB_DATABASE, NULL, "bridges", "insert",
+				ni_ovsdb_json_set(ni_ovsdb_json_atom("named-uuid", bridge)));
+		ni_ovsdb_txn_comment(txn, "add-br %s", brname);
+	}
+
+	ni_string_free(&bridge);
+	ni_string_free(&port);
+	return TRUE;
+}
+
+ni_bool_t
+ni_ovsdb_txn_bridge_del(ni_ovsdb_txn_t *txn, const char *brname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	ni_ovsdb_row_t *port;
+	ni_json_t *set;
+	unsigned int i;
+
+	if (!txn || ni_string_empty(brname))
+		return FALSE;
+
+	if (!ni_ovsdb_bridge_lookup(txn->client, brname, &ref)) {
+		ni_error("%s: unable to find ovs bridge", brname);
+		return FALSE;
+	}
+
+	if (ref.fake) {
+		/* the ports of a fake bridge are deleted with it */
+		set = ni_ovsdb_json_set(ni_ovsdb_json_atom("uuid", ref.fake->uuid));
+		for (i = 0; i < ref.bridge->ports.count; ++i) {
+			port = ni_ovsdb_table_find_uuid(&txn->client->ports,
+							ref.bridge->ports.data[i]);
+			if (port && ni_ovsdb_bridge_has_port(txn->client, &ref, port))
+				ni_json_array_append(ni_json_array_get(set, 1),
+						ni_ovsdb_json_atom("uuid", port->uuid));
+		}
+		ni_ovsdb_txn_mutate(txn, "Bridge", ref.bridge->uuid, "ports", "delete", set);
+	} else {
+		ni_ovsdb_txn_mutate(txn, NI_OVSDB_DATABASE, NULL, "bridges", "delete",
+				ni_ovsdb_json_set(ni_ovsdb_json_atom("uuid", ref.bridge->uuid)));
+	}
+	ni_ovsdb_txn_comment(txn, "del-br %s", brname);
+	return TRUE;
+}
+
+ni_bool_t
+ni_ovsdb_txn_port_add(ni_ovsdb_txn_t *txn, const char *brname,
+			const char *pname, ni_bool_t may_exist)
+{
+	ni_ovsdb_bridge_ref_t ref, pref;
+	ni_ovsdb_row_t *port;
+	char *named = NULL;
+
+	if (!txn || ni_string_empty(brname) || ni_string_empty(pname))
+		return FALSE;
+
+	if (!ni_ovsdb_bridge_lookup(txn->client, brname, &ref)) {
+		ni_error("%s: unable to find ovs bridge %s", pname, brname);
+		return FALSE;
+	}
+
+	if ((port = ni_ovsdb_table_find_name(&txn->client->ports, pname))) {
+		if (may_exist && ni_ovsdb_port_lookup(txn->client, port, &pref) &&
+		    pref.bridge == ref.bridge && pref.fake == ref.fake)
+			return TRUE;
+
+		ni_error("%s: port already exists in another ovs bridge", pname);
+		return FALSE;
+	}
+	if (ni_ovsdb_table_find_name(&txn->client->bridges, pname)) {
+		ni_error("%s: unable to add port, an ovs bridge with this name exists", pname);
+		return FALSE;
+	}
+
+	ni_ovsdb_txn_insert_port(txn, pname, NULL, ref.fake ? ref.fake->tag : -1,
+					FALSE, &named);
+	ni_ovsdb_txn_mutate(txn, "Bridge", ref.bridge->uuid, "ports", "insert",
+				ni_ovsdb_json_set(ni_ovsdb_json_atom("named-uuid", named)));
+	ni_ovsdb_txn_comment(txn, "add-port %s %s", brname, pname);
+
+	ni_string_free(&named);
+	return TRUE;
+}
+
+ni_bool_t
+ni_ovsdb_txn_port_del(ni_ovsdb_txn_t *txn, const char *brname, const char *pname)
+{
+	ni_ovsdb_bridge_ref_t ref;
+	ni_ovsdb_row_t *port;
+
+	if (!txn || ni_string_empty(brname) || ni_string_empty(pname))
+		return FALSE;
+
+	if (!(port = ni_ovsdb_table_find_name(&txn->client->ports, pname)) ||
+	    !ni_ovsdb_port_lookup(txn->client, port, &ref) ||
+	    !ni_string_eq(ni_ovsdb_bridge_ref_name(&ref), brname)) {
+		ni_error("%s: unable to find port in ovs bridge %s", pname, brname);
+		return FALSE;
+	}
+
+	ni_ovsdb_txn_mutate(txn, "Bridge", ref.bridge->uuid, "ports", "delete",
+				ni_ovsdb_json_set(ni_ovsdb_json_atom("uuid", port->uuid)));
+	ni_ovsdb_txn_comment(txn, "del-port %s %s", brname, pname);
+	return TRUE;
+}
+
+/*
+ * Wait until ovs-vswitchd applied the committed configuration
+ */
+static void
+ni_ovsdb_client_wait_cfg(ni_ovsdb_client_t *client, int64_t next_cfg)
+{
+	struct timeval start;
+	long timeout;
+
+	ni_timer_get_time(&start);
+	while (client->sock && client->cur_cfg < next_cfg) {
+		if (!(timeout = ni_ovsdb_timeout_left(&start, NI_OVSDB_RECONFIG_TIMEOUT))) {
+			ni_warn("ovsdb: timeout waiting for ovs-vswitchd to apply configuration");
+			return;
+		}
+		if (ni_ovsdb_client_poll(client, timeout) < 0)
+			return;
+	}
+}
+
+int
+ni_ovsdb_txn_commit(ni_ovsdb_txn_t *txn)
+{
+	ni_stringbuf_t buf = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *op, *params, *reply, *result, *error;
+	int64_t next_cfg = 0;
+	unsigned int i, count;
+	int ret = 0;
+
+	if (!txn || !txn->params)
+		return -1;
+
+	if (!txn->changes)
+		return 0;
+
+	op = ni_ovsdb_txn_op(txn, "comment", NULL);
+	ni_json_object_set(op, "comment", ni_json_new_string(txn->comment.string));
+
+	/* request ovs-vswitchd to reconfigure and fetch the cfg to wait for */
+	ni_ovsdb_txn_mutate(txn, NI_OVSDB_DATABASE, NULL, "next_cfg", "+=", ni_json_new_int64(1));
+	op = ni_ovsdb_txn_op(txn, "select", NI_OVSDB_DATABASE);
+	ni_json_object_set(op, "where", ni_json_new_array());
+	ni_json_object_set(op, "columns", ni_json_parse_string("[ \"next_cfg\" ]"));
+
+	params = txn->params;
+	txn->params = NULL;
+	if (!(reply = ni_ovsdb_client_call(txn->client, "transact", params)))
+		return -1;
+
+	if (!(result = ni_ovsdb_reply_result(reply, "transact"))) {
+		ni_json_free(reply);
+		return -1;
+	}
+
+	count = ni_json_array_entries(result);
+	for (i = 0; i < count; ++i) {
+		op = ni_json_array_get(result, i);
+		if (!(error = ni_json_object_get_value(op, "error")))
+			continue;
+
+		ni_stringbuf_clear(&buf);
+		ni_json_format_string(&buf, op, NULL);
+		ni_error("ovsdb: %s failed: %s", txn->comment.string, buf.string);
+		ret = -1;
+	}
+	ni_stringbuf_destroy(&buf);
+
+	if (ret == 0) {
+		op = ni_json_array_get(result, count - 1);
+		op = ni_json_array_get(ni_json_object_get_value(op, "rows"), 0);
+		if (ni_ovsdb_value_int(ni_json_object_get_value(op, "next_cfg"), &next_cfg))
+			ni_ovsdb_client_wait_cfg(txn->client, next_cfg);
+	}
+	ni_json_free(reply);
+	return ret;
+}
@@ -0,0 +1,70 @@
+/*
+ *	OVSDB JSON-RPC client and cache of the bridge configuration
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ */
+#ifndef NI_WICKED_OVSDB_H
+#define NI_WICKED_OVSDB_H
+
+#include <wicked/types.h>
+#include <wicked/ovs.h>
+
+typedef struct ni_ovsdb_client	ni_ovsdb_client_t;
+typedef struct ni_ovsdb_txn	ni_ovsdb_txn_t;
+
+/*
+ * Returns the client connected to the ovsdb-server unix socket with
+ * an up to date cache of the bridge and port tables or NULL, when the
+ * ovsdb-server is not reachable.
+ */
+extern ni_ovsdb_client_t *	ni_ovsdb_client(void);
+extern void			ni_ovsdb_client_close(void);
+
+/*
+ * A client monitoring via an already connected socket, e.g. in tests;
+ * refresh applies the update notifications received meanwhile.
+ */
+extern ni_ovsdb_client_t *	ni_ovsdb_client_open(int);
+extern int			ni_ovsdb_client_refresh(ni_ovsdb_client_t *);
+extern void			ni_ovsdb_client_free(ni_ovsdb_client_t *);
+
+/*
+ * Queries answered from the monitored cache; the return codes follow
+ * the ovs-vsctl exit codes: 0 on success, 2 for a failed bridge exists
+ * test and a negative value for any other error.
+ */
+extern int			ni_ovsdb_bridge_exists(ni_ovsdb_client_t *, const char *);
+extern int			ni_ovsdb_bridge_to_vlan(ni_ovsdb_client_t *, const char *, uint16_t *);
+extern int			ni_ovsdb_bridge_to_parent(ni_ovsdb_client_t *, const char *, char **);
+extern int			ni_ovsdb_bridge_ports(ni_ovsdb_client_t *, const char *,
+							ni_ovs_bridge_port_array_t *);
+extern int			ni_ovsdb_bridge_port_to_bridge(ni_ovsdb_client_t *, const char *, char **);
+
+/*
+ * Changes are collected into a transaction, that is committed in one
+ * step and waits until ovs-vswitchd applied the new configuration.
+ */
+extern ni_ovsdb_txn_t *		ni_ovsdb_txn_new(ni_ovsdb_client_t *);
+extern void			ni_ovsdb_txn_free(ni_ovsdb_txn_t *);
+extern ni_bool_t		ni_ovsdb_txn_bridge_add(ni_ovsdb_txn_t *, const char *,
+							const char *, uint16_t, ni_bool_t);
+extern ni_bool_t		ni_ovsdb_txn_bridge_del(ni_ovsdb_txn_t *, const char *);
+extern ni_bool_t		ni_ovsdb_txn_port_add(ni_ovsdb_txn_t *, const char *,
+							const char *, ni_bool_t);
+extern ni_bool_t		ni_ovsdb_txn_port_del(ni_ovsdb_txn_t *, const char *, const char *);
+extern int			ni_ovsdb_txn_commit(ni_ovsdb_txn_t *);
+
+#endif /* NI_WICKED_OVSDB_H */
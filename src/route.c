@@ -537,6 +537,24 @@ ni_route_bind_ifindex(ni_route_t *rp, ni_netconfig_t *nc, ni_netdev_t *dev, unsi
 		ni_route_nexthop_bind_ifindex(nh, nc, dev, ifflags);
 }
 
+/*
+ * ipv6 automatically assigns a priority (metric) to routes without one
+ */
+static unsigned int
+ni_route_ipv6_priority(const ni_route_t *rp)
+{
+	if (rp->priority)
+		return rp->priority;
+
+	if (!ni_route_type_needs_nexthop(rp->type))
+		return IP6_RT_PRIO_USER;
+	else
+	if (ni_route_via_gateway(rp))
+		return IP6_RT_PRIO_USER;
+	else
+		return IP6_RT_PRIO_ADDRCONF;
+}
+
 ni_bool_t
 ni_route_equal_destination(const ni_route_t *r1, const ni_route_t *r2)
 {
@@ -567,32 +585,34 @@ ni_route_equal_destination(const ni_route_t *r1, const ni_route_t *r2)
 		 * we don't support source routes yet and filter them out, so
 		 * all routes have a "from all" source for now.
 		 */
-		unsigned int p1 = r1->priority;
-		unsigned int p2 = r2->priority;
-		if (!p1) {
-			if (!ni_route_type_needs_nexthop(r1->type))
-				p1 = IP6_RT_PRIO_USER;
-			else
-			if (ni_route_via_gateway(r1))
-				p1 = IP6_RT_PRIO_USER;
-			else
-				p1 = IP6_RT_PRIO_ADDRCONF;
-		}
-		if (!p2) {
-			if (!ni_route_type_needs_nexthop(r2->type))
-				p2 = IP6_RT_PRIO_USER;
-			else
-			if (ni_route_via_gateway(r2))
-				p2 = IP6_RT_PRIO_USER;
-			else
-				p2 = IP6_RT_PRIO_ADDRCONF;
-		}
-		if (p1 != p2)
+		if (ni_route_ipv6_priority(r1) != ni_route_ipv6_priority(r2))
 			return FALSE;
 	}
 	return TRUE;
 }
 
+/*
+ * Hash of the route table and of the destination key fields, for
+ * lookups matching the table and ni_route_equal_destination.
+ */
+unsigned int
+ni_route_destination_hash(const ni_route_t *rp)
+{
+	unsigned int hash;
+
+	hash = ni_hash_uint(rp->table) ^ ni_hash_uint(rp->family << 8 | rp->prefixlen);
+	if (rp->prefixlen)
+		hash ^= ni_sockaddr_hash(&rp->destination);
+
+	if (rp->family == AF_INET)
+		hash ^= ni_hash_uint(rp->tos << 24 ^ rp->priority);
+	else
+	if (rp->family == AF_INET6)
+		hash ^= ni_hash_uint(ni_route_ipv6_priority(rp));
+
+	return hash;
+}
+
 ni_bool_t
 ni_route_equal_pref_source(const ni_route_t *r1, const ni_route_t *r2)
 {
@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/poll.h>
+#include <sys/epoll.h>
 #include <sys/un.h>
 #include <signal.h>
 #include <string.h>
@@ -29,12 +30,15 @@
 #include "appconfig.h"
 
 #define	NI_SOCKET_ARRAY_CHUNK	16
+#define	NI_SOCKET_EPOLL_EVENTS	64
 
 static void			__ni_socket_close(ni_socket_t *);
 static void			__ni_default_error_handler(ni_socket_t *);
 static void			__ni_default_hangup_handler(ni_socket_t *);
 
-static ni_socket_array_t	__ni_sockets;
+static void			__ni_socket_array_detach(ni_socket_array_t *, ni_socket_t *);
+
+static ni_socket_array_t	__ni_sockets = NI_SOCKET_ARRAY_INIT;
 
 
 /*
@@ -47,12 +51,12 @@ ni_socket_activate(ni_socket_t *sock)
 }
 
 static inline void
-__ni_socket_deactivate(ni_socket_t **slot)
+__ni_socket_deactivate(ni_socket_array_t *array, ni_socket_t **slot)
 {
 	ni_socket_t *sock = *slot;
 
 	*slot = NULL;
-	sock->active = NULL;
+	__ni_socket_array_detach(array, sock);
 	ni_socket_release(sock);
 }
 
@@ -90,6 +94,7 @@ ni_socket_release(ni_socket_t *sock)
 	if (sock->refcount == 0) {
 		__ni_socket_close(sock);
 		ni_assert(!sock->active);
+		ni_assert(!sock->timer);
 		if (sock->release_user_data)
 			sock->release_user_data(sock->user_data);
 		free(sock);
@@ -111,54 +116,79 @@ __ni_default_hangup_handler(ni_socket_t *sock)
 
 
 /*
- * Wait for incoming data on any of the sockets.
+ * Deactivate a socket while dispatching its events. The poll backend
+ * passes the array slot, the epoll backend looks it up on demand.
  */
-int
-ni_socket_array_wait(ni_socket_array_t *array, long timeout)
+static void
+__ni_socket_disable(ni_socket_array_t *array, ni_socket_t **slot, ni_socket_t *sock)
+{
+	unsigned int i;
+
+	if (!slot && (i = ni_socket_array_find(array, sock)) != -1U)
+		slot = &array->data[i];
+
+	if (slot && *slot == sock)
+		__ni_socket_deactivate(array, slot);
+}
+
+static void
+__ni_socket_handle_events(ni_socket_array_t *array, ni_socket_t **slot,
+			ni_socket_t *sock, int revents)
+{
+	if (revents & POLLERR) {
+		/* Deactivate socket */
+		__ni_socket_disable(array, slot, sock);
+		sock->handle_error(sock);
+		return;
+	}
+
+	if (revents & POLLIN) {
+		if (sock->receive == NULL) {
+			ni_error("socket %d has no receive callback", sock->__fd);
+			__ni_socket_disable(array, slot, sock);
+		} else {
+			sock->receive(sock);
+		}
+		if (sock->__fd < 0)
+			return;
+	}
+
+	if (revents & POLLHUP) {
+		if (sock->handle_hangup)
+			sock->handle_hangup(sock);
+		if (sock->__fd < 0)
+			return;
+	} else
+
+	if (revents & POLLOUT) {
+		if (sock->transmit == NULL) {
+			ni_error("socket %d has no transmit callback", sock->__fd);
+			__ni_socket_disable(array, slot, sock);
+		} else {
+			sock->transmit(sock);
+		}
+	}
+}
+
+static int
+__ni_socket_array_poll_wait(ni_socket_array_t *array, long timeout)
 {
 	struct pollfd pfd[array->count];
-	struct timeval now, expires;
 	unsigned int i, socket_count;
 
-	/* First step - cleanup empty socket slots from the array. */
-	ni_socket_array_cleanup(array);
-
-	/* Second step - build pollfd array and get timeouts */
-	timerclear(&expires);
+	/* Build pollfd array from the active sockets */
 	socket_count = 0;
 	for (i = 0; i < array->count; ++i) {
 		ni_socket_t *sock = array->data[i];
-		struct timeval socket_expires;
 
 		if (sock->active != array)
 			continue;
 
-		timerclear(&socket_expires);
-		if (sock->get_timeout && sock->get_timeout(sock, &socket_expires) == 0) {
-			if (!timerisset(&expires) || timercmp(&socket_expires, &expires, <))
-				expires = socket_expires;
-		}
-
 		pfd[socket_count].fd = sock->__fd;
 		pfd[socket_count].events = sock->poll_flags;
 		socket_count++;
 	}
 
-	ni_timer_get_time(&now);
-	if (timerisset(&expires)) {
-		struct timeval delta;
-		long delta_ms;
-
-		if (timercmp(&expires, &now, <)) {
-			timeout = 0;
-		} else {
-			timersub(&expires, &now, &delta);
-			delta_ms = 1000 * delta.tv_sec + delta.tv_usec / 1000;
-			if (timeout < 0 || delta_ms < timeout)
-				timeout = delta_ms;
-		}
-	}
-
 	if (socket_count == 0 && timeout < 0) {
 		ni_debug_socket("no sockets left to watch");
 		return 1;
@@ -177,64 +207,156 @@ ni_socket_array_wait(ni_socket_array_t *array, long timeout)
 		if (!sock || sock->active != array)
 			continue;
 
-		if (pfd[i].fd != sock->__fd)
+		if (pfd[i].fd != sock->__fd || !pfd[i].revents)
 			continue;
 
 		ni_socket_hold(sock);
+		__ni_socket_handle_events(array, &array->data[i], sock, pfd[i].revents);
+		ni_socket_release(sock);
+	}
+	return 0;
+}
 
-		if (pfd[i].revents & POLLERR) {
-			/* Deactivate socket */
-			__ni_socket_deactivate(&array->data[i]);
-			sock->handle_error(sock);
-			goto done_with_this_socket;
-		}
-
-		if (pfd[i].revents & POLLIN) {
-			if (sock->receive == NULL) {
-				ni_error("socket %d has no receive callback", sock->__fd);
-				__ni_socket_deactivate(&array->data[i]);
-			} else {
-				sock->receive(sock);
-			}
-			if (sock->__fd < 0)
-				goto done_with_this_socket;
-		}
+static int
+__ni_socket_array_epoll_wait(ni_socket_array_t *array, long timeout)
+{
+	struct epoll_event events[NI_SOCKET_EPOLL_EVENTS];
+	int i, count;
 
-		if (pfd[i].revents & POLLHUP) {
-			if (sock->handle_hangup)
-				sock->handle_hangup(sock);
-			if (sock->__fd < 0)
-				goto done_with_this_socket;
-		} else
-
-		if (pfd[i].revents & POLLOUT) {
-			if (sock->transmit == NULL) {
-				ni_error("socket %d has no transmit callback", sock->__fd);
-				__ni_socket_deactivate(&array->data[i]);
-			} else {
-				sock->transmit(sock);
-			}
-		}
+	if (array->count == 0 && timeout < 0) {
+		ni_debug_socket("no sockets left to watch");
+		return 1;
+	}
 
-done_with_this_socket:
-		ni_socket_release(sock);
+	count = epoll_wait(array->epfd, events, NI_SOCKET_EPOLL_EVENTS, timeout);
+	if (count < 0) {
+		if (errno == EINTR)
+			return 0;
+		ni_error("epoll_wait returns error: %m");
+		return -1;
 	}
 
-	ni_timer_get_time(&now);
-	for (i = 0; i < array->count && i < socket_count; ++i) {
-		ni_socket_t *sock = array->data[i];
+	/* A callback may deactivate (and release) other sockets reported
+	 * in this batch, so keep them all referenced until we're done. */
+	for (i = 0; i < count; ++i)
+		ni_socket_hold(events[i].data.ptr);
 
-		if (!sock || sock->active != array)
+	for (i = 0; i < count; ++i) {
+		ni_socket_t *sock = events[i].data.ptr;
+
+		if (sock->active != array || sock->__fd < 0)
 			continue;
 
-		if (sock->check_timeout)
-			sock->check_timeout(sock, &now);
+		/* EPOLLIN, EPOLLOUT, ... share the values of their POLL* peers */
+		__ni_socket_handle_events(array, NULL, sock, events[i].events);
 	}
 
+	for (i = 0; i < count; ++i)
+		ni_socket_release(events[i].data.ptr);
+
+	return 0;
+}
+
+/*
+ * Wait for incoming data on any of the sockets.
+ * Socket timeouts are driven by the timer subsystem,
+ * see ni_socket_update_timeout().
+ */
+int
+ni_socket_array_wait(ni_socket_array_t *array, long timeout)
+{
+	int ret;
+
+	/* First step - cleanup empty socket slots from the array. */
+	ni_socket_array_cleanup(array);
+
+	if (array->backend == NI_SOCKET_ARRAY_BACKEND_EPOLL)
+		ret = __ni_socket_array_epoll_wait(array, timeout);
+	else
+		ret = __ni_socket_array_poll_wait(array, timeout);
+
 	/* Finally cleanup deactivated/released sockets */
 	ni_socket_array_cleanup(array);
 
-	return 0;
+	return ret;
+}
+
+/*
+ * Per-socket timeouts, reported by the get_timeout callback, are
+ * armed as a timer; the owner calls this whenever its deadline changes.
+ */
+static void
+__ni_socket_timeout_expired(void *user_data, const ni_timer_t *timer)
+{
+	ni_socket_t *sock = user_data;
+	struct timeval now;
+
+	if (sock->timer != timer)
+		return;
+
+	sock->timer = NULL;
+	ni_socket_hold(sock);
+	if (sock->active && sock->check_timeout) {
+		ni_timer_get_time(&now);
+		sock->check_timeout(sock, &now);
+	}
+	ni_socket_update_timeout(sock);
+	ni_socket_release(sock);
+}
+
+void
+ni_socket_update_timeout(ni_socket_t *sock)
+{
+	struct timeval now, expires, delta;
+	unsigned long timeout = 0;
+
+	if (!sock)
+		return;
+
+	timerclear(&expires);
+	if (!sock->active || !sock->get_timeout || !sock->check_timeout ||
+	    sock->get_timeout(sock, &expires) != 0 || !timerisset(&expires)) {
+		if (sock->timer) {
+			ni_timer_cancel(sock->timer);
+			sock->timer = NULL;
+		}
+		return;
+	}
+
+	ni_timer_get_time(&now);
+	if (timercmp(&expires, &now, >)) {
+		timersub(&expires, &now, &delta);
+		/* round up, the deadline has to be passed when we fire */
+		timeout = delta.tv_sec * 1000 + (delta.tv_usec + 999) / 1000;
+	}
+
+	if (sock->timer && (sock->timer = ni_timer_rearm(sock->timer, timeout)))
+		return;
+
+	sock->timer = ni_timer_register(timeout, __ni_socket_timeout_expired, sock);
+}
+
+/*
+ * Change the events we're waiting for on a socket
+ */
+void
+ni_socket_set_poll_flags(ni_socket_t *sock, int poll_flags)
+{
+	ni_socket_array_t *array;
+	struct epoll_event ev;
+
+	if (!sock || sock->poll_flags == poll_flags)
+		return;
+
+	sock->poll_flags = poll_flags;
+	if (!(array = sock->active) || array->backend != NI_SOCKET_ARRAY_BACKEND_EPOLL)
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = poll_flags;
+	ev.data.ptr = sock;
+	if (sock->__fd >= 0 && epoll_ctl(array->epfd, EPOLL_CTL_MOD, sock->__fd, &ev) < 0)
+		ni_error("unable to modify epoll events of socket %d: %m", sock->__fd);
 }
 
 int
@@ -282,6 +404,10 @@ ni_socket_wrap(int fd, int sotype)
 static void
 __ni_socket_close(ni_socket_t *sock)
 {
+	/* Remove it from the epoll set while the descriptor is still valid */
+	if (sock->active)
+		ni_socket_deactivate(sock);
+
 	if (sock->close) {
 		sock->close(sock);
 	} else if (sock->__fd >= 0) {
@@ -291,9 +417,6 @@ __ni_socket_close(ni_socket_t *sock)
 
 	ni_buffer_destroy(&sock->wbuf);
 	ni_buffer_destroy(&sock->rbuf);
-
-	if (sock->active)
-		ni_socket_deactivate(sock);
 }
 
 void
@@ -310,6 +433,7 @@ void
 ni_socket_array_init(ni_socket_array_t *array)
 {
 	memset(array, 0, sizeof(*array));
+	array->epfd = -1;
 }
 
 void
@@ -323,12 +447,14 @@ ni_socket_array_destroy(ni_socket_array_t *array)
 			array->data[array->count] = NULL;
 			if (sock) {
 				if (sock->active == array)
-					sock->active = NULL;
+					__ni_socket_array_detach(array, sock);
 				ni_socket_release(sock);
 			}
 		}
 		free(array->data);
-		memset(array, 0, sizeof(*array));
+		if (array->epfd >= 0)
+			close(array->epfd);
+		ni_socket_array_init(array);
 	}
 }
 
@@ -391,7 +517,7 @@ ni_socket_array_remove_at(ni_socket_array_t *array, unsigned int index)
 	array->data[array->count] = NULL;
 
 	if (sock && sock->active == array)
-		sock->active = NULL;
+		__ni_socket_array_detach(array, sock);
 	return sock;
 }
 
@@ -424,6 +550,61 @@ ni_socket_array_find(ni_socket_array_t *array, ni_socket_t *sock)
 	return -1U;
 }
 
+/*
+ * Select the wait backend on first activation
+ */
+static void
+__ni_socket_array_init_backend(ni_socket_array_t *array)
+{
+	if (array->backend != NI_SOCKET_ARRAY_BACKEND_UNSET)
+		return;
+
+	array->backend = NI_SOCKET_ARRAY_BACKEND_POLL;
+	if (ni_config_event_loop_backend() != NI_CONFIG_EVENT_LOOP_EPOLL)
+		return;
+
+	if ((array->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		ni_warn("unable to create epoll instance, falling back to poll: %m");
+		return;
+	}
+	array->backend = NI_SOCKET_ARRAY_BACKEND_EPOLL;
+}
+
+static ni_bool_t
+__ni_socket_array_attach(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	struct epoll_event ev;
+
+	if (array->backend != NI_SOCKET_ARRAY_BACKEND_EPOLL)
+		return TRUE;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = sock->poll_flags;
+	ev.data.ptr = sock;
+	if (epoll_ctl(array->epfd, EPOLL_CTL_ADD, sock->__fd, &ev) == 0)
+		return TRUE;
+
+	/* descriptor reused after an unnoticed close -- take it over */
+	if (errno == EEXIST && epoll_ctl(array->epfd, EPOLL_CTL_MOD, sock->__fd, &ev) == 0)
+		return TRUE;
+
+	ni_error("unable to add socket %d to epoll set: %m", sock->__fd);
+	return FALSE;
+}
+
+static void
+__ni_socket_array_detach(ni_socket_array_t *array, ni_socket_t *sock)
+{
+	if (array->backend == NI_SOCKET_ARRAY_BACKEND_EPOLL && sock->__fd >= 0)
+		epoll_ctl(array->epfd, EPOLL_CTL_DEL, sock->__fd, NULL);
+
+	sock->active = NULL;
+	if (sock->timer) {
+		ni_timer_cancel(sock->timer);
+		sock->timer = NULL;
+	}
+}
+
 ni_bool_t
 ni_socket_array_activate(ni_socket_array_t *array, ni_socket_t *sock)
 {
@@ -433,12 +614,20 @@ ni_socket_array_activate(ni_socket_array_t *array, ni_socket_t *sock)
 	if (sock->active)
 		return sock->active == array;
 
-	if (!ni_socket_array_append(array, sock))
+	__ni_socket_array_init_backend(array);
+
+	sock->poll_flags = POLLIN;
+	if (!__ni_socket_array_attach(array, sock))
 		return FALSE;
 
+	if (!ni_socket_array_append(array, sock)) {
+		__ni_socket_array_detach(array, sock);
+		return FALSE;
+	}
+
 	ni_socket_hold(sock);
 	sock->active = array;
-	sock->poll_flags = POLLIN;
+	ni_socket_update_timeout(sock);
 	return TRUE;
 }
 
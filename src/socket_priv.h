@@ -35,17 +35,29 @@ struct ni_socket {
 
 	int		(*get_timeout)(const ni_socket_t *, struct timeval *);
 	void		(*check_timeout)(ni_socket_t *, const struct timeval *);
+	const ni_timer_t *	timer;
 
 	void		(*release_user_data)(void *);
 	void *		user_data;
 };
 
+typedef enum {
+	NI_SOCKET_ARRAY_BACKEND_UNSET = 0,
+	NI_SOCKET_ARRAY_BACKEND_POLL,
+	NI_SOCKET_ARRAY_BACKEND_EPOLL,
+} ni_socket_array_backend_t;
+
 struct ni_socket_array {
 	unsigned int	count;
 	ni_socket_t **	data;
+
+	ni_socket_array_backend_t backend;
+	int		epfd;
 };
 
-#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL }
+#define NI_SOCKET_ARRAY_INIT	{ .count = 0, .data = NULL, \
+				  .backend = NI_SOCKET_ARRAY_BACKEND_UNSET, \
+				  .epfd = -1 }
 
 extern void		ni_socket_array_init(ni_socket_array_t *);
 extern void		ni_socket_array_destroy(ni_socket_array_t *);
@@ -59,5 +71,8 @@ extern unsigned int	ni_socket_array_find(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_activate(ni_socket_array_t *, ni_socket_t *);
 extern ni_bool_t	ni_socket_array_deactivate(ni_socket_array_t *, ni_socket_t *);
 
+extern void		ni_socket_set_poll_flags(ni_socket_t *, int);
+extern void		ni_socket_update_timeout(ni_socket_t *);
+
 #endif /* __WICKED_SOCKET_PRIV_H__ */
 
@@ -195,6 +195,24 @@ ni_sysfs_netif_readlink(const char *ifname, const char *attr_name, char **link)
 	return TRUE;
 }
 
+/*
+ * Names of the lower devices (e.g. team ports) linked as "lower_<name>"
+ */
+int
+ni_sysfs_netif_get_lower_names(const char *ifname, ni_string_array_t *names)
+{
+	ni_string_array_t links = NI_STRING_ARRAY_INIT;
+	unsigned int i, len = sizeof("lower_") - 1;
+
+	if (!ni_scandir(__ni_sysfs_netif_attrpath(ifname, ""), "lower_*", &links))
+		return 0;
+
+	for (i = 0; i < links.count; ++i)
+		ni_string_array_append(names, links.data[i] + len);
+	ni_string_array_destroy(&links);
+	return i;
+}
+
 static const char *
 __ni_sysfs_netif_get_attr(const char *ifname, const char *attr_name)
 {
@@ -425,7 +443,7 @@ ni_sysfs_bridge_get_config(const char *ifname, ni_bridge_t *bridge)
 	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/forward_delay", &ui) == 0)
 		bridge->forward_delay = (double)ui / 100.0;
 	if (ni_sysfs_netif_get_ulong(ifname, SYSFS_BRIDGE_ATTR "/ageing_time", &ul) == 0)
-		bridge->ageing_time = (double)ui / 100.0;
+		bridge->ageing_time = (double)ul / 100.0;
 	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/hello_time", &ui) == 0)
 		bridge->hello_time = (double)ui / 100.0;
 	if (ni_sysfs_netif_get_uint(ifname, SYSFS_BRIDGE_ATTR "/max_age", &ui) == 0)
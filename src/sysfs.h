@@ -24,6 +24,7 @@ extern int	ni_sysfs_netif_printf(const char *, const char *, const char *, ...);
 extern ni_bool_t ni_sysfs_is_read_only(void);
 extern ni_bool_t ni_sysfs_netif_exists(const char *, const char *);
 extern ni_bool_t ni_sysfs_netif_readlink(const char *, const char *, char **);
+extern int	ni_sysfs_netif_get_lower_names(const char *, ni_string_array_t *);
 extern int	ni_sysfs_bonding_available(void);
 extern int	ni_sysfs_bonding_get_masters(ni_string_array_t *list);
 extern int	ni_sysfs_bonding_is_master(const char *);
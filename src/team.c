@@ -478,6 +478,70 @@ ni_team_free(ni_team_t *team)
 	}
 }
 
+static ni_team_link_watch_t *
+ni_team_link_watch_clone(const ni_team_link_watch_t *orig)
+{
+	ni_team_link_watch_t *lw;
+
+	if (!orig || !(lw = ni_team_link_watch_new(orig->type)))
+		return NULL;
+
+	switch (orig->type) {
+	case NI_TEAM_LINK_WATCH_ETHTOOL:
+		lw->ethtool = orig->ethtool;
+		break;
+	case NI_TEAM_LINK_WATCH_ARP_PING:
+		lw->arp = orig->arp;
+		lw->arp.source_host = NULL;
+		lw->arp.target_host = NULL;
+		ni_string_dup(&lw->arp.source_host, orig->arp.source_host);
+		ni_string_dup(&lw->arp.target_host, orig->arp.target_host);
+		break;
+	case NI_TEAM_LINK_WATCH_NSNA_PING:
+		lw->nsna = orig->nsna;
+		lw->nsna.target_host = NULL;
+		ni_string_dup(&lw->nsna.target_host, orig->nsna.target_host);
+		break;
+	case NI_TEAM_LINK_WATCH_TIPC:
+		ni_string_dup(&lw->tipc.bearer, orig->tipc.bearer);
+		break;
+	default:
+		break;
+	}
+	return lw;
+}
+
+ni_team_t *
+ni_team_clone(const ni_team_t *orig)
+{
+	ni_team_t *team;
+	unsigned int i;
+
+	if (!orig || !(team = ni_team_new()))
+		return NULL;
+
+	team->runner = orig->runner;
+
+	for (i = 0; i < orig->link_watch.count; ++i) {
+		ni_team_link_watch_t *lw;
+
+		lw = ni_team_link_watch_clone(orig->link_watch.data[i]);
+		if (!ni_team_link_watch_array_append(&team->link_watch, lw))
+			ni_team_link_watch_free(lw);
+	}
+
+	for (i = 0; i < orig->ports.count; ++i) {
+		const ni_team_port_t *o = orig->ports.data[i];
+		ni_team_port_t *p = ni_team_port_new();
+
+		ni_netdev_ref_set(&p->device, o->device.name, o->device.index);
+		p->config = o->config;
+		if (!ni_team_port_array_append(&team->ports, p))
+			ni_team_port_free(p);
+	}
+	return team;
+}
+
 void
 ni_team_runner_init(ni_team_runner_t *runner, ni_team_runner_type_t type)
 {
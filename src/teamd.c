@@ -45,6 +45,7 @@
 #include "process.h"
 #include "buffer.h"
 #include "teamd.h"
+#include "sysfs.h"
 #include "json.h"
 
 #define NI_TEAMD_CONFIG_OWNER			"teamd"
@@ -92,6 +93,9 @@ struct ni_teamd_client {
 
 	/* unix */
 	ni_shellcmd_t *		cmd;
+
+	/* config changed since last dump */
+	ni_bool_t		changed;
 };
 
 static inline const char *
@@ -166,10 +170,12 @@ ni_teamd_dbus_client_destroy(ni_teamd_client_t *tdc)
 static void
 ni_teamd_dbus_signal(ni_dbus_connection_t *connection, ni_dbus_message_t *msg, void *user_data)
 {
-	/* ni_teamd_client_t *tdc = user_data; */
+	ni_teamd_client_t *tdc = user_data;
 	const char *member = dbus_message_get_member(msg);
 
-	ni_debug_dbus("teamd-client: %s signal received (not handled)", member);
+	ni_debug_dbus("teamd-client: %s signal received", member);
+	if (tdc)
+		tdc->changed = TRUE;
 }
 
 static int
@@ -687,6 +693,7 @@ ni_teamd_ctl_state_set_item(ni_teamd_client_t *tdc, const char *item_name, const
 {
 	if (!tdc || !tdc->ops.ctl_state_set_item)
 		return -1;
+	tdc->changed = TRUE;
 	return tdc->ops.ctl_state_set_item(tdc, item_name, item_val);
 }
 
@@ -695,6 +702,7 @@ ni_teamd_ctl_port_add(ni_teamd_client_t *tdc, const char *port_name)
 {
 	if (!tdc || !tdc->ops.ctl_port_add)
 		return -1;
+	tdc->changed = TRUE;
 	return tdc->ops.ctl_port_add(tdc, port_name);
 }
 
@@ -703,6 +711,7 @@ ni_teamd_ctl_port_remove(ni_teamd_client_t *tdc, const char *port_name)
 {
 	if (!tdc || !tdc->ops.ctl_port_remove)
 		return -1;
+	tdc->changed = TRUE;
 	return tdc->ops.ctl_port_remove(tdc, port_name);
 }
 
@@ -711,9 +720,129 @@ ni_teamd_ctl_port_config_update(ni_teamd_client_t *tdc, const char *port_name, c
 {
 	if (!tdc || !tdc->ops.ctl_port_config_update)
 		return -1;
+	tdc->changed = TRUE;
 	return tdc->ops.ctl_port_config_update(tdc, port_name, port_conf);
 }
 
+/*
+ * teamd discovery cache
+ *
+ * Keeps a client connection per team device and the team discovered
+ * from its last config dump. The cached team is served as long as the
+ * ports known to teamd match the ports the kernel reports in sysfs and
+ * neither a teamd signal nor a change request through the client did
+ * invalidate it.
+ */
+typedef struct ni_teamd_cache	ni_teamd_cache_t;
+
+struct ni_teamd_cache {
+	ni_teamd_cache_t *	next;
+
+	char *			ifname;
+	unsigned int		ifindex;
+	ni_teamd_client_t *	tdc;
+
+	char *			conf;
+	ni_team_t *		team;
+};
+
+static ni_teamd_cache_t *	ni_teamd_cache_list;
+
+static void
+ni_teamd_cache_free(ni_teamd_cache_t *cache)
+{
+	if (cache) {
+		ni_teamd_client_free(cache->tdc);
+		ni_string_free(&cache->ifname);
+		ni_string_free(&cache->conf);
+		ni_team_free(cache->team);
+		free(cache);
+	}
+}
+
+static ni_teamd_cache_t **
+ni_teamd_cache_find(const char *ifname)
+{
+	ni_teamd_cache_t **pos, *cache;
+
+	for (pos = &ni_teamd_cache_list; (cache = *pos); pos = &cache->next) {
+		if (ni_string_eq(cache->ifname, ifname))
+			break;
+	}
+	return pos;
+}
+
+static ni_teamd_cache_t *
+ni_teamd_cache_get(const char *ifname, unsigned int ifindex)
+{
+	ni_teamd_cache_t **pos, *cache;
+
+	if (ni_string_empty(ifname))
+		return NULL;
+
+	pos = ni_teamd_cache_find(ifname);
+	if ((cache = *pos)) {
+		/* device has been re-created in the meantime */
+		if (!ifindex || !cache->ifindex || cache->ifindex == ifindex) {
+			if (ifindex)
+				cache->ifindex = ifindex;
+			return cache;
+		}
+		*pos = cache->next;
+		ni_teamd_cache_free(cache);
+	}
+
+	cache = xcalloc(1, sizeof(*cache));
+	if (!(cache->tdc = ni_teamd_client_open(ifname))) {
+		free(cache);
+		return NULL;
+	}
+	ni_string_dup(&cache->ifname, ifname);
+	cache->ifindex = ifindex;
+
+	cache->next = ni_teamd_cache_list;
+	ni_teamd_cache_list = cache;
+	return cache;
+}
+
+static void
+ni_teamd_cache_drop(const char *ifname)
+{
+	ni_teamd_cache_t **pos, *cache;
+
+	pos = ni_teamd_cache_find(ifname);
+	if ((cache = *pos)) {
+		*pos = cache->next;
+		ni_teamd_cache_free(cache);
+	}
+}
+
+static ni_bool_t
+ni_teamd_cache_ports_match(const ni_teamd_cache_t *cache)
+{
+	ni_string_array_t names = NI_STRING_ARRAY_INIT;
+	ni_bool_t match;
+	unsigned int i;
+
+	ni_sysfs_netif_get_lower_names(cache->ifname, &names);
+	match = names.count == cache->team->ports.count;
+	for (i = 0; match && i < names.count; ++i) {
+		if (!ni_team_port_array_find_by_name(&cache->team->ports, names.data[i]))
+			match = FALSE;
+	}
+	ni_string_array_destroy(&names);
+	return match;
+}
+
+static ni_bool_t
+ni_teamd_cache_valid(const ni_teamd_cache_t *cache)
+{
+	if (!cache->team || cache->tdc->changed)
+		return FALSE;
+
+	return ni_teamd_cache_ports_match(cache);
+}
+
 static ni_json_t *
 ni_teamd_port_config_json(const ni_team_port_config_t *config)
 {
@@ -739,17 +868,20 @@ int
 ni_teamd_port_enslave(const ni_netdev_t *master, const ni_netdev_t *port, const ni_team_port_config_t *config)
 {
 	ni_stringbuf_t dump = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_teamd_cache_t *cache;
 	ni_teamd_client_t *tdc;
-	int ret = -1;
 
 	if (!master || !master->name || !port || !port->name)
 		return -1;
 
-	if (!(tdc = ni_teamd_client_open(master->name)))
+	if (!(cache = ni_teamd_cache_get(master->name, master->link.ifindex)))
 		return -1;
 
-	if (ni_teamd_ctl_port_add(tdc, port->name) < 0)
-		goto failure;
+	tdc = cache->tdc;
+	if (ni_teamd_ctl_port_add(tdc, port->name) < 0) {
+		ni_teamd_cache_drop(master->name);
+		return -1;
+	}
 
 	if (config) {
 		ni_json_t *object = ni_teamd_port_config_json(config);
@@ -763,33 +895,26 @@ ni_teamd_port_enslave(const ni_netdev_t *master, const ni_netdev_t *port, const
 		ni_stringbuf_destroy(&dump);
 	}
 
-	ret = 0;
-
-failure:
-	ni_teamd_client_free(tdc);
-	return ret;
+	return 0;
 }
 
 int
 ni_teamd_port_unenslave(const ni_netdev_t *master, const ni_netdev_t *port)
 {
-	ni_teamd_client_t *tdc;
-	int ret = -1;
+	ni_teamd_cache_t *cache;
 
 	if (!master || !master->name || !port || !port->name)
 		return -1;
 
-	if (!(tdc = ni_teamd_client_open(master->name)))
+	if (!(cache = ni_teamd_cache_get(master->name, master->link.ifindex)))
 		return -1;
 
-	if (ni_teamd_ctl_port_remove(tdc, port->name) < 0)
-		goto failure;
-
-	ret = 0;
+	if (ni_teamd_ctl_port_remove(cache->tdc, port->name) < 0) {
+		ni_teamd_cache_drop(master->name);
+		return -1;
+	}
 
-failure:
-	ni_teamd_client_free(tdc);
-	return ret;
+	return 0;
 }
 
 
@@ -1106,7 +1231,7 @@ ni_teamd_discover_ports(ni_team_t *team, ni_json_t *conf)
 int
 ni_teamd_discover(ni_netdev_t *dev)
 {
-	ni_teamd_client_t *tdc = NULL;
+	ni_teamd_cache_t *cache;
 	ni_json_t *conf = NULL;
 	ni_team_t *team = NULL;
 	char *val = NULL;
@@ -1114,15 +1239,23 @@ ni_teamd_discover(ni_netdev_t *dev)
 	if (!dev || dev->link.type != NI_IFTYPE_TEAM)
 		return -1;
 
-	/* we are about to replace dev->team, so just
-	 * allocate new one we can drop at any time */
-	if (!(team = ni_team_new()))
-		goto failure;
+	if (!(cache = ni_teamd_cache_get(dev->name, dev->link.ifindex)))
+		return -1;
+
+	if (ni_teamd_cache_valid(cache))
+		goto done;
 
-	if (!(tdc = ni_teamd_client_open(dev->name)))
+	cache->tdc->changed = FALSE;
+	if (ni_teamd_ctl_config_dump(cache->tdc, TRUE, &val) < 0)
 		goto failure;
 
-	if (ni_teamd_ctl_config_dump(tdc, TRUE, &val) < 0)
+	/* unchanged config, e.g. while teamd catches up with the kernel */
+	if (cache->team && ni_string_eq(cache->conf, val)) {
+		ni_string_free(&val);
+		goto done;
+	}
+
+	if (!(team = ni_team_new()))
 		goto failure;
 
 	if (!(conf = ni_json_parse_string(val)))
@@ -1137,20 +1270,30 @@ ni_teamd_discover(ni_netdev_t *dev)
 	if (ni_teamd_discover_ports(team, conf) < 0)
 		goto failure;
 
-	ni_netdev_set_team(dev, team);
-	ni_teamd_client_free(tdc);
 	ni_json_free(conf);
-	ni_string_free(&val);
+	ni_team_free(cache->team);
+	cache->team = team;
+	ni_string_free(&cache->conf);
+	cache->conf = val;
+
+done:
+	ni_netdev_set_team(dev, ni_team_clone(cache->team));
 	return 0;
 
 failure:
 	ni_json_free(conf);
 	ni_team_free(team);
-	ni_teamd_client_free(tdc);
 	ni_string_free(&val);
+	ni_teamd_cache_drop(dev->name);
 	return -1;
 }
 
+void
+ni_teamd_discover_drop(const char *ifname)
+{
+	ni_teamd_cache_drop(ifname);
+}
+
 /*
  * teamd startup config file
  */
@@ -1557,6 +1700,8 @@ ni_teamd_service_start(const ni_netdev_t *cfg)
 	if (ni_teamd_config_file_write(cfg->name, cfg->team, &cfg->link.hwaddr) < 0)
 		return -1;
 
+	ni_teamd_cache_drop(cfg->name);
+
 	ni_string_printf(&service, NI_TEAMD_SERVICE_FMT, cfg->name);
 	rv = ni_systemctl_service_start(service);
 	if (rv < 0)
@@ -1572,6 +1717,7 @@ ni_teamd_service_stop(const char *ifname)
 	int rv;
 	char *service = NULL;
 
+	ni_teamd_cache_drop(ifname);
 	ni_string_printf(&service, NI_TEAMD_SERVICE_FMT, ifname);
 	rv = ni_systemctl_service_stop(service);
 	ni_teamd_config_file_remove(ifname);
@@ -46,6 +46,7 @@ extern int				ni_teamd_port_enslave(const ni_netdev_t *, const ni_netdev_t *, co
 extern int				ni_teamd_port_unenslave(const ni_netdev_t *, const ni_netdev_t *);
 
 extern int				ni_teamd_discover(ni_netdev_t *);
+extern void				ni_teamd_discover_drop(const char *);
 
 extern int				ni_teamd_service_start(const ni_netdev_t *);
 extern int				ni_teamd_service_stop (const char *);
@@ -8,31 +8,188 @@
 #endif
 
 #include <time.h>
+#include <string.h>
 #include <sys/time.h>
 #include <wicked/socket.h>
+#include <wicked/logging.h>
 #include "netinfo_priv.h"
 #include "util_priv.h"
 
+/*
+ * Timers are kept in a binary min-heap ordered by expiry time (and
+ * arm sequence for equal expiry times), each timer remembering its
+ * heap position, so arm and cancel are O(log n).
+ *
+ * Timer objects are allocated in slabs and recycled through a FIFO
+ * free list; the memory is never returned, so a stale handle passed
+ * to ni_timer_cancel/rearm is detected (not armed) instead of being
+ * a use-after-free.
+ */
 struct ni_timer {
 	ni_timer_t *		next;
 	unsigned int		ident;
+	unsigned int		index;
+	unsigned long		seq;
 	struct timeval		expires;
 	ni_timeout_callback_t	*callback;
 	void *			user_data;
 };
 
-static ni_timer_t *		ni_timer_list;
+#define NI_TIMER_SLAB_SIZE	64
+#define NI_TIMER_HEAP_CHUNK	64
+#define NI_TIMER_NOT_ARMED	-1U
+
+static struct ni_timer_heap {
+	ni_timer_t **		data;
+	unsigned int		count;
+	unsigned int		size;
+	unsigned long		seq;
+} ni_timer_heap;
+
+static struct ni_timer_free_list {
+	ni_timer_t *		head;
+	ni_timer_t **		tail;
+} ni_timer_free_list = { NULL, &ni_timer_free_list.head };
 
 static void			__ni_timer_arm(ni_timer_t *, unsigned long);
 static ni_timer_t *		__ni_timer_disarm(const ni_timer_t *);
 
+static void
+__ni_timer_free(ni_timer_t *timer)
+{
+	timer->next = NULL;
+	timer->index = NI_TIMER_NOT_ARMED;
+	timer->callback = NULL;
+	timer->user_data = NULL;
+
+	*ni_timer_free_list.tail = timer;
+	ni_timer_free_list.tail = &timer->next;
+}
+
+static ni_timer_t *
+__ni_timer_alloc(void)
+{
+	ni_timer_t *timer;
+	unsigned int i;
+
+	if (ni_timer_free_list.head == NULL) {
+		timer = xcalloc(NI_TIMER_SLAB_SIZE, sizeof(*timer));
+		for (i = 0; i < NI_TIMER_SLAB_SIZE; ++i)
+			__ni_timer_free(&timer[i]);
+	}
+
+	timer = ni_timer_free_list.head;
+	if (!(ni_timer_free_list.head = timer->next))
+		ni_timer_free_list.tail = &ni_timer_free_list.head;
+
+	memset(timer, 0, sizeof(*timer));
+	timer->index = NI_TIMER_NOT_ARMED;
+	return timer;
+}
+
+static inline ni_bool_t
+__ni_timer_before(const ni_timer_t *a, const ni_timer_t *b)
+{
+	if (timercmp(&a->expires, &b->expires, !=))
+		return timercmp(&a->expires, &b->expires, <);
+	return a->seq < b->seq;
+}
+
+static inline void
+__ni_timer_heap_set(unsigned int index, ni_timer_t *timer)
+{
+	ni_timer_heap.data[index] = timer;
+	timer->index = index;
+}
+
+static void
+__ni_timer_heap_sift_up(unsigned int index)
+{
+	ni_timer_t *timer = ni_timer_heap.data[index];
+	unsigned int parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (!__ni_timer_before(timer, ni_timer_heap.data[parent]))
+			break;
+		__ni_timer_heap_set(index, ni_timer_heap.data[parent]);
+		index = parent;
+	}
+	__ni_timer_heap_set(index, timer);
+}
+
+static void
+__ni_timer_heap_sift_down(unsigned int index)
+{
+	ni_timer_t *timer = ni_timer_heap.data[index];
+	unsigned int child;
+
+	while ((child = 2 * index + 1) < ni_timer_heap.count) {
+		if (child + 1 < ni_timer_heap.count &&
+		    __ni_timer_before(ni_timer_heap.data[child + 1], ni_timer_heap.data[child]))
+			child++;
+		if (!__ni_timer_before(ni_timer_heap.data[child], timer))
+			break;
+		__ni_timer_heap_set(index, ni_timer_heap.data[child]);
+		index = child;
+	}
+	__ni_timer_heap_set(index, timer);
+}
+
+static void
+__ni_timer_heap_insert(ni_timer_t *timer)
+{
+	if (ni_timer_heap.count == ni_timer_heap.size) {
+		ni_timer_heap.size += NI_TIMER_HEAP_CHUNK;
+		ni_timer_heap.data = xrealloc(ni_timer_heap.data,
+				ni_timer_heap.size * sizeof(ni_timer_t *));
+	}
+
+	timer->seq = ni_timer_heap.seq++;
+	__ni_timer_heap_set(ni_timer_heap.count++, timer);
+	__ni_timer_heap_sift_up(timer->index);
+}
+
+static void
+__ni_timer_heap_remove(ni_timer_t *timer)
+{
+	unsigned int index = timer->index;
+	ni_timer_t *last;
+
+	last = ni_timer_heap.data[--ni_timer_heap.count];
+	ni_timer_heap.data[ni_timer_heap.count] = NULL;
+	timer->index = NI_TIMER_NOT_ARMED;
+
+	if (last == timer)
+		return;
+
+	__ni_timer_heap_set(index, last);
+	if (index > 0 && __ni_timer_before(last, ni_timer_heap.data[(index - 1) / 2]))
+		__ni_timer_heap_sift_up(index);
+	else
+		__ni_timer_heap_sift_down(index);
+}
+
+static inline ni_timer_t *
+__ni_timer_heap_top(void)
+{
+	return ni_timer_heap.count ? ni_timer_heap.data[0] : NULL;
+}
+
+static inline ni_bool_t
+__ni_timer_armed(const ni_timer_t *timer)
+{
+	return timer && timer->index < ni_timer_heap.count &&
+		ni_timer_heap.data[timer->index] == timer;
+}
+
 const ni_timer_t *
 ni_timer_register(unsigned long timeout, ni_timeout_callback_t *callback, void *data)
 {
 	static unsigned int id_counter;
 	ni_timer_t *timer;
 
-	timer = xcalloc(1, sizeof(*timer));
+	timer = __ni_timer_alloc();
 	timer->callback = callback;
 	timer->user_data = data;
 	timer->ident = id_counter++;
@@ -54,7 +211,7 @@ ni_timer_cancel(const ni_timer_t *handle)
 		user_data = timer->user_data;
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: released timer %p", __func__, timer);
-		free(timer);
+		__ni_timer_free(timer);
 	} else {
 		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 				"%s: timer %p NOT found", __func__, handle);
@@ -83,7 +240,7 @@ ni_timer_next_timeout(void)
 	long timeout;
 
 	ni_timer_get_time(&now);
-	while ((timer = ni_timer_list) != NULL) {
+	while ((timer = __ni_timer_heap_top()) != NULL) {
 		if (!timercmp(&timer->expires, &now, <)) {
 			timersub(&timer->expires, &now, &delta);
 			timeout = delta.tv_sec * 1000 + delta.tv_usec / 1000;
@@ -98,19 +255,16 @@ ni_timer_next_timeout(void)
 				__func__, timer,
 				(long) now.tv_sec, (long) now.tv_usec,
 				(long) timer->expires.tv_sec, (long) timer->expires.tv_usec);
-		ni_timer_list = timer->next;
+		__ni_timer_heap_remove(timer);
 		timer->callback(timer->user_data, timer);
-		free(timer);
+		__ni_timer_free(timer);
 	}
-
 	return -1;
 }
 
 static void
 __ni_timer_arm(ni_timer_t *timer, unsigned long timeout)
 {
-	ni_timer_t *tail, **pos;
-
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
 			"%s: timer %p timeout %lu", __func__, timer, timeout);
 	ni_timer_get_time(&timer->expires);
@@ -121,32 +275,24 @@ __ni_timer_arm(ni_timer_t *timer, unsigned long timeout)
 		timer->expires.tv_usec -= 1000000;
 	}
 
-	for (pos = &ni_timer_list; (tail = *pos) != NULL; pos = &tail->next) {
-		if (timercmp(&timer->expires, &tail->expires, <))
-			break;
-	}
-
-	timer->next = tail;
-	*pos = timer;
+	__ni_timer_heap_insert(timer);
 }
 
 static ni_timer_t *
 __ni_timer_disarm(const ni_timer_t *handle)
 {
-	ni_timer_t **pos, *timer;
+	ni_timer_t *timer = (ni_timer_t *)handle;
 
-	for (pos = &ni_timer_list; (timer = *pos) != NULL; pos = &timer->next) {
-		if (timer == handle) {
-			*pos = timer->next;
-			timer->next = NULL;
-			ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
-					"%s: timer %p found", __func__, handle);
-			return timer;
-		}
+	if (!__ni_timer_armed(timer)) {
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
+				"%s: timer %p NOT found", __func__, handle);
+		return NULL;
 	}
+
+	__ni_timer_heap_remove(timer);
 	ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_TIMER,
-			"%s: timer %p NOT found", __func__, handle);
-	return NULL;
+			"%s: timer %p found", __func__, handle);
+	return timer;
 }
 
 static inline int
@@ -29,11 +29,13 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include <wicked/types.h>
 #include <wicked/util.h>
 #include <wicked/netinfo.h>
 
+#include "netinfo_priv.h"
 #include "udev-utils.h"
 #include "process.h"
 #include "buffer.h"
@@ -43,6 +45,9 @@
 #ifndef _PATH_SYS_CLASS_NET
 #define _PATH_SYS_CLASS_NET	"/sys/class/net"
 #endif
+#ifndef _PATH_UDEV_DATA_DIR
+#define _PATH_UDEV_DATA_DIR	"/run/udev/data"
+#endif
 
 struct netdev_uinfo {
 	unsigned int	ifindex;
@@ -173,6 +178,106 @@ ni_udevadm_info(ni_var_array_t **list, const char *query, const char *path)
 	return ret;
 }
 
+static ni_bool_t
+ni_udev_db_available(void)
+{
+	return ni_isdir(_PATH_UDEV_DATA_DIR);
+}
+
+/*
+ * Read the udev database entry of a network device, that is the
+ * /run/udev/data/n<ifindex> file written by udevd after it finished
+ * to process the device (incl. renames). The properties are mapped
+ * to the names used by udevadm info:
+ *
+ *   I:<usec>		USEC_INITIALIZED=<usec>
+ *   E:<key>=<value>	<key>=<value>
+ *   G:<tag>		TAGS=:<tag>:...
+ *
+ * Returns 0 on success, 1 when there is no entry (yet), -1 on error.
+ */
+static int
+ni_udev_db_netdev_info(ni_var_array_t *vars, unsigned int ifindex)
+{
+	ni_stringbuf_t tags = NI_STRINGBUF_INIT_DYNAMIC;
+	char pathbuf[PATH_MAX] = { '\0' };
+	char line[4096];
+	char *key, *val;
+	size_t len;
+	FILE *fp;
+
+	snprintf(pathbuf, sizeof(pathbuf), "%s/n%u", _PATH_UDEV_DATA_DIR, ifindex);
+	if (!(fp = fopen(pathbuf, "re"))) {
+		if (errno == ENOENT)
+			return 1;
+		ni_debug_verbose(NI_LOG_DEBUG2, NI_TRACE_EVENTS,
+				"unable to open udev database file %s: %m", pathbuf);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		len = strcspn(line, "\r\n");
+		line[len] = '\0';
+		if (len < 2 || line[1] != ':')
+			continue;
+
+		val = line + 2;
+		switch (line[0]) {
+		case 'I':
+			ni_var_array_set(vars, "USEC_INITIALIZED", val);
+			break;
+		case 'E':
+			key = val;
+			if (!(val = strchr(key, '=')))
+				break;
+			*val++ = '\0';
+			ni_var_array_set(vars, key, val);
+			break;
+		case 'G':
+			if (ni_string_empty(val))
+				break;
+			if (!tags.len)
+				ni_stringbuf_putc(&tags, ':');
+			ni_stringbuf_printf(&tags, "%s:", val);
+			break;
+		default:
+			break;
+		}
+	}
+	fclose(fp);
+
+	if (tags.len)
+		ni_var_array_set(vars, "TAGS", tags.string);
+	ni_stringbuf_destroy(&tags);
+	return 0;
+}
+
+static int
+netdev_udb_ready(const ni_var_array_t *vars, const char *ifname, unsigned int ifindex)
+{
+	const ni_var_t *var;
+
+	if (!ni_var_array_get(vars, "USEC_INITIALIZED")) {
+		ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+				"%s[%u] udev db: device is not initialized",
+				ifname, ifindex);
+		return -1;
+	}
+
+	var = ni_var_array_get(vars, "TAGS");
+	if (var && strstr(var->value, ":systemd:")) {
+		ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+				"%s[%u] udev db: systemd tag is set",
+				ifname, ifindex);
+		return 0;	/* only systemd-udevd sets tags */
+	}
+
+	ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+			"%s[%u] udev db: systemd tag is not set",
+			ifname, ifindex);
+	return -1;
+}
+
 static ni_bool_t
 ni_systemd_udev_is_active(void)
 {
@@ -196,6 +301,13 @@ ni_udev_net_subsystem_available(void)
 	ni_bool_t result = FALSE;
 	int ret;
 
+	/* udevd maintains a database, no need to ask udevadm */
+	if (ni_udev_db_available() && ni_isdir(_PATH_SYS_CLASS_NET)) {
+		ni_debug_verbose(NI_LOG_DEBUG, NI_TRACE_EVENTS,
+				"udev: net subsystem is available");
+		return TRUE;
+	}
+
 	ret = ni_udevadm_info(&vars, "all", _PATH_SYS_CLASS_NET);
 	if (ret == 0 && vars) {
 		ni_var_t *devpath = ni_var_array_get(vars, "DEVPATH");
@@ -315,12 +427,40 @@ ni_udev_netdev_update_name(ni_netdev_t *dev)
 	if (ni_string_empty(ifname))
 		return -1; /* device seems to be gone */
 
-	if (!ni_string_eq(dev->name, ifname))
+	if (!ni_string_eq(dev->name, ifname)) {
 		ni_string_dup(&dev->name, ifname);
+		ni_netconfig_device_index_update(ni_global_state_handle(0), dev);
+	}
 
 	return 0;
 }
 
+static ni_bool_t
+ni_udev_db_netdev_is_ready(ni_netdev_t *dev)
+{
+	ni_var_array_t vars = NI_VAR_ARRAY_INIT;
+	int ret;
+
+	/*
+	 * The database is looked up by ifindex, so an
+	 * ifname obsoleted by a udev rename does not
+	 * matter; we just refresh it from the kernel.
+	 */
+	if (ni_udev_netdev_update_name(dev) < 0)
+		return FALSE;
+
+	ret = ni_udev_db_netdev_info(&vars, dev->link.ifindex);
+	if (ret == 0)
+		ret = netdev_udb_ready(&vars, dev->name, dev->link.ifindex);
+	else if (ret > 0)
+		ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_EVENTS,
+				"%s[%u] udev db: no entry for device yet",
+				dev->name, dev->link.ifindex);
+	ni_var_array_destroy(&vars);
+
+	return ret == 0;
+}
+
 ni_bool_t
 ni_udev_netdev_is_ready(ni_netdev_t *dev)
 {
@@ -328,6 +468,16 @@ ni_udev_netdev_is_ready(ni_netdev_t *dev)
 	ni_var_array_t *vars = NULL;
 	int ret, retry = 2;
 
+	if (!dev || !dev->link.ifindex)
+		return FALSE;
+
+	/*
+	 * Devices which are not ready yet, are marked ready
+	 * by the uevent monitor once udevd processed them.
+	 */
+	if (ni_udev_db_available())
+		return ni_udev_db_netdev_is_ready(dev);
+
 	do {
 		/*
 		 * we're called to bootstrap before events listeners
@@ -8,12 +8,14 @@
 #endif
 
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include <wicked/netinfo.h>
 #include <wicked/logging.h>
 #include <wicked/addrconf.h>
 #include <wicked/system.h>
 #include <wicked/resolver.h>
+#include <wicked/nis.h>
 #include <wicked/leaseinfo.h>
 
 #include "netinfo_priv.h"
@@ -33,6 +35,11 @@
 #define NI_UPDATER_REVERSE_MAX_CNT	1
 #endif
 
+/* msecs the builtin updaters collect changes before applying them */
+#ifndef NI_UPDATER_BUILTIN_DELAY
+#define NI_UPDATER_BUILTIN_DELAY	250
+#endif
+
 #define	NI_UPDATER_SOURCE_ARRAY_CHUNK	4
 #define	NI_UPDATER_SOURCE_ARRAY_INIT	{ 0, NULL }
 
@@ -45,6 +52,11 @@ struct ni_updater_source {
 		unsigned int		family;
 		unsigned int		type;
 	} lease;
+
+	/* lease data merged by the builtin updaters */
+	char *				hostname;
+	ni_resolver_info_t		resolver;
+	ni_nis_info_t			nis;
 };
 
 typedef struct ni_updater_source_array	ni_updater_source_array_t;
@@ -107,6 +119,12 @@ struct ni_updater {
 	ni_shellcmd_t *			proc_install;
 	ni_shellcmd_t *			proc_remove;
 	ni_shellcmd_t *			proc_batch;
+
+	int				backend;
+	const ni_timer_t *		timer;
+	char *				applied;
+	char *				saved_hostname;
+	ni_bool_t			saved_missing;
 };
 
 static ni_updater_t			updaters[__NI_ADDRCONF_UPDATER_MAX];
@@ -122,9 +140,16 @@ static const ni_intmap_t		ni_updater_kind_names[] = {
 	{ "hostname",			NI_ADDRCONF_UPDATER_HOSTNAME	},
 	{ "resolver",			NI_ADDRCONF_UPDATER_RESOLVER	},
 	{ "generic",			NI_ADDRCONF_UPDATER_GENERIC	},
+	{ "nis",			NI_ADDRCONF_UPDATER_NIS		},
 	{ NULL,				__NI_ADDRCONF_UPDATER_MAX	}
 };
 
+static const ni_intmap_t		ni_updater_backend_names[] = {
+	{ "script",			NI_ADDRCONF_UPDATER_BACKEND_SCRIPT	},
+	{ "builtin",			NI_ADDRCONF_UPDATER_BACKEND_BUILTIN	},
+	{ NULL,				-1U					}
+};
+
 static ni_bool_t			ni_system_updater_generic_batch_test(ni_updater_t *);
 
 /*
@@ -151,6 +176,21 @@ ni_updater_format_name(unsigned int format)
 	return ni_format_uint_mapped(format, ni_updater_format_names);
 }
 
+static ni_bool_t
+ni_updater_backend_type(const char *backend, int *type)
+{
+	unsigned int value;
+
+	if (ni_string_empty(backend)) {
+		*type = NI_ADDRCONF_UPDATER_BACKEND_SCRIPT;
+		return TRUE;
+	}
+	if (ni_parse_uint_mapped(backend, ni_updater_backend_names, &value))
+		return FALSE;
+	*type = value;
+	return TRUE;
+}
+
 static ni_updater_source_t *
 ni_updater_source_new(void)
 {
@@ -184,6 +224,9 @@ ni_updater_source_free(ni_updater_source_t *src)
 
 		if (src->refcount == 0) {
 			ni_netdev_ref_destroy(&src->device);
+			ni_string_free(&src->hostname);
+			ni_resolver_info_free(&src->resolver);
+			ni_nis_info_free(&src->nis);
 			free(src);
 		}
 	}
@@ -278,7 +321,7 @@ ni_updater_sources_remove_match(ni_updater_source_array_t *usa,
  * Add this lease to the given updater, to record that we can use the
  * information from this lease.
  */
-static void
+static ni_updater_source_t *
 ni_updater_sources_update_match(ni_updater_source_array_t *usa,
 				const ni_netdev_ref_t *device,
 				const ni_addrconf_lease_t *lease)
@@ -286,7 +329,7 @@ ni_updater_sources_update_match(ni_updater_source_array_t *usa,
 	ni_updater_source_t *src;
 
 	if (!usa || !device || !lease)
-		return;
+		return NULL;
 
 	if ((src = ni_updater_sources_remove_match(usa, device, lease)))
 		ni_updater_source_free(src);
@@ -295,11 +338,13 @@ ni_updater_sources_update_match(ni_updater_source_array_t *usa,
 	if (src) {
 		src->lease.type = lease->type;
 		src->lease.family = lease->family;
-		if (!ni_netdev_ref_set(&src->device, device->name, device->index))
+		if (!ni_netdev_ref_set(&src->device, device->name, device->index)) {
 			ni_updater_source_free(src);
-		else
+			src = NULL;
+		} else
 			ni_updater_source_array_append(usa, src);
 	}
+	return src;
 }
 
 static inline void
@@ -589,6 +634,27 @@ ni_system_updaters_init(void)
 
 		updater->enabled = TRUE;
 		updater->format = ni_updater_format_type(ex->format);
+		if (!ni_updater_backend_type(ex->backend, &updater->backend)) {
+			ni_warn("system-updater %s configured with unknown backend '%s'",
+					name, ex->backend);
+			updater->enabled = FALSE;
+			continue;
+		}
+		if (updater->backend == NI_ADDRCONF_UPDATER_BACKEND_BUILTIN) {
+			if (kind == NI_ADDRCONF_UPDATER_GENERIC) {
+				ni_warn("system-updater %s configured, but does not support a builtin backend",
+						name);
+				updater->enabled = FALSE;
+			}
+			continue;
+		}
+		if (kind == NI_ADDRCONF_UPDATER_NIS) {
+			ni_warn("system-updater %s configured, but supports the builtin backend only",
+					name);
+			updater->enabled = FALSE;
+			continue;
+		}
+
 		updater->proc_backup = ni_extension_script_find(ex, "backup");
 		updater->proc_restore = ni_extension_script_find(ex, "restore");
 		updater->proc_install = ni_extension_script_find(ex, "install");
@@ -651,6 +717,11 @@ can_update_type(const ni_addrconf_lease_t *lease, unsigned int kind)
 			can = lease->resolver ? TRUE : FALSE;
 		break;
 
+	case NI_ADDRCONF_UPDATER_NIS:
+		if (__ni_addrconf_should_update(lease->update, NI_ADDRCONF_UPDATE_NIS))
+			can = lease->nis ? TRUE : FALSE;
+		break;
+
 	case NI_ADDRCONF_UPDATER_GENERIC:
 		/* Always attempt generic update. */
 		can = TRUE;
@@ -1634,6 +1705,430 @@ ni_system_updater_hostname_remove_wait(ni_updater_t *updater, ni_updater_job_t *
 	return ret;
 }
 
+/*
+ * Builtin updater specific calls
+ *
+ * The builtin backend keeps the settings of all installed leases in the
+ * updater sources and applies their merged result in-process, without
+ * running any scripts. Changes are collected for a short delay and then
+ * applied at once, using atomic file replacement. An unchanged result is
+ * not applied again. A file which is a symlink belongs to another service
+ * (e.g. a local resolver) and is left alone: replacing it would break the
+ * link, writing through it would modify the other service's file.
+ */
+static ni_updater_source_t *
+ni_updater_sources_find_match(ni_updater_source_array_t *usa,
+				const ni_netdev_ref_t *device,
+				const ni_addrconf_lease_t *lease)
+{
+	ni_updater_source_t *ptr;
+	unsigned int i;
+
+	for (i = 0; i < usa->count; ++i) {
+		ptr = usa->data[i];
+		if (ptr &&
+		    ptr->device.index == device->index &&
+		    ptr->lease.family == lease->family &&
+		    ptr->lease.type   == lease->type)
+			return ptr;
+	}
+	return NULL;
+}
+
+static void
+ni_updater_string_array_merge(ni_string_array_t *dst, const ni_string_array_t *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < src->count; ++i) {
+		if (ni_string_array_index(dst, src->data[i]) == -1)
+			ni_string_array_append(dst, src->data[i]);
+	}
+}
+
+static void
+ni_updater_resolver_info_merge(ni_resolver_info_t *dst, const ni_resolver_info_t *src)
+{
+	if (ni_string_empty(dst->default_domain) && !ni_string_empty(src->default_domain))
+		ni_string_dup(&dst->default_domain, src->default_domain);
+
+	ni_updater_string_array_merge(&dst->dns_servers, &src->dns_servers);
+	ni_updater_string_array_merge(&dst->dns_search, &src->dns_search);
+}
+
+static void
+ni_updater_nis_info_merge(ni_nis_info_t *dst, const ni_nis_info_t *src)
+{
+	const ni_nis_domain_t *sd;
+	ni_nis_domain_t *dd;
+	unsigned int i;
+
+	if (ni_string_empty(dst->domainname) && !ni_string_empty(src->domainname))
+		ni_string_dup(&dst->domainname, src->domainname);
+
+	ni_updater_string_array_merge(&dst->default_servers, &src->default_servers);
+
+	for (i = 0; i < src->domains.count; ++i) {
+		sd = src->domains.data[i];
+		if (!(dd = ni_nis_domain_find(dst, sd->domainname))) {
+			if (!(dd = ni_nis_domain_new(dst, sd->domainname)))
+				continue;
+			dd->binding = sd->binding;
+		}
+		ni_updater_string_array_merge(&dd->servers, &sd->servers);
+	}
+}
+
+static void
+ni_system_updater_builtin_merge(ni_updater_t *updater, ni_stringbuf_t *state,
+		const char **hostname, ni_resolver_info_t *resolver, ni_nis_info_t *nis)
+{
+	const ni_updater_source_t *src;
+	const ni_nis_domain_t *dom;
+	unsigned int i, j;
+
+	for (i = 0; i < updater->sources.count; ++i) {
+		src = updater->sources.data[i];
+
+		switch (updater->kind) {
+		case NI_ADDRCONF_UPDATER_HOSTNAME:
+			if (!*hostname && !ni_string_empty(src->hostname))
+				*hostname = src->hostname;
+			break;
+		case NI_ADDRCONF_UPDATER_RESOLVER:
+			ni_updater_resolver_info_merge(resolver, &src->resolver);
+			break;
+		case NI_ADDRCONF_UPDATER_NIS:
+			if (i == 0)
+				nis->default_binding = src->nis.default_binding;
+			ni_updater_nis_info_merge(nis, &src->nis);
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* a text form of the result to detect changes */
+	switch (updater->kind) {
+	case NI_ADDRCONF_UPDATER_HOSTNAME:
+		ni_stringbuf_printf(state, "hostname %s\n", *hostname ?: "");
+		break;
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		ni_stringbuf_printf(state, "domain %s\n", resolver->default_domain ?: "");
+		for (i = 0; i < resolver->dns_servers.count; ++i)
+			ni_stringbuf_printf(state, "nameserver %s\n", resolver->dns_servers.data[i]);
+		for (i = 0; i < resolver->dns_search.count; ++i)
+			ni_stringbuf_printf(state, "search %s\n", resolver->dns_search.data[i]);
+		break;
+	case NI_ADDRCONF_UPDATER_NIS:
+		ni_stringbuf_printf(state, "domain %s %s\n", nis->domainname ?: "",
+				ni_nis_binding_type_to_name(nis->default_binding));
+		for (i = 0; i < nis->default_servers.count; ++i)
+			ni_stringbuf_printf(state, "ypserver %s\n", nis->default_servers.data[i]);
+		for (i = 0; i < nis->domains.count; ++i) {
+			dom = nis->domains.data[i];
+			ni_stringbuf_printf(state, "domain %s %s\n", dom->domainname,
+					ni_nis_binding_type_to_name(dom->binding));
+			for (j = 0; j < dom->servers.count; ++j)
+				ni_stringbuf_printf(state, "domain %s server %s\n",
+						dom->domainname, dom->servers.data[j]);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static const char *
+ni_system_updater_builtin_symlink(const ni_updater_t *updater)
+{
+	const char *path;
+	struct stat stb;
+
+	switch (updater->kind) {
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		path = _PATH_RESOLV_CONF;
+		break;
+	case NI_ADDRCONF_UPDATER_NIS:
+		path = NI_PATH_YP_CONF;
+		break;
+	default:
+		return NULL;
+	}
+
+	if (lstat(path, &stb) == 0 && S_ISLNK(stb.st_mode))
+		return path;
+	return NULL;
+}
+
+static int
+ni_system_updater_builtin_backup(ni_updater_t *updater)
+{
+	char buffer[256] = {'\0'};
+
+	/* when there is no file yet, the one we create is removed on restore */
+	updater->saved_missing = FALSE;
+
+	switch (updater->kind) {
+	case NI_ADDRCONF_UPDATER_HOSTNAME:
+		if (__ni_system_hostname_get(buffer, sizeof(buffer)) < 0)
+			return -1;
+		ni_string_dup(&updater->saved_hostname, buffer);
+		return 0;
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		if (!ni_file_exists(_PATH_RESOLV_CONF)) {
+			updater->saved_missing = TRUE;
+			return 0;
+		}
+		return __ni_system_resolver_backup();
+	case NI_ADDRCONF_UPDATER_NIS:
+		if (!ni_file_exists(NI_PATH_YP_CONF)) {
+			updater->saved_missing = TRUE;
+			return 0;
+		}
+		return __ni_system_nis_backup();
+	default:
+		return -1;
+	}
+}
+
+static int
+ni_system_updater_builtin_restore(ni_updater_t *updater)
+{
+	int ret = -1;
+
+	switch (updater->kind) {
+	case NI_ADDRCONF_UPDATER_HOSTNAME:
+		if (!ni_string_empty(updater->saved_hostname))
+			ret = __ni_system_hostname_put(updater->saved_hostname);
+		ni_string_free(&updater->saved_hostname);
+		break;
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		if (updater->saved_missing)
+			ret = unlink(_PATH_RESOLV_CONF);
+		else
+			ret = __ni_system_resolver_restore();
+		break;
+	case NI_ADDRCONF_UPDATER_NIS:
+		if (updater->saved_missing) {
+			__ni_system_nis_domain_put(NULL);
+			ret = unlink(NI_PATH_YP_CONF);
+		} else
+			ret = __ni_system_nis_restore();
+		break;
+	default:
+		break;
+	}
+	updater->saved_missing = FALSE;
+	return ret;
+}
+
+static int
+ni_system_updater_builtin_install(ni_updater_t *updater, const char *hostname,
+		const ni_resolver_info_t *resolver, const ni_nis_info_t *nis)
+{
+	switch (updater->kind) {
+	case NI_ADDRCONF_UPDATER_HOSTNAME:
+		if (ni_string_empty(hostname))
+			return 0;
+		return __ni_system_hostname_put(hostname);
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		return __ni_system_resolver_put(resolver);
+	case NI_ADDRCONF_UPDATER_NIS:
+		return __ni_system_nis_put(nis);
+	default:
+		return -1;
+	}
+}
+
+static void
+ni_system_updater_builtin_apply(ni_updater_t *updater)
+{
+	ni_stringbuf_t state = NI_STRINGBUF_INIT_DYNAMIC;
+	const char *name = ni_updater_name(updater->kind);
+	const char *hostname = NULL;
+	const char *link;
+	ni_resolver_info_t resolver;
+	ni_nis_info_t nis;
+
+	memset(&resolver, 0, sizeof(resolver));
+	memset(&nis, 0, sizeof(nis));
+
+	if ((link = ni_system_updater_builtin_symlink(updater))) {
+		ni_warn("builtin %s updater: %s is a symlink, not modifying it",
+				name, link);
+		ni_string_free(&updater->applied);
+		goto done;
+	}
+
+	if (!updater->sources.count) {
+		if (updater->have_backup) {
+			ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+					"builtin %s updater: restoring backup", name);
+			if (ni_system_updater_builtin_restore(updater) < 0)
+				ni_warn("builtin %s updater: unable to restore backup", name);
+			updater->have_backup = 0;
+		}
+		ni_string_free(&updater->applied);
+		goto done;
+	}
+
+	ni_system_updater_builtin_merge(updater, &state, &hostname, &resolver, &nis);
+	if (updater->applied && ni_string_eq(updater->applied, state.string)) {
+		ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+				"builtin %s updater: settings of %u lease(s) unchanged",
+				name, updater->sources.count);
+		goto done;
+	}
+
+	if (!updater->have_backup) {
+		if (ni_system_updater_builtin_backup(updater) == 0)
+			updater->have_backup = 1;
+		else
+			ni_warn("builtin %s updater: unable to backup current settings", name);
+	}
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+			"builtin %s updater: applying settings of %u lease(s)",
+			name, updater->sources.count);
+	if (ni_system_updater_builtin_install(updater, hostname, &resolver, &nis) < 0) {
+		ni_error("builtin %s updater: unable to apply settings: %m", name);
+		ni_string_free(&updater->applied);
+	} else {
+		ni_string_dup(&updater->applied, state.string);
+	}
+
+done:
+	ni_stringbuf_destroy(&state);
+	ni_resolver_info_free(&resolver);
+	ni_nis_info_free(&nis);
+
+	if (ni_global.other_event) {
+		switch (updater->kind) {
+		case NI_ADDRCONF_UPDATER_HOSTNAME:
+			ni_global.other_event(NI_EVENT_HOSTNAME_UPDATED);
+			break;
+		case NI_ADDRCONF_UPDATER_RESOLVER:
+			ni_global.other_event(NI_EVENT_RESOLVER_UPDATED);
+			break;
+		default:
+			ni_global.other_event(NI_EVENT_GENERIC_UPDATED);
+			break;
+		}
+	}
+}
+
+static void
+ni_system_updater_builtin_timeout(void *user_data, const ni_timer_t *timer)
+{
+	ni_updater_t *updater = user_data;
+
+	if (!updater || updater->timer != timer)
+		return;
+
+	updater->timer = NULL;
+	ni_system_updater_builtin_apply(updater);
+}
+
+static void
+ni_system_updater_builtin_schedule(ni_updater_t *updater)
+{
+	if (updater->timer)
+		return;
+
+	updater->timer = ni_timer_register(NI_UPDATER_BUILTIN_DELAY,
+				ni_system_updater_builtin_timeout, updater);
+}
+
+static int
+ni_system_updater_builtin_install_call(ni_updater_t *updater, ni_updater_job_t *job)
+{
+	ni_updater_source_t *src;
+	ni_nis_domain_t *dom;
+	unsigned int i;
+
+	job->result = 0;
+
+	/* keep the position of known leases, so renewals do not reorder */
+	src = ni_updater_sources_find_match(&updater->sources, &job->device, job->lease);
+	if (src)
+		ni_netdev_ref_set(&src->device, job->device.name, job->device.index);
+	else
+	if (!(src = ni_updater_sources_update_match(&updater->sources, &job->device, job->lease)))
+		return -1;
+
+	ni_string_free(&src->hostname);
+	ni_resolver_info_free(&src->resolver);
+	ni_nis_info_free(&src->nis);
+
+	switch (updater->kind) {
+	case NI_ADDRCONF_UPDATER_HOSTNAME:
+		ni_string_dup(&src->hostname, job->hostname);
+		break;
+
+	case NI_ADDRCONF_UPDATER_RESOLVER:
+		if (!job->lease->resolver)
+			break;
+		ni_string_dup(&src->resolver.default_domain, job->lease->resolver->default_domain);
+		ni_string_array_copy(&src->resolver.dns_servers, &job->lease->resolver->dns_servers);
+		ni_string_array_copy(&src->resolver.dns_search, &job->lease->resolver->dns_search);
+		break;
+
+	case NI_ADDRCONF_UPDATER_NIS:
+		if (!job->lease->nis)
+			break;
+		ni_string_dup(&src->nis.domainname, job->lease->nis->domainname);
+		src->nis.default_binding = job->lease->nis->default_binding;
+		ni_string_array_copy(&src->nis.default_servers, &job->lease->nis->default_servers);
+		for (i = 0; i < job->lease->nis->domains.count; ++i) {
+			const ni_nis_domain_t *sd = job->lease->nis->domains.data[i];
+
+			if (!(dom = ni_nis_domain_new(&src->nis, sd->domainname)))
+				continue;
+			dom->binding = sd->binding;
+			ni_string_array_copy(&dom->servers, &sd->servers);
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+			"%s: scheduled builtin %s updater for lease %s:%s in state %s",
+			job->device.name, ni_updater_name(updater->kind),
+			ni_addrfamily_type_to_name(job->lease->family),
+			ni_addrconf_type_to_name(job->lease->type),
+			ni_addrconf_state_to_name(job->lease->state));
+
+	ni_system_updater_builtin_schedule(updater);
+	return 0;
+}
+
+static int
+ni_system_updater_builtin_remove_call(ni_updater_t *updater, ni_updater_job_t *job)
+{
+	ni_updater_source_t *src;
+
+	job->result = 0;
+
+	/* Call remove action only, when we applied it */
+	src = ni_updater_sources_remove_match(&updater->sources, &job->device, job->lease);
+	if (!src)
+		return 0;
+	ni_updater_source_free(src);
+
+	ni_debug_verbose(NI_LOG_DEBUG1, NI_TRACE_EXTENSION,
+			"%s: scheduled builtin %s updater removal for lease %s:%s in state %s",
+			job->device.name, ni_updater_name(updater->kind),
+			ni_addrfamily_type_to_name(job->lease->family),
+			ni_addrconf_type_to_name(job->lease->type),
+			ni_addrconf_state_to_name(job->lease->state));
+
+	ni_system_updater_builtin_schedule(updater);
+	return 0;
+}
+
 static const ni_updater_action_t	system_updater_generic_install[] = {
 	{ ni_system_updater_generic_cleanup_call	},
 	{ ni_system_updater_generic_cleanup_wait	},
@@ -1687,9 +2182,44 @@ static const ni_updater_action_t	system_updater_hostname_removal[] = {
 	{ NULL }
 };
 
+static const ni_updater_action_t	system_updater_builtin_install[] = {
+	{ ni_system_updater_builtin_install_call	},
+	{ NULL }
+};
+static const ni_updater_action_t	system_updater_builtin_removal[] = {
+	{ ni_system_updater_builtin_remove_call		},
+	{ NULL }
+};
+
+static const ni_updater_action_t	system_updater_builtin_hostname_install[] = {
+	{ ni_system_updater_hostname_lookup_call	},
+	{ ni_system_updater_hostname_lookup_wait	},
+	{ ni_system_updater_builtin_install_call	},
+	{ NULL }
+};
+
+static const ni_updater_action_t *
+system_updater_builtin_action_table(unsigned int kind, ni_updater_job_flow_t flow)
+{
+	switch (flow) {
+	case NI_UPDATER_FLOW_INSTALL:
+		if (kind == NI_ADDRCONF_UPDATER_HOSTNAME)
+			return system_updater_builtin_hostname_install;
+		return system_updater_builtin_install;
+	case NI_UPDATER_FLOW_REMOVAL:
+		return system_updater_builtin_removal;
+	default:
+		return NULL;
+	}
+}
+
 static const ni_updater_action_t *
 system_updater_action_table(unsigned int kind, ni_updater_job_flow_t flow)
 {
+	if (kind < __NI_ADDRCONF_UPDATER_MAX &&
+	    updaters[kind].backend == NI_ADDRCONF_UPDATER_BACKEND_BUILTIN)
+		return system_updater_builtin_action_table(kind, flow);
+
 	switch (kind) {
 	case NI_ADDRCONF_UPDATER_GENERIC:
 		switch (flow) {
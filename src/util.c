@@ -3297,6 +3297,164 @@ xstrdup(const char *string)
 	return p;
 }
 
+/*
+ * FNV-1a hash, used by in-memory lookup tables
+ */
+#define NI_HASH_FNV_OFFSET	2166136261U
+#define NI_HASH_FNV_PRIME	16777619U
+
+unsigned int
+ni_hash_data(const void *data, size_t len)
+{
+	const unsigned char *ptr = data;
+	unsigned int hash = NI_HASH_FNV_OFFSET;
+
+	while (ptr && len--) {
+		hash ^= *ptr++;
+		hash *= NI_HASH_FNV_PRIME;
+	}
+	return hash;
+}
+
+unsigned int
+ni_hash_string(const char *str)
+{
+	unsigned int hash = NI_HASH_FNV_OFFSET;
+
+	while (str && *str) {
+		hash ^= (unsigned char)*str++;
+		hash *= NI_HASH_FNV_PRIME;
+	}
+	return hash;
+}
+
+unsigned int
+ni_hash_uint(unsigned int value)
+{
+	/* Knuth's multiplicative hash, spreads sequential values */
+	return value * 2654435761U;
+}
+
+#define NI_HASH_TABLE_MIN_SIZE	16U
+
+static void
+ni_hash_table_resize(ni_hash_table_t *table, unsigned int size)
+{
+	struct ni_hash_table_slot *slots, *slot;
+	unsigned int i, pos;
+
+	slots = xcalloc(size, sizeof(*slots));
+
+	for (i = 0; i < table->size; ++i) {
+		slot = &table->slots[i];
+		if (!slot->data)
+			continue;
+
+		pos = slot->hash & (size - 1);
+		while (slots[pos].data)
+			pos = (pos + 1) & (size - 1);
+		slots[pos] = *slot;
+	}
+
+	free(table->slots);
+	table->slots = slots;
+	table->size = size;
+}
+
+ni_bool_t
+ni_hash_table_insert(ni_hash_table_t *table, unsigned int hash, const void *data)
+{
+	unsigned int pos;
+
+	if (!table || !data)
+		return FALSE;
+
+	/* keep the load factor below 1/2 */
+	if ((table->count + 1) * 2 > table->size) {
+		unsigned int size = table->size ? table->size : NI_HASH_TABLE_MIN_SIZE;
+
+		while ((table->count + 1) * 2 > size) {
+			if (size > UINT_MAX / 2)
+				return FALSE;
+			size *= 2;
+		}
+		ni_hash_table_resize(table, size);
+	}
+
+	pos = hash & (table->size - 1);
+	while (table->slots[pos].data)
+		pos = (pos + 1) & (table->size - 1);
+
+	table->slots[pos].hash = hash;
+	table->slots[pos].data = data;
+	table->count++;
+	return TRUE;
+}
+
+void *
+ni_hash_table_find(const ni_hash_table_t *table, unsigned int hash,
+			ni_hash_table_match_fn_t *match, const void *key)
+{
+	const struct ni_hash_table_slot *slot;
+	unsigned int pos;
+
+	if (!table || !table->count || !match)
+		return NULL;
+
+	pos = hash & (table->size - 1);
+	while ((slot = &table->slots[pos])->data) {
+		if (slot->hash == hash && match(slot->data, key))
+			return (void *)slot->data;
+		pos = (pos + 1) & (table->size - 1);
+	}
+	return NULL;
+}
+
+ni_bool_t
+ni_hash_table_remove(ni_hash_table_t *table, unsigned int hash, const void *data)
+{
+	unsigned int mask, pos, next, home;
+
+	if (!table || !table->count || !data)
+		return FALSE;
+
+	mask = table->size - 1;
+	pos = hash & mask;
+	while (table->slots[pos].data != data) {
+		if (!table->slots[pos].data)
+			return FALSE;
+		pos = (pos + 1) & mask;
+	}
+
+	/*
+	 * Close the gap: move back each following entry of the cluster,
+	 * which is not between the gap and its own slot in probe order.
+	 */
+	for (next = (pos + 1) & mask; table->slots[next].data; next = (next + 1) & mask) {
+		home = table->slots[next].hash & mask;
+		if (((next - home) & mask) >= ((next - pos) & mask)) {
+			table->slots[pos] = table->slots[next];
+			pos = next;
+		}
+	}
+
+	table->slots[pos].hash = 0;
+	table->slots[pos].data = NULL;
+	table->count--;
+	return TRUE;
+}
+
+void
+ni_hash_table_destroy(ni_hash_table_t *table)
+{
+	if (table) {
+		free(table->slots);
+		table->slots = NULL;
+		table->size = 0;
+		table->count = 0;
+	}
+}
+
 ni_bool_t
 ni_uint_in_range(const ni_uint_range_t *range, const unsigned int value)
 {
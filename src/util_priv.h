@@ -14,6 +14,37 @@ extern void *	xrealloc(void *, size_t);
 
 extern char *	xstrdup(const char *);
 
+/*
+ * Non-cryptographic hash functions for in-memory lookup tables
+ */
+extern unsigned int	ni_hash_data(const void *, size_t);
+extern unsigned int	ni_hash_string(const char *);
+extern unsigned int	ni_hash_uint(unsigned int);
+
+/*
+ * Open addressing hash table of object references, e.g. to match the
+ * entries of two lists in linear instead of quadratic time or to index
+ * objects by name. The hash has to be consistent with the match function.
+ */
+typedef struct ni_hash_table {
+	unsigned int		size;
+	unsigned int		count;
+	struct ni_hash_table_slot {
+		unsigned int	hash;
+		const void *	data;
+	} *			slots;
+} ni_hash_table_t;
+
+typedef ni_bool_t		ni_hash_table_match_fn_t(const void *, const void *);
+
+#define NI_HASH_TABLE_INIT	{ .size = 0, .count = 0, .slots = NULL }
+
+extern ni_bool_t	ni_hash_table_insert(ni_hash_table_t *, unsigned int, const void *);
+extern void *		ni_hash_table_find(const ni_hash_table_t *, unsigned int,
+					ni_hash_table_match_fn_t *, const void *);
+extern ni_bool_t	ni_hash_table_remove(ni_hash_table_t *, unsigned int, const void *);
+extern void		ni_hash_table_destroy(ni_hash_table_t *);
+
 #endif /* __WICKED_UTIL_PRIV_H__ */
 
 
@@ -26,10 +26,16 @@
 #endif
 
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include <wicked/xml.h>
 #include <wicked/logging.h>
+#include "util_priv.h"
+#include "xml_priv.h"
 #include "buffer.h"
 
 #undef XMLDEBUG_PARSER
@@ -52,44 +58,67 @@ typedef enum {
 	Comment,
 } xml_token_type_t;
 
-#define XML_READER_BUFSZ	512
+/*
+ * The reader scans the whole document in one buffer: the mapped file,
+ * the stream contents read at once or the data of the input ni_buffer.
+ * Tokens refer to the buffer, only the (interned) names, the attribute
+ * values and the cdata are copied into the document arena the nodes
+ * are allocated from.
+ */
+#define XML_READER_BUFSZ	4096
+#define XML_READER_ATTRS_CHUNK	8
+
+typedef struct xml_token_value {
+	const char *		string;		/* not NUL terminated, except CData */
+	size_t			len;
+} xml_token_value_t;
+
 typedef struct xml_reader {
 	const char *		filename;
 
 	ni_buffer_t *		in_buffer;
 
 	FILE *			file;
-	unsigned char *		buffer;		/* FIXME: use in_buffer for this as well */
+	char *			buffer;
+	void *			mapped;
+	size_t			mapped_len;
 
 	unsigned int		no_close : 1;
 
 	char *			doctype;
 
-	/* This pointer must be unsigned char, else 0xFF would
-	 * be expanded to EOF */
-	unsigned char *		pos;
+	const char *		data;
+	const char *		pos;
+	const char *		end;
 
 	xml_parser_state_t	state;
 	unsigned int		lineCount;
 
 	struct xml_location_shared *shared_location;
+
+	xml_arena_t *		arena;
+	ni_hash_table_t		names;
+	ni_var_t *		attrs;
+	unsigned int		attrs_size;
 } xml_reader_t;
 
 static xml_document_t *	xml_process_document(xml_reader_t *);
 static ni_bool_t	xml_process_element_nested(xml_reader_t *, xml_node_t *, unsigned int);
-static ni_bool_t	xml_get_identifier(xml_reader_t *, ni_stringbuf_t *);
-static xml_token_type_t	xml_get_token(xml_reader_t *, ni_stringbuf_t *);
-static xml_token_type_t	xml_get_token_initial(xml_reader_t *, ni_stringbuf_t *);
-static xml_token_type_t	xml_get_token_tag(xml_reader_t *, ni_stringbuf_t *);
+static ni_bool_t	xml_get_identifier(xml_reader_t *, xml_token_value_t *);
+static xml_token_type_t	xml_get_token(xml_reader_t *, xml_token_value_t *);
+static xml_token_type_t	xml_get_token_initial(xml_reader_t *, xml_token_value_t *);
+static xml_token_type_t	xml_get_token_cdata(xml_reader_t *, const char *, xml_token_value_t *);
+static xml_token_type_t	xml_get_token_tag(xml_reader_t *, xml_token_value_t *);
 static xml_token_type_t	xml_skip_comment(xml_reader_t *);
 static xml_token_type_t	xml_get_tag_attributes(xml_reader_t *, xml_node_t *);
-static ni_bool_t	xml_expand_entity(xml_reader_t *, ni_stringbuf_t *);
-static void		xml_skip_space(xml_reader_t *, ni_stringbuf_t *);
+static ni_bool_t	xml_expand_entity(xml_reader_t *, char **);
+static void		xml_skip_space(xml_reader_t *);
 static void		xml_parse_error(xml_reader_t *, const char *, ...);
-static const char *	xml_parser_state_name(xml_parser_state_t);
 static const char *	xml_token_name(xml_token_type_t token);
 
 static xml_location_t *	xml_location_new(struct xml_location_shared *, unsigned int);
+static inline struct xml_location_shared *	xml_location_shared_hold(struct xml_location_shared *);
+static inline void	xml_location_shared_release(struct xml_location_shared *);
 
 #ifdef XMLDEBUG_PARSER
 static void		xml_debug(const char *, ...);
@@ -101,8 +130,103 @@ static int		xml_reader_init_file(xml_reader_t *xr, FILE *fp, const char *locatio
 static int		xml_reader_init_buffer(xml_reader_t *xr, ni_buffer_t *buf, const char *location);
 static int		xml_reader_open(xml_reader_t *xr, const char *filename);
 static int		xml_reader_destroy(xml_reader_t *xr);
-static int		xml_getc(xml_reader_t *xr);
-static void		xml_ungetc(xml_reader_t *xr, int cc);
+
+/*
+ * Input scanning
+ */
+static inline int
+xml_peekc(const xml_reader_t *xr)
+{
+	/* Return unsigned char, else 0xFF would be expanded to EOF */
+	if (xr->pos < xr->end)
+		return (unsigned char) *xr->pos;
+	return EOF;
+}
+
+static inline int
+xml_getc(xml_reader_t *xr)
+{
+	int cc;
+
+	if (xr->pos >= xr->end)
+		return EOF;
+
+	cc = (unsigned char) *xr->pos++;
+	if (cc == '\n')
+		xr->lineCount++;
+	return cc;
+}
+
+static inline void
+xml_advance(xml_reader_t *xr, const char *to)
+{
+	const char *nl;
+
+	while ((nl = memchr(xr->pos, '\n', to - xr->pos)) != NULL) {
+		xr->lineCount++;
+		xr->pos = nl + 1;
+	}
+	xr->pos = to;
+}
+
+static inline ni_bool_t
+xml_token_eq(const xml_token_value_t *token, const char *string)
+{
+	return string && strlen(string) == token->len &&
+		!memcmp(token->string, string, token->len);
+}
+
+/*
+ * Element and attribute names are interned in the document arena
+ */
+static ni_bool_t
+xml_reader_name_match(const void *name, const void *key)
+{
+	const xml_token_value_t *ident = key;
+
+	return !strncmp(name, ident->string, ident->len) &&
+		((const char *) name)[ident->len] == '\0';
+}
+
+static const char *
+xml_reader_intern(xml_reader_t *xr, const xml_token_value_t *ident)
+{
+	unsigned int hash = ni_hash_data(ident->string, ident->len);
+	char *name;
+
+	name = ni_hash_table_find(&xr->names, hash, xml_reader_name_match, ident);
+	if (name == NULL) {
+		name = xml_arena_strndup(xr->arena, ident->string, ident->len);
+		ni_hash_table_insert(&xr->names, hash, name);
+	}
+	return name;
+}
+
+static xml_node_t *
+xml_reader_node_new(xml_reader_t *xr, const xml_token_value_t *ident)
+{
+	xml_location_t *location;
+	xml_node_t *node;
+
+	node = xml_arena_node_new(xr->arena, xml_reader_intern(xr, ident));
+	if (xr->shared_location) {
+		location = xml_arena_alloc(xr->arena, sizeof(*location));
+		location->shared = xml_location_shared_hold(xr->shared_location);
+		location->line = xr->lineCount;
+		node->location = location;
+	}
+	return node;
+}
+
+static void
+xml_reader_set_cdata(xml_reader_t *xr, xml_node_t *node, char *cdata)
+{
+	/* The document root is not allocated from the arena */
+	if (node->arena == xr->arena)
+		node->cdata = cdata;
+	else
+		xml_node_set_cdata(node, cdata);
+}
 
 /*
  * Document reader implementation
@@ -200,17 +324,19 @@ xml_node_t *
 xml_node_scan(FILE *fp, const char *location)
 {
 	xml_reader_t reader;
-	xml_node_t *root = xml_node_new(NULL, NULL);
+	xml_node_t *root;
 
 	if (xml_reader_init_file(&reader, fp, location) < 0)
 		return NULL;
 
+	root = xml_node_new(NULL, NULL);
 	if (reader.shared_location)
 		root->location = xml_location_new(reader.shared_location, reader.lineCount);
 
 	/* Note! We do not deal with properly formatted XML documents here.
 	 * Specifically, we do not expect them to have a document header. */
 	if (!xml_process_element_nested(&reader, root, 0)) {
+		xml_reader_destroy(&reader);
 		xml_node_free(root);
 		return NULL;
 	}
@@ -238,18 +364,18 @@ xml_process_pi_node(xml_reader_t *xr, xml_node_t *pi)
 			   and make sure we process all input that way. */
 		}
 	}
-		
 }
 
 ni_bool_t
 xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesting)
 {
-	ni_stringbuf_t tokenValue, identifier;
+	xml_token_value_t tokenValue, identifier;
 	xml_token_type_t token;
-	xml_node_t *child;
+	xml_node_t *child, **tail;
 
-	ni_stringbuf_init(&tokenValue);
-	ni_stringbuf_init(&identifier);
+	/* Append new children without walking the list each time */
+	for (tail = &cur->children; *tail; tail = &(*tail)->next)
+		;
 
 	while (1) {
 		token = xml_get_token(xr, &tokenValue);
@@ -257,7 +383,7 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 		switch (token) {
 		case CData:
 			/* process element content */
-			xml_node_set_cdata(cur, tokenValue.string);
+			xml_reader_set_cdata(xr, cur, (char *) tokenValue.string);
 			break;
 
 		case LeftAngleExclam:
@@ -267,8 +393,9 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 				goto error;
 			}
 
-			if (strcmp(identifier.string, "DOCTYPE")) {
-				xml_parse_error(xr, "Unexpected element: <!%s ...> not supported", identifier.string);
+			if (!xml_token_eq(&identifier, "DOCTYPE")) {
+				xml_parse_error(xr, "Unexpected element: <!%.*s ...> not supported",
+						(int) identifier.len, identifier.string);
 				goto error;
 			}
 
@@ -277,7 +404,8 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 				if (token == RightAngle)
 					break;
 				if (token == Identifier && !xr->doctype)
-					ni_string_dup(&xr->doctype, identifier.string);
+					xr->doctype = xml_arena_strndup(xr->arena,
+							identifier.string, identifier.len);
 				if (token != Identifier && token != QuotedString) {
 					xml_parse_error(xr, "Error parsing <!DOCTYPE ...> attributes");
 					goto error;
@@ -292,9 +420,10 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 				goto error;
 			}
 
-			child = xml_node_new(identifier.string, cur);
-			if (xr->shared_location)
-				child->location = xml_location_new(xr->shared_location, xr->lineCount);
+			child = xml_reader_node_new(xr, &identifier);
+			child->parent = cur;
+			*tail = child;
+			tail = &child->next;
 
 			token = xml_get_tag_attributes(xr, child);
 			if (token == None) {
@@ -325,22 +454,24 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 			}
 
 			if (xml_get_token(xr, &tokenValue) != RightAngle) {
-				xml_parse_error(xr, "Bad element: </%s - missing tag close", identifier.string);
+				xml_parse_error(xr, "Bad element: </%.*s - missing tag close",
+						(int) identifier.len, identifier.string);
 				goto error;
 			}
 
 			if (cur->parent == NULL) {
-				xml_parse_error(xr, "Unexpected </%s> tag", identifier.string);
+				xml_parse_error(xr, "Unexpected </%.*s> tag",
+						(int) identifier.len, identifier.string);
 				goto error;
 			}
-			if (strcmp(cur->name, identifier.string)) {
-				xml_parse_error(xr, "Closing tag </%s> does not match <%s>",
-						identifier.string, cur->name);
+			if (!xml_token_eq(&identifier, cur->name)) {
+				xml_parse_error(xr, "Closing tag </%.*s> does not match <%s>",
+						(int) identifier.len, identifier.string, cur->name);
 				goto error;
 			}
 
 			xml_debug("%*.*s</%s>\n", nesting, nesting, "", cur->name);
-			goto success;
+			return TRUE;
 
 		case LeftAngleQ:
 			/* New PI node starts here */
@@ -349,9 +480,7 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 				goto error;
 			}
 
-			child = xml_node_new(identifier.string, NULL);
-			if (xr->shared_location)
-				child->location = xml_location_new(xr->shared_location, xr->lineCount);
+			child = xml_reader_node_new(xr, &identifier);
 
 			token = xml_get_tag_attributes(xr, child);
 			if (token == None) {
@@ -377,7 +506,7 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 				xml_parse_error(xr, "End of document while processing element <%s>", cur->name);
 				goto error;
 			}
-			goto success;
+			return TRUE;
 
 		case None:
 			/* parser error */
@@ -389,32 +518,54 @@ xml_process_element_nested(xml_reader_t *xr, xml_node_t *cur, unsigned int nesti
 		}
 	}
 
-success:
-	ni_stringbuf_destroy(&tokenValue);
-	ni_stringbuf_destroy(&identifier);
-	return TRUE;
-
 error:
-	ni_stringbuf_destroy(&tokenValue);
-	ni_stringbuf_destroy(&identifier);
 	return FALSE;
 }
 
 ni_bool_t
-xml_get_identifier(xml_reader_t *xr, ni_stringbuf_t *res)
+xml_get_identifier(xml_reader_t *xr, xml_token_value_t *res)
 {
 	return xml_get_token(xr, res) == Identifier;
 }
 
+/*
+ * Collect the tag attributes in the reader and store them in
+ * the arena once the tag is complete.
+ */
+static void
+xml_reader_add_attr(xml_reader_t *xr, unsigned int *count,
+		const xml_token_value_t *name, const xml_token_value_t *value)
+{
+	const char *attr_name = xml_reader_intern(xr, name);
+	char *attr_value = NULL;
+	unsigned int i;
+
+	if (value)
+		attr_value = xml_arena_strndup(xr->arena, value->string, value->len);
+
+	xml_debug("  attr %s=%s\n", attr_name, attr_value);
+	for (i = 0; i < *count; ++i) {
+		if (xr->attrs[i].name == attr_name) {
+			xr->attrs[i].value = attr_value;
+			return;
+		}
+	}
+
+	if (*count == xr->attrs_size) {
+		xr->attrs_size += XML_READER_ATTRS_CHUNK;
+		xr->attrs = xrealloc(xr->attrs, xr->attrs_size * sizeof(xr->attrs[0]));
+	}
+	xr->attrs[*count].name = (char *) attr_name;
+	xr->attrs[*count].value = attr_value;
+	(*count)++;
+}
+
 xml_token_type_t
 xml_get_tag_attributes(xml_reader_t *xr, xml_node_t *node)
 {
-	ni_stringbuf_t tokenValue, attrName, attrValue;
+	xml_token_value_t tokenValue, attrName;
 	xml_token_type_t token;
-
-	ni_stringbuf_init(&tokenValue);
-	ni_stringbuf_init(&attrName);
-	ni_stringbuf_init(&attrValue);
+	unsigned int count = 0;
 
 	token = xml_get_token(xr, &tokenValue);
 	while (1) {
@@ -427,11 +578,11 @@ xml_get_tag_attributes(xml_reader_t *xr, xml_node_t *node)
 			break;
 		}
 
-		ni_stringbuf_move(&attrName, &tokenValue);
+		attrName = tokenValue;
 
 		token = xml_get_token(xr, &tokenValue);
 		if (token != Equals) {
-			xml_node_add_attr(node, attrName.string, NULL);
+			xml_reader_add_attr(xr, &count, &attrName, NULL);
 			continue;
 		}
 
@@ -442,15 +593,16 @@ xml_get_tag_attributes(xml_reader_t *xr, xml_node_t *node)
 			break;
 		}
 
-		xml_debug("  attr %s=%s\n", attrName.string, tokenValue.string);
-		xml_node_add_attr(node, attrName.string, tokenValue.string);
+		xml_reader_add_attr(xr, &count, &attrName, &tokenValue);
 
 		token = xml_get_token(xr, &tokenValue);
 	}
 
-	ni_stringbuf_destroy(&tokenValue);
-	ni_stringbuf_destroy(&attrName);
-	ni_stringbuf_destroy(&attrValue);
+	if (count) {
+		node->attrs.data = xml_arena_alloc(xr->arena, count * sizeof(xr->attrs[0]));
+		memcpy(node->attrs.data, xr->attrs, count * sizeof(xr->attrs[0]));
+		node->attrs.count = count;
+	}
 	return token;
 }
 
@@ -458,14 +610,12 @@ xml_get_tag_attributes(xml_reader_t *xr, xml_node_t *node)
  * Get the next token from the XML stream
  */
 xml_token_type_t
-xml_get_token(xml_reader_t *xr, ni_stringbuf_t *res)
+xml_get_token(xml_reader_t *xr, xml_token_value_t *res)
 {
-#ifdef XMLDEBUG_PARSER
-	xml_parser_state_t old_state = xr->state;
-#endif
 	xml_token_type_t token;
 
-	ni_stringbuf_clear(res);
+	res->string = NULL;
+	res->len = 0;
 	switch (xr->state) {
 	default:
 		xml_parse_error(xr, "Unexpected state %u in XML reader", xr->state);
@@ -483,11 +633,10 @@ xml_get_token(xml_reader_t *xr, ni_stringbuf_t *res)
 		break;
 	}
 
-	xml_debug("++ %3u %-7s %-10s (%s)\n",
+	xml_debug("++ %3u %-10s (%.*s)\n",
 			xr->lineCount,
-			xml_parser_state_name(old_state),
 			xml_token_name(token),
-			res->string?: "");
+			(int) res->len, res->string ?: "");
 	return token;
 }
 
@@ -496,108 +645,142 @@ xml_get_token(xml_reader_t *xr, ni_stringbuf_t *res)
  * While in state Initial, obtain the next token
  */
 xml_token_type_t
-xml_get_token_initial(xml_reader_t *xr, ni_stringbuf_t *res)
+xml_get_token_initial(xml_reader_t *xr, xml_token_value_t *res)
 {
 	xml_token_type_t token;
+	const char *start;
 	int cc;
 
 restart:
-	/* Eat initial white space and store it in @res */
-	xml_skip_space(xr, res);
+	/* Eat initial white space, it is part of the cdata */
+	start = xr->pos;
+	xml_skip_space(xr);
 
 	cc = xml_getc(xr);
-	if (cc == EOF) {
-		ni_stringbuf_clear(res);
+	if (cc == EOF)
 		return EndOfDocument;
-	}
 
-	if (cc == '<') {
-		/* Discard the white space in @res - we're not interested in that. */
-		ni_stringbuf_clear(res);
+	if (cc != '<') {
+		/* Looks like CDATA */
+		xr->pos--;
+		return xml_get_token_cdata(xr, start, res);
+	}
 
-		ni_stringbuf_putc(res, cc);
+	/* tag is legal here */
+	res->string = xr->pos - 1;
+	xr->state = Tag;
 
-		if (xr->state != Initial) {
-			xml_parse_error(xr, "Unexpected < in XML stream (state %s)",
-					xml_parser_state_name(xr->state));
-			return None;
+	switch (xml_peekc(xr)) {
+	case '/':
+		xr->pos++;
+		res->len = 2;
+		return LeftAngleSlash;
+	case '?':
+		xr->pos++;
+		res->len = 2;
+		return LeftAngleQ;
+	case '!':
+		xr->pos++;
+		res->len = 2;
+
+		/* If it's <!IDENTIFIER, return LeftAngleExclam */
+		if (xml_peekc(xr) != '-')
+			return LeftAngleExclam;
+		xr->pos++;
+
+		token = xml_skip_comment(xr);
+		if (token == Comment) {
+			xr->state = Initial;
+			goto restart;
 		}
+		return token;
+	default:
+		break;
+	}
+	res->len = 1;
+	return LeftAngle;
+}
 
-		/* tag is legal here */
-		xr->state = Tag;
-
-		cc = xml_getc(xr);
-		switch (cc) {
-		case '/':
-			ni_stringbuf_putc(res, cc);
-			return LeftAngleSlash;
-		case '?':
-			ni_stringbuf_putc(res, cc);
-			return LeftAngleQ;
-		case '!':
-			ni_stringbuf_putc(res, cc);
-
-			/* If it's <!IDENTIFIER, return LeftAngleExclam */
-			cc = xml_getc(xr);
-			if (cc != '-') {
-				xml_ungetc(xr, cc);
-				return LeftAngleExclam;
-			}
+/*
+ * Copy the cdata up to the next < into the arena, expand entities
+ * and trim the empty lines as ni_stringbuf_trim_empty_lines does.
+ */
+xml_token_type_t
+xml_get_token_cdata(xml_reader_t *xr, const char *start, xml_token_value_t *res)
+{
+	const char *stop;
+	char *cdata, *out;
+	size_t n, trim, len;
+	int cc;
 
-			token = xml_skip_comment(xr);
-			if (token == Comment) {
-				xr->state = Initial;
-				ni_stringbuf_clear(res);
-				goto restart;
-			}
-			return token;
-		default:
-			xml_ungetc(xr, cc);
-			break;
+	/* FIXME: handle comments within CDATA? */
+	if (!(stop = memchr(xr->pos, '<', xr->end - xr->pos)))
+		stop = xr->end;
+
+	out = cdata = xml_arena_alloc(xr->arena, stop - start + 1);
+	memcpy(out, start, xr->pos - start);
+	out += xr->pos - start;
+
+	while (xr->pos < stop) {
+		const char *amp;
+
+		if (!(amp = memchr(xr->pos, '&', stop - xr->pos)))
+			amp = stop;
+
+		memcpy(out, xr->pos, amp - xr->pos);
+		out += amp - xr->pos;
+		xml_advance(xr, amp);
+
+		if (amp < stop) {
+			xml_getc(xr);
+			if (!xml_expand_entity(xr, &out))
+				return None;
 		}
-		return LeftAngle;
 	}
+	len = out - cdata;
 
-	// Looks like CDATA. 
-	// Ignore initial newline, then scan to next <
-	do {
-		if (cc == '<') {
-			/* Looks like we're done.
-			 * FIXME: handle comments within CDATA?
-			 */
-			xml_ungetc(xr, cc);
+	/* trim tail */
+	for (trim = n = len; n; --n) {
+		cc = cdata[n - 1];
+
+		if (cc == '\r' || cc == '\n')
+			trim = n;
+		else if (cc != ' ' && cc != '\t')
 			break;
-		} else
-		if (cc == '&') {
-			if (!xml_expand_entity(xr, res))
-				return None;
-		} else {
-			ni_stringbuf_putc(res, cc);
-		}
+	}
+	cdata[trim] = '\0';
+	len = trim;
 
-		cc = xml_getc(xr);
-	} while (cc != EOF);
+	/* trim head */
+	for (trim = n = 0; n < len; ) {
+		cc = cdata[n++];
 
-	ni_stringbuf_trim_empty_lines(res);
+		if (cc == '\r' || cc == '\n')
+			trim = n;
+		else if (cc != ' ' && cc != '\t')
+			break;
+	}
 
+	res->string = cdata + trim;
+	res->len = len - trim;
 	return CData;
 }
 
-
 xml_token_type_t
-xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
+xml_get_token_tag(xml_reader_t *xr, xml_token_value_t *res)
 {
+	const char *quote;
 	int cc, oc;
 
-	xml_skip_space(xr, NULL);
+	xml_skip_space(xr);
 
+	res->string = xr->pos;
 	cc = xml_getc(xr);
 	if (cc == EOF) {
 		xml_parse_error(xr, "Unexpected EOF while parsing tag");
 		return None;
 	}
-
-	ni_stringbuf_putc(res, cc);
+	res->len = 1;
 
 	switch (cc) {
 	case '<':
@@ -606,7 +789,7 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 	case '?':
 		if ((cc = xml_getc(xr)) != '>')
 			goto error;
-		ni_stringbuf_putc(res, cc);
+		res->len = 2;
 		xr->state = Initial;
 		return RightAngleQ;
 
@@ -617,7 +800,7 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 	case '/':
 		if ((cc = xml_getc(xr)) != '>')
 			goto error;
-		ni_stringbuf_putc(res, cc);
+		res->len = 2;
 		xr->state = Initial;
 		return RightAngleSlash;
 
@@ -628,29 +811,25 @@ xml_get_token_tag(xml_reader_t *xr, ni_stringbuf_t *res)
 	case 'A' ... 'Z':
 	case '_':
 	case '!':
-		while ((cc = xml_getc(xr)) != EOF) {
-			if (!isalnum(cc) && cc != '_' && cc != '!' && cc != ':' && cc != '-') {
-				xml_ungetc(xr, cc);
+		while ((cc = xml_peekc(xr)) != EOF) {
+			if (!isalnum(cc) && cc != '_' && cc != '!' && cc != ':' && cc != '-')
 				break;
-			}
-			ni_stringbuf_putc(res, cc);
+			xr->pos++;
 		}
+		res->len = xr->pos - res->string;
 		return Identifier;
 
 	case '\'':
 	case '"':
-		ni_stringbuf_clear(res);
 		oc = cc;
-		while (1) {
-			cc = xml_getc(xr);
-			if (cc == EOF) {
-				xml_parse_error(xr, "Unexpected EOF while parsing quoted string");
-				return None;
-			}
-			if (cc == oc)
-				break;
-			ni_stringbuf_putc(res, cc);
+		if (!(quote = memchr(xr->pos, oc, xr->end - xr->pos))) {
+			xml_advance(xr, xr->end);
+			xml_parse_error(xr, "Unexpected EOF while parsing quoted string");
+			return None;
 		}
+		res->string = xr->pos;
+		res->len = quote - xr->pos;
+		xml_advance(xr, quote + 1);
 		return QuotedString;
 
 	default:
@@ -668,27 +847,22 @@ error:
 xml_token_type_t
 xml_skip_comment(xml_reader_t *xr)
 {
-	int match = 0, cc;
+	const char *end;
 
 	if (xml_getc(xr) != '-') {
 		xml_parse_error(xr, "Unexpected <!-...> element");
 		return None;
 	}
 
-	while ((cc = xml_getc(xr)) != EOF) {
-		if (cc == '-') {
-			match++;
-		} else {
-			if (cc == '>' && match >= 2) {
+	if ((end = memmem(xr->pos, xr->end - xr->pos, "-->", 3)) != NULL) {
+		xml_advance(xr, end + 3);
 #ifdef XMLDEBUG_PARSER
-				xml_debug("Processed comment\n");
+		xml_debug("Processed comment\n");
 #endif
-				return Comment;
-			}
-			match = 0;
-		}
+		return Comment;
 	}
 
+	xml_advance(xr, xr->end);
 	xml_parse_error(xr, "Unexpected end of file while parsing comment");
 	return None;
 }
@@ -700,7 +874,7 @@ xml_skip_comment(xml_reader_t *xr)
  *   lt gt amp
  */
 ni_bool_t
-xml_expand_entity(xml_reader_t *xr, ni_stringbuf_t *res)
+xml_expand_entity(xml_reader_t *xr, char **res)
 {
 	char temp[128];
 	ni_stringbuf_t entity = NI_STRINGBUF_INIT_BUFFER(temp);
@@ -745,27 +919,20 @@ xml_expand_entity(xml_reader_t *xr, ni_stringbuf_t *res)
 	}
 
 good:
-	ni_stringbuf_putc(res, expanded);
+	*(*res)++ = expanded;
 	return TRUE;
 }
 
 /*
- * Skip any space in the input stream, and copy if to @result
+ * Skip any space in the input stream
  */
 void
-xml_skip_space(xml_reader_t *xr, ni_stringbuf_t *result)
+xml_skip_space(xml_reader_t *xr)
 {
 	int cc;
 
-	while ((cc = xml_getc(xr)) != EOF) {
-		if (!isspace(cc)) {
-			xml_ungetc(xr, cc);
-			break;
-		}
-
-		if (result)
-			ni_stringbuf_putc(result, cc);
-	}
+	while ((cc = xml_peekc(xr)) != EOF && isspace(cc))
+		xml_getc(xr);
 }
 
 void
@@ -819,20 +986,6 @@ xml_token_name(xml_token_type_t token)
 	return "???";
 }
 
-const char *
-xml_parser_state_name(xml_parser_state_t state)
-{
-	switch (state) {
-	case Initial:
-		return "Initial";
-	case Tag:
-		return "Tag";
-	case Error:
-		return "Error";
-	}
-	return "Unknown";
-}
-
 #ifdef XMLDEBUG_PARSER
 void
 xml_debug(const char *fmt, ...)
@@ -985,7 +1138,9 @@ xml_node_location_set(xml_node_t *node, xml_location_t *loc)
 {
 	if (node->location == loc)
 		return;
-	if (node->location)
+	if (xml_node_owns(node, node->location))
+		xml_location_shared_release(node->location->shared);
+	else if (node->location)
 		xml_location_free(node->location);
 
 	node->location = loc;
@@ -1009,22 +1164,95 @@ xml_location_free(xml_location_t *loc)
 /*
  * XML Reader object
  */
+static void
+xml_reader_init(xml_reader_t *xr, const char *location)
+{
+	memset(xr, 0, sizeof(*xr));
+	xr->filename = location;
+	xr->state = Initial;
+	xr->lineCount = 1;
+	xr->shared_location = xml_location_shared_new(location);
+	xr->arena = xml_arena_new();
+}
+
+static void
+xml_reader_set_data(xml_reader_t *xr, const char *data, size_t len)
+{
+	const char *nul;
+
+	/* The document ends at the first NUL byte, if any */
+	if (data && (nul = memchr(data, '\0', len)))
+		len = nul - data;
+
+	xr->data = data;
+	xr->pos = data;
+	xr->end = data + len;
+}
+
+/*
+ * Read the (remaining) stream at once
+ */
+static int
+xml_reader_read_file(xml_reader_t *xr)
+{
+	size_t size = 0, len = 0;
+
+	while (!feof(xr->file)) {
+		if (size - len < XML_READER_BUFSZ) {
+			size += max_t(size_t, size, XML_READER_BUFSZ);
+			xr->buffer = xrealloc(xr->buffer, size);
+		}
+
+		len += fread(xr->buffer + len, 1, size - len, xr->file);
+		if (ferror(xr->file)) {
+			ni_error("Unable to read %s: %m", xr->filename);
+			return -1;
+		}
+	}
+
+	xml_reader_set_data(xr, xr->buffer, len);
+	return 0;
+}
+
 static int
 xml_reader_open(xml_reader_t *xr, const char *filename)
 {
-	memset(xr, 0, sizeof(*xr));
-	xr->filename = filename;
+	struct stat stb;
+	void *mapped;
+	int fd;
 
-	xr->file = fopen(filename, "r");
-	if (xr->file == NULL) {
+	xml_reader_init(xr, filename);
+
+	fd = open(filename, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
 		ni_error("Unable to open %s: %m", filename);
+		xml_reader_destroy(xr);
 		return -1;
 	}
 
-	xr->buffer = xmalloc(XML_READER_BUFSZ);
-	xr->state = Initial;
-	xr->lineCount = 1;
-	xr->shared_location = xml_location_shared_new(filename);
+	if (fstat(fd, &stb) == 0 && S_ISREG(stb.st_mode) && stb.st_size > 0) {
+		mapped = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) {
+			close(fd);
+			xr->mapped = mapped;
+			xr->mapped_len = stb.st_size;
+			xml_reader_set_data(xr, mapped, stb.st_size);
+			return 0;
+		}
+	}
+
+	/* Not a regular file or not mappable, read it */
+	if (!(xr->file = fdopen(fd, "r"))) {
+		ni_error("Unable to open %s: %m", filename);
+		close(fd);
+		xml_reader_destroy(xr);
+		return -1;
+	}
+
+	if (xml_reader_read_file(xr) < 0) {
+		xml_reader_destroy(xr);
+		return -1;
+	}
 	return 0;
 }
 
@@ -1034,16 +1262,14 @@ xml_reader_init_file(xml_reader_t *xr, FILE *fp, const char *location)
 	if (ni_string_empty(location))
 		location = "<stdin>";
 
-	memset(xr, 0, sizeof(*xr));
-	xr->filename = location;
+	xml_reader_init(xr, location);
 	xr->file = fp;
 	xr->no_close = 1;
 
-	xr->buffer = xmalloc(XML_READER_BUFSZ);
-	xr->state = Initial;
-	xr->lineCount = 1;
-	xr->shared_location = xml_location_shared_new(location);
-
+	if (xml_reader_read_file(xr) < 0) {
+		xml_reader_destroy(xr);
+		return -1;
+	}
 	return 0;
 }
 
@@ -1053,15 +1279,11 @@ xml_reader_init_buffer(xml_reader_t *xr, ni_buffer_t *buf, const char *location)
 	if (ni_string_empty(location))
 		location = "<buffer>";
 
-	memset(xr, 0, sizeof(*xr));
-	xr->filename = location;
+	xml_reader_init(xr, location);
 	xr->in_buffer = buf;
 	xr->no_close = 1;
 
-	xr->state = Initial;
-	xr->lineCount = 1;
-	xr->shared_location = xml_location_shared_new(location);
-
+	xml_reader_set_data(xr, ni_buffer_head(buf), ni_buffer_count(buf));
 	return 0;
 }
 
@@ -1076,78 +1298,33 @@ xml_reader_destroy(xml_reader_t *xr)
 		fclose(xr->file);
 		xr->file = NULL;
 	}
+	if (xr->in_buffer && xr->pos > xr->data) {
+		/* the parsed data is consumed from the buffer */
+		ni_buffer_pull_head(xr->in_buffer, xr->pos - xr->data);
+		xr->in_buffer = NULL;
+	}
+	if (xr->mapped) {
+		munmap(xr->mapped, xr->mapped_len);
+		xr->mapped = NULL;
+	}
 	if (xr->buffer) {
 		free(xr->buffer);
 		xr->buffer = NULL;
 	}
+	xr->data = xr->pos = xr->end = NULL;
+
+	free(xr->attrs);
+	xr->attrs = NULL;
+	xr->attrs_size = 0;
+	ni_hash_table_destroy(&xr->names);
 
+	if (xr->arena) {
+		xml_arena_free(xr->arena);
+		xr->arena = NULL;
+	}
 	if (xr->shared_location) {
 		xml_location_shared_release(xr->shared_location);
 		xr->shared_location = NULL;
 	}
 	return rv;
 }
-
-int
-xml_getc(xml_reader_t *xr)
-{
-	int cc;
-
-	if (xr->in_buffer) {
-		cc = ni_buffer_getc(xr->in_buffer);
-		if (cc == '\n')
-			xr->lineCount++;
-		return cc;
-	}
-
-	while (1) {
-		if (xr->pos) {
-			cc = *xr->pos++;
-			if (cc == '\n')
-				xr->lineCount++;
-			if (cc != '\0')
-				return cc;
-			xr->pos = NULL;
-		}
-
-		if (xr->file == NULL) {
-			/* Parsing just a string, no file backing */
-			break;
-		}
-
-		if (fgets((char *)xr->buffer, XML_READER_BUFSZ, xr->file) == NULL)
-			break;
-
-		xr->pos = xr->buffer;
-	}
-
-	return EOF;
-}
-
-void
-xml_ungetc(xml_reader_t *xr, int cc)
-{
-	if (xr->in_buffer) {
-		if (ni_buffer_ungetc(xr->in_buffer, cc) < 0)
-			ni_error("xml_ungetc: cannot put back");
-		if (cc == '\n')
-			xr->lineCount--;
-		return;
-	}
-
-	if (xr->pos == NULL
-	 || xr->pos == xr->buffer
-	 || xr->pos[-1] != cc) {
-		ni_error("xml_ungetc: cannot put back");
-		ni_error("  buffer=%p pos=%p *pos=0x%x cc=0x%x",
-				xr->buffer, xr->pos,
-				xr->pos? xr->pos[-1] : 0,
-				cc);
-		return;
-	}
-
-	if (cc == '\n')
-		xr->lineCount--;
-	xr->pos--;
-}
-
@@ -0,0 +1,463 @@
+/*
+ *	Binary cache of the parsed schema documents
+ *
+ *	This program is free software; you can redistribute it and/or modify
+ *	it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation; either version 2 of the License, or
+ *	(at your option) any later version.
+ *
+ *	This program is distributed in the hope that it will be useful,
+ *	but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *	GNU General Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along
+ *	with this program; if not, see <http://www.gnu.org/licenses/> or write
+ *	to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *	Boston, MA 02110-1301 USA.
+ *
+ *
+ *	Every wicked process parses all schema files at startup. The cache
+ *	keeps the xml node trees of every file read while processing a schema
+ *	in a compact binary form, together with the size, modification time
+ *	and inode number of the source file. The cache file is mapped read-only
+ *	and a document is rebuilt from it, skipping the xml tokenizer, as long
+ *	as a stat of the source file still matches. It is rewritten when any
+ *	of the source files changed or was not cached yet.
+ *
+ *	All values are stored in host byte order; the magic catches a cache
+ *	written on a host of different endianness.
+ *
+ *	  header:	u32 magic, u32 version
+ *	  entry:	u32 length, string filename, stamp, node
+ *	  stamp:	u64 size, u64 inode, s64 mtime sec, s64 mtime nsec
+ *	  node:		string name, string cdata, u32 line,
+ *			u32 nattrs, { string name, string value } * nattrs,
+ *			u32 nchildren, node * nchildren
+ *	  string:	u32 length (incl. NUL, 0 means NULL), char data[length]
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/xml.h>
+#include "xml-schema.h"
+#include "buffer.h"
+
+#define NI_XS_CACHE_MAGIC		0x43535857	/* "WXSC" */
+#define NI_XS_CACHE_VERSION		2
+#define NI_XS_CACHE_BUFSZ		(256 * 1024)
+
+typedef struct ni_xs_cache_stamp {
+	uint64_t		size;
+	uint64_t		inode;
+	int64_t			mtime_sec;
+	int64_t			mtime_nsec;
+} ni_xs_cache_stamp_t;
+
+typedef struct ni_xs_cache_entry {
+	const char *		filename;
+	const unsigned char *	data;
+	size_t			len;
+} ni_xs_cache_entry_t;
+
+struct ni_xs_cache {
+	char *			path;
+
+	void *			map;
+	size_t			map_len;
+
+	unsigned int		count;
+	ni_xs_cache_entry_t *	entries;
+
+	ni_buffer_t		wbuf;
+	ni_bool_t		dirty;
+};
+
+/*
+ * Writer helpers
+ */
+static void
+ni_xs_cache_put(ni_buffer_t *bp, const void *data, size_t len)
+{
+	if (ni_buffer_tailroom(bp) < len)
+		ni_buffer_ensure_tailroom(bp, max_t(size_t, len, bp->size));
+	ni_buffer_put(bp, data, len);
+}
+
+static void
+ni_xs_cache_put_uint32(ni_buffer_t *bp, uint32_t value)
+{
+	ni_xs_cache_put(bp, &value, sizeof(value));
+}
+
+static void
+ni_xs_cache_put_string(ni_buffer_t *bp, const char *string)
+{
+	uint32_t len = string ? strlen(string) + 1 : 0;
+
+	ni_xs_cache_put_uint32(bp, len);
+	if (len)
+		ni_xs_cache_put(bp, string, len);
+}
+
+static void
+ni_xs_cache_put_node(ni_buffer_t *bp, const xml_node_t *node)
+{
+	const xml_node_t *child;
+	unsigned int i, count;
+
+	ni_xs_cache_put_string(bp, node->name);
+	ni_xs_cache_put_string(bp, node->cdata);
+	ni_xs_cache_put_uint32(bp, node->location ? node->location->line : 0);
+
+	ni_xs_cache_put_uint32(bp, node->attrs.count);
+	for (i = 0; i < node->attrs.count; ++i) {
+		ni_xs_cache_put_string(bp, node->attrs.data[i].name);
+		ni_xs_cache_put_string(bp, node->attrs.data[i].value);
+	}
+
+	for (count = 0, child = node->children; child; child = child->next)
+		count++;
+	ni_xs_cache_put_uint32(bp, count);
+	for (child = node->children; child; child = child->next)
+		ni_xs_cache_put_node(bp, child);
+}
+
+/*
+ * Reader helpers; they operate on the read-only mapping
+ */
+static ni_bool_t
+ni_xs_cache_get_uint32(ni_buffer_t *bp, uint32_t *value)
+{
+	return ni_buffer_get(bp, value, sizeof(*value)) == 0;
+}
+
+static ni_bool_t
+ni_xs_cache_get_string(ni_buffer_t *bp, const char **string)
+{
+	const char *data;
+	uint32_t len;
+
+	if (!ni_xs_cache_get_uint32(bp, &len))
+		return FALSE;
+
+	if (len == 0) {
+		*string = NULL;
+		return TRUE;
+	}
+
+	if (!(data = ni_buffer_pull_head(bp, len)) || data[len - 1] != '\0')
+		return FALSE;
+
+	*string = data;
+	return TRUE;
+}
+
+static xml_node_t *
+ni_xs_cache_get_node(ni_buffer_t *bp, xml_node_t *parent, xml_location_t **location,
+			const char *filename)
+{
+	const char *name, *cdata, *attr_name, *attr_value;
+	uint32_t line, count, i;
+	xml_node_t *node, *child, **tail;
+
+	if (!ni_xs_cache_get_string(bp, &name) ||
+	    !ni_xs_cache_get_string(bp, &cdata) ||
+	    !ni_xs_cache_get_uint32(bp, &line))
+		return NULL;
+
+	node = xml_node_new(name, NULL);
+	node->parent = parent;
+	xml_node_set_cdata(node, cdata);
+
+	if (line) {
+		if (*location == NULL) {
+			*location = xml_location_create(filename, line);
+			node->location = xml_location_clone(*location);
+		} else {
+			node->location = xml_location_clone(*location);
+			node->location->line = line;
+		}
+	}
+
+	if (!ni_xs_cache_get_uint32(bp, &count))
+		goto failed;
+	for (i = 0; i < count; ++i) {
+		if (!ni_xs_cache_get_string(bp, &attr_name) ||
+		    !ni_xs_cache_get_string(bp, &attr_value) || !attr_name)
+			goto failed;
+		xml_node_add_attr(node, attr_name, attr_value);
+	}
+
+	/* link children in place, xml_node_add_child walks the sibling list */
+	if (!ni_xs_cache_get_uint32(bp, &count))
+		goto failed;
+	for (i = 0, tail = &node->children; i < count; ++i, tail = &child->next) {
+		if (!(child = ni_xs_cache_get_node(bp, node, location, filename)))
+			goto failed;
+		*tail = child;
+	}
+
+	return node;
+
+failed:
+	node->parent = NULL;
+	xml_node_free(node);
+	return NULL;
+}
+
+/*
+ * Stamp of a schema source file; a changed file has a different size,
+ * modification time or, when replaced by a package update, inode.
+ */
+static ni_bool_t
+ni_xs_cache_source_stamp(const char *filename, ni_xs_cache_stamp_t *stamp)
+{
+	struct stat stb;
+
+	if (stat(filename, &stb) < 0 || !S_ISREG(stb.st_mode))
+		return FALSE;
+
+	memset(stamp, 0, sizeof(*stamp));
+	stamp->size = stb.st_size;
+	stamp->inode = stb.st_ino;
+	stamp->mtime_sec = stb.st_mtim.tv_sec;
+	stamp->mtime_nsec = stb.st_mtim.tv_nsec;
+	return TRUE;
+}
+
+/*
+ * Map the cache file and index its entries
+ */
+static void
+ni_xs_cache_map(ni_xs_cache_t *cache)
+{
+	ni_buffer_t rbuf;
+	const char *filename;
+	uint32_t magic, version, len;
+	struct stat stb;
+	void *map;
+	int fd;
+
+	if ((fd = open(cache->path, O_RDONLY | O_CLOEXEC)) < 0)
+		return;
+
+	if (fstat(fd, &stb) < 0 || stb.st_size <= 0) {
+		close(fd);
+		return;
+	}
+
+	map = mmap(NULL, stb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return;
+
+	cache->map = map;
+	cache->map_len = stb.st_size;
+
+	ni_buffer_init_reader(&rbuf, map, cache->map_len);
+	if (!ni_xs_cache_get_uint32(&rbuf, &magic) || magic != NI_XS_CACHE_MAGIC ||
+	    !ni_xs_cache_get_uint32(&rbuf, &version) || version != NI_XS_CACHE_VERSION) {
+		ni_debug_xml("%s: ignoring schema cache with wrong magic or version",
+				cache->path);
+		return;
+	}
+
+	while (ni_buffer_count(&rbuf)) {
+		const unsigned char *data;
+		ni_buffer_t ebuf;
+
+		if (!ni_xs_cache_get_uint32(&rbuf, &len) ||
+		    !(data = ni_buffer_pull_head(&rbuf, len))) {
+			ni_debug_xml("%s: truncated schema cache", cache->path);
+			break;
+		}
+
+		ni_buffer_init_reader(&ebuf, (void *)data, len);
+		if (!ni_xs_cache_get_string(&ebuf, &filename) || !filename)
+			break;
+
+		if ((cache->count % 16) == 0) {
+			cache->entries = xrealloc(cache->entries,
+				(cache->count + 16) * sizeof(cache->entries[0]));
+		}
+		cache->entries[cache->count].filename = filename;
+		cache->entries[cache->count].data = data;
+		cache->entries[cache->count].len = len;
+		cache->count++;
+	}
+}
+
+ni_xs_cache_t *
+ni_xs_cache_open(const char *path)
+{
+	ni_xs_cache_t *cache;
+	uint32_t value;
+
+	if (ni_string_empty(path))
+		return NULL;
+
+	cache = xcalloc(1, sizeof(*cache));
+	cache->path = xstrdup(path);
+	ni_xs_cache_map(cache);
+
+	ni_buffer_init_dynamic(&cache->wbuf, NI_XS_CACHE_BUFSZ);
+	value = NI_XS_CACHE_MAGIC;
+	ni_xs_cache_put_uint32(&cache->wbuf, value);
+	value = NI_XS_CACHE_VERSION;
+	ni_xs_cache_put_uint32(&cache->wbuf, value);
+
+	return cache;
+}
+
+static const ni_xs_cache_entry_t *
+ni_xs_cache_find(const ni_xs_cache_t *cache, const char *filename)
+{
+	unsigned int i;
+
+	for (i = 0; i < cache->count; ++i) {
+		if (ni_string_eq(cache->entries[i].filename, filename))
+			return &cache->entries[i];
+	}
+	return NULL;
+}
+
+static void
+ni_xs_cache_append(ni_xs_cache_t *cache, const void *data, size_t len)
+{
+	ni_xs_cache_put_uint32(&cache->wbuf, len);
+	ni_xs_cache_put(&cache->wbuf, data, len);
+}
+
+/*
+ * Return the document for a schema file, rebuilt from the cache when
+ * the source did not change or parsed from the source file otherwise.
+ */
+xml_document_t *
+ni_xs_cache_read_document(ni_xs_cache_t *cache, const char *filename)
+{
+	ni_xs_cache_stamp_t stamp, cached;
+	const ni_xs_cache_entry_t *entry;
+	xml_location_t *location = NULL;
+	xml_document_t *doc;
+	ni_buffer_t ebuf;
+	const char *name;
+	uint32_t len;
+	size_t start;
+
+	if (!cache)
+		return xml_document_read(filename);
+
+	if (!ni_xs_cache_source_stamp(filename, &stamp)) {
+		cache->dirty = TRUE;
+		return xml_document_read(filename);
+	}
+
+	if ((entry = ni_xs_cache_find(cache, filename)) != NULL) {
+		ni_buffer_init_reader(&ebuf, (void *)entry->data, entry->len);
+		if (ni_xs_cache_get_string(&ebuf, &name) &&
+		    ni_buffer_get(&ebuf, &cached, sizeof(cached)) == 0 &&
+		    !memcmp(&cached, &stamp, sizeof(stamp))) {
+			doc = xml_document_new();
+			doc->root = ni_xs_cache_get_node(&ebuf, NULL, &location, filename);
+			if (location)
+				xml_location_free(location);
+			if (doc->root) {
+				ni_debug_verbose(NI_LOG_DEBUG3, NI_TRACE_XML,
+					"%s: using cached schema document", filename);
+				ni_xs_cache_append(cache, entry->data, entry->len);
+				return doc;
+			}
+			xml_document_free(doc);
+			ni_debug_xml("%s: corrupted schema cache entry for %s",
+					cache->path, filename);
+		}
+	}
+
+	if (!(doc = xml_document_read(filename)) || !doc->root)
+		return doc;
+
+	/* Serialize the document now, schema processing takes nodes away */
+	cache->dirty = TRUE;
+	ni_xs_cache_put_uint32(&cache->wbuf, 0);
+	start = cache->wbuf.tail;
+	ni_xs_cache_put_string(&cache->wbuf, filename);
+	ni_xs_cache_put(&cache->wbuf, &stamp, sizeof(stamp));
+	ni_xs_cache_put_node(&cache->wbuf, doc->root);
+	len = cache->wbuf.tail - start;
+	memcpy(cache->wbuf.base + start - sizeof(len), &len, sizeof(len));
+
+	return doc;
+}
+
+/*
+ * Write the cache if anything changed, replacing the old file atomically
+ */
+static void
+ni_xs_cache_write(ni_xs_cache_t *cache)
+{
+	char *tmpfile = NULL;
+	size_t done = 0;
+	ssize_t len;
+	int fd;
+
+	if (!ni_string_printf(&tmpfile, "%s.XXXXXX", cache->path))
+		return;
+
+	if ((fd = mkstemp(tmpfile)) < 0) {
+		ni_debug_xml("%s: cannot create schema cache: %m", cache->path);
+		goto cleanup;
+	}
+
+	while (done < cache->wbuf.tail) {
+		len = write(fd, cache->wbuf.base + done, cache->wbuf.tail - done);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0) {
+			ni_debug_xml("%s: cannot write schema cache: %m", cache->path);
+			close(fd);
+			unlink(tmpfile);
+			goto cleanup;
+		}
+		done += len;
+	}
+
+	if (fchmod(fd, 0644) < 0 || close(fd) < 0 || rename(tmpfile, cache->path) < 0) {
+		ni_debug_xml("%s: cannot install schema cache: %m", cache->path);
+		unlink(tmpfile);
+		goto cleanup;
+	}
+	ni_debug_xml("%s: updated schema cache", cache->path);
+
+cleanup:
+	ni_string_free(&tmpfile);
+}
+
+void
+ni_xs_cache_close(ni_xs_cache_t *cache, ni_bool_t commit)
+{
+	if (!cache)
+		return;
+
+	if (commit && cache->dirty)
+		ni_xs_cache_write(cache);
+
+	if (cache->map)
+		munmap(cache->map, cache->map_len);
+	free(cache->entries);
+	ni_buffer_destroy(&cache->wbuf);
+	ni_string_free(&cache->path);
+	free(cache);
+}
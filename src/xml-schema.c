@@ -50,6 +50,8 @@ static void		ni_xs_scalar_set_bitmap(ni_xs_type_t *, ni_xs_intmap_t *);
 static void		ni_xs_scalar_set_enum(ni_xs_type_t *, ni_xs_intmap_t *);
 static void		ni_xs_scalar_set_range(ni_xs_type_t *, ni_xs_range_t *);
 
+static ni_xs_cache_t *	ni_xs_schema_cache;
+
 /*
  * Constructor functions for basic and complex types
  */
@@ -625,7 +627,7 @@ ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 		return -1;
 	}
 
-	doc = xml_document_read(filename);
+	doc = ni_xs_cache_read_document(ni_xs_schema_cache, filename);
 	if (doc == NULL) {
 		ni_error("cannot parse schema file \"%s\"", filename);
 		return -1;
@@ -641,6 +643,26 @@ ni_xs_process_schema_file(const char *filename, ni_xs_scope_t *scope)
 	return 0;
 }
 
+/*
+ * Process an XML schema file, using the binary document cache for it
+ * and all included files. The cache is updated when any file changed.
+ */
+int
+ni_xs_process_schema_file_cached(const char *filename, ni_xs_scope_t *scope, const char *cachefile)
+{
+	int rv;
+
+	if (ni_xs_schema_cache)
+		return ni_xs_process_schema_file(filename, scope);
+
+	ni_xs_schema_cache = ni_xs_cache_open(cachefile);
+	rv = ni_xs_process_schema_file(filename, scope);
+	ni_xs_cache_close(ni_xs_schema_cache, rv == 0);
+	ni_xs_schema_cache = NULL;
+
+	return rv;
+}
+
 /*
  * Process a schema.
  * For now, this is nothing but a sequence of <define> elements
@@ -802,7 +824,7 @@ ni_xs_process_method(xml_node_t *node, ni_xs_service_t *service, ni_xs_scope_t *
 			if (method->meta == NULL)
 				method->meta = xml_node_new("meta", NULL);
 			xml_node_reparent(method->meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 
@@ -1300,7 +1322,7 @@ ni_xs_build_simple_type(xml_node_t *node, const char *typeName, ni_xs_scope_t *s
 			if (meta == NULL)
 				meta = xml_node_new("meta", NULL);
 			xml_node_reparent(meta, child);
-			ni_string_dup(&child->name, child->name + 5);
+			xml_node_set_name(child, child->name + 5);
 		}
 	}
 	if (meta) {
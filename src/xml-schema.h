@@ -351,8 +351,17 @@ extern ni_xs_type_t *	ni_xs_scope_lookup(const ni_xs_scope_t *, const char *);
 extern ni_xs_type_t *	ni_xs_scope_lookup_local(const ni_xs_scope_t *, const char *);
 
 extern int		ni_xs_process_schema_file(const char *, ni_xs_scope_t *);
+extern int		ni_xs_process_schema_file_cached(const char *, ni_xs_scope_t *, const char *);
 extern int		ni_xs_process_schema(xml_node_t *, ni_xs_scope_t *);
 
+#define NI_XS_SCHEMA_CACHE_FILE	"schema.cache"
+
+typedef struct ni_xs_cache	ni_xs_cache_t;
+
+extern ni_xs_cache_t *	ni_xs_cache_open(const char *);
+extern xml_document_t *	ni_xs_cache_read_document(ni_xs_cache_t *, const char *);
+extern void		ni_xs_cache_close(ni_xs_cache_t *, ni_bool_t);
+
 extern ni_xs_type_t *	ni_xs_scalar_new(const char *, unsigned int);
 extern int		ni_xs_scope_typedef(ni_xs_scope_t *, const char *, ni_xs_type_t *, const char *);
 extern void		ni_xs_type_free(ni_xs_type_t *type);
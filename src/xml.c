@@ -26,11 +26,31 @@
 #include <wicked/xml.h>
 #include <wicked/logging.h>
 #include "util_priv.h"
+#include "xml_priv.h"
 #include <inttypes.h>
 
 #define XML_DOCUMENTARRAY_CHUNK		1
 #define XML_NODEARRAY_CHUNK		8
 
+#define XML_ARENA_CHUNK_MIN		4096
+#define XML_ARENA_CHUNK_MAX		(256 * 1024)
+#define XML_ARENA_ALIGN(len)		(((len) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+typedef struct xml_arena_chunk	xml_arena_chunk_t;
+
+struct xml_arena_chunk {
+	xml_arena_chunk_t *	next;
+	size_t			size;
+	size_t			used;
+	unsigned char		data[];
+};
+
+struct xml_arena {
+	unsigned int		refcount;
+	size_t			chunk_size;
+	xml_arena_chunk_t *	chunks;
+};
+
 xml_document_t *
 xml_document_new()
 {
@@ -139,6 +159,145 @@ xml_node_add_child(xml_node_t *parent, xml_node_t *child)
 	__xml_node_list_insert(tail, child, parent);
 }
 
+/*
+ * Document arena the reader allocates the nodes and strings from
+ */
+xml_arena_t *
+xml_arena_new(void)
+{
+	xml_arena_t *arena;
+
+	arena = xcalloc(1, sizeof(*arena));
+	arena->refcount = 1;
+	arena->chunk_size = XML_ARENA_CHUNK_MIN;
+	return arena;
+}
+
+xml_arena_t *
+xml_arena_ref(xml_arena_t *arena)
+{
+	if (arena) {
+		ni_assert(arena->refcount);
+		arena->refcount++;
+	}
+	return arena;
+}
+
+void
+xml_arena_free(xml_arena_t *arena)
+{
+	xml_arena_chunk_t *chunk;
+
+	if (!arena)
+		return;
+
+	ni_assert(arena->refcount);
+	if (--(arena->refcount) != 0)
+		return;
+
+	while ((chunk = arena->chunks) != NULL) {
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	free(arena);
+}
+
+/*
+ * Allocate zeroed memory from the arena. The chunks grow up to
+ * XML_ARENA_CHUNK_MAX, so large documents need only a few of them.
+ */
+void *
+xml_arena_alloc(xml_arena_t *arena, size_t len)
+{
+	xml_arena_chunk_t *chunk = arena->chunks;
+	unsigned char *ptr;
+	size_t size;
+
+	len = XML_ARENA_ALIGN(len);
+	if (!chunk || chunk->size - chunk->used < len) {
+		size = max_t(size_t, arena->chunk_size, len);
+		chunk = xmalloc(sizeof(*chunk) + size);
+		chunk->size = size;
+		chunk->used = 0;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+
+		if (arena->chunk_size < XML_ARENA_CHUNK_MAX)
+			arena->chunk_size <<= 1;
+	}
+
+	ptr = chunk->data + chunk->used;
+	chunk->used += len;
+	memset(ptr, 0, len);
+	return ptr;
+}
+
+char *
+xml_arena_strndup(xml_arena_t *arena, const char *str, size_t len)
+{
+	char *copy;
+
+	copy = xml_arena_alloc(arena, len + 1);
+	memcpy(copy, str, len);
+	return copy;
+}
+
+ni_bool_t
+xml_arena_owns(const xml_arena_t *arena, const void *ptr)
+{
+	const unsigned char *p = ptr;
+	const xml_arena_chunk_t *chunk;
+
+	for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+		if (p >= chunk->data && p < chunk->data + chunk->used)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * Allocate an xml node from the arena; the name has to be
+ * allocated from the arena as well (or be a static string).
+ */
+xml_node_t *
+xml_arena_node_new(xml_arena_t *arena, const char *name)
+{
+	xml_node_t *node;
+
+	node = xml_arena_alloc(arena, sizeof(*node));
+	node->name = (char *) name;
+	node->arena = xml_arena_ref(arena);
+	node->refcount = 1;
+	return node;
+}
+
+/*
+ * Arena owned cdata and attributes are replaced by heap copies
+ * before we modify them
+ */
+static inline void
+xml_node_cdata_unshare(xml_node_t *node)
+{
+	if (xml_node_owns(node, node->cdata))
+		node->cdata = NULL;
+}
+
+static void
+xml_node_attrs_unshare(xml_node_t *node)
+{
+	ni_var_array_t attrs = NI_VAR_ARRAY_INIT;
+	unsigned int i;
+
+	if (!xml_node_owns(node, node->attrs.data))
+		return;
+
+	for (i = 0; i < node->attrs.count; ++i)
+		ni_var_array_append(&attrs, node->attrs.data[i].name,
+					node->attrs.data[i].value);
+	node->attrs.count = attrs.count;
+	node->attrs.data = attrs.data;
+}
+
 xml_node_t *
 xml_node_new(const char *ident, xml_node_t *parent)
 {
@@ -299,18 +458,36 @@ xml_node_free(xml_node_t *node)
 		xml_node_free(child);
 	}
 
-	if (node->location)
-		xml_location_free(node->location);
+	xml_node_location_set(node, NULL);
+
+	if (xml_node_owns(node, node->attrs.data))
+		ni_var_array_init(&node->attrs);
+	else
+		ni_var_array_destroy(&node->attrs);
+	if (!xml_node_owns(node, node->cdata))
+		free(node->cdata);
+	if (!xml_node_owns(node, node->name))
+		free(node->name);
 
-	ni_var_array_destroy(&node->attrs);
-	free(node->cdata);
-	free(node->name);
-	free(node);
+	if (node->arena)
+		xml_arena_free(node->arena);
+	else
+		free(node);
+}
+
+void
+xml_node_set_name(xml_node_t *node, const char *name)
+{
+	/* interned in the arena, the name may be shared by other nodes */
+	if (xml_node_owns(node, node->name))
+		node->name = NULL;
+	ni_string_dup(&node->name, name);
 }
 
 void
 xml_node_set_cdata(xml_node_t *node, const char *cdata)
 {
+	xml_node_cdata_unshare(node);
 	ni_string_dup(&node->cdata, cdata);
 }
 
@@ -320,7 +497,7 @@ xml_node_set_int(xml_node_t *node, int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%d", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -329,7 +506,7 @@ xml_node_set_int64(xml_node_t *node, int64_t value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%"PRId64, value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -338,7 +515,7 @@ xml_node_set_uint(xml_node_t *node, unsigned int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%u", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -347,7 +524,7 @@ xml_node_set_uint64(xml_node_t *node, uint64_t value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "%"PRIu64, value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
@@ -356,30 +533,34 @@ xml_node_set_uint_hex(xml_node_t *node, unsigned int value)
 	char buffer[32];
 
 	snprintf(buffer, sizeof(buffer), "0x%x", value);
-	ni_string_dup(&node->cdata, buffer);
+	xml_node_set_cdata(node, buffer);
 }
 
 void
 xml_node_add_attr(xml_node_t *node, const char *name, const char *value)
 {
+	xml_node_attrs_unshare(node);
 	ni_var_array_set(&node->attrs, name, value);
 }
 
 void
 xml_node_add_attr_uint(xml_node_t *node, const char *name, unsigned int value)
 {
+	xml_node_attrs_unshare(node);
 	ni_var_array_set_uint(&node->attrs, name, value);
 }
 
 void
 xml_node_add_attr_ulong(xml_node_t *node, const char *name, unsigned long value)
 {
+	xml_node_attrs_unshare(node);
 	ni_var_array_set_ulong(&node->attrs, name, value);
 }
 
 void
 xml_node_add_attr_double(xml_node_t *node, const char *name, double value)
 {
+	xml_node_attrs_unshare(node);
 	ni_var_array_set_double(&node->attrs, name, value);
 }
 
@@ -408,7 +589,11 @@ xml_node_get_attr(const xml_node_t *node, const char *name)
 ni_bool_t
 xml_node_del_attr(xml_node_t *node, const char *name)
 {
-	return node ? ni_var_array_remove(&node->attrs, name) : FALSE;
+	if (!node)
+		return FALSE;
+
+	xml_node_attrs_unshare(node);
+	return ni_var_array_remove(&node->attrs, name);
 }
 
 ni_bool_t
@@ -0,0 +1,37 @@
+/*
+ * Internal XML node allocation functions.
+ * Do not confuse with <wicked/xml.h> which is public.
+ */
+
+#ifndef __WICKED_XML_PRIV_H__
+#define __WICKED_XML_PRIV_H__
+
+#include <wicked/xml.h>
+
+/*
+ * The XML reader allocates the nodes, locations, names, attributes
+ * and cdata of a document from a per-document arena.
+ *
+ * Each node allocated from an arena holds a reference to it, so the
+ * arena is released in one shot with the last node of the document.
+ * The xml node functions check whether a string or array is owned by
+ * the arena of the node and replace it by a heap copy on modification.
+ */
+typedef struct xml_arena	xml_arena_t;
+
+extern xml_arena_t *	xml_arena_new(void);
+extern xml_arena_t *	xml_arena_ref(xml_arena_t *);
+extern void		xml_arena_free(xml_arena_t *);
+extern void *		xml_arena_alloc(xml_arena_t *, size_t);
+extern char *		xml_arena_strndup(xml_arena_t *, const char *, size_t);
+extern ni_bool_t	xml_arena_owns(const xml_arena_t *, const void *);
+
+extern xml_node_t *	xml_arena_node_new(xml_arena_t *, const char *);
+
+static inline ni_bool_t
+xml_node_owns(const xml_node_t *node, const void *ptr)
+{
+	return node->arena && ptr && xml_arena_owns(node->arena, ptr);
+}
+
+#endif /* __WICKED_XML_PRIV_H__ */
@@ -0,0 +1,309 @@
+/*
+ * Test the property change tracking of dbus clients: when one client
+ * retrieves the properties of an object which changed without being
+ * marked, the other clients have to receive the change, instead of
+ * keeping a stale value they consider current.
+ *
+ * The test runs its server and clients on the session bus, use e.g.
+ *	dbus-run-session -- ./dbus-props-test
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/dbus.h>
+#include <wicked/dbus-service.h>
+#include <wicked/objectmodel.h>
+
+#include "dbus-server.h"
+#include "util_priv.h"
+
+#define PROPS_TEST_BUS_NAME	"org.opensuse.Network.PropsTest"
+#define PROPS_TEST_ROOT_PATH	"/org/opensuse/Network/PropsTest"
+#define PROPS_TEST_INTERFACE	PROPS_TEST_BUS_NAME ".Counter"
+#define PROPS_TEST_DELAY	200	/* msec to deliver the signals */
+
+static unsigned int	props_test_failed;
+static ni_bool_t	props_test_quit;
+
+static void
+props_test_check(ni_bool_t ok, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		props_test_failed++;
+	}
+}
+
+static dbus_bool_t
+props_test_get_value(const ni_dbus_object_t *object, const ni_dbus_property_t *property,
+		ni_dbus_variant_t *result, DBusError *error)
+{
+	unsigned int *value = ni_dbus_object_get_handle(object);
+
+	ni_dbus_variant_set_uint32(result, *value);
+	return TRUE;
+}
+
+static dbus_bool_t
+props_test_set_value(ni_dbus_object_t *object, const ni_dbus_property_t *property,
+		const ni_dbus_variant_t *argument, DBusError *error)
+{
+	unsigned int *value = ni_dbus_object_get_handle(object);
+
+	return ni_dbus_variant_get_uint32(argument, value);
+}
+
+/* change the value without marking the object as changed */
+static dbus_bool_t
+props_test_bump(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	unsigned int *value = ni_dbus_object_get_handle(object);
+
+	(*value)++;
+	return TRUE;
+}
+
+static dbus_bool_t
+props_test_quit_server(ni_dbus_object_t *object, const ni_dbus_method_t *method,
+		unsigned int argc, const ni_dbus_variant_t *argv,
+		ni_dbus_message_t *reply, DBusError *error)
+{
+	props_test_quit = TRUE;
+	return TRUE;
+}
+
+static void
+props_test_initialize(ni_dbus_object_t *object)
+{
+	object->handle = xcalloc(1, sizeof(unsigned int));
+}
+
+static void
+props_test_destroy(ni_dbus_object_t *object)
+{
+	free(object->handle);
+	object->handle = NULL;
+}
+
+static ni_dbus_class_t		props_test_counter_class = {
+	.name		= "props-test-counter",
+	.initialize	= props_test_initialize,
+	.destroy	= props_test_destroy,
+};
+
+static ni_dbus_class_t		props_test_list_class = {
+	.name		= "props-test-list",
+	.list		= { .item_class = &props_test_counter_class },
+};
+
+static const ni_dbus_property_t	props_test_properties[] = {
+	{
+		.name		= "value",
+		.signature	= DBUS_TYPE_UINT32_AS_STRING,
+		.get		= props_test_get_value,
+		.set		= props_test_set_value,
+	},
+	{ NULL }
+};
+
+static const ni_dbus_method_t	props_test_methods[] = {
+	{ "bump",	"",	.handler = props_test_bump },
+	{ "quit",	"",	.handler = props_test_quit_server },
+	{ NULL }
+};
+
+static ni_dbus_service_t	props_test_service = {
+	.name		= PROPS_TEST_INTERFACE,
+	.compatible	= &props_test_counter_class,
+	.methods	= props_test_methods,
+	.properties	= props_test_properties,
+};
+
+static int
+props_test_server(int ready)
+{
+	ni_dbus_server_t *server;
+	ni_dbus_object_t *object;
+	long timeout;
+
+	if (!(server = ni_dbus_server_open("session", PROPS_TEST_BUS_NAME, NULL)))
+		return 1;
+
+	object = ni_dbus_server_register_object(server, "Counter",
+			&props_test_counter_class, xcalloc(1, sizeof(unsigned int)));
+	ni_dbus_object_register_service(object, &props_test_service);
+
+	if (write(ready, "", 1) != 1)
+		return 1;
+	close(ready);
+
+	while (!props_test_quit) {
+		timeout = ni_timer_next_timeout();
+		if (ni_socket_wait(timeout) != 0)
+			break;
+		ni_dbus_server_send_properties_changed(server);
+	}
+
+	ni_dbus_server_free(server);
+	return 0;
+}
+
+static void
+props_test_run(void)
+{
+	struct timeval start, now, delta;
+	long left;
+
+	ni_timer_get_time(&start);
+	do {
+		ni_timer_get_time(&now);
+		timersub(&now, &start, &delta);
+		left = PROPS_TEST_DELAY - (delta.tv_sec * 1000 + delta.tv_usec / 1000);
+		if (left <= 0)
+			break;
+		ni_socket_wait(left);
+	} while (1);
+}
+
+static ni_dbus_object_t *
+props_test_client(ni_dbus_client_t **client_p)
+{
+	ni_dbus_object_t *root;
+	DBusError error = DBUS_ERROR_INIT;
+
+	if (!(*client_p = ni_dbus_client_open("session", PROPS_TEST_BUS_NAME)))
+		return NULL;
+
+	root = ni_dbus_client_object_new(*client_p, &props_test_list_class,
+			PROPS_TEST_ROOT_PATH, NULL, NULL);
+	ni_dbus_client_track_properties(*client_p, root);
+
+	if (!ni_dbus_object_get_managed_objects(root, &error, TRUE)) {
+		fprintf(stderr, "GetManagedObjects: %s\n", error.message);
+		dbus_error_free(&error);
+		return NULL;
+	}
+	return ni_dbus_object_lookup(root, "Counter");
+}
+
+static void
+props_test_bump_value(ni_dbus_object_t *proxy)
+{
+	DBusError error = DBUS_ERROR_INIT;
+
+	if (!ni_dbus_object_call_variant(proxy, PROPS_TEST_INTERFACE, "bump",
+				0, NULL, 0, NULL, &error)) {
+		fprintf(stderr, "bump: %s\n", error.message);
+		dbus_error_free(&error);
+		props_test_failed++;
+	}
+}
+
+static void
+props_test_value_seen(const ni_dbus_object_t *proxy, unsigned int expect, const char *what)
+{
+	const unsigned int *value = ni_dbus_object_get_handle(proxy);
+
+	props_test_check(ni_dbus_object_properties_current(proxy), what);
+	props_test_check(value && *value == expect, what);
+}
+
+int
+main(void)
+{
+	ni_dbus_client_t *client_a = NULL, *client_b = NULL;
+	ni_dbus_object_t *proxy_a, *proxy_b;
+	DBusError error = DBUS_ERROR_INIT;
+	int ready[2], status;
+	char c;
+	pid_t pid;
+
+	if (!getenv("DBUS_SESSION_BUS_ADDRESS")) {
+		fprintf(stderr, "dbus-props-test: needs a session bus, "
+				"run it using dbus-run-session\n");
+		return 1;
+	}
+
+	ni_objectmodel_register_service(&props_test_service);
+
+	if (pipe(ready) < 0) {
+		perror("pipe");
+		return 1;
+	}
+	if ((pid = fork()) < 0) {
+		perror("fork");
+		return 1;
+	}
+	if (pid == 0) {
+		close(ready[0]);
+		_exit(props_test_server(ready[1]));
+	}
+	close(ready[1]);
+	if (read(ready[0], &c, 1) != 1) {
+		fprintf(stderr, "dbus-props-test: server failed to start\n");
+		waitpid(pid, NULL, 0);
+		return 1;
+	}
+	close(ready[0]);
+
+	proxy_a = props_test_client(&client_a);
+	proxy_b = props_test_client(&client_b);
+	if (!proxy_a || !proxy_b) {
+		fprintf(stderr, "dbus-props-test: unable to get the server objects\n");
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+		return 1;
+	}
+	props_test_value_seen(proxy_a, 0, "client a retrieved the value");
+	props_test_value_seen(proxy_b, 0, "client b retrieved the value");
+
+	/* an unmarked change retrieved by one client reaches the other */
+	props_test_bump_value(proxy_a);
+	props_test_check(ni_dbus_object_get_managed_objects(proxy_a->parent, &error, FALSE),
+			"client a retrieved the objects");
+	dbus_error_free(&error);
+	props_test_run();
+	props_test_value_seen(proxy_a, 1, "client a got the unmarked change");
+	props_test_value_seen(proxy_b, 1, "client b got the change retrieved by a");
+
+	/* the same applies to a GetAll of the service */
+	props_test_bump_value(proxy_b);
+	props_test_check(ni_dbus_object_refresh_properties(proxy_b, &props_test_service, &error),
+			"client b refreshed the properties");
+	dbus_error_free(&error);
+	props_test_run();
+	props_test_value_seen(proxy_b, 2, "client b got the unmarked change");
+	props_test_value_seen(proxy_a, 2, "client a got the change retrieved by b");
+
+	ni_dbus_object_call_variant(proxy_a, PROPS_TEST_INTERFACE, "quit",
+			0, NULL, 0, NULL, &error);
+	dbus_error_free(&error);
+	ni_dbus_client_free(client_a);
+	ni_dbus_client_free(client_b);
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "dbus-props-test: server failed\n");
+		props_test_failed++;
+	}
+
+	if (props_test_failed) {
+		fprintf(stderr, "%u dbus property test(s) failed\n", props_test_failed);
+		return 1;
+	}
+	printf("dbus property tests passed\n");
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Test the ovsdb client against a recorded ovsdb-server conversation,
+ * served over a socketpair: the replies are queued to the server end
+ * before the client sends the request, so no server process is needed.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include <wicked/util.h>
+#include <wicked/logging.h>
+#include <wicked/ovs.h>
+
+#include "ovsdb.h"
+#include "json.h"
+
+#define UUID_OVS	"a0000000-0000-0000-0000-000000000000"
+#define UUID_BR0	"b0000000-0000-0000-0000-000000000000"
+#define UUID_BR1	"b1000000-0000-0000-0000-000000000000"
+#define UUID_P_BR0	"c0000000-0000-0000-0000-000000000000"
+#define UUID_P_ETH0	"c1000000-0000-0000-0000-000000000000"
+#define UUID_P_ETH1	"c2000000-0000-0000-0000-000000000000"
+#define UUID_P_FAKE	"c3000000-0000-0000-0000-000000000000"
+#define UUID_P_ETH2	"c4000000-0000-0000-0000-000000000000"
+#define UUID_P_BR1	"c5000000-0000-0000-0000-000000000000"
+
+/*
+ * br0 with the ports eth0, eth1 and the fake bridge br0.10 (vlan 10)
+ * with the port eth2; br1 without ports.
+ */
+static const char *	ovsdb_test_monitor_reply =
+	"{\"id\":1,\"error\":null,\"result\":{"
+	"\"Open_vSwitch\":{\"" UUID_OVS "\":{\"new\":{\"cur_cfg\":5,\"next_cfg\":5}}},"
+	"\"Bridge\":{"
+	  "\"" UUID_BR0 "\":{\"new\":{\"name\":\"br0\",\"ports\":[\"set\",["
+	    "[\"uuid\",\"" UUID_P_BR0 "\"],[\"uuid\",\"" UUID_P_ETH0 "\"],"
+	    "[\"uuid\",\"" UUID_P_ETH1 "\"],[\"uuid\",\"" UUID_P_FAKE "\"],"
+	    "[\"uuid\",\"" UUID_P_ETH2 "\"]]]}},"
+	  "\"" UUID_BR1 "\":{\"new\":{\"name\":\"br1\",\"ports\":[\"uuid\",\"" UUID_P_BR1 "\"]}}},"
+	"\"Port\":{"
+	  "\"" UUID_P_BR0 "\":{\"new\":{\"name\":\"br0\",\"tag\":[\"set\",[]],\"fake_bridge\":false}},"
+	  "\"" UUID_P_ETH0 "\":{\"new\":{\"name\":\"eth0\",\"tag\":[\"set\",[]],\"fake_bridge\":false}},"
+	  "\"" UUID_P_ETH1 "\":{\"new\":{\"name\":\"eth1\",\"tag\":[\"set\",[]],\"fake_bridge\":false}},"
+	  "\"" UUID_P_FAKE "\":{\"new\":{\"name\":\"br0.10\",\"tag\":10,\"fake_bridge\":true}},"
+	  "\"" UUID_P_ETH2 "\":{\"new\":{\"name\":\"eth2\",\"tag\":10,\"fake_bridge\":false}},"
+	  "\"" UUID_P_BR1 "\":{\"new\":{\"name\":\"br1\",\"tag\":[\"set\",[]],\"fake_bridge\":false}}}"
+	"}}";
+
+/* eth1 got deleted and eth0 moved from br0 to br1 */
+static const char *	ovsdb_test_update =
+	"{\"id\":null,\"method\":\"update\",\"params\":[null,{"
+	"\"Bridge\":{"
+	  "\"" UUID_BR0 "\":{\"new\":{\"name\":\"br0\",\"ports\":[\"set\",["
+	    "[\"uuid\",\"" UUID_P_BR0 "\"],[\"uuid\",\"" UUID_P_FAKE "\"],"
+	    "[\"uuid\",\"" UUID_P_ETH2 "\"]]]}},"
+	  "\"" UUID_BR1 "\":{\"new\":{\"name\":\"br1\",\"ports\":[\"set\",["
+	    "[\"uuid\",\"" UUID_P_BR1 "\"],[\"uuid\",\"" UUID_P_ETH0 "\"]]]}}},"
+	"\"Port\":{"
+	  "\"" UUID_P_ETH1 "\":{\"old\":{\"name\":\"eth1\"}}}"
+	"}]}";
+
+/* the reply to the add-port transaction and the applied cur_cfg */
+static const char *	ovsdb_test_transact_reply =
+	"{\"id\":2,\"error\":null,\"result\":["
+	"{\"uuid\":[\"uuid\",\"d0000000-0000-0000-0000-000000000000\"]},"
+	"{\"uuid\":[\"uuid\",\"c6000000-0000-0000-0000-000000000000\"]},"
+	"{\"count\":1},{},{\"count\":1},{\"rows\":[{\"next_cfg\":6}]}]}";
+
+static const char *	ovsdb_test_cfg_update =
+	"{\"id\":null,\"method\":\"update\",\"params\":[null,{"
+	"\"Open_vSwitch\":{\"" UUID_OVS "\":{\"new\":{\"cur_cfg\":6,\"next_cfg\":6}}}"
+	"}]}";
+
+static const char *	ovsdb_test_transact_params =
+	"[\"Open_vSwitch\","
+	"{\"op\":\"insert\",\"table\":\"Interface\",\"uuid-name\":\"row1\",\"row\":{\"name\":\"eth3\"}},"
+	"{\"op\":\"insert\",\"table\":\"Port\",\"uuid-name\":\"row2\",\"row\":{\"name\":\"eth3\","
+	  "\"interfaces\":[\"named-uuid\",\"row1\"],\"tag\":10}},"
+	"{\"op\":\"mutate\",\"table\":\"Bridge\","
+	  "\"where\":[[\"_uuid\",\"==\",[\"uuid\",\"" UUID_BR0 "\"]]],"
+	  "\"mutations\":[[\"ports\",\"insert\",[\"set\",[[\"named-uuid\",\"row2\"]]]]]},"
+	"{\"op\":\"comment\",\"comment\":\"wicked: add-port br0.10 eth3\"},"
+	"{\"op\":\"mutate\",\"table\":\"Open_vSwitch\",\"where\":[],"
+	  "\"mutations\":[[\"next_cfg\",\"+=\",1]]},"
+	"{\"op\":\"select\",\"table\":\"Open_vSwitch\",\"where\":[],\"columns\":[\"next_cfg\"]}]";
+
+static unsigned int	ovsdb_test_failed;
+
+static void
+ovsdb_test_check(ni_bool_t ok, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		ovsdb_test_failed++;
+	}
+}
+
+static ni_bool_t
+ovsdb_test_send(int fd, const char *msg)
+{
+	size_t len = strlen(msg);
+
+	return write(fd, msg, len) == (ssize_t)len;
+}
+
+/*
+ * Read the request sent by the client and return its method and params
+ */
+static ni_json_t *
+ovsdb_test_recv(int fd, const char *method)
+{
+	char buf[65536];
+	ni_json_t *request, *params;
+	ssize_t len;
+
+	len = read(fd, buf, sizeof(buf) - 1);
+	if (len <= 0)
+		return NULL;
+	buf[len] = '\0';
+
+	request = ni_json_parse_string(buf);
+	if (!ni_string_eq(ni_json_string_value(ni_json_object_get_value(request,
+					"method")), method)) {
+		ni_json_free(request);
+		return NULL;
+	}
+	params = ni_json_object_ref_value(request, "params");
+	ni_json_free(request);
+	return params;
+}
+
+static ni_bool_t
+ovsdb_test_json_equal(ni_json_t *json, const char *expected)
+{
+	ni_stringbuf_t a = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_stringbuf_t b = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_json_t *exp;
+	ni_bool_t ret;
+
+	exp = ni_json_parse_string(expected);
+	ret = json && exp && ni_string_eq(ni_json_format_string(&a, json, NULL),
+					ni_json_format_string(&b, exp, NULL));
+	if (!ret)
+		fprintf(stderr, "got:      %s\nexpected: %s\n", a.string, b.string);
+
+	ni_stringbuf_destroy(&a);
+	ni_stringbuf_destroy(&b);
+	ni_json_free(exp);
+	return ret;
+}
+
+static ni_bool_t
+ovsdb_test_ports(ni_ovsdb_client_t *client, const char *brname, const char *expected)
+{
+	ni_stringbuf_t names = NI_STRINGBUF_INIT_DYNAMIC;
+	ni_ovs_bridge_port_array_t ports;
+	unsigned int i;
+	ni_bool_t ret;
+
+	ni_ovs_bridge_port_array_init(&ports);
+	if (ni_ovsdb_bridge_ports(client, brname, &ports) != 0)
+		return FALSE;
+
+	for (i = 0; i < ports.count; ++i) {
+		if (names.len)
+			ni_stringbuf_putc(&names, ' ');
+		ni_stringbuf_puts(&names, ports.data[i]->device.name);
+	}
+	ret = ni_string_eq(names.string ? names.string : "", expected);
+	if (!ret)
+		fprintf(stderr, "%s ports: '%s', expected '%s'\n", brname,
+				names.string ? names.string : "", expected);
+
+	ni_stringbuf_destroy(&names);
+	ni_ovs_bridge_port_array_destroy(&ports);
+	return ret;
+}
+
+static ni_bool_t
+ovsdb_test_port_bridge(ni_ovsdb_client_t *client, const char *pname, const char *expected)
+{
+	char *brname = NULL;
+	ni_bool_t ret;
+
+	if (ni_ovsdb_bridge_port_to_bridge(client, pname, &brname) != 0)
+		return expected == NULL;
+
+	ret = ni_string_eq(brname, expected);
+	ni_string_free(&brname);
+	return ret;
+}
+
+int
+main(int argc, char **argv)
+{
+	ni_ovsdb_client_t *client;
+	ni_ovsdb_txn_t *txn;
+	ni_json_t *params;
+	char *parent = NULL;
+	uint16_t vlan = 0;
+	int sv[2];
+
+	if (socketpair(AF_LOCAL, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sv) < 0) {
+		fprintf(stderr, "socketpair: %m\n");
+		return 1;
+	}
+
+	/* initial monitor request */
+	ovsdb_test_check(ovsdb_test_send(sv[1], ovsdb_test_monitor_reply), "queue monitor reply");
+	if (!(client = ni_ovsdb_client_open(sv[0]))) {
+		fprintf(stderr, "unable to open ovsdb client\n");
+		return 1;
+	}
+	params = ovsdb_test_recv(sv[1], "monitor");
+	ovsdb_test_check(params != NULL, "monitor request");
+	ni_json_free(params);
+
+	ovsdb_test_check(ni_ovsdb_bridge_exists(client, "br0") == 0, "br0 exists");
+	ovsdb_test_check(ni_ovsdb_bridge_exists(client, "br0.10") == 0, "fake br0.10 exists");
+	ovsdb_test_check(ni_ovsdb_bridge_exists(client, "eth0") == 2, "eth0 is not a bridge");
+	ovsdb_test_check(ovsdb_test_ports(client, "br0", "eth0 eth1"), "br0 ports");
+	ovsdb_test_check(ovsdb_test_ports(client, "br0.10", "eth2"), "fake br0.10 ports");
+	ovsdb_test_check(ovsdb_test_ports(client, "br1", ""), "br1 ports");
+	ovsdb_test_check(ni_ovsdb_bridge_to_parent(client, "br0.10", &parent) == 0 &&
+			ni_string_eq(parent, "br0"), "fake br0.10 parent");
+	ovsdb_test_check(ni_ovsdb_bridge_to_vlan(client, "br0.10", &vlan) == 0 &&
+			vlan == 10, "fake br0.10 vlan");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "eth0", "br0"), "eth0 bridge");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "eth1", "br0"), "eth1 bridge");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "eth2", "br0.10"), "eth2 bridge");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "br0.10", NULL), "fake bridge is no port");
+	ni_string_free(&parent);
+
+	/* update notification */
+	ovsdb_test_check(ovsdb_test_send(sv[1], ovsdb_test_update), "queue update");
+	ni_ovsdb_client_refresh(client);
+
+	ovsdb_test_check(ovsdb_test_ports(client, "br0", ""), "br0 ports after update");
+	ovsdb_test_check(ovsdb_test_ports(client, "br1", "eth0"), "br1 ports after update");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "eth0", "br1"), "eth0 moved to br1");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "eth1", NULL), "eth1 deleted");
+	ovsdb_test_check(ovsdb_test_port_bridge(client, "eth2", "br0.10"), "eth2 bridge after update");
+
+	/* transaction */
+	ovsdb_test_check(ovsdb_test_send(sv[1], ovsdb_test_transact_reply), "queue transact reply");
+	ovsdb_test_check(ovsdb_test_send(sv[1], ovsdb_test_cfg_update), "queue cfg update");
+
+	txn = ni_ovsdb_txn_new(client);
+	ovsdb_test_check(ni_ovsdb_txn_port_add(txn, "br0.10", "eth3", FALSE), "add port eth3");
+	ovsdb_test_check(!ni_ovsdb_txn_port_add(txn, "br0", "eth2", FALSE), "eth2 is in use");
+	ovsdb_test_check(ni_ovsdb_txn_commit(txn) == 0, "commit");
+	ni_ovsdb_txn_free(txn);
+
+	params = ovsdb_test_recv(sv[1], "transact");
+	ovsdb_test_check(ovsdb_test_json_equal(params, ovsdb_test_transact_params),
+			"transact request");
+	ni_json_free(params);
+
+	ni_ovsdb_client_free(client);
+	close(sv[1]);
+
+	if (ovsdb_test_failed) {
+		fprintf(stderr, "%u ovsdb test(s) failed\n", ovsdb_test_failed);
+		return 1;
+	}
+	printf("ovsdb tests passed\n");
+	return 0;
+}
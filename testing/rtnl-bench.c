@@ -0,0 +1,1167 @@
+/*
+ * Benchmark for the rtnetlink state discovery and event processing.
+ *
+ * Records rtnetlink dump responses and event streams to a file and
+ * replays them (or synthetic ones) via a netlink shim into the state
+ * refresh and the event listener -- without root or kernel interfaces.
+ *
+ *	rtnl-bench record <file> [seconds]
+ *	rtnl-bench replay <file>
+ *	rtnl-bench synth [--links N] [--addrs M] [--routes K] [--flaps F]
+ *			 [--output <file>]
+ *
+ * Reports the refresh time, the event throughput and per-event latency
+ * and the peak RSS of the process.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <net/if_arp.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <netlink/attr.h>
+#include <linux/rtnetlink.h>
+
+#include <wicked/logging.h>
+#include <wicked/socket.h>
+#include <wicked/netinfo.h>
+#include <wicked/route.h>
+#include <wicked/wireless.h>
+
+#include "netinfo_priv.h"
+#include "kernel.h"
+
+#define RTNL_BENCH_MAGIC	"WNLR"
+#define RTNL_BENCH_VERSION	1
+
+enum {
+	RTNL_BENCH_REQUEST = 1,
+	RTNL_BENCH_RESPONSE,
+	RTNL_BENCH_EVENT,
+};
+
+/*
+ * Recorded netlink buffers, in the order of the file
+ */
+typedef struct rtnl_bench_record {
+	unsigned int		kind;
+	uint64_t		time;
+	size_t			len;
+	unsigned char *		data;
+} rtnl_bench_record_t;
+
+typedef struct rtnl_bench_record_array {
+	unsigned int		count;
+	rtnl_bench_record_t *	data;
+} rtnl_bench_record_array_t;
+
+typedef struct rtnl_bench_file_header {
+	char			magic[4];
+	uint32_t		version;
+} rtnl_bench_file_header_t;
+
+typedef struct rtnl_bench_record_header {
+	uint32_t		kind;
+	uint32_t		len;
+	uint64_t		time;
+} rtnl_bench_record_header_t;
+
+/*
+ * Growing buffer to assemble responses in
+ */
+typedef struct rtnl_bench_buf {
+	unsigned char *		data;
+	size_t			len;
+	size_t			size;
+} rtnl_bench_buf_t;
+
+typedef struct rtnl_bench {
+	ni_nl_shim_t		shim;
+
+	uint64_t		start;
+	FILE *			record;
+	unsigned int		recorded;
+
+	rtnl_bench_record_array_t records;
+
+	/* pending responses to requests */
+	rtnl_bench_record_array_t responses;
+	unsigned int		response_next;
+	unsigned int		requests;
+
+	/* pending events and latency stats */
+	rtnl_bench_record_array_t events;
+	unsigned int		event_next;
+	uint64_t		event_last;
+	uint64_t *		latency;
+	unsigned int		latency_count;
+} rtnl_bench_t;
+
+static int		term_sig;
+static void		catch_term_signal(int);
+
+static uint64_t
+rtnl_bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+rtnl_bench_record_array_append(rtnl_bench_record_array_t *array, unsigned int kind,
+		uint64_t time, const void *data, size_t len)
+{
+	rtnl_bench_record_t *rec;
+
+	if ((array->count % 64) == 0) {
+		array->data = realloc(array->data, (array->count + 64) * sizeof(*rec));
+		if (!array->data)
+			ni_fatal("%s: out of memory", __func__);
+	}
+
+	rec = &array->data[array->count++];
+	rec->kind = kind;
+	rec->time = time;
+	rec->len  = len;
+	rec->data = malloc(len);
+	if (!rec->data)
+		ni_fatal("%s: out of memory", __func__);
+	memcpy(rec->data, data, len);
+}
+
+static void
+rtnl_bench_record_array_destroy(rtnl_bench_record_array_t *array)
+{
+	while (array->count)
+		free(array->data[--array->count].data);
+	free(array->data);
+	array->data = NULL;
+}
+
+static void
+rtnl_bench_buf_put(rtnl_bench_buf_t *buf, const void *data, size_t len)
+{
+	size_t need = buf->len + NLMSG_ALIGN(len);
+
+	if (need > buf->size) {
+		buf->size = need > 2 * buf->size ? need : 2 * buf->size;
+		if (!(buf->data = realloc(buf->data, buf->size)))
+			ni_fatal("%s: out of memory", __func__);
+	}
+	memcpy(buf->data + buf->len, data, len);
+	memset(buf->data + buf->len + len, 0, NLMSG_ALIGN(len) - len);
+	buf->len = need;
+}
+
+/*
+ * Record file I/O
+ */
+static ni_bool_t
+rtnl_bench_write_header(FILE *fp)
+{
+	rtnl_bench_file_header_t hdr;
+
+	memcpy(hdr.magic, RTNL_BENCH_MAGIC, sizeof(hdr.magic));
+	hdr.version = RTNL_BENCH_VERSION;
+	return fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+}
+
+static ni_bool_t
+rtnl_bench_write_record(FILE *fp, unsigned int kind, uint64_t time,
+		const void *data, size_t len)
+{
+	rtnl_bench_record_header_t hdr;
+
+	hdr.kind = kind;
+	hdr.len  = len;
+	hdr.time = time;
+	return fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+		fwrite(data, len, 1, fp) == 1;
+}
+
+static int
+rtnl_bench_save(const char *filename, const rtnl_bench_record_array_t *records)
+{
+	const rtnl_bench_record_t *rec;
+	unsigned int i;
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "w"))) {
+		ni_error("Cannot open %s for writing: %m", filename);
+		return -1;
+	}
+
+	if (!rtnl_bench_write_header(fp))
+		goto failure;
+
+	for (i = 0; i < records->count; ++i) {
+		rec = &records->data[i];
+		if (!rtnl_bench_write_record(fp, rec->kind, rec->time, rec->data, rec->len))
+			goto failure;
+	}
+
+	if (fclose(fp) == 0)
+		return 0;
+
+	ni_error("Cannot write %s: %m", filename);
+	return -1;
+
+failure:
+	ni_error("Cannot write %s: %m", filename);
+	fclose(fp);
+	return -1;
+}
+
+static int
+rtnl_bench_load(const char *filename, rtnl_bench_record_array_t *records)
+{
+	rtnl_bench_file_header_t hdr;
+	rtnl_bench_record_header_t rhdr;
+	unsigned char *data;
+	FILE *fp;
+
+	if (!(fp = fopen(filename, "r"))) {
+		ni_error("Cannot open %s: %m", filename);
+		return -1;
+	}
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, RTNL_BENCH_MAGIC, sizeof(hdr.magic)) ||
+	    hdr.version != RTNL_BENCH_VERSION) {
+		ni_error("%s: not a netlink record file", filename);
+		fclose(fp);
+		return -1;
+	}
+
+	while (fread(&rhdr, sizeof(rhdr), 1, fp) == 1) {
+		if (!rhdr.len || !(data = malloc(rhdr.len)))
+			break;
+		if (fread(data, rhdr.len, 1, fp) != 1) {
+			free(data);
+			break;
+		}
+		rtnl_bench_record_array_append(records, rhdr.kind, rhdr.time, data, rhdr.len);
+		free(data);
+	}
+
+	if (!feof(fp)) {
+		ni_error("%s: truncated or corrupt record file", filename);
+		fclose(fp);
+		return -1;
+	}
+	fclose(fp);
+	return 0;
+}
+
+/*
+ * Record shim: talk to the kernel and store everything passed through
+ */
+static int
+rtnl_bench_record_send(ni_nl_shim_t *shim, struct nl_sock *sk, struct nl_msg *msg)
+{
+	rtnl_bench_t *bench = shim->user_data;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+
+	rtnl_bench_write_record(bench->record, RTNL_BENCH_REQUEST,
+			rtnl_bench_now() - bench->start, nlh, nlh->nlmsg_len);
+	return nl_sendto(sk, nlh, nlh->nlmsg_len);
+}
+
+static int
+rtnl_bench_record_recv(ni_nl_shim_t *shim, struct nl_sock *sk,
+		struct sockaddr_nl *nla, unsigned char **buf)
+{
+	rtnl_bench_t *bench = shim->user_data;
+	int len;
+
+	if ((len = nl_recv(sk, nla, buf, NULL)) > 0) {
+		rtnl_bench_write_record(bench->record, RTNL_BENCH_RESPONSE,
+				rtnl_bench_now() - bench->start, *buf, len);
+	}
+	return len;
+}
+
+static int
+rtnl_bench_record_event(ni_nl_shim_t *shim, struct nl_sock *sk,
+		struct sockaddr_nl *nla, unsigned char **buf)
+{
+	rtnl_bench_t *bench = shim->user_data;
+	int len;
+
+	if ((len = nl_recv(sk, nla, buf, NULL)) > 0) {
+		bench->recorded++;
+		rtnl_bench_write_record(bench->record, RTNL_BENCH_EVENT,
+				rtnl_bench_now() - bench->start, *buf, len);
+	}
+	return len;
+}
+
+/*
+ * The event processing verifies the links using if_indextoname(3),
+ * which is interposed to know the replayed links, but not the kernel.
+ */
+enum {
+	RTNL_BENCH_IFNAME_UNKNOWN = 0,
+	RTNL_BENCH_IFNAME_PRESENT,
+	RTNL_BENCH_IFNAME_DELETED,
+};
+
+#define RTNL_BENCH_IFINDEX_MAX	(1U << 20)
+
+static struct rtnl_bench_ifnames {
+	unsigned int		count;
+	struct rtnl_bench_ifname {
+		unsigned int	state;
+		char		name[IF_NAMESIZE];
+	} *			data;
+} rtnl_bench_ifnames;
+
+static void
+rtnl_bench_ifname_update(const struct nlmsghdr *nlh)
+{
+	struct rtnl_bench_ifnames *names = &rtnl_bench_ifnames;
+	struct ifinfomsg *ifi;
+	struct nlattr *nla;
+	unsigned int count;
+
+	if (nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK)
+		return;
+	if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)))
+		return;
+
+	ifi = NLMSG_DATA(nlh);
+	if (ifi->ifi_index <= 0 || (unsigned int)ifi->ifi_index >= RTNL_BENCH_IFINDEX_MAX)
+		return;
+
+	if ((unsigned int)ifi->ifi_index >= names->count) {
+		count = ifi->ifi_index + 64;
+		names->data = realloc(names->data, count * sizeof(*names->data));
+		if (!names->data)
+			ni_fatal("%s: out of memory", __func__);
+		memset(names->data + names->count, 0,
+				(count - names->count) * sizeof(*names->data));
+		names->count = count;
+	}
+
+	if (nlh->nlmsg_type == RTM_DELLINK) {
+		names->data[ifi->ifi_index].state = RTNL_BENCH_IFNAME_DELETED;
+		return;
+	}
+
+	nla = nlmsg_find_attr((struct nlmsghdr *)nlh, sizeof(*ifi), IFLA_IFNAME);
+	if (nla) {
+		names->data[ifi->ifi_index].state = RTNL_BENCH_IFNAME_PRESENT;
+		nla_strlcpy(names->data[ifi->ifi_index].name, nla, IF_NAMESIZE);
+	}
+}
+
+char *
+if_indextoname(unsigned int ifindex, char ifname[IF_NAMESIZE])
+{
+	static char *(*real_if_indextoname)(unsigned int, char *);
+	struct rtnl_bench_ifnames *names = &rtnl_bench_ifnames;
+
+	if (ifindex < names->count) {
+		switch (names->data[ifindex].state) {
+		case RTNL_BENCH_IFNAME_PRESENT:
+			return strcpy(ifname, names->data[ifindex].name);
+		case RTNL_BENCH_IFNAME_DELETED:
+			errno = ENXIO;
+			return NULL;
+		default:
+			break;
+		}
+	}
+
+	if (!real_if_indextoname)
+		real_if_indextoname = dlsym(RTLD_NEXT, "if_indextoname");
+	if (!real_if_indextoname) {
+		errno = ENOSYS;
+		return NULL;
+	}
+	return real_if_indextoname(ifindex, ifname);
+}
+
+/*
+ * Replay shim: answer requests from the recorded dump responses and
+ * provide the recorded events one message per receive call.
+ */
+static int
+rtnl_bench_msg_family(const struct nlmsghdr *nlh)
+{
+	if (nlh->nlmsg_len < NLMSG_LENGTH(1))
+		return AF_UNSPEC;
+	return *(const unsigned char *)NLMSG_DATA(nlh);
+}
+
+static unsigned int
+rtnl_bench_msg_ifindex(const struct nlmsghdr *nlh)
+{
+	struct nlattr *nla;
+
+	switch (nlh->nlmsg_type) {
+	case RTM_NEWLINK:
+	case RTM_GETLINK:
+		if (nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg)))
+			return ((struct ifinfomsg *)NLMSG_DATA(nlh))->ifi_index;
+		break;
+
+	case RTM_NEWADDR:
+	case RTM_GETADDR:
+		if (nlh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifaddrmsg)))
+			return ((struct ifaddrmsg *)NLMSG_DATA(nlh))->ifa_index;
+		break;
+
+	case RTM_NEWROUTE:
+	case RTM_GETROUTE:
+		if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtmsg)))
+			break;
+		nla = nlmsg_find_attr((struct nlmsghdr *)nlh, sizeof(struct rtmsg), RTA_OIF);
+		if (nla)
+			return nla_get_u32(nla);
+		break;
+
+	default:
+		break;
+	}
+	return 0;
+}
+
+static const rtnl_bench_record_t *
+rtnl_bench_find_request(const rtnl_bench_record_array_t *records,
+		const struct nlmsghdr *req)
+{
+	const rtnl_bench_record_t *rec, *any = NULL;
+	const struct nlmsghdr *nlh;
+	int family = rtnl_bench_msg_family(req);
+	unsigned int i;
+
+	for (i = 0; i < records->count; ++i) {
+		rec = &records->data[i];
+		if (rec->kind != RTNL_BENCH_REQUEST)
+			continue;
+
+		nlh = (const struct nlmsghdr *)rec->data;
+		if (nlh->nlmsg_type != req->nlmsg_type)
+			continue;
+
+		if (rtnl_bench_msg_family(nlh) == family)
+			return rec;
+		if (!any && rtnl_bench_msg_family(nlh) == AF_UNSPEC)
+			any = rec;
+	}
+	return any;
+}
+
+static void
+rtnl_bench_put_responses(rtnl_bench_buf_t *buf, const rtnl_bench_record_array_t *records,
+		const rtnl_bench_record_t *req, const struct nlmsghdr *hdr)
+{
+	const rtnl_bench_record_t *rec, *end = records->data + records->count;
+	unsigned int ifindex = rtnl_bench_msg_ifindex(hdr);
+	int family = rtnl_bench_msg_family(hdr);
+	struct nlmsghdr *nlh, *res;
+	int len;
+
+	for (rec = req + 1; rec < end && rec->kind != RTNL_BENCH_REQUEST; ++rec) {
+		if (rec->kind != RTNL_BENCH_RESPONSE)
+			continue;
+
+		len = rec->len;
+		for (nlh = (struct nlmsghdr *)rec->data; nlmsg_ok(nlh, len);
+				nlh = nlmsg_next(nlh, &len)) {
+			if (nlh->nlmsg_type < RTM_BASE)
+				continue;
+			if (family != AF_UNSPEC && rtnl_bench_msg_family(nlh) != family)
+				continue;
+			if (ifindex && rtnl_bench_msg_ifindex(nlh) != ifindex)
+				continue;
+
+			rtnl_bench_buf_put(buf, nlh, nlh->nlmsg_len);
+			res = (struct nlmsghdr *)(buf->data + buf->len - NLMSG_ALIGN(nlh->nlmsg_len));
+			res->nlmsg_seq = hdr->nlmsg_seq;
+			res->nlmsg_pid = hdr->nlmsg_pid;
+			if (hdr->nlmsg_flags & NLM_F_DUMP)
+				res->nlmsg_flags |= NLM_F_MULTI;
+			else
+				res->nlmsg_flags &= ~NLM_F_MULTI;
+
+			/* a get request is answered by a single message */
+			if (!(hdr->nlmsg_flags & NLM_F_DUMP))
+				return;
+		}
+	}
+}
+
+static void
+rtnl_bench_put_status(rtnl_bench_buf_t *buf, const struct nlmsghdr *hdr,
+		int type, int error)
+{
+	struct {
+		struct nlmsghdr		nlh;
+		struct nlmsgerr		err;
+	} msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.nlh.nlmsg_type = type;
+	msg.nlh.nlmsg_seq  = hdr->nlmsg_seq;
+	msg.nlh.nlmsg_pid  = hdr->nlmsg_pid;
+	if (type == NLMSG_DONE) {
+		msg.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(int));
+		msg.nlh.nlmsg_flags = NLM_F_MULTI;
+	} else {
+		msg.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+		msg.err.error = error;
+		msg.err.msg = *hdr;
+	}
+	rtnl_bench_buf_put(buf, &msg, msg.nlh.nlmsg_len);
+}
+
+static int
+rtnl_bench_replay_send(ni_nl_shim_t *shim, struct nl_sock *sk, struct nl_msg *msg)
+{
+	rtnl_bench_t *bench = shim->user_data;
+	struct nlmsghdr *hdr = nlmsg_hdr(msg);
+	const rtnl_bench_record_t *req = NULL;
+	rtnl_bench_buf_t buf = { NULL, 0, 0 };
+	size_t len;
+
+	bench->requests++;
+	if (hdr->nlmsg_flags & NLM_F_REQUEST)
+		req = rtnl_bench_find_request(&bench->records, hdr);
+
+	if (req)
+		rtnl_bench_put_responses(&buf, &bench->records, req, hdr);
+
+	if (hdr->nlmsg_flags & NLM_F_DUMP) {
+		rtnl_bench_put_status(&buf, hdr, NLMSG_DONE, 0);
+	} else if (!buf.len && (hdr->nlmsg_type == RTM_GETLINK ||
+				hdr->nlmsg_type == RTM_GETADDR ||
+				hdr->nlmsg_type == RTM_GETROUTE)) {
+		rtnl_bench_put_status(&buf, hdr, NLMSG_ERROR, -ENODEV);
+	} else if (hdr->nlmsg_flags & NLM_F_ACK) {
+		rtnl_bench_put_status(&buf, hdr, NLMSG_ERROR, 0);
+	}
+
+	if (buf.len)
+		rtnl_bench_record_array_append(&bench->responses, RTNL_BENCH_RESPONSE,
+				0, buf.data, buf.len);
+	len = hdr->nlmsg_len;
+	free(buf.data);
+	return len;
+}
+
+static int
+rtnl_bench_replay_recv(ni_nl_shim_t *shim, struct nl_sock *sk,
+		struct sockaddr_nl *nla, unsigned char **buf)
+{
+	rtnl_bench_t *bench = shim->user_data;
+	rtnl_bench_record_t *rec;
+	int len;
+
+	if (bench->response_next >= bench->responses.count)
+		return -NLE_AGAIN;
+
+	rec = &bench->responses.data[bench->response_next++];
+	*buf = rec->data;
+	len  = rec->len;
+	rec->data = NULL;
+	rec->len  = 0;
+
+	if (bench->response_next == bench->responses.count) {
+		rtnl_bench_record_array_destroy(&bench->responses);
+		bench->response_next = 0;
+	}
+
+	memset(nla, 0, sizeof(*nla));
+	nla->nl_family = AF_NETLINK;
+	return len;
+}
+
+static int
+rtnl_bench_replay_event(ni_nl_shim_t *shim, struct nl_sock *sk,
+		struct sockaddr_nl *nla, unsigned char **buf)
+{
+	rtnl_bench_t *bench = shim->user_data;
+	rtnl_bench_record_t *rec;
+	uint64_t now, count;
+
+	now = rtnl_bench_now();
+	if (bench->event_last) {
+		bench->latency[bench->latency_count++] = now - bench->event_last;
+		bench->event_last = 0;
+	}
+
+	if (bench->event_next >= bench->events.count) {
+		if (read(shim->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+			return -nl_syserr2nlerr(errno);
+		return -NLE_AGAIN;
+	}
+
+	rec = &bench->events.data[bench->event_next++];
+	if (!(*buf = malloc(rec->len)))
+		return -NLE_NOMEM;
+	memcpy(*buf, rec->data, rec->len);
+	rtnl_bench_ifname_update((struct nlmsghdr *)rec->data);
+
+	memset(nla, 0, sizeof(*nla));
+	nla->nl_family = AF_NETLINK;
+	bench->event_last = rtnl_bench_now();
+	return rec->len;
+}
+
+/*
+ * Split the recorded event buffers into single messages and
+ * learn the names of the links in the recorded dumps.
+ */
+static void
+rtnl_bench_prepare_events(rtnl_bench_t *bench)
+{
+	const rtnl_bench_record_t *rec;
+	struct nlmsghdr *nlh;
+	unsigned int i;
+	int len;
+
+	for (i = 0; i < bench->records.count; ++i) {
+		rec = &bench->records.data[i];
+		if (rec->kind == RTNL_BENCH_RESPONSE) {
+			len = rec->len;
+			for (nlh = (struct nlmsghdr *)rec->data; nlmsg_ok(nlh, len);
+					nlh = nlmsg_next(nlh, &len))
+				rtnl_bench_ifname_update(nlh);
+		}
+		if (rec->kind != RTNL_BENCH_EVENT)
+			continue;
+
+		len = rec->len;
+		for (nlh = (struct nlmsghdr *)rec->data; nlmsg_ok(nlh, len);
+				nlh = nlmsg_next(nlh, &len)) {
+			rtnl_bench_record_array_append(&bench->events, RTNL_BENCH_EVENT,
+					rec->time, nlh, nlh->nlmsg_len);
+		}
+	}
+
+	bench->latency = calloc(bench->events.count + 1, sizeof(uint64_t));
+	if (!bench->latency)
+		ni_fatal("%s: out of memory", __func__);
+}
+
+/*
+ * Synthetic dumps and event storms: N links x M addresses x K routes
+ */
+typedef struct rtnl_bench_synth {
+	unsigned int		links;
+	unsigned int		addrs;
+	unsigned int		routes;
+	unsigned int		flaps;
+} rtnl_bench_synth_t;
+
+#define RTNL_BENCH_IFINDEX_BASE	1000
+
+static void
+rtnl_bench_synth_append(rtnl_bench_record_array_t *records, unsigned int kind,
+		struct nl_msg *msg)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+
+	rtnl_bench_record_array_append(records, kind, 0, nlh, nlh->nlmsg_len);
+	nlmsg_free(msg);
+}
+
+static void
+rtnl_bench_synth_request(rtnl_bench_record_array_t *records, int type)
+{
+	struct rtgenmsg rtg = { .rtgen_family = AF_UNSPEC };
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_simple(type, NLM_F_REQUEST | NLM_F_DUMP);
+	nlmsg_append(msg, &rtg, sizeof(rtg), NLMSG_ALIGNTO);
+	rtnl_bench_synth_append(records, RTNL_BENCH_REQUEST, msg);
+}
+
+static struct nl_msg *
+rtnl_bench_synth_link(int type, unsigned int link, ni_bool_t up)
+{
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+	unsigned char hwaddr[ETH_ALEN] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	char name[IFNAMSIZ];
+
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_type = ARPHRD_ETHER;
+	ifi.ifi_index = RTNL_BENCH_IFINDEX_BASE + link;
+	ifi.ifi_flags = IFF_BROADCAST | IFF_MULTICAST;
+	if (up)
+		ifi.ifi_flags |= IFF_UP | IFF_RUNNING | IFF_LOWER_UP;
+	ifi.ifi_change = ~0U;
+
+	hwaddr[3] = (link >> 16) & 0xff;
+	hwaddr[4] = (link >> 8) & 0xff;
+	hwaddr[5] = link & 0xff;
+	snprintf(name, sizeof(name), "bench%u", link);
+
+	msg = nlmsg_alloc_simple(type, 0);
+	nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+	nla_put_string(msg, IFLA_IFNAME, name);
+	nla_put_u32(msg, IFLA_MTU, 1500);
+	nla_put_u32(msg, IFLA_TXQLEN, 1000);
+	nla_put_u8(msg, IFLA_OPERSTATE, up ? IF_OPER_UP : IF_OPER_DOWN);
+	nla_put(msg, IFLA_ADDRESS, sizeof(hwaddr), hwaddr);
+	return msg;
+}
+
+static struct nl_msg *
+rtnl_bench_synth_addr(int type, unsigned int link, unsigned int addr)
+{
+	struct ifaddrmsg ifa;
+	struct nl_msg *msg;
+	struct in_addr in;
+
+	memset(&ifa, 0, sizeof(ifa));
+	ifa.ifa_family = AF_INET;
+	ifa.ifa_prefixlen = 24;
+	ifa.ifa_flags = IFA_F_PERMANENT;
+	ifa.ifa_scope = RT_SCOPE_UNIVERSE;
+	ifa.ifa_index = RTNL_BENCH_IFINDEX_BASE + link;
+
+	/* 10.<link>.<addr>/24 */
+	in.s_addr = htonl((10U << 24) | ((link & 0xffff) << 8) | ((addr % 254) + 1));
+
+	msg = nlmsg_alloc_simple(type, 0);
+	nlmsg_append(msg, &ifa, sizeof(ifa), NLMSG_ALIGNTO);
+	nla_put(msg, IFA_LOCAL, sizeof(in), &in);
+	nla_put(msg, IFA_ADDRESS, sizeof(in), &in);
+	return msg;
+}
+
+static struct nl_msg *
+rtnl_bench_synth_route(int type, unsigned int link, unsigned int route,
+		unsigned int routes)
+{
+	struct rtmsg rtm;
+	struct nl_msg *msg;
+	struct in_addr dst;
+	unsigned int n = link * routes + route;
+
+	memset(&rtm, 0, sizeof(rtm));
+	rtm.rtm_family = AF_INET;
+	rtm.rtm_dst_len = 32;
+	rtm.rtm_table = RT_TABLE_MAIN;
+	rtm.rtm_protocol = RTPROT_STATIC;
+	rtm.rtm_scope = RT_SCOPE_LINK;
+	rtm.rtm_type = RTN_UNICAST;
+
+	/* 172.16.0.0/12 host routes */
+	dst.s_addr = htonl((172U << 24) | (16U << 16) | (n & 0xfffff));
+
+	msg = nlmsg_alloc_simple(type, 0);
+	nlmsg_append(msg, &rtm, sizeof(rtm), NLMSG_ALIGNTO);
+	nla_put_u32(msg, RTA_TABLE, RT_TABLE_MAIN);
+	nla_put(msg, RTA_DST, sizeof(dst), &dst);
+	nla_put_u32(msg, RTA_OIF, RTNL_BENCH_IFINDEX_BASE + link);
+	return msg;
+}
+
+static void
+rtnl_bench_synth(const rtnl_bench_synth_t *synth, rtnl_bench_record_array_t *records)
+{
+	unsigned int i, j, f;
+
+	rtnl_bench_synth_request(records, RTM_GETLINK);
+	for (i = 0; i < synth->links; ++i) {
+		rtnl_bench_synth_append(records, RTNL_BENCH_RESPONSE,
+				rtnl_bench_synth_link(RTM_NEWLINK, i, TRUE));
+	}
+
+	rtnl_bench_synth_request(records, RTM_GETADDR);
+	for (i = 0; i < synth->links; ++i) {
+		for (j = 0; j < synth->addrs; ++j) {
+			rtnl_bench_synth_append(records, RTNL_BENCH_RESPONSE,
+					rtnl_bench_synth_addr(RTM_NEWADDR, i, j));
+		}
+	}
+
+	rtnl_bench_synth_request(records, RTM_GETROUTE);
+	for (i = 0; i < synth->links; ++i) {
+		for (j = 0; j < synth->routes; ++j) {
+			rtnl_bench_synth_append(records, RTNL_BENCH_RESPONSE,
+					rtnl_bench_synth_route(RTM_NEWROUTE, i, j, synth->routes));
+		}
+	}
+
+	/* flap storm: link down/up, first address and route deleted/re-added */
+	for (f = 0; f < synth->flaps; ++f) {
+		for (i = 0; i < synth->links; ++i) {
+			rtnl_bench_synth_append(records, RTNL_BENCH_EVENT,
+					rtnl_bench_synth_link(RTM_NEWLINK, i, FALSE));
+			if (synth->addrs) {
+				rtnl_bench_synth_append(records, RTNL_BENCH_EVENT,
+						rtnl_bench_synth_addr(RTM_DELADDR, i, 0));
+			}
+			if (synth->routes) {
+				rtnl_bench_synth_append(records, RTNL_BENCH_EVENT,
+						rtnl_bench_synth_route(RTM_DELROUTE, i, 0, synth->routes));
+			}
+			rtnl_bench_synth_append(records, RTNL_BENCH_EVENT,
+					rtnl_bench_synth_link(RTM_NEWLINK, i, TRUE));
+			if (synth->addrs) {
+				rtnl_bench_synth_append(records, RTNL_BENCH_EVENT,
+						rtnl_bench_synth_addr(RTM_NEWADDR, i, 0));
+			}
+			if (synth->routes) {
+				rtnl_bench_synth_append(records, RTNL_BENCH_EVENT,
+						rtnl_bench_synth_route(RTM_NEWROUTE, i, 0, synth->routes));
+			}
+		}
+	}
+}
+
+/*
+ * Event handlers -- the processing into the netconfig is measured,
+ * the handlers itself do nothing.
+ */
+static void
+rtnl_bench_interface_event(ni_netdev_t *dev, ni_event_t event)
+{
+}
+
+static void
+rtnl_bench_interface_addr_event(ni_netdev_t *dev, ni_event_t event, const ni_address_t *ap)
+{
+}
+
+static void
+rtnl_bench_route_event(ni_netconfig_t *nc, ni_event_t event, const ni_route_t *rp)
+{
+}
+
+static int
+rtnl_bench_listen(void)
+{
+	if (ni_server_listen_interface_events(rtnl_bench_interface_event) < 0 ||
+	    ni_server_enable_interface_addr_events(rtnl_bench_interface_addr_event) < 0 ||
+	    ni_server_enable_route_events(rtnl_bench_route_event) < 0) {
+		ni_error("Cannot enable rtnetlink event listener");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Reporting
+ */
+static int
+rtnl_bench_latency_cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void
+rtnl_bench_report_state(ni_netconfig_t *nc)
+{
+	unsigned int links = 0, addrs = 0, routes = 0;
+	ni_route_table_t *tab;
+	ni_netdev_t *dev;
+
+	for (dev = ni_netconfig_devlist(nc); dev; dev = dev->next) {
+		links++;
+		addrs += ni_address_list_count(dev->addrs);
+		for (tab = dev->routes; tab; tab = tab->next)
+			routes += tab->routes.count;
+	}
+	printf("state:     %u links, %u addresses, %u routes\n", links, addrs, routes);
+}
+
+static void
+rtnl_bench_report_events(rtnl_bench_t *bench, uint64_t elapsed)
+{
+	uint64_t *lat = bench->latency, sum = 0;
+	unsigned int i, n = bench->latency_count;
+
+	if (!n) {
+		printf("events:    none\n");
+		return;
+	}
+
+	qsort(lat, n, sizeof(*lat), rtnl_bench_latency_cmp);
+	for (i = 0; i < n; ++i)
+		sum += lat[i];
+
+	printf("events:    %u in %.3f ms, %.0f events/s\n", n, elapsed / 1000.0,
+			elapsed ? n * 1000000.0 / elapsed : 0.0);
+	printf("latency:   min %llu avg %.1f p50 %llu p99 %llu max %llu usec\n",
+			(unsigned long long)lat[0], (double)sum / n,
+			(unsigned long long)lat[n / 2],
+			(unsigned long long)lat[(n * 99) / 100],
+			(unsigned long long)lat[n - 1]);
+}
+
+static void
+rtnl_bench_report_rss(const char *what)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		printf("peak rss:  %ld KiB %s\n", ru.ru_maxrss, what);
+}
+
+/*
+ * Modes
+ */
+static int
+rtnl_bench_record(rtnl_bench_t *bench, const char *filename, unsigned int seconds)
+{
+	uint64_t end;
+
+	if (!(bench->record = fopen(filename, "w")) ||
+	    !rtnl_bench_write_header(bench->record)) {
+		ni_error("Cannot open %s for writing: %m", filename);
+		return 1;
+	}
+
+	bench->shim.request_send = rtnl_bench_record_send;
+	bench->shim.request_recv = rtnl_bench_record_recv;
+	bench->shim.event_recv   = rtnl_bench_record_event;
+	bench->shim.event_fd     = -1;
+	bench->start = rtnl_bench_now();
+	if (ni_nl_shim_install(&bench->shim) < 0)
+		return 1;
+
+	if (!ni_global_state_handle(1) || rtnl_bench_listen() < 0)
+		return 1;
+
+	printf("recording events for %u seconds to %s\n", seconds, filename);
+	end = bench->start + seconds * 1000000ULL;
+	while (!term_sig && rtnl_bench_now() < end) {
+		long timeout = ni_timer_next_timeout();
+		long remain = (end - rtnl_bench_now()) / 1000 + 1;
+
+		if (timeout < 0 || timeout > remain)
+			timeout = remain;
+		if (ni_socket_wait(timeout) != 0)
+			break;
+	}
+
+	ni_server_deactivate_interface_events();
+	if (fclose(bench->record) != 0) {
+		ni_error("Cannot write %s: %m", filename);
+		return 1;
+	}
+	printf("recorded %u event buffers\n", bench->recorded);
+	return 0;
+}
+
+static int
+rtnl_bench_replay(rtnl_bench_t *bench)
+{
+	ni_netconfig_t *nc;
+	uint64_t begin, elapsed;
+	int efd;
+
+	if ((efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		ni_error("Cannot create eventfd: %m");
+		return 1;
+	}
+
+	bench->shim.request_send = rtnl_bench_replay_send;
+	bench->shim.request_recv = rtnl_bench_replay_recv;
+	bench->shim.event_recv   = rtnl_bench_replay_event;
+	bench->shim.event_fd     = efd;
+	if (ni_nl_shim_install(&bench->shim) < 0)
+		return 1;
+
+	rtnl_bench_prepare_events(bench);
+
+	begin = rtnl_bench_now();
+	if (!(nc = ni_global_state_handle(1))) {
+		ni_error("Cannot refresh state from replayed dumps");
+		return 1;
+	}
+	elapsed = rtnl_bench_now() - begin;
+	printf("refresh:   %.3f ms, %u requests\n", elapsed / 1000.0, bench->requests);
+	rtnl_bench_report_state(nc);
+	rtnl_bench_report_rss("after refresh");
+
+	if (rtnl_bench_listen() < 0)
+		return 1;
+
+	if (bench->events.count) {
+		uint64_t one = 1;
+
+		if (write(efd, &one, sizeof(one)) != sizeof(one)) {
+			ni_error("Cannot signal eventfd: %m");
+			return 1;
+		}
+	}
+
+	begin = rtnl_bench_now();
+	while (!term_sig && (bench->event_next < bench->events.count || bench->event_last)) {
+		if (ni_socket_wait(ni_timer_next_timeout()) != 0)
+			break;
+	}
+	elapsed = rtnl_bench_now() - begin;
+
+	rtnl_bench_report_events(bench, elapsed);
+	rtnl_bench_report_state(nc);
+	rtnl_bench_report_rss("after events");
+
+	ni_server_deactivate_interface_events();
+	close(efd);
+	return 0;
+}
+
+enum {
+	OPT_DEBUG,
+	OPT_LINKS,
+	OPT_ADDRS,
+	OPT_ROUTES,
+	OPT_FLAPS,
+	OPT_OUTPUT,
+};
+
+static struct option	options[] = {
+	{ "debug",		required_argument,	NULL,	OPT_DEBUG },
+	{ "links",		required_argument,	NULL,	OPT_LINKS },
+	{ "addrs",		required_argument,	NULL,	OPT_ADDRS },
+	{ "routes",		required_argument,	NULL,	OPT_ROUTES },
+	{ "flaps",		required_argument,	NULL,	OPT_FLAPS },
+	{ "output",		required_argument,	NULL,	OPT_OUTPUT },
+
+	{ NULL }
+};
+
+int
+main(int argc, char **argv)
+{
+	rtnl_bench_synth_t synth = { .links = 100, .addrs = 4, .routes = 10, .flaps = 10 };
+	const char *opt_output = NULL;
+	const char *command, *filename = NULL;
+	rtnl_bench_t bench;
+	unsigned int seconds = 10;
+	int c, rv;
+
+	while ((c = getopt_long(argc, argv, "", options, NULL)) != EOF) {
+		switch (c) {
+		default:
+		usage:
+			fprintf(stderr,
+				"./rtnl-bench [--debug <facility>] record <file> [seconds]\n"
+				"./rtnl-bench [--debug <facility>] replay <file>\n"
+				"./rtnl-bench [--debug <facility>] synth [--links N] [--addrs M]"
+					" [--routes K] [--flaps F] [--output <file>]\n"
+			       );
+			return 1;
+
+		case OPT_DEBUG:
+			if (ni_enable_debug(optarg) < 0) {
+				fprintf(stderr, "Bad debug facility \"%s\"\n", optarg);
+				return 1;
+			}
+			break;
+
+		case OPT_LINKS:
+			if (ni_parse_uint(optarg, &synth.links, 10) < 0)
+				goto usage;
+			break;
+
+		case OPT_ADDRS:
+			if (ni_parse_uint(optarg, &synth.addrs, 10) < 0)
+				goto usage;
+			break;
+
+		case OPT_ROUTES:
+			if (ni_parse_uint(optarg, &synth.routes, 10) < 0)
+				goto usage;
+			break;
+
+		case OPT_FLAPS:
+			if (ni_parse_uint(optarg, &synth.flaps, 10) < 0)
+				goto usage;
+			break;
+
+		case OPT_OUTPUT:
+			opt_output = optarg;
+			break;
+		}
+	}
+
+	if (optind >= argc)
+		goto usage;
+	command = argv[optind++];
+
+	if (!strcmp(command, "record") || !strcmp(command, "replay")) {
+		if (optind >= argc)
+			goto usage;
+		filename = argv[optind++];
+	}
+	if (!strcmp(command, "record") && optind < argc) {
+		if (ni_parse_uint(argv[optind++], &seconds, 10) < 0)
+			goto usage;
+	}
+	if (optind < argc)
+		goto usage;
+
+	signal(SIGINT,  catch_term_signal);
+	signal(SIGTERM, catch_term_signal);
+
+	if (ni_init("rtnl-bench") < 0)
+		return 1;
+
+	ni_wireless_set_scanning(FALSE);
+
+	memset(&bench, 0, sizeof(bench));
+	bench.shim.user_data = &bench;
+
+	if (!strcmp(command, "record")) {
+		rv = rtnl_bench_record(&bench, filename, seconds);
+	} else
+	if (!strcmp(command, "replay")) {
+		if (rtnl_bench_load(filename, &bench.records) < 0)
+			return 1;
+		rv = rtnl_bench_replay(&bench);
+	} else
+	if (!strcmp(command, "synth")) {
+		printf("synth:     %u links x %u addresses x %u routes, %u flaps\n",
+				synth.links, synth.addrs, synth.routes, synth.flaps);
+		rtnl_bench_synth(&synth, &bench.records);
+		if (opt_output && rtnl_bench_save(opt_output, &bench.records) < 0)
+			return 1;
+		rv = rtnl_bench_replay(&bench);
+	} else {
+		goto usage;
+	}
+
+	rtnl_bench_record_array_destroy(&bench.records);
+	rtnl_bench_record_array_destroy(&bench.responses);
+	rtnl_bench_record_array_destroy(&bench.events);
+	free(rtnl_bench_ifnames.data);
+	free(bench.latency);
+	return rv;
+}
+
+static void
+catch_term_signal(int sig)
+{
+	term_sig = sig;
+}
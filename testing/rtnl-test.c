@@ -4,6 +4,8 @@
 #include <signal.h>
 #include <netinet/in.h>
 #include <netlink/netlink.h>
+#include <netlink/msg.h>
+#include <linux/rtnetlink.h>
 
 #include <wicked/logging.h>
 #include <wicked/socket.h>
@@ -12,6 +14,7 @@
 #include <wicked/ipv6.h>
 
 #include "netinfo_priv.h"
+#include "kernel.h"
 
 
 /*
@@ -29,6 +32,7 @@ static void		rtnl_test_interface_addr_event(ni_netdev_t *, ni_event_t,
 static void		rtnl_test_interface_prefix_event(ni_netdev_t *, ni_event_t,
 							const ni_ipv6_ra_pinfo_t *);
 static void		rtnl_test_interface_ndopt_event(ni_netdev_t *, ni_event_t);
+static int		rtnl_test_batch(void);
 
 int main(int argc, char **argv)
 {
@@ -49,6 +53,9 @@ int main(int argc, char **argv)
 	if( ni_global_state_handle(1) == NULL)
 		ni_fatal("cannot refresh global state!");
 
+	if (argc > 1 && ni_string_eq(argv[1], "--batch"))
+		return rtnl_test_batch() ? 1 : 0;
+
 	ni_server_listen_interface_events(rtnl_test_interface_event);
 	ni_server_enable_interface_addr_events(rtnl_test_interface_addr_event);
 	ni_server_enable_interface_prefix_events(rtnl_test_interface_prefix_event);
@@ -140,3 +147,74 @@ rtnl_test_interface_ndopt_event(ni_netdev_t *dev, ni_event_t ev)
 	ni_server_trace_interface_nduseropt_events(dev, ev);
 }
 
+
+/*
+ * Send a batch of link requests spanning several windows and verify,
+ * that the (N)ACK of each request is mapped to its batch entry:
+ * the (no-op) changes of the loopback succeed, the deletion of an
+ * ifindex which does not exist fails with ENODEV (NLE_NODEV).
+ * Afterwards, regular requests on the shared socket have to succeed.
+ * Needs CAP_NET_ADMIN, but does not modify any interface.
+ */
+#define RTNL_TEST_BATCH_COUNT		150
+#define RTNL_TEST_BATCH_NOINDEX		0x7fff0000
+
+static int
+rtnl_test_batch(void)
+{
+	ni_nl_batch_t batch = NI_NL_BATCH_INIT;
+	struct ni_nlmsg_list list;
+	struct ifinfomsg ifi;
+	struct nl_msg *msg;
+	unsigned int i, failed = 0;
+	int expected, err;
+
+	for (i = 0; i < RTNL_TEST_BATCH_COUNT; ++i) {
+		memset(&ifi, 0, sizeof(ifi));
+		ifi.ifi_family = AF_UNSPEC;
+		ifi.ifi_index = (i % 3) ? 1 : RTNL_TEST_BATCH_NOINDEX + i;
+
+		msg = nlmsg_alloc_simple((i % 3) ? RTM_NEWLINK : RTM_DELLINK,
+					NLM_F_REQUEST);
+		if (!msg || nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO) < 0) {
+			nlmsg_free(msg);
+			ni_error("batch: unable to build request %u", i);
+			goto cleanup;
+		}
+		if (!ni_nl_batch_append(&batch, msg, NULL)) {
+			ni_error("batch: unable to append request %u", i);
+			goto cleanup;
+		}
+	}
+
+	if ((err = ni_nl_batch_talk(&batch)) < 0) {
+		ni_error("batch: transaction failed: %s", nl_geterror(err));
+		failed++;
+	}
+
+	for (i = 0; i < batch.count; ++i) {
+		expected = (i % 3) ? 0 : -NLE_NODEV;
+		if (batch.data[i].error == expected && batch.data[i].seq)
+			continue;
+
+		ni_error("batch: request %u (seq %u): error %d, expected %d",
+				i, batch.data[i].seq, batch.data[i].error, expected);
+		failed++;
+	}
+
+	ni_nlmsg_list_init(&list);
+	if ((err = ni_nl_get_link_store(1, &list)) < 0 || !list.head) {
+		ni_error("batch: request after transaction failed: %s",
+				nl_geterror(err));
+		failed++;
+	}
+	ni_nlmsg_list_destroy(&list);
+
+	ni_trace("batch: %u requests, %u failed", batch.count, failed);
+
+cleanup:
+	if (batch.count != RTNL_TEST_BATCH_COUNT)
+		failed++;
+	ni_nl_batch_destroy(&batch);
+	return failed ? -1 : 0;
+}
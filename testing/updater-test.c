@@ -0,0 +1,289 @@
+/*
+ * Test the builtin resolver updater: a burst of lease install and remove
+ * jobs has to result in a single merged resolv.conf write, the original
+ * file has to be restored after the last lease is removed and a symlink
+ * has to be left alone.
+ *
+ * The updater writes the real /etc/resolv.conf, so the test has to run
+ * as root and mounts a tmpfs over /etc in a private mount namespace.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sched.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/time.h>
+#include <resolv.h>
+
+#include <wicked/netinfo.h>
+#include <wicked/logging.h>
+#include <wicked/addrconf.h>
+#include <wicked/resolver.h>
+#include <wicked/system.h>
+#include <wicked/socket.h>
+
+#include "netinfo_priv.h"
+#include "appconfig.h"
+
+#define UPDATER_TEST_DELAY	1000	/* > builtin updater delay */
+
+static const char *	updater_test_config =
+	"<config>\n"
+	"  <statedir path=\"%s\"/>\n"
+	"  <system-updater name=\"resolver\" backend=\"builtin\"/>\n"
+	"</config>\n";
+
+static const char *	updater_test_orig = "nameserver 192.0.2.1\n";
+
+static unsigned int	updater_test_failed;
+static int		updater_test_inotify = -1;
+
+static void
+updater_test_check(ni_bool_t ok, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		updater_test_failed++;
+	}
+}
+
+static ni_bool_t
+updater_test_write(const char *path, const char *data)
+{
+	FILE *fp;
+
+	if (!(fp = fopen(path, "w")))
+		return FALSE;
+	fputs(data, fp);
+	return fclose(fp) == 0;
+}
+
+static ni_bool_t
+updater_test_content(const char *path, const char *data)
+{
+	char buf[256];
+	size_t len;
+	FILE *fp;
+
+	if (!(fp = fopen(path, "r")))
+		return FALSE;
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	fclose(fp);
+	buf[len] = '\0';
+	return ni_string_eq(buf, data);
+}
+
+/*
+ * Run the timers for a while and return the number of times a file in
+ * /etc has been replaced (rename) or written (restore copy) meanwhile.
+ */
+static unsigned int
+updater_test_run(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	struct timeval start, now, delta;
+	unsigned int writes = 0;
+	long timeout, left;
+	ssize_t len;
+	char *ptr;
+
+	ni_timer_get_time(&start);
+	do {
+		ni_timer_get_time(&now);
+		timersub(&now, &start, &delta);
+		left = UPDATER_TEST_DELAY - (delta.tv_sec * 1000 + delta.tv_usec / 1000);
+		if (left <= 0)
+			break;
+
+		timeout = ni_timer_next_timeout();
+		if (timeout < 0 || timeout > left)
+			timeout = left;
+		ni_socket_wait(timeout);
+	} while (1);
+
+	while ((len = read(updater_test_inotify, buf, sizeof(buf))) > 0) {
+		for (ptr = buf; ptr < buf + len; ptr += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)ptr;
+			if (!ev->len || ni_string_eq(ev->name, "resolv.conf.new"))
+				continue;
+			writes++;
+		}
+	}
+	return writes;
+}
+
+static ni_addrconf_lease_t *
+updater_test_lease(const char *domain, const char *server)
+{
+	ni_addrconf_lease_t *lease;
+
+	lease = ni_addrconf_lease_new(NI_ADDRCONF_DHCP, AF_INET);
+	lease->update = NI_BIT(NI_ADDRCONF_UPDATE_DNS);
+	lease->resolver = ni_resolver_info_new();
+	ni_string_dup(&lease->resolver->default_domain, domain);
+	ni_string_array_append(&lease->resolver->dns_servers, server);
+	return lease;
+}
+
+static void
+updater_test_update(ni_addrconf_lease_t *lease, ni_bool_t install,
+		unsigned int ifindex, const char *ifname)
+{
+	if (install) {
+		lease->state = NI_ADDRCONF_STATE_GRANTED;
+		ni_addrconf_updater_new_applying(lease, NULL, NI_EVENT_ADDRESS_ACQUIRED);
+	} else {
+		lease->state = NI_ADDRCONF_STATE_RELEASED;
+		ni_addrconf_updater_new_removing(lease, NULL, NI_EVENT_ADDRESS_RELEASED);
+	}
+
+	/* builtin updater jobs finish at once, the write is deferred */
+	updater_test_check(ni_system_update_from_lease(lease, ifindex, ifname) == 0,
+			"update job finished");
+	ni_addrconf_updater_free(&lease->updater);
+}
+
+static void
+updater_test_servers(const char *domain, const char *s1, const char *s2, const char *s3,
+		const char *what)
+{
+	ni_resolver_info_t *resolver;
+	ni_bool_t ok;
+
+	resolver = ni_resolver_parse_resolv_conf(_PATH_RESOLV_CONF);
+	ok = resolver && ni_string_eq(resolver->default_domain, domain) &&
+		resolver->dns_servers.count == (s3 ? 3U : 2U) &&
+		ni_string_eq(resolver->dns_servers.data[0], s1) &&
+		ni_string_eq(resolver->dns_servers.data[1], s2) &&
+		(!s3 || ni_string_eq(resolver->dns_servers.data[2], s3));
+	updater_test_check(ok, what);
+	ni_resolver_info_free(resolver);
+}
+
+int
+main(void)
+{
+	char tmpdir[] = "/tmp/updater-test.XXXXXX";
+	ni_addrconf_lease_t *a, *b, *c;
+	char config[PATH_MAX];
+	char *data = NULL;
+	struct stat stb;
+
+	if (geteuid() != 0) {
+		fprintf(stderr, "updater-test: has to run as root\n");
+		return 1;
+	}
+
+	if (!mkdtemp(tmpdir)) {
+		perror("mkdtemp");
+		return 1;
+	}
+	snprintf(config, sizeof(config), "%s/config.xml", tmpdir);
+	ni_string_printf(&data, updater_test_config, tmpdir);
+	if (!updater_test_write(config, data)) {
+		perror(config);
+		return 1;
+	}
+	ni_string_free(&data);
+
+	ni_set_global_config_path(config);
+	if (ni_init("updater-test") < 0)
+		return 1;
+
+	if (unshare(CLONE_NEWNS) < 0 ||
+	    mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) < 0 ||
+	    mount("tmpfs", "/etc", "tmpfs", 0, "mode=0755") < 0) {
+		perror("unable to mount a private /etc");
+		return 1;
+	}
+
+	if (!updater_test_write(_PATH_RESOLV_CONF, updater_test_orig))
+		return 1;
+
+	updater_test_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (updater_test_inotify < 0 ||
+	    inotify_add_watch(updater_test_inotify, "/etc", IN_MOVED_TO | IN_CLOSE_WRITE) < 0) {
+		perror("inotify");
+		return 1;
+	}
+
+	a = updater_test_lease("example.com", "192.0.2.11");
+	b = updater_test_lease("example.net", "192.0.2.12");
+	c = updater_test_lease(NULL, "192.0.2.11");
+	ni_string_array_append(&c->resolver->dns_servers, "192.0.2.13");
+
+	/* a burst of installs is merged into one write */
+	updater_test_update(a, TRUE, 1001, "test-a");
+	updater_test_update(b, TRUE, 1002, "test-b");
+	updater_test_update(c, TRUE, 1003, "test-c");
+	updater_test_check(updater_test_run() == 1, "install burst written once");
+	updater_test_servers("example.com", "192.0.2.11", "192.0.2.12", "192.0.2.13",
+			"install burst merged");
+
+	/* renewals with unchanged settings do not write */
+	updater_test_update(a, TRUE, 1001, "test-a");
+	updater_test_update(b, TRUE, 1002, "test-b");
+	updater_test_check(updater_test_run() == 0, "unchanged renewal not written");
+
+	/* a change and a removal keep the lease order */
+	ni_string_array_destroy(&b->resolver->dns_servers);
+	ni_string_array_append(&b->resolver->dns_servers, "192.0.2.14");
+	updater_test_update(b, TRUE, 1002, "test-b");
+	updater_test_update(c, FALSE, 1003, "test-c");
+	updater_test_check(updater_test_run() == 1, "change and removal written once");
+	updater_test_servers("example.com", "192.0.2.11", "192.0.2.14", NULL,
+			"change and removal merged");
+
+	/* removing the last lease restores the original file */
+	updater_test_update(a, FALSE, 1001, "test-a");
+	updater_test_update(b, FALSE, 1002, "test-b");
+	updater_test_check(updater_test_run() == 1, "restore written once");
+	updater_test_check(updater_test_content(_PATH_RESOLV_CONF, updater_test_orig),
+			"original file restored");
+
+	/* a symlink to a file of another service is not modified */
+	if (unlink(_PATH_RESOLV_CONF) < 0 ||
+	    !updater_test_write("/etc/resolv.conf.other", updater_test_orig) ||
+	    symlink("resolv.conf.other", _PATH_RESOLV_CONF) < 0) {
+		perror("unable to create resolv.conf symlink");
+		return 1;
+	}
+	updater_test_run();
+
+	updater_test_update(a, TRUE, 1001, "test-a");
+	updater_test_check(updater_test_run() == 0, "symlink not written");
+	updater_test_check(lstat(_PATH_RESOLV_CONF, &stb) == 0 && S_ISLNK(stb.st_mode),
+			"symlink kept");
+	updater_test_check(updater_test_content(_PATH_RESOLV_CONF, updater_test_orig),
+			"symlink target unchanged");
+	updater_test_update(a, FALSE, 1001, "test-a");
+	updater_test_check(updater_test_run() == 0, "symlink not restored");
+
+	ni_addrconf_lease_free(a);
+	ni_addrconf_lease_free(b);
+	ni_addrconf_lease_free(c);
+	close(updater_test_inotify);
+
+	unlink(config);
+	rmdir(ni_config_backupdir());
+	rmdir(tmpdir);
+
+	if (updater_test_failed) {
+		fprintf(stderr, "%u updater test(s) failed\n", updater_test_failed);
+		return 1;
+	}
+	printf("updater tests passed\n");
+	return 0;
+}
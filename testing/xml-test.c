@@ -8,7 +8,14 @@
 #endif
 
 #include <stdlib.h>
+#include <wicked/logging.h>
+#include <wicked/util.h>
 #include <wicked/xml.h>
+#include <wicked/dbus.h>
+
+#include "xml-schema.h"
+
+static int		xml_test_arena(void);
 
 int
 main(int argc, char **argv)
@@ -17,9 +24,13 @@ main(int argc, char **argv)
 	xml_document_t *doc;
 
 	if (argc != 2) {
-		fprintf(stderr, "Usage: xml-test filename\n");
+		fprintf(stderr, "Usage: xml-test filename\n"
+				"       xml-test --arena\n");
 		return 1;
 	}
+	if (ni_string_eq(argv[1], "--arena"))
+		return xml_test_arena();
+
 	filename = argv[1];
 
 	doc = xml_document_read(filename);
@@ -33,3 +44,108 @@ main(int argc, char **argv)
 	return 0;
 }
 
+/*
+ * The reader allocates the nodes, interned names and cdata of a document
+ * from an arena; modify such nodes after parsing and make sure that the
+ * arena owned strings are not freed or changed beneath the other nodes.
+ */
+static const char *	xml_test_arena_doc =
+	"<root a=\"1\" b=\"2\">\n"
+	"  <item>one</item>\n"
+	"  <item>two</item>\n"
+	"  <meta:data>three</meta:data>\n"
+	"</root>\n";
+
+static const char *	xml_test_arena_schema =
+	"<define name=\"x\" type=\"uint32\">\n"
+	"  <meta:bar/>\n"
+	"</define>\n";
+
+static unsigned int	xml_test_failed;
+
+static void
+xml_test_check(ni_bool_t ok, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAILED: %s\n", what);
+		xml_test_failed++;
+	}
+}
+
+static int
+xml_test_arena(void)
+{
+	xml_node_t *root, *first, *second, *meta;
+	xml_document_t *doc;
+	ni_xs_scope_t *scope;
+	ni_xs_type_t *type;
+
+	doc = xml_document_from_string(xml_test_arena_doc, "arena-test");
+	if (!doc || !(root = xml_document_root(doc)) || !(root = root->children)) {
+		fprintf(stderr, "Error parsing arena test document\n");
+		return 1;
+	}
+
+	first  = xml_node_get_child(root, "item");
+	second = first ? xml_node_get_next_child(root, "item", first) : NULL;
+	meta   = xml_node_get_child(root, "meta:data");
+	if (!first || !second || !meta) {
+		fprintf(stderr, "Unexpected arena test document structure\n");
+		xml_document_free(doc);
+		return 1;
+	}
+
+	/* the interned "item" name is shared by both nodes */
+	xml_node_set_name(first, "first");
+	xml_test_check(ni_string_eq(first->name, "first"), "set name");
+	xml_test_check(ni_string_eq(second->name, "item"), "shared name intact");
+
+	xml_node_set_name(meta, meta->name + 5);
+	xml_test_check(ni_string_eq(meta->name, "data"), "set name to own substring");
+
+	xml_node_set_cdata(first, first->cdata);
+	xml_test_check(ni_string_eq(first->cdata, "one"), "set cdata to own cdata");
+	xml_node_set_cdata(first, "uno");
+	xml_test_check(ni_string_eq(first->cdata, "uno"), "set cdata");
+	xml_node_set_uint(meta, 3);
+	xml_test_check(ni_string_eq(meta->cdata, "3"), "set uint cdata");
+
+	xml_node_add_attr(root, "c", "3");
+	xml_node_del_attr(root, "a");
+	xml_test_check(!xml_node_has_attr(root, "a") &&
+			ni_string_eq(xml_node_get_attr(root, "b"), "2") &&
+			ni_string_eq(xml_node_get_attr(root, "c"), "3"),
+			"modify attributes");
+
+	/* a detached node has to outlive the document and its arena */
+	xml_node_detach(second);
+	xml_document_free(doc);
+	xml_test_check(ni_string_eq(second->name, "item") &&
+			ni_string_eq(second->cdata, "two"), "detached node");
+	xml_node_set_name(second, NULL);
+	xml_node_free(second);
+
+	/* schema processing renames and reparents <meta:*> children */
+	doc = xml_document_from_string(xml_test_arena_schema, "arena-schema-test");
+	scope = ni_dbus_xml_init();
+	if (!doc || !scope) {
+		fprintf(stderr, "Error parsing arena test schema\n");
+		return 1;
+	}
+
+	xml_test_check(ni_xs_process_schema(xml_document_root(doc), scope) == 0,
+			"process schema");
+	type = ni_xs_scope_lookup(scope, "x");
+	xml_test_check(type && type->meta && xml_node_get_child(type->meta, "bar"),
+			"schema meta node");
+
+	xml_document_free(doc);
+	ni_xs_scope_free(scope);
+
+	if (xml_test_failed) {
+		fprintf(stderr, "%u arena test(s) failed\n", xml_test_failed);
+		return 1;
+	}
+	printf("arena tests passed\n");
+	return 0;
+}